@@ -28,6 +28,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef HOST_ILCORE_H
 #define HOST_ILCORE_H
 
+struct ILCS_CALLBACK_STATS_T; // see interface/vmcs_host/vcilcs.h
+struct OMX_TRANSACTIONTYPE;   // see interface/vmcs_host/khronos/IL/OMX_ILCS.h
+
 #ifdef WANT_OMX_NAME_MANGLE
 OMX_API OMX_ERRORTYPE OMX_APIENTRY host_OMX_Init(void);
 OMX_API OMX_ERRORTYPE OMX_APIENTRY host_OMX_Deinit(void);
@@ -58,6 +61,21 @@ OMX_API OMX_ERRORTYPE host_OMX_GetRolesOfComponent (
 OMX_ERRORTYPE host_OMX_GetDebugInformation (
    OMX_OUT    OMX_STRING debugInfo,
    OMX_INOUT  OMX_S32 *pLen);
+OMX_ERRORTYPE host_OMX_GetCallbackStats (
+   OMX_OUT    struct ILCS_CALLBACK_STATS_T *pStats);
+OMX_ERRORTYPE host_OMX_EmptyThisBuffers (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_IN     OMX_BUFFERHEADERTYPE **ppBuffers,
+   OMX_IN     OMX_U32 nCount,
+   OMX_OUT    OMX_ERRORTYPE *pErrors);
+OMX_ERRORTYPE host_OMX_FillThisBuffers (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_IN     OMX_BUFFERHEADERTYPE **ppBuffers,
+   OMX_IN     OMX_U32 nCount,
+   OMX_OUT    OMX_ERRORTYPE *pErrors);
+OMX_ERRORTYPE host_OMX_SendTransaction (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_INOUT  struct OMX_TRANSACTIONTYPE *pTransaction);
 
 #define OMX_Init host_OMX_Init
 #define OMX_Deinit host_OMX_Deinit
@@ -68,10 +86,29 @@ OMX_ERRORTYPE host_OMX_GetDebugInformation (
 #define OMX_GetComponentsOfRole host_OMX_GetComponentsOfRole
 #define OMX_GetRolesOfComponent host_OMX_GetRolesOfComponent
 #define OMX_GetDebugInformation host_OMX_GetDebugInformation
+#define OMX_GetCallbackStats host_OMX_GetCallbackStats
+#define OMX_EmptyThisBuffers host_OMX_EmptyThisBuffers
+#define OMX_FillThisBuffers host_OMX_FillThisBuffers
+#define OMX_SendTransaction host_OMX_SendTransaction
 #else
 OMX_ERRORTYPE OMX_GetDebugInformation (
    OMX_OUT    OMX_STRING debugInfo,
    OMX_INOUT  OMX_S32 *pLen);
+OMX_ERRORTYPE OMX_GetCallbackStats (
+   OMX_OUT    struct ILCS_CALLBACK_STATS_T *pStats);
+OMX_ERRORTYPE OMX_EmptyThisBuffers (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_IN     OMX_BUFFERHEADERTYPE **ppBuffers,
+   OMX_IN     OMX_U32 nCount,
+   OMX_OUT    OMX_ERRORTYPE *pErrors);
+OMX_ERRORTYPE OMX_FillThisBuffers (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_IN     OMX_BUFFERHEADERTYPE **ppBuffers,
+   OMX_IN     OMX_U32 nCount,
+   OMX_OUT    OMX_ERRORTYPE *pErrors);
+OMX_ERRORTYPE OMX_SendTransaction (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_INOUT  struct OMX_TRANSACTIONTYPE *pTransaction);
 #endif
 
 #endif // HOST_ILCORE_H
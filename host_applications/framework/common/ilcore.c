@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 #include "interface/vmcs_host/khronos/IL/OMX_Component.h"
+#include "interface/vmcs_host/khronos/IL/OMX_ILCS.h"
 #include "interface/vmcs_host/vcilcs.h"
 #include "interface/vmcs_host/vchost.h"
 #include "interface/vmcs_host/vcilcs_common.h"
@@ -51,6 +52,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OMX_GetComponentsOfRole host_OMX_GetComponentsOfRole
 #define OMX_ComponentNameEnum host_OMX_ComponentNameEnum
 #define OMX_GetDebugInformation host_OMX_GetDebugInformation
+#define OMX_EmptyThisBuffers host_OMX_EmptyThisBuffers
+#define OMX_FillThisBuffers host_OMX_FillThisBuffers
+#define OMX_GetCallbackStats host_OMX_GetCallbackStats
+#define OMX_SendTransaction host_OMX_SendTransaction
 #endif
 
 #ifdef WANT_LOCAL_OMX
@@ -117,6 +122,20 @@ OMX_ERRORTYPE OMX_APIENTRY OMX_Init(void)
          goto end;
       }
 
+      // allow the inline/bulk crossover for buffer data to be tuned
+      {
+         const char *inline_max = getenv("VC_ILCS_INLINE_MAX");
+         if(inline_max)
+            ilcs_set_inline_threshold(ilcs_service, atoi(inline_max));
+      }
+
+      // the GetParameter cache can be turned off with VC_ILCS_PARAM_CACHE=0
+      {
+         const char *param_cache = getenv("VC_ILCS_PARAM_CACHE");
+         if(param_cache && atoi(param_cache) == 0)
+            vcil_out_set_param_cache(ilcs_get_common(ilcs_service), 0);
+      }
+
       coreInit = 1;
    }
 #ifdef USE_VCHIQ_ARM
@@ -347,7 +366,45 @@ OMX_ERRORTYPE OMX_GetDebugInformation (
    return vcil_out_get_debug_information(ilcs_get_common(ilcs_service), debugInfo, pLen);
 }
 
+/* OMX_EmptyThisBuffers */
+OMX_ERRORTYPE OMX_EmptyThisBuffers (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_IN     OMX_BUFFERHEADERTYPE **ppBuffers,
+   OMX_IN     OMX_U32 nCount,
+   OMX_OUT    OMX_ERRORTYPE *pErrors)
+{
+   return vcil_out_pass_buffers(hComponent, IL_EMPTY_THIS_BUFFER, ppBuffers, nCount, pErrors);
+}
 
+/* OMX_FillThisBuffers */
+OMX_ERRORTYPE OMX_FillThisBuffers (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_IN     OMX_BUFFERHEADERTYPE **ppBuffers,
+   OMX_IN     OMX_U32 nCount,
+   OMX_OUT    OMX_ERRORTYPE *pErrors)
+{
+   return vcil_out_pass_buffers(hComponent, IL_FILL_THIS_BUFFER, ppBuffers, nCount, pErrors);
+}
 
-/* File EOF */
+/* OMX_GetCallbackStats */
+OMX_ERRORTYPE OMX_GetCallbackStats (
+   OMX_OUT    ILCS_CALLBACK_STATS_T *pStats)
+{
+   if(ilcs_service == NULL || pStats == NULL)
+      return OMX_ErrorBadParameter;
+
+   ilcs_get_callback_stats(ilcs_service, pStats);
+   return OMX_ErrorNone;
+}
 
+/* OMX_SendTransaction */
+OMX_ERRORTYPE OMX_SendTransaction (
+   OMX_IN     OMX_HANDLETYPE hComponent,
+   OMX_INOUT  OMX_TRANSACTIONTYPE *pTransaction)
+{
+   return vcil_out_transaction(hComponent, pTransaction);
+}
+
+
+
+/* File EOF */
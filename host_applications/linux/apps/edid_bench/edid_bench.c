@@ -0,0 +1,251 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Benchmark and fuzz harness for the host side EDID parser.
+ *
+ * edid_bench [-n iterations] [-f mutations] [-s seed] [edid files...]
+ *
+ * Each file (or, with no files, a built-in base block plus CEA extension)
+ * is parsed <iterations> times and the mean parse time reported. With -f,
+ * each input is also randomly mutated <mutations> times and every result
+ * checked against the limits in vc_edid_parser.h.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/vmcs_host/vc_edid_parser.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+#define EDID_BENCH_MAX_BLOCKS 8
+
+/* ---- Private Functions ------------------------------------------------ */
+
+static void set_checksum(uint8_t *block)
+{
+   uint8_t sum = 0;
+   int i;
+   for (i = 0; i < EDID_BLOCK_SIZE - 1; i++)
+      sum += block[i];
+   block[EDID_BLOCK_SIZE - 1] = (uint8_t)(0x100 - sum);
+}
+
+static void set_dtd(uint8_t *d, uint32_t clock_10khz, uint32_t ha, uint32_t hb, uint32_t va, uint32_t vb)
+{
+   d[0] = clock_10khz & 0xff;
+   d[1] = clock_10khz >> 8;
+   d[2] = ha & 0xff;
+   d[3] = hb & 0xff;
+   d[4] = ((ha >> 4) & 0xf0) | ((hb >> 8) & 0x0f);
+   d[5] = va & 0xff;
+   d[6] = vb & 0xff;
+   d[7] = ((va >> 4) & 0xf0) | ((vb >> 8) & 0x0f);
+   d[17] = 0x1e;
+}
+
+/* A 1080p HDMI sink with a handful of SVDs, SADs and an HDMI VSDB */
+static uint32_t default_edid(uint8_t *edid)
+{
+   static const uint8_t header[8] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+   static const uint8_t blocks[] = {
+      0x48, 0x10, 0x04, 0x05, 0x10, 0x1f, 0x20, 0x22, 0x21, /* video: 8 SVDs */
+      0x26, 0x09, 0x07, 0x07, 0x15, 0x07, 0x50,             /* audio: 2 SADs */
+      0x83, 0x01, 0x00, 0x00,                               /* speaker allocation */
+      0x67, 0x03, 0x0c, 0x00, 0x10, 0x00, 0xb8, 0x2d        /* HDMI VSDB */
+   };
+   uint8_t *base = edid, *cea = edid + EDID_BLOCK_SIZE;
+
+   memset(edid, 0, 2 * EDID_BLOCK_SIZE);
+   memcpy(base, header, sizeof(header));
+   base[0x08] = 0x10; base[0x09] = 0xac;   /* "DEL" */
+   base[0x12] = 1; base[0x13] = 3;
+   base[0x14] = 0x80;
+   base[0x15] = 53; base[0x16] = 30;
+   base[0x23] = 0x21; base[0x24] = 0x08;
+   memset(base + 0x26, 0x01, 16);
+   base[0x26] = 0xd1; base[0x27] = 0xc0;
+   set_dtd(base + 0x36, 14850, 1920, 280, 1080, 45);
+   base[0x48 + 3] = 0xfd;
+   base[0x48 + 5] = 56; base[0x48 + 6] = 76; base[0x48 + 7] = 31; base[0x48 + 8] = 83; base[0x48 + 9] = 15;
+   base[0x5a + 3] = 0xfc;
+   memcpy(base + 0x5a + 5, "BENCH\n       ", 13);
+   base[0x6c + 3] = 0x10;
+   base[0x7e] = 1;
+   set_checksum(base);
+
+   cea[0] = 0x02;
+   cea[1] = 0x03;
+   cea[2] = (uint8_t)(4 + sizeof(blocks));
+   cea[3] = 0xf1;
+   memcpy(cea + 4, blocks, sizeof(blocks));
+   set_dtd(cea + cea[2], 7425, 1280, 370, 720, 30);
+   set_checksum(cea);
+
+   return 2 * EDID_BLOCK_SIZE;
+}
+
+static uint32_t load_edid(const char *path, uint8_t *edid)
+{
+   FILE *fp = fopen(path, "rb");
+   size_t length;
+
+   if (!fp)
+   {
+      fprintf(stderr, "Can't open %s\n", path);
+      return 0;
+   }
+   length = fread(edid, 1, EDID_BENCH_MAX_BLOCKS * EDID_BLOCK_SIZE, fp);
+   fclose(fp);
+   return (uint32_t)length;
+}
+
+static int check_info(const EDID_INFO_T *info, uint32_t length)
+{
+   if (info->num_blocks > (length + EDID_BLOCK_SIZE - 1) / EDID_BLOCK_SIZE ||
+       info->num_standard_timings > EDID_MAX_STANDARD_TIMINGS ||
+       info->num_detailed_timings > EDID_MAX_DETAILED_TIMINGS ||
+       info->num_native_detailed_timings > info->num_detailed_timings ||
+       info->num_svds > EDID_MAX_SVDS ||
+       info->num_sads > EDID_MAX_SADS ||
+       memchr(info->monitor_name, 0, sizeof(info->monitor_name)) == NULL ||
+       info->manufacturer[3] != 0)
+      return -1;
+   return 0;
+}
+
+static void bench(const char *name, const uint8_t *edid, uint32_t length, uint32_t iterations)
+{
+   EDID_INFO_T info;
+   uint64_t start, elapsed;
+   uint32_t i;
+   int ret = 0;
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < iterations; i++)
+      ret |= vc_edid_parse(edid, length, &info);
+   elapsed = vcos_getmicrosecs64() - start;
+
+   printf("%s: %u bytes, %u blocks, flags 0x%x, %u dtds, %u svds, %u sads%s\n",
+          name, length, info.num_blocks, info.flags, info.num_detailed_timings,
+          info.num_svds, info.num_sads, ret ? " (not recognised)" : "");
+   printf("%s: %u parses in %llu us, %.3f us/parse\n",
+          name, iterations, (unsigned long long)elapsed,
+          iterations ? (double)elapsed / iterations : 0.0);
+}
+
+static int fuzz(const char *name, const uint8_t *edid, uint32_t length, uint32_t mutations)
+{
+   uint8_t buf[EDID_BENCH_MAX_BLOCKS * EDID_BLOCK_SIZE];
+   EDID_INFO_T info;
+   uint32_t i, failures = 0, recognised = 0;
+
+   for (i = 0; i < mutations; i++)
+   {
+      uint32_t len = length, n = 1 + rand() % 8, j;
+
+      memcpy(buf, edid, length);
+      for (j = 0; j < n; j++)
+         buf[rand() % length] ^= (uint8_t)(1 << (rand() % 8));
+      /* Sometimes fix up the checksums so mutations reach the decoders */
+      if (rand() & 1)
+         for (j = 0; j + EDID_BLOCK_SIZE <= length; j += EDID_BLOCK_SIZE)
+            set_checksum(buf + j);
+      /* And sometimes cut the data short */
+      if ((rand() & 7) == 0)
+         len = rand() % (length + 1);
+
+      if (vc_edid_parse(buf, len, &info) == 0)
+         recognised++;
+      if (check_info(&info, len) != 0)
+      {
+         if (failures++ == 0)
+            fprintf(stderr, "%s: mutation %u produced an out of range result\n", name, i);
+      }
+   }
+
+   printf("%s: %u mutations, %u recognised, %u failures\n", name, mutations, recognised, failures);
+   return failures ? -1 : 0;
+}
+
+static int run(const char *name, const uint8_t *edid, uint32_t length, uint32_t iterations, uint32_t mutations)
+{
+   bench(name, edid, length, iterations);
+   return mutations ? fuzz(name, edid, length, mutations) : 0;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   uint8_t edid[EDID_BENCH_MAX_BLOCKS * EDID_BLOCK_SIZE];
+   uint32_t iterations = 100000, mutations = 0, length;
+   unsigned int seed = 1;
+   int opt, ret = 0;
+
+   while ((opt = getopt(argc, argv, "n:f:s:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'n': iterations = strtoul(optarg, NULL, 0); break;
+      case 'f': mutations = strtoul(optarg, NULL, 0); break;
+      case 's': seed = strtoul(optarg, NULL, 0); break;
+      default:
+         fprintf(stderr, "Usage: %s [-n iterations] [-f mutations] [-s seed] [edid files...]\n", argv[0]);
+         return -1;
+      }
+   }
+
+   vcos_init();
+   srand(seed);
+
+   if (optind == argc)
+   {
+      length = default_edid(edid);
+      ret |= run("default", edid, length, iterations, mutations);
+   }
+   for (; optind < argc; optind++)
+   {
+      length = load_edid(argv[optind], edid);
+      if (length == 0)
+      {
+         ret = -1;
+         continue;
+      }
+      ret |= run(argv[optind], edid, length, iterations, mutations);
+   }
+
+   vcos_deinit();
+   return ret ? 1 : 0;
+}
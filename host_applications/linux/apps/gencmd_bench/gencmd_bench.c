@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Benchmarks for the general command service.
+ *
+ * gencmd_bench [-t threads] [-n commands] [-b batch] [command]
+ *    Monitoring throughput: <threads> threads share <commands> requests of
+ *    <command> (default "measure_temp"), sent one at a time with vc_gencmd or
+ *    <batch> at a time with vc_gencmd_batch.
+ *
+ * gencmd_bench -p [-n iterations] [response]
+ *    Response parsing: looks up every property of <response> (or a built-in
+ *    get_config style response) with vc_gencmd_string_property and with
+ *    vc_gencmd_parse_properties/vc_gencmd_find_property. Needs no VideoCore.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/vmcs_host/vc_vchi_gencmd.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+#define GENCMD_BENCH_MAX_THREADS 16
+#define GENCMD_BENCH_MAX_BATCH   16
+#define GENCMD_BENCH_RESPONSE    256
+#define GENCMD_BENCH_TEXT        1024
+#define GENCMD_BENCH_NAME        64
+
+typedef struct {
+   VCOS_THREAD_T thread;
+   const char   *command;
+   int           count;
+   int           batch;
+   int           failures;
+   uint64_t      max_latency;
+   char          responses[GENCMD_BENCH_MAX_BATCH][GENCMD_BENCH_RESPONSE];
+} GENCMD_BENCH_THREAD_T;
+
+static GENCMD_BENCH_THREAD_T threads[GENCMD_BENCH_MAX_THREADS];
+
+static const char default_response[] =
+   "arm_freq=1200 core_freq=400 sdram_freq=450 over_voltage=0 "
+   "disable_overscan=1 hdmi_group=1 hdmi_mode=16 hdmi_drive=2 "
+   "hdmi_force_hotplug=1 framebuffer_width=1920 framebuffer_height=1080 "
+   "gpu_mem=128 gpu_mem_256=64 gpu_mem_512=128 gpu_mem_1024=256 "
+   "temp_limit=85 force_turbo=0 initial_turbo=0 avoid_pwm_pll=0 "
+   "camera_auto_detect=1 display_auto_detect=1 dtoverlay=\"vc4-kms-v3d\"";
+
+/* ---- Private Functions ------------------------------------------------ */
+
+static void *throughput_thread(void *arg)
+{
+   GENCMD_BENCH_THREAD_T *t = (GENCMD_BENCH_THREAD_T *)arg;
+   const char *commands[GENCMD_BENCH_MAX_BATCH];
+   char *responses[GENCMD_BENCH_MAX_BATCH];
+   int i, n;
+
+   for (i = 0; i < t->batch; i++)
+   {
+      commands[i] = t->command;
+      responses[i] = t->responses[i];
+   }
+
+   for (i = 0; i < t->count; i += n)
+   {
+      uint64_t start = vcos_getmicrosecs64(), latency;
+      int ret;
+
+      n = t->count - i < t->batch ? t->count - i : t->batch;
+      if (t->batch == 1)
+         ret = vc_gencmd(responses[0], GENCMD_BENCH_RESPONSE, "%s", t->command);
+      else
+         ret = vc_gencmd_batch(n, commands, responses, GENCMD_BENCH_RESPONSE);
+
+      latency = vcos_getmicrosecs64() - start;
+      if (latency > t->max_latency)
+         t->max_latency = latency;
+      if (ret != 0)
+         t->failures += n;
+   }
+   return NULL;
+}
+
+static int throughput(const char *command, int num_threads, int count, int batch)
+{
+   uint64_t start, elapsed, max_latency = 0;
+   int i, started = 0, failures = 0;
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < num_threads; i++)
+   {
+      GENCMD_BENCH_THREAD_T *t = &threads[i];
+
+      t->command = command;
+      t->count = count / num_threads + (i < count % num_threads);
+      t->batch = batch;
+      if (vcos_thread_create(&t->thread, "gencmd_bench", NULL, throughput_thread, t) != VCOS_SUCCESS)
+         break;
+      started++;
+   }
+   for (i = 0; i < started; i++)
+   {
+      vcos_thread_join(&threads[i].thread, NULL);
+      failures += threads[i].failures;
+      if (threads[i].max_latency > max_latency)
+         max_latency = threads[i].max_latency;
+   }
+   elapsed = vcos_getmicrosecs64() - start;
+
+   if (started < num_threads)
+   {
+      printf("Failed to start thread %d\n", started);
+      return -1;
+   }
+
+   printf("%s: %d commands, %d threads, batch %d: %llu us, %.1f commands/s, max latency %llu us, %d failed\n",
+          command, count, num_threads, batch, (unsigned long long)elapsed,
+          elapsed ? count * 1000000.0 / elapsed : 0.0, (unsigned long long)max_latency, failures);
+   if (count > 0)
+      printf("last response: %s\n", threads[0].responses[0]);
+   return failures ? -1 : 0;
+}
+
+static int parsing(const char *response, int iterations)
+{
+   static VC_GENCMD_PROPERTIES_T properties;
+   char text[GENCMD_BENCH_TEXT];
+   char names[VC_GENCMD_MAX_PROPERTIES][GENCMD_BENCH_NAME];
+   char *value[2];
+   int length[2];
+   uint64_t start, linear, indexed;
+   int num_names, i, j, found = 0, mismatches = 0;
+
+   if (strlen(response) >= sizeof(text))
+   {
+      printf("Response too long\n");
+      return -1;
+   }
+   strcpy(text, response);
+
+   num_names = vc_gencmd_parse_properties(text, &properties);
+   for (j = 0; j < num_names; j++)
+   {
+      int n = properties.property[j].name_length;
+      if (n >= GENCMD_BENCH_NAME)
+         n = GENCMD_BENCH_NAME - 1;
+      memcpy(names[j], properties.property[j].name, n);
+      names[j][n] = 0;
+   }
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < iterations; i++)
+      for (j = 0; j < num_names; j++)
+         found += vc_gencmd_string_property(text, names[j], &value[0], &length[0]);
+   linear = vcos_getmicrosecs64() - start;
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < iterations; i++)
+   {
+      vc_gencmd_parse_properties(text, &properties);
+      for (j = 0; j < num_names; j++)
+         found += vc_gencmd_find_property(&properties, names[j], &value[1], &length[1]);
+   }
+   indexed = vcos_getmicrosecs64() - start;
+
+   for (j = 0; j < num_names; j++)
+   {
+      if (vc_gencmd_string_property(text, names[j], &value[0], &length[0]) !=
+          vc_gencmd_find_property(&properties, names[j], &value[1], &length[1]) ||
+          value[0] != value[1] || length[0] != length[1])
+      {
+         printf("Lookups disagree on %s\n", names[j]);
+         mismatches++;
+      }
+   }
+
+   printf("%d properties, %d iterations, %d found\n", num_names, iterations, found);
+   printf("vc_gencmd_string_property: %llu us, %.3f us/response\n",
+          (unsigned long long)linear, iterations ? (double)linear / iterations : 0.0);
+   printf("vc_gencmd_parse_properties+find: %llu us, %.3f us/response\n",
+          (unsigned long long)indexed, iterations ? (double)indexed / iterations : 0.0);
+   return mismatches ? -1 : 0;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   VCHI_INSTANCE_T vchi_instance;
+   VCHI_CONNECTION_T *vchi_connection;
+   int num_threads = 1, count = 1000, batch = 1, parse = 0;
+   int opt, ret;
+
+   while ((opt = getopt(argc, argv, "t:n:b:p")) != -1)
+   {
+      switch (opt)
+      {
+      case 't': num_threads = atoi(optarg); break;
+      case 'n': count = atoi(optarg); break;
+      case 'b': batch = atoi(optarg); break;
+      case 'p': parse = 1; break;
+      default:
+         printf("Usage: %s [-t threads] [-n commands] [-b batch] [command]\n"
+                "       %s -p [-n iterations] [response]\n", argv[0], argv[0]);
+         return -1;
+      }
+   }
+   if (num_threads < 1 || num_threads > GENCMD_BENCH_MAX_THREADS ||
+       batch < 1 || batch > GENCMD_BENCH_MAX_BATCH || count < 0)
+   {
+      printf("Up to %d threads and batches of up to %d\n", GENCMD_BENCH_MAX_THREADS, GENCMD_BENCH_MAX_BATCH);
+      return -1;
+   }
+
+   vcos_init();
+
+   if (parse)
+      return parsing(optind < argc ? argv[optind] : default_response, count) ? 1 : 0;
+
+   if (vchi_initialise(&vchi_instance) != 0)
+   {
+      printf("VCHI initialization failed\n");
+      return -1;
+   }
+
+   if (vchi_connect(NULL, 0, vchi_instance) != 0)
+   {
+      printf("VCHI connection failed\n");
+      return -1;
+   }
+
+   vc_vchi_gencmd_init(vchi_instance, &vchi_connection, 1);
+
+   ret = throughput(optind < argc ? argv[optind] : "measure_temp", num_threads, count, batch);
+
+   vc_gencmd_stop();
+
+   if (vchi_disconnect(vchi_instance) != 0)
+   {
+      printf("VCHI disconnect failed\n");
+      return -1;
+   }
+
+   return ret ? 1 : 0;
+}
@@ -0,0 +1,863 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Benchmarks for the OpenMAX IL client service (ILCS), run against the IL
+ * components on VideoCore.
+ *
+ * ilcs_bench [-t threads] [-n calls] [component]
+ *    GetParameter latency: <threads> threads each make <calls>
+ *    OMX_GetParameter calls for the first port definition of <component>
+ *    (default OMX.broadcom.video_render). The host parameter cache is turned
+ *    off so that every call is a round trip; with more threads than ILCS has
+ *    wait slots, callers queue for a free slot.
+ *
+ * ilcs_bench -b [-n buffers] [-s size[,size...]] [component]
+ *    Buffer throughput: sends <buffers> buffers of each size to the first
+ *    input port of <component> (default OMX.broadcom.null_sink) with
+ *    OMX_EmptyThisBuffer, keeping 8 (or the port minimum) in flight. Payloads
+ *    up to the ILCS inline limit are carried in the message and larger ones
+ *    by bulk transfer; set VC_ILCS_INLINE_MAX to move the crossover.
+ *
+ * ilcs_bench -p [-n rounds] [component]
+ *    Port negotiation: each round makes the GetParameter calls a client uses
+ *    to discover <component>'s ports: the port counts, every port definition,
+ *    every supported port format and the component role. Reports the first
+ *    round and the mean of the rest, and checks every round sees the same
+ *    results. Compare with VC_ILCS_PARAM_CACHE=0 to see what the host
+ *    parameter cache saves.
+ *
+ * ilcs_bench -u [-n rounds] [component]
+ *    Component bring-up: each round takes the first port of <component> from
+ *    OMX_StateLoaded to OMX_StateIdle twice, with the component allocating
+ *    the port's buffers, and back again. The first time the state change and
+ *    buffer allocations are separate calls, the second time they are sent
+ *    with one OMX_SendTransaction. Reports the mean time for each.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bcm_host.h"
+#include "interface/vcos/vcos.h"
+#include "interface/vmcs_host/khronos/IL/OMX_Broadcom.h"
+#include "interface/vmcs_host/khronos/IL/OMX_ILCS.h"
+#include "host_applications/framework/common/host_ilcore.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+#define ILCS_BENCH_MAX_THREADS 16
+#define ILCS_BENCH_MAX_PORTS   16
+#define ILCS_BENCH_MAX_BUFFERS 32
+#define ILCS_BENCH_MAX_SIZES   16
+#define ILCS_BENCH_MAX_DONE    16
+#define ILCS_BENCH_MAX_FORMATS 64
+#define ILCS_BENCH_BUFFERS     8
+#define ILCS_BENCH_TIMEOUT_MS  5000
+
+typedef struct {
+   OMX_HANDLETYPE        handle;
+   VCOS_MUTEX_T          lock;
+   VCOS_SEMAPHORE_T      event;      /* posted for each command completion or error */
+   OMX_ERRORTYPE         error;      /* first error event */
+   int                   num_done;   /* completions not yet waited for */
+   OMX_U32               done[ILCS_BENCH_MAX_DONE][2];
+   VCOS_SEMAPHORE_T      returned;   /* counts the buffers on the free list */
+   int                   num_free;
+   OMX_BUFFERHEADERTYPE *free[ILCS_BENCH_MAX_BUFFERS];
+   int                   num_buffers;
+   OMX_BUFFERHEADERTYPE *buffers[ILCS_BENCH_MAX_BUFFERS];
+   OMX_U32               port;       /* port the buffers are allocated on */
+   OMX_U32               buffer_count;
+   OMX_U32               buffer_size;
+} ILCS_BENCH_COMPONENT_T;
+
+typedef struct {
+   VCOS_THREAD_T  thread;
+   OMX_HANDLETYPE handle;
+   OMX_U32        port;
+   int            count;
+   int            failures;
+   uint64_t       total_latency;
+   uint64_t       max_latency;
+} ILCS_BENCH_THREAD_T;
+
+static ILCS_BENCH_THREAD_T threads[ILCS_BENCH_MAX_THREADS];
+
+static const OMX_INDEXTYPE port_init_index[] = {
+   OMX_IndexParamAudioInit, OMX_IndexParamImageInit,
+   OMX_IndexParamVideoInit, OMX_IndexParamOtherInit
+};
+
+static const struct {
+   OMX_PORTDOMAINTYPE domain;
+   OMX_INDEXTYPE      index;
+   OMX_U32            size;
+} port_format_index[] = {
+   { OMX_PortDomainAudio, OMX_IndexParamAudioPortFormat, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE) },
+   { OMX_PortDomainImage, OMX_IndexParamImagePortFormat, sizeof(OMX_IMAGE_PARAM_PORTFORMATTYPE) },
+   { OMX_PortDomainVideo, OMX_IndexParamVideoPortFormat, sizeof(OMX_VIDEO_PARAM_PORTFORMATTYPE) },
+   { OMX_PortDomainOther, OMX_IndexParamOtherPortFormat, sizeof(OMX_OTHER_PARAM_PORTFORMATTYPE) }
+};
+
+/* ---- Private Functions ------------------------------------------------ */
+
+#define ILCS_BENCH_INIT(s) \
+   (memset(&(s), 0, sizeof(s)), (s).nSize = sizeof(s), (s).nVersion.nVersion = OMX_VERSION)
+
+static OMX_ERRORTYPE event_handler(OMX_HANDLETYPE handle, OMX_PTR app_data, OMX_EVENTTYPE event,
+                                   OMX_U32 data1, OMX_U32 data2, OMX_PTR event_data)
+{
+   ILCS_BENCH_COMPONENT_T *comp = (ILCS_BENCH_COMPONENT_T *)app_data;
+
+   if (event != OMX_EventCmdComplete && event != OMX_EventError)
+      return OMX_ErrorNone;
+
+   vcos_mutex_lock(&comp->lock);
+   if (event == OMX_EventError)
+   {
+      if (comp->error == OMX_ErrorNone)
+         comp->error = (OMX_ERRORTYPE)data1;
+   }
+   else if (comp->num_done < ILCS_BENCH_MAX_DONE)
+   {
+      comp->done[comp->num_done][0] = data1;
+      comp->done[comp->num_done][1] = data2;
+      comp->num_done++;
+   }
+   vcos_mutex_unlock(&comp->lock);
+   vcos_semaphore_post(&comp->event);
+   return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE empty_buffer_done(OMX_HANDLETYPE handle, OMX_PTR app_data, OMX_BUFFERHEADERTYPE *buffer)
+{
+   ILCS_BENCH_COMPONENT_T *comp = (ILCS_BENCH_COMPONENT_T *)app_data;
+
+   vcos_mutex_lock(&comp->lock);
+   comp->free[comp->num_free++] = buffer;
+   vcos_mutex_unlock(&comp->lock);
+   vcos_semaphore_post(&comp->returned);
+   return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE fill_buffer_done(OMX_HANDLETYPE handle, OMX_PTR app_data, OMX_BUFFERHEADERTYPE *buffer)
+{
+   return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE callbacks = { event_handler, empty_buffer_done, fill_buffer_done };
+
+static OMX_ERRORTYPE component_create(ILCS_BENCH_COMPONENT_T *comp, const char *name)
+{
+   OMX_ERRORTYPE error;
+
+   memset(comp, 0, sizeof(*comp));
+   if (vcos_mutex_create(&comp->lock, "ilcs_bench") != VCOS_SUCCESS)
+      return OMX_ErrorInsufficientResources;
+   if (vcos_semaphore_create(&comp->event, "ilcs_bench event", 0) != VCOS_SUCCESS)
+   {
+      vcos_mutex_delete(&comp->lock);
+      return OMX_ErrorInsufficientResources;
+   }
+   if (vcos_semaphore_create(&comp->returned, "ilcs_bench returned", 0) != VCOS_SUCCESS)
+   {
+      vcos_semaphore_delete(&comp->event);
+      vcos_mutex_delete(&comp->lock);
+      return OMX_ErrorInsufficientResources;
+   }
+
+   error = OMX_GetHandle(&comp->handle, (OMX_STRING)name, comp, &callbacks);
+   if (error != OMX_ErrorNone)
+   {
+      vcos_semaphore_delete(&comp->returned);
+      vcos_semaphore_delete(&comp->event);
+      vcos_mutex_delete(&comp->lock);
+   }
+   return error;
+}
+
+static void component_destroy(ILCS_BENCH_COMPONENT_T *comp)
+{
+   OMX_FreeHandle(comp->handle);
+   vcos_semaphore_delete(&comp->returned);
+   vcos_semaphore_delete(&comp->event);
+   vcos_mutex_delete(&comp->lock);
+}
+
+/** Wait for the component to complete <command> on <data>, or report an error. */
+static OMX_ERRORTYPE wait_command(ILCS_BENCH_COMPONENT_T *comp, OMX_COMMANDTYPE command, OMX_U32 data)
+{
+   for (;;)
+   {
+      OMX_ERRORTYPE error;
+      int i, found = 0;
+
+      vcos_mutex_lock(&comp->lock);
+      error = comp->error;
+      for (i = 0; i < comp->num_done; i++)
+      {
+         if (comp->done[i][0] == (OMX_U32)command && comp->done[i][1] == data)
+         {
+            memmove(comp->done[i], comp->done[i + 1], (comp->num_done - i - 1) * sizeof(comp->done[0]));
+            comp->num_done--;
+            found = 1;
+            break;
+         }
+      }
+      vcos_mutex_unlock(&comp->lock);
+
+      if (error != OMX_ErrorNone)
+         return error;
+      if (found)
+         return OMX_ErrorNone;
+      if (vcos_semaphore_wait_timeout(&comp->event, ILCS_BENCH_TIMEOUT_MS) != VCOS_SUCCESS)
+         return OMX_ErrorTimeout;
+   }
+}
+
+/** List the ports of a component, returning how many were found. */
+static int get_ports(OMX_HANDLETYPE handle, OMX_U32 *ports, int max_ports)
+{
+   OMX_PORT_PARAM_TYPE param;
+   int num_ports = 0;
+   unsigned int i, j;
+
+   for (i = 0; i < vcos_countof(port_init_index); i++)
+   {
+      ILCS_BENCH_INIT(param);
+      if (OMX_GetParameter(handle, port_init_index[i], &param) != OMX_ErrorNone)
+         continue;
+      for (j = 0; j < param.nPorts && num_ports < max_ports; j++)
+         ports[num_ports++] = param.nStartPortNumber + j;
+   }
+   return num_ports;
+}
+
+/** Find the lowest numbered port of a component, or return -1 if it has none. */
+static int first_port(OMX_HANDLETYPE handle)
+{
+   OMX_U32 ports[ILCS_BENCH_MAX_PORTS];
+   int num_ports, first = -1, i;
+
+   num_ports = get_ports(handle, ports, ILCS_BENCH_MAX_PORTS);
+   for (i = 0; i < num_ports; i++)
+      if (first < 0 || ports[i] < (OMX_U32)first)
+         first = ports[i];
+   return first;
+}
+
+/** Find the lowest numbered input port of a component, or return -1 if it has none. */
+static int first_input_port(OMX_HANDLETYPE handle)
+{
+   OMX_U32 ports[ILCS_BENCH_MAX_PORTS];
+   OMX_PARAM_PORTDEFINITIONTYPE def;
+   int num_ports, first = -1, i;
+
+   num_ports = get_ports(handle, ports, ILCS_BENCH_MAX_PORTS);
+   for (i = 0; i < num_ports; i++)
+   {
+      ILCS_BENCH_INIT(def);
+      def.nPortIndex = ports[i];
+      if (OMX_GetParameter(handle, OMX_IndexParamPortDefinition, &def) == OMX_ErrorNone &&
+          def.eDir == OMX_DirInput && (first < 0 || ports[i] < (OMX_U32)first))
+         first = ports[i];
+   }
+   return first;
+}
+
+/** Disable every port but <port> and set it up for at least <count> buffers
+ * of at least <size> bytes. */
+static OMX_ERRORTYPE component_setup_port(ILCS_BENCH_COMPONENT_T *comp, OMX_U32 port, int count, OMX_U32 size)
+{
+   OMX_U32 ports[ILCS_BENCH_MAX_PORTS];
+   OMX_PARAM_PORTDEFINITIONTYPE def;
+   OMX_ERRORTYPE error;
+   int num_ports, i;
+
+   num_ports = get_ports(comp->handle, ports, ILCS_BENCH_MAX_PORTS);
+   for (i = 0; i < num_ports; i++)
+   {
+      if (ports[i] == port)
+         continue;
+      error = OMX_SendCommand(comp->handle, OMX_CommandPortDisable, ports[i], NULL);
+      if (error == OMX_ErrorNone)
+         error = wait_command(comp, OMX_CommandPortDisable, ports[i]);
+      if (error != OMX_ErrorNone)
+         return error;
+   }
+
+   ILCS_BENCH_INIT(def);
+   def.nPortIndex = port;
+   error = OMX_GetParameter(comp->handle, OMX_IndexParamPortDefinition, &def);
+   if (error != OMX_ErrorNone)
+      return error;
+   if (def.nBufferCountActual < (OMX_U32)count)
+      def.nBufferCountActual = count < (int)def.nBufferCountMin ? def.nBufferCountMin : (OMX_U32)count;
+   if (def.nBufferSize < size)
+      def.nBufferSize = size;
+   error = OMX_SetParameter(comp->handle, OMX_IndexParamPortDefinition, &def);
+   if (error == OMX_ErrorNone)
+      error = OMX_GetParameter(comp->handle, OMX_IndexParamPortDefinition, &def);
+   if (error != OMX_ErrorNone)
+      return error;
+   if (def.nBufferCountActual > ILCS_BENCH_MAX_BUFFERS || def.nBufferSize < size)
+      return OMX_ErrorBadParameter;
+
+   comp->port = port;
+   comp->buffer_count = def.nBufferCountActual;
+   comp->buffer_size = def.nBufferSize;
+   return OMX_ErrorNone;
+}
+
+static void add_buffer(ILCS_BENCH_COMPONENT_T *comp, OMX_BUFFERHEADERTYPE *buffer)
+{
+   comp->buffers[comp->num_buffers++] = buffer;
+   comp->free[comp->num_free++] = buffer;
+   vcos_semaphore_post(&comp->returned);
+}
+
+/** Move from OMX_StateLoaded to OMX_StateIdle, with the component allocating
+ * the buffers of the port set up by component_setup_port. The state change and
+ * allocations are separate calls, or one OMX_SendTransaction if <transaction>. */
+static OMX_ERRORTYPE component_idle(ILCS_BENCH_COMPONENT_T *comp, int transaction)
+{
+   OMX_ERRORTYPE error;
+   OMX_U32 i;
+
+   if (transaction)
+   {
+      OMX_TRANSACTION_BUFFERTYPE buffers[ILCS_BENCH_MAX_BUFFERS];
+      OMX_TRANSACTIONTYPE t;
+
+      memset(&t, 0, sizeof(t));
+      memset(buffers, 0, sizeof(buffers));
+      t.bSetState = OMX_TRUE;
+      t.eState = OMX_StateIdle;
+      t.nBuffers = comp->buffer_count;
+      t.pBuffers = buffers;
+      for (i = 0; i < comp->buffer_count; i++)
+      {
+         buffers[i].nPortIndex = comp->port;
+         buffers[i].nSizeBytes = comp->buffer_size;
+      }
+
+      error = OMX_SendTransaction(comp->handle, &t);
+      for (i = 0; i < comp->buffer_count; i++)
+         if (buffers[i].eError == OMX_ErrorNone && buffers[i].pBufferHdr)
+            add_buffer(comp, buffers[i].pBufferHdr);
+   }
+   else
+   {
+      error = OMX_SendCommand(comp->handle, OMX_CommandStateSet, OMX_StateIdle, NULL);
+      for (i = 0; error == OMX_ErrorNone && i < comp->buffer_count; i++)
+      {
+         OMX_BUFFERHEADERTYPE *buffer;
+
+         error = OMX_AllocateBuffer(comp->handle, &buffer, comp->port, NULL, comp->buffer_size);
+         if (error == OMX_ErrorNone)
+            add_buffer(comp, buffer);
+      }
+   }
+
+   if (error == OMX_ErrorNone)
+      error = wait_command(comp, OMX_CommandStateSet, OMX_StateIdle);
+   return error;
+}
+
+/** Set up <port> with component_setup_port and move to OMX_StateExecuting. */
+static OMX_ERRORTYPE component_start(ILCS_BENCH_COMPONENT_T *comp, OMX_U32 port, int count, OMX_U32 size)
+{
+   OMX_ERRORTYPE error;
+
+   error = component_setup_port(comp, port, count, size);
+   if (error == OMX_ErrorNone)
+      error = component_idle(comp, 0);
+   if (error == OMX_ErrorNone)
+      error = OMX_SendCommand(comp->handle, OMX_CommandStateSet, OMX_StateExecuting, NULL);
+   if (error == OMX_ErrorNone)
+      error = wait_command(comp, OMX_CommandStateSet, OMX_StateExecuting);
+   return error;
+}
+
+/** Return the component to OMX_StateLoaded and free its buffers. */
+static OMX_ERRORTYPE component_stop(ILCS_BENCH_COMPONENT_T *comp)
+{
+   OMX_STATETYPE state = OMX_StateInvalid;
+   OMX_ERRORTYPE error = OMX_ErrorNone;
+   int i;
+
+   OMX_GetState(comp->handle, &state);
+   if (state == OMX_StateExecuting)
+   {
+      error = OMX_SendCommand(comp->handle, OMX_CommandStateSet, OMX_StateIdle, NULL);
+      if (error == OMX_ErrorNone)
+         error = wait_command(comp, OMX_CommandStateSet, OMX_StateIdle);
+      if (error == OMX_ErrorNone)
+         state = OMX_StateIdle;
+   }
+   if (state == OMX_StateIdle)
+      error = OMX_SendCommand(comp->handle, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+
+   for (i = 0; i < comp->num_buffers; i++)
+      OMX_FreeBuffer(comp->handle, comp->port, comp->buffers[i]);
+   comp->num_buffers = 0;
+   comp->num_free = 0;
+   while (vcos_semaphore_trywait(&comp->returned) == VCOS_SUCCESS)
+      continue;
+
+   if (state == OMX_StateIdle && error == OMX_ErrorNone)
+      error = wait_command(comp, OMX_CommandStateSet, OMX_StateLoaded);
+   return error;
+}
+
+static void *get_thread(void *arg)
+{
+   ILCS_BENCH_THREAD_T *t = (ILCS_BENCH_THREAD_T *)arg;
+   OMX_PARAM_PORTDEFINITIONTYPE def;
+   int i;
+
+   for (i = 0; i < t->count; i++)
+   {
+      uint64_t start, latency;
+
+      ILCS_BENCH_INIT(def);
+      def.nPortIndex = t->port;
+      start = vcos_getmicrosecs64();
+      if (OMX_GetParameter(t->handle, OMX_IndexParamPortDefinition, &def) != OMX_ErrorNone ||
+          def.nPortIndex != t->port)
+         t->failures++;
+      latency = vcos_getmicrosecs64() - start;
+      t->total_latency += latency;
+      if (latency > t->max_latency)
+         t->max_latency = latency;
+   }
+   return NULL;
+}
+
+static int get_latency(OMX_HANDLETYPE handle, int num_threads, int count)
+{
+   uint64_t start, elapsed, total_latency = 0, max_latency = 0;
+   int i, port, started = 0, failures = 0;
+
+   port = first_port(handle);
+   if (port < 0)
+   {
+      printf("Component has no ports\n");
+      return -1;
+   }
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < num_threads; i++)
+   {
+      ILCS_BENCH_THREAD_T *t = &threads[i];
+
+      t->handle = handle;
+      t->port = port;
+      t->count = count;
+      if (vcos_thread_create(&t->thread, "ilcs_bench", NULL, get_thread, t) != VCOS_SUCCESS)
+         break;
+      started++;
+   }
+   for (i = 0; i < started; i++)
+   {
+      vcos_thread_join(&threads[i].thread, NULL);
+      failures += threads[i].failures;
+      total_latency += threads[i].total_latency;
+      if (threads[i].max_latency > max_latency)
+         max_latency = threads[i].max_latency;
+   }
+   elapsed = vcos_getmicrosecs64() - start;
+
+   if (started < num_threads)
+   {
+      printf("Failed to start thread %d\n", started);
+      return -1;
+   }
+
+   printf("GetParameter port %d: %d threads x %d calls: %llu us, %.1f calls/s, "
+          "mean latency %.1f us, max latency %llu us, %d failed\n",
+          port, num_threads, count, (unsigned long long)elapsed,
+          elapsed ? (double)num_threads * count * 1000000.0 / elapsed : 0.0,
+          count ? (double)total_latency / ((uint64_t)num_threads * count) : 0.0,
+          (unsigned long long)max_latency, failures);
+   return failures ? -1 : 0;
+}
+
+static int buffer_throughput(ILCS_BENCH_COMPONENT_T *comp, const OMX_U32 *sizes, int num_sizes, int count)
+{
+   const char *inline_max = getenv("VC_ILCS_INLINE_MAX");
+   OMX_U32 max_size = 0;
+   OMX_ERRORTYPE error;
+   int i, j, port, failures = 0;
+
+   port = first_input_port(comp->handle);
+   if (port < 0)
+   {
+      printf("Component has no input ports\n");
+      return -1;
+   }
+   for (i = 0; i < num_sizes; i++)
+      if (sizes[i] > max_size)
+         max_size = sizes[i];
+
+   error = component_start(comp, port, ILCS_BENCH_BUFFERS, max_size);
+   if (error != OMX_ErrorNone)
+   {
+      printf("Failed to start port %d: 0x%x\n", port, error);
+      component_stop(comp);
+      return -1;
+   }
+   for (i = 0; i < comp->num_buffers; i++)
+      memset(comp->buffers[i]->pBuffer, 0x5a, comp->buffers[i]->nAllocLen);
+
+   printf("Port %d, %d buffers, VC_ILCS_INLINE_MAX=%s\n", port, comp->num_buffers,
+          inline_max ? inline_max : "(default)");
+
+   for (i = 0; i < num_sizes; i++)
+   {
+      uint64_t start, elapsed;
+      int sent = 0, returned, size_failures = 0;
+
+      start = vcos_getmicrosecs64();
+      for (j = 0; j < count; j++)
+      {
+         OMX_BUFFERHEADERTYPE *buffer;
+
+         if (vcos_semaphore_wait_timeout(&comp->returned, ILCS_BENCH_TIMEOUT_MS) != VCOS_SUCCESS)
+         {
+            printf("Timed out waiting for a buffer to be returned\n");
+            size_failures++;
+            break;
+         }
+         vcos_mutex_lock(&comp->lock);
+         buffer = comp->free[--comp->num_free];
+         vcos_mutex_unlock(&comp->lock);
+
+         buffer->nOffset = 0;
+         buffer->nFilledLen = sizes[i];
+         buffer->nFlags = 0;
+         if (OMX_EmptyThisBuffer(comp->handle, buffer) != OMX_ErrorNone)
+         {
+            empty_buffer_done(comp->handle, comp, buffer);
+            size_failures++;
+            continue;
+         }
+         sent++;
+      }
+
+      // wait for every buffer to come back before stopping the clock
+      for (j = 0; j < comp->num_buffers; j++)
+      {
+         if (vcos_semaphore_wait_timeout(&comp->returned, ILCS_BENCH_TIMEOUT_MS) != VCOS_SUCCESS)
+         {
+            printf("Timed out waiting for the buffers to be returned\n");
+            size_failures++;
+            break;
+         }
+      }
+      elapsed = vcos_getmicrosecs64() - start;
+      for (returned = j; j > 0; j--)
+         vcos_semaphore_post(&comp->returned);
+
+      printf("%8u bytes: %d buffers, %llu us, %.1f buffers/s, %.2f MB/s, %d failed\n",
+             (unsigned)sizes[i], sent, (unsigned long long)elapsed,
+             elapsed ? sent * 1000000.0 / elapsed : 0.0,
+             elapsed ? (double)sent * sizes[i] / elapsed : 0.0, size_failures);
+      failures += size_failures;
+      if (returned < comp->num_buffers)
+         break;
+   }
+
+   error = component_stop(comp);
+   if (error != OMX_ErrorNone)
+   {
+      printf("Failed to stop port %d: 0x%x\n", port, error);
+      failures++;
+   }
+   return failures ? -1 : 0;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t size)
+{
+   const uint8_t *bytes = (const uint8_t *)data;
+
+   while (size--)
+      hash = (hash ^ *bytes++) * 16777619;
+   return hash;
+}
+
+/** Make the GetParameter calls of one port negotiation, returning a hash of
+ * the results and counting the calls made. */
+static uint32_t negotiate_ports(OMX_HANDLETYPE handle, int *calls)
+{
+   OMX_U32 ports[ILCS_BENCH_MAX_PORTS];
+   OMX_PARAM_PORTDEFINITIONTYPE def;
+   OMX_PARAM_COMPONENTROLETYPE role;
+   union {
+      OMX_AUDIO_PARAM_PORTFORMATTYPE audio;
+      OMX_IMAGE_PARAM_PORTFORMATTYPE image;
+      OMX_VIDEO_PARAM_PORTFORMATTYPE video;
+      OMX_OTHER_PARAM_PORTFORMATTYPE other;
+   } format;
+   uint32_t hash = 2166136261u;
+   int num_ports, i;
+   unsigned int j, k;
+
+   num_ports = get_ports(handle, ports, ILCS_BENCH_MAX_PORTS);
+   *calls += vcos_countof(port_init_index);
+   hash = hash_bytes(hash, ports, num_ports * sizeof(ports[0]));
+
+   for (i = 0; i < num_ports; i++)
+   {
+      ILCS_BENCH_INIT(def);
+      def.nPortIndex = ports[i];
+      (*calls)++;
+      if (OMX_GetParameter(handle, OMX_IndexParamPortDefinition, &def) != OMX_ErrorNone)
+         continue;
+      hash = hash_bytes(hash, &def, sizeof(def));
+
+      for (j = 0; j < vcos_countof(port_format_index); j++)
+      {
+         if (port_format_index[j].domain != def.eDomain)
+            continue;
+         for (k = 0; k < ILCS_BENCH_MAX_FORMATS; k++)
+         {
+            memset(&format, 0, sizeof(format));
+            format.video.nSize = port_format_index[j].size;
+            format.video.nVersion.nVersion = OMX_VERSION;
+            format.video.nPortIndex = ports[i];
+            format.video.nIndex = k;
+            (*calls)++;
+            if (OMX_GetParameter(handle, port_format_index[j].index, &format) != OMX_ErrorNone)
+               break;
+            hash = hash_bytes(hash, &format, port_format_index[j].size);
+         }
+      }
+   }
+
+   ILCS_BENCH_INIT(role);
+   (*calls)++;
+   if (OMX_GetParameter(handle, OMX_IndexParamStandardComponentRole, &role) == OMX_ErrorNone)
+      hash = hash_bytes(hash, &role, sizeof(role));
+   return hash;
+}
+
+static int negotiation(OMX_HANDLETYPE handle, int rounds)
+{
+   const char *param_cache = getenv("VC_ILCS_PARAM_CACHE");
+   uint64_t start, first = 0, rest = 0;
+   uint32_t expected = 0;
+   int i, calls = 0, mismatches = 0;
+
+   for (i = 0; i < rounds; i++)
+   {
+      uint64_t elapsed;
+      uint32_t hash;
+
+      calls = 0;
+      start = vcos_getmicrosecs64();
+      hash = negotiate_ports(handle, &calls);
+      elapsed = vcos_getmicrosecs64() - start;
+
+      if (i == 0)
+      {
+         first = elapsed;
+         expected = hash;
+      }
+      else
+      {
+         rest += elapsed;
+         mismatches += hash != expected;
+      }
+   }
+
+   printf("%d GetParameter calls per round, %d rounds, VC_ILCS_PARAM_CACHE=%s\n",
+          calls, rounds, param_cache ? param_cache : "(default)");
+   printf("first round: %llu us\n", (unsigned long long)first);
+   printf("later rounds: %.1f us/round, %.2f us/call, %d differed from the first\n",
+          rounds > 1 ? (double)rest / (rounds - 1) : 0.0,
+          rounds > 1 && calls ? (double)rest / ((uint64_t)(rounds - 1) * calls) : 0.0, mismatches);
+   return mismatches ? -1 : 0;
+}
+
+static int startup(ILCS_BENCH_COMPONENT_T *comp, int rounds)
+{
+   static const char * const method_names[2] = { "separate calls", "OMX_SendTransaction" };
+   uint64_t time[2] = { 0 };
+   OMX_ERRORTYPE error;
+   int i, method, port, failures = 0;
+
+   port = first_port(comp->handle);
+   if (port < 0)
+   {
+      printf("Component has no ports\n");
+      return -1;
+   }
+   error = component_setup_port(comp, port, 0, 0);
+   if (error != OMX_ErrorNone)
+   {
+      printf("Failed to set up port %d: 0x%x\n", port, error);
+      return -1;
+   }
+
+   for (i = 0; i < rounds; i++)
+   {
+      for (method = 0; method < 2; method++)
+      {
+         uint64_t start = vcos_getmicrosecs64();
+
+         error = component_idle(comp, method);
+         time[method] += vcos_getmicrosecs64() - start;
+         if (error != OMX_ErrorNone)
+         {
+            printf("%s: failed to reach OMX_StateIdle: 0x%x\n", method_names[method], error);
+            failures++;
+         }
+         error = component_stop(comp);
+         if (error != OMX_ErrorNone)
+         {
+            printf("Failed to return to OMX_StateLoaded: 0x%x\n", error);
+            return -1;
+         }
+      }
+   }
+
+   printf("Port %d, %u buffers of %u bytes, %d rounds\n", port,
+          (unsigned)comp->buffer_count, (unsigned)comp->buffer_size, rounds);
+   for (method = 0; method < 2; method++)
+      printf("%-20s %10.1f us to OMX_StateIdle\n", method_names[method],
+             rounds ? (double)time[method] / rounds : 0.0);
+   return failures ? -1 : 0;
+}
+
+static int parse_sizes(const char *arg, OMX_U32 *sizes)
+{
+   int num_sizes = 0;
+   char *end;
+
+   do
+   {
+      unsigned long size = strtoul(arg, &end, 0);
+      if (end == arg || size == 0 || num_sizes == ILCS_BENCH_MAX_SIZES)
+         return -1;
+      sizes[num_sizes++] = (OMX_U32)size;
+      arg = end + 1;
+   } while (*end == ',');
+
+   return *end ? -1 : num_sizes;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   static const OMX_U32 default_sizes[] = { 64, 256, 1024, 4096, 16384, 65536, 262144 };
+   const char *name = NULL;
+   ILCS_BENCH_COMPONENT_T comp;
+   OMX_U32 sizes[ILCS_BENCH_MAX_SIZES];
+   OMX_ERRORTYPE error;
+   int num_threads = 8, count = 1000, buffers = 0, ports = 0, bring_up = 0, num_sizes;
+   int opt, ret;
+
+   memcpy(sizes, default_sizes, sizeof(default_sizes));
+   num_sizes = vcos_countof(default_sizes);
+
+   while ((opt = getopt(argc, argv, "t:n:bs:pu")) != -1)
+   {
+      switch (opt)
+      {
+      case 't': num_threads = atoi(optarg); break;
+      case 'n': count = atoi(optarg); break;
+      case 'b': buffers = 1; break;
+      case 's': num_sizes = parse_sizes(optarg, sizes); break;
+      case 'p': ports = 1; break;
+      case 'u': bring_up = 1; break;
+      default:
+         printf("Usage: %s [-t threads] [-n calls] [component]\n"
+                "       %s -b [-n buffers] [-s size[,size...]] [component]\n"
+                "       %s -p [-n rounds] [component]\n"
+                "       %s -u [-n rounds] [component]\n", argv[0], argv[0], argv[0], argv[0]);
+         return -1;
+      }
+   }
+   if (num_threads < 1 || num_threads > ILCS_BENCH_MAX_THREADS || count < 0)
+   {
+      printf("Up to %d threads\n", ILCS_BENCH_MAX_THREADS);
+      return -1;
+   }
+   if (num_sizes < 0)
+   {
+      printf("Up to %d sizes, each at least 1 byte\n", ILCS_BENCH_MAX_SIZES);
+      return -1;
+   }
+   if (optind < argc)
+      name = argv[optind];
+   else
+      name = buffers ? "OMX.broadcom.null_sink" : "OMX.broadcom.video_render";
+
+   // every GetParameter has to reach VideoCore
+   if (!buffers && !ports && !bring_up)
+      setenv("VC_ILCS_PARAM_CACHE", "0", 1);
+
+   bcm_host_init();
+
+   error = OMX_Init();
+   if (error != OMX_ErrorNone)
+   {
+      printf("OMX_Init failed: 0x%x\n", error);
+      return -1;
+   }
+
+   error = component_create(&comp, name);
+   if (error != OMX_ErrorNone)
+   {
+      printf("Failed to create %s: 0x%x\n", name, error);
+      OMX_Deinit();
+      return -1;
+   }
+
+   if (buffers)
+      ret = buffer_throughput(&comp, sizes, num_sizes, count);
+   else if (ports)
+      ret = negotiation(comp.handle, count);
+   else if (bring_up)
+      ret = startup(&comp, count);
+   else
+      ret = get_latency(comp.handle, num_threads, count);
+
+   component_destroy(&comp);
+   OMX_Deinit();
+   bcm_host_deinit();
+
+   return ret ? 1 : 0;
+}
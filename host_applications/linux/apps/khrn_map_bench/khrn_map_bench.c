@@ -0,0 +1,308 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Churn benchmark for the Khronos client maps.
+ *
+ * khrn_map_bench [-n operations] [-k keys] [-s stride] [-r seed]
+ *
+ * Runs a random mix of lookups, inserts and deletes over <keys> keys spaced
+ * <stride> apart (like the pointers and handles the client maps are keyed
+ * on) against khrn_pointer_map and against the global image map layout,
+ * with an iterate-and-delete pass every so often. Every result is checked
+ * against a plain array, as are the global image references taken.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "interface/khronos/common/khrn_int_common.h"
+#include "interface/khronos/common/khrn_client_platform.h"
+#include "interface/khronos/common/khrn_client_pointermap.h"
+#include "khrn_map_bench.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+#define MAP_BENCH_ITERATE_PERIOD 100000 /* operations between iterate passes */
+
+typedef struct {
+   const char *name;
+   void *map;
+   bool (*insert)(void *map, uint32_t key, uint64_t value);
+   bool (*remove)(void *map, uint32_t key);
+   uint64_t (*lookup)(void *map, uint32_t key);
+   uint32_t (*count)(void *map);
+   void (*prune)(void *map);
+   uint32_t (*capacity)(void *map);
+} MAP_BENCH_OPS_T;
+
+static uint64_t *reference;
+static uint32_t num_keys, stride = 16;
+
+/* ---- Private Functions ------------------------------------------------ */
+
+/* xorshift, so that rand() does not dominate the timings */
+static uint32_t bench_random(uint32_t *state)
+{
+   uint32_t x = *state;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return *state = x;
+}
+
+static uint32_t bench_key(uint32_t i)
+{
+   return 0x10000 + i * stride;
+}
+
+static uint32_t bench_index(uint32_t key)
+{
+   return (key - 0x10000) / stride;
+}
+
+/* Values are never zero, the maps' "none" value */
+static uint64_t bench_value(uint32_t i, uint32_t generation)
+{
+   return ((uint64_t)generation << 32) | (i + 1);
+}
+
+/* Deletes every other entry, from inside the iterate callback */
+#define MAP_BENCH_PRUNE(prefix, MAP_T, VALUE_T)                                     \
+   static void prefix##_prune_callback(MAP_T *map, uint32_t key, VALUE_T value, void *data) \
+   {                                                                                \
+      if (bench_index(key) & 1) {                                                   \
+         prefix##_delete(map, key);                                                 \
+         reference[bench_index(key)] = 0;                                           \
+      }                                                                             \
+   }
+
+MAP_BENCH_PRUNE(khrn_pointer_map, KHRN_POINTER_MAP_T, void *)
+MAP_BENCH_PRUNE(khrn_bench_image_map, KHRN_BENCH_IMAGE_MAP_T, uint64_t)
+
+static bool pointer_insert(void *map, uint32_t key, uint64_t value)
+{
+   return khrn_pointer_map_insert((KHRN_POINTER_MAP_T *)map, key, (void *)(uintptr_t)value);
+}
+
+static bool pointer_remove(void *map, uint32_t key)
+{
+   return khrn_pointer_map_delete((KHRN_POINTER_MAP_T *)map, key);
+}
+
+static uint64_t pointer_lookup(void *map, uint32_t key)
+{
+   return (uintptr_t)khrn_pointer_map_lookup((KHRN_POINTER_MAP_T *)map, key);
+}
+
+static uint32_t pointer_count(void *map)
+{
+   return khrn_pointer_map_get_count((KHRN_POINTER_MAP_T *)map);
+}
+
+static void pointer_prune(void *map)
+{
+   khrn_pointer_map_iterate((KHRN_POINTER_MAP_T *)map, khrn_pointer_map_prune_callback, NULL);
+}
+
+static uint32_t pointer_capacity(void *map)
+{
+   return ((KHRN_POINTER_MAP_T *)map)->capacity;
+}
+
+static bool image_insert(void *map, uint32_t key, uint64_t value)
+{
+   return khrn_bench_image_map_insert((KHRN_BENCH_IMAGE_MAP_T *)map, key, value);
+}
+
+static bool image_remove(void *map, uint32_t key)
+{
+   return khrn_bench_image_map_delete((KHRN_BENCH_IMAGE_MAP_T *)map, key);
+}
+
+static uint64_t image_lookup(void *map, uint32_t key)
+{
+   return khrn_bench_image_map_lookup((KHRN_BENCH_IMAGE_MAP_T *)map, key);
+}
+
+static uint32_t image_count(void *map)
+{
+   return khrn_bench_image_map_get_count((KHRN_BENCH_IMAGE_MAP_T *)map);
+}
+
+static void image_prune(void *map)
+{
+   khrn_bench_image_map_iterate((KHRN_BENCH_IMAGE_MAP_T *)map, khrn_bench_image_map_prune_callback, NULL);
+}
+
+static uint32_t image_capacity(void *map)
+{
+   return ((KHRN_BENCH_IMAGE_MAP_T *)map)->capacity;
+}
+
+static int churn(const MAP_BENCH_OPS_T *ops, uint32_t operations, uint32_t seed)
+{
+   uint32_t live = 0, i, errors = 0, max_capacity = 0, state = seed ? seed : 1;
+   uint64_t start, elapsed;
+
+   memset(reference, 0, num_keys * sizeof(reference[0]));
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < operations; i++)
+   {
+      uint32_t r = bench_random(&state);
+      uint32_t index = (r >> 2) % num_keys, key = bench_key(index);
+      int op = r & 3;
+
+      if (op < 2)
+      {
+         if (ops->lookup(ops->map, key) != reference[index])
+            errors++;
+      }
+      else if (op == 2)
+      {
+         uint64_t value = bench_value(index, i);
+         if (!ops->insert(ops->map, key, value))
+            errors++;
+         else
+         {
+            live += reference[index] == 0;
+            reference[index] = value;
+         }
+      }
+      else
+      {
+         if (ops->remove(ops->map, key) != (reference[index] != 0))
+            errors++;
+         live -= reference[index] != 0;
+         reference[index] = 0;
+      }
+
+      if ((i + 1) % MAP_BENCH_ITERATE_PERIOD == 0)
+      {
+         uint32_t j;
+         ops->prune(ops->map);
+         for (live = 0, j = 0; j < num_keys; j++)
+            live += reference[j] != 0;
+         if (ops->capacity(ops->map) > max_capacity)
+            max_capacity = ops->capacity(ops->map);
+      }
+   }
+   elapsed = vcos_getmicrosecs64() - start;
+
+   /* Everything left must still be found, and nothing else */
+   for (i = 0; i < num_keys; i++)
+   {
+      if (ops->lookup(ops->map, bench_key(i)) != reference[i])
+         errors++;
+   }
+   if (ops->count(ops->map) != live)
+      errors++;
+   if (ops->capacity(ops->map) > max_capacity)
+      max_capacity = ops->capacity(ops->map);
+
+   printf("%-18s %u operations over %u keys, stride %u: %.1f ns/operation, %u live, capacity %u, %u errors\n",
+          ops->name, operations, num_keys, stride, operations ? elapsed * 1000.0 / operations : 0.0,
+          live, max_capacity, errors);
+   return errors ? -1 : 0;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+void *khrn_platform_malloc(size_t size, const char *desc)
+{
+   return malloc(size);
+}
+
+void khrn_platform_free(void *v)
+{
+   free(v);
+}
+
+int main(int argc, char **argv)
+{
+   KHRN_POINTER_MAP_T pointer_map;
+   KHRN_BENCH_IMAGE_MAP_T image_map;
+   MAP_BENCH_OPS_T maps[2] = {
+      { "khrn_pointer_map", &pointer_map, pointer_insert, pointer_remove, pointer_lookup,
+        pointer_count, pointer_prune, pointer_capacity },
+      { "global image map", &image_map, image_insert, image_remove, image_lookup,
+        image_count, image_prune, image_capacity }
+   };
+   uint32_t operations = 10000000;
+   uint32_t seed = 1;
+   int opt, ret = 0;
+
+   num_keys = 4096;
+   while ((opt = getopt(argc, argv, "n:k:s:r:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'n': operations = strtoul(optarg, NULL, 0); break;
+      case 'k': num_keys = strtoul(optarg, NULL, 0); break;
+      case 's': stride = strtoul(optarg, NULL, 0); break;
+      case 'r': seed = strtoul(optarg, NULL, 0); break;
+      default:
+         printf("Usage: %s [-n operations] [-k keys] [-s stride] [-r seed]\n", argv[0]);
+         return -1;
+      }
+   }
+   if (num_keys < 1 || stride < 1 || (uint64_t)num_keys * stride > 0x7fff0000)
+   {
+      printf("Keys times stride must fit in 31 bits\n");
+      return -1;
+   }
+
+   vcos_init();
+   reference = (uint64_t *)malloc(num_keys * sizeof(reference[0]));
+   if (!reference || !khrn_pointer_map_init(&pointer_map, 8) || !khrn_bench_image_map_init(&image_map, 8))
+   {
+      printf("Out of memory\n");
+      return -1;
+   }
+
+   ret |= churn(&maps[0], operations, seed);
+   ret |= churn(&maps[1], operations, seed);
+
+   khrn_pointer_map_term(&pointer_map);
+   khrn_bench_image_map_term(&image_map);
+   if (khrn_bench_image_acquires != khrn_bench_image_releases)
+   {
+      printf("global image references: %u taken, %u dropped\n",
+             khrn_bench_image_acquires, khrn_bench_image_releases);
+      ret = -1;
+   }
+
+   free(reference);
+   vcos_deinit();
+   return ret ? 1 : 0;
+}
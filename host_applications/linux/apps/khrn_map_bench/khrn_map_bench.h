@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * The global image map's instantiation of khrn_int_generic_map, with the
+ * platform global image calls replaced by counters so that the benchmark
+ * runs without VideoCore.
+ */
+
+#ifndef KHRN_MAP_BENCH_H
+#define KHRN_MAP_BENCH_H
+
+#define khrn_generic_map(X) khrn_bench_image_map_##X
+#define KHRN_GENERIC_MAP(X) KHRN_BENCH_IMAGE_MAP_##X
+#define KHRN_GENERIC_MAP_KEY_T uint32_t
+#define KHRN_GENERIC_MAP_VALUE_T uint64_t
+
+#ifdef KHRN_MAP_BENCH_IMAGE_MAP_C
+   #include "interface/khronos/common/khrn_int_generic_map.c"
+#else
+   #include "interface/khronos/common/khrn_int_generic_map.h"
+#endif
+
+#undef KHRN_GENERIC_MAP_VALUE_T
+#undef KHRN_GENERIC_MAP_KEY_T
+#undef KHRN_GENERIC_MAP
+#undef khrn_generic_map
+
+/* Global image references taken and dropped by the map */
+extern uint32_t khrn_bench_image_acquires;
+extern uint32_t khrn_bench_image_releases;
+
+#endif
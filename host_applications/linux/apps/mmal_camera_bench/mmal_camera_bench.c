@@ -0,0 +1,174 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Camera setup latency benchmark.
+ *
+ * mmal_camera_bench [-r rounds] [-g gets] [component]
+ *
+ * Each round creates the camera component (vc.ril.camera by default), sets
+ * a typical list of control port parameters one call at a time and then
+ * again with mmal_port_parameter_set_multi, reads MMAL_PARAMETER_CAMERA_INFO
+ * <gets> times and destroys the component. The mean time of each step is
+ * reported.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/util/mmal_util.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+typedef enum {
+   STEP_CREATE,
+   STEP_SET,
+   STEP_SET_MULTI,
+   STEP_GET_INFO,
+   STEP_DESTROY,
+   STEP_MAX
+} STEP_T;
+
+static const char *step_names[STEP_MAX] = {
+   "create", "set (one at a time)", "set_multi", "get CAMERA_INFO", "destroy"
+};
+
+/* ---- Private Functions ------------------------------------------------ */
+
+static MMAL_STATUS_T camera_setup(MMAL_PORT_T *port, int multi)
+{
+   MMAL_PARAMETER_AWBMODE_T awb = {{MMAL_PARAMETER_AWB_MODE, sizeof(awb)}, MMAL_PARAM_AWBMODE_AUTO};
+   MMAL_PARAMETER_EXPOSUREMODE_T exposure = {{MMAL_PARAMETER_EXPOSURE_MODE, sizeof(exposure)}, MMAL_PARAM_EXPOSUREMODE_AUTO};
+   MMAL_PARAMETER_EXPOSUREMETERINGMODE_T metering = {{MMAL_PARAMETER_EXP_METERING_MODE, sizeof(metering)}, MMAL_PARAM_EXPOSUREMETERINGMODE_AVERAGE};
+   MMAL_PARAMETER_INT32_T exposure_comp = {{MMAL_PARAMETER_EXPOSURE_COMP, sizeof(exposure_comp)}, 0};
+   MMAL_PARAMETER_IMAGEFX_T effect = {{MMAL_PARAMETER_IMAGE_EFFECT, sizeof(effect)}, MMAL_PARAM_IMAGEFX_NONE};
+   MMAL_PARAMETER_FLICKERAVOID_T flicker = {{MMAL_PARAMETER_FLICKER_AVOID, sizeof(flicker)}, MMAL_PARAM_FLICKERAVOID_AUTO};
+   MMAL_PARAMETER_BOOLEAN_T stabilisation = {{MMAL_PARAMETER_VIDEO_STABILISATION, sizeof(stabilisation)}, MMAL_FALSE};
+   MMAL_PARAMETER_BOOLEAN_T faces = {{MMAL_PARAMETER_DRAW_BOX_FACES_AND_FOCUS, sizeof(faces)}, MMAL_FALSE};
+   const MMAL_PARAMETER_HEADER_T * const params[] = {
+      &awb.hdr, &exposure.hdr, &metering.hdr, &exposure_comp.hdr,
+      &effect.hdr, &flicker.hdr, &stabilisation.hdr, &faces.hdr
+   };
+   MMAL_STATUS_T status = MMAL_SUCCESS, ret;
+   unsigned int i;
+
+   if (multi)
+      return mmal_port_parameter_set_multi(port, params, vcos_countof(params));
+
+   for (i = 0; i < vcos_countof(params); i++)
+   {
+      ret = mmal_port_parameter_set(port, params[i]);
+      if (status == MMAL_SUCCESS)
+         status = ret;
+   }
+   return status;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   const char *name = "vc.ril.camera";
+   uint64_t time[STEP_MAX] = { 0 };
+   unsigned long calls[STEP_MAX] = { 0 }, failures[STEP_MAX] = { 0 };
+   int rounds = 20, gets = 10;
+   int opt, round, i;
+
+   while ((opt = getopt(argc, argv, "r:g:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'r': rounds = atoi(optarg); break;
+      case 'g': gets = atoi(optarg); break;
+      default:
+         printf("Usage: %s [-r rounds] [-g gets] [component]\n", argv[0]);
+         return -1;
+      }
+   }
+   if (optind < argc)
+      name = argv[optind];
+
+   for (round = 0; round < rounds; round++)
+   {
+      MMAL_COMPONENT_T *camera;
+      MMAL_PARAMETER_CAMERA_INFO_T info;
+      MMAL_STATUS_T status;
+      uint64_t start;
+
+      start = vcos_getmicrosecs64();
+      status = mmal_component_create(name, &camera);
+      time[STEP_CREATE] += vcos_getmicrosecs64() - start;
+      calls[STEP_CREATE]++;
+      if (status != MMAL_SUCCESS)
+      {
+         printf("Failed to create %s: %s\n", name, mmal_status_to_string(status));
+         return 1;
+      }
+
+      start = vcos_getmicrosecs64();
+      status = camera_setup(camera->control, 0);
+      time[STEP_SET] += vcos_getmicrosecs64() - start;
+      calls[STEP_SET]++;
+      failures[STEP_SET] += status != MMAL_SUCCESS;
+
+      start = vcos_getmicrosecs64();
+      status = camera_setup(camera->control, 1);
+      time[STEP_SET_MULTI] += vcos_getmicrosecs64() - start;
+      calls[STEP_SET_MULTI]++;
+      failures[STEP_SET_MULTI] += status != MMAL_SUCCESS;
+
+      for (i = 0; i < gets; i++)
+      {
+         info.hdr.id = MMAL_PARAMETER_CAMERA_INFO;
+         info.hdr.size = sizeof(info);
+         start = vcos_getmicrosecs64();
+         status = mmal_port_parameter_get(camera->control, &info.hdr);
+         time[STEP_GET_INFO] += vcos_getmicrosecs64() - start;
+         calls[STEP_GET_INFO]++;
+         failures[STEP_GET_INFO] += status != MMAL_SUCCESS;
+      }
+
+      start = vcos_getmicrosecs64();
+      status = mmal_component_destroy(camera);
+      time[STEP_DESTROY] += vcos_getmicrosecs64() - start;
+      calls[STEP_DESTROY]++;
+      failures[STEP_DESTROY] += status != MMAL_SUCCESS;
+   }
+
+   printf("%s, %d rounds\n", name, rounds);
+   for (i = 0; i < STEP_MAX; i++)
+      printf("%-20s %6lu calls, %10.1f us/call, %lu failed\n", step_names[i], calls[i],
+             calls[i] ? (double)time[i] / calls[i] : 0.0, failures[i]);
+
+   return 0;
+}
@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Benchmark for the MMAL/OMX IL conversion utilities.
+ *
+ * mmal_il_bench [-n iterations]
+ *
+ * Times the per-buffer header conversions (mmalil_buffer_header_to_omx and
+ * mmalil_buffer_header_to_mmal) and the colour format and video coding
+ * lookups, and checks that buffers and known encodings survive a round trip.
+ * Needs no VideoCore.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/util/mmal_il.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+/* Lookup keys cover the standard range, plus a few vendor values so that
+ * misses are timed too */
+#define IL_BENCH_STANDARD_KEYS 64
+#define IL_BENCH_VENDOR_KEYS   64
+#define IL_BENCH_KEYS          (IL_BENCH_STANDARD_KEYS + IL_BENCH_VENDOR_KEYS)
+
+/* Keeps the compiler from dropping the timed lookups */
+static volatile uint32_t il_bench_sink;
+static uint8_t il_bench_data[65536];
+
+/* ---- Private Functions ------------------------------------------------ */
+
+static uint32_t il_bench_key(uint32_t i)
+{
+   return i < IL_BENCH_STANDARD_KEYS ? i : 0x7F000000 + i - IL_BENCH_STANDARD_KEYS;
+}
+
+static void report(const char *name, unsigned long calls, uint64_t elapsed)
+{
+   printf("%-28s %10lu calls, %8.2f ns/call\n", name, calls,
+          calls ? elapsed * 1000.0 / calls : 0.0);
+}
+
+static int bench_buffer_headers(int iterations)
+{
+   MMAL_BUFFER_HEADER_T mmal, back;
+   OMX_BUFFERHEADERTYPE omx;
+   uint32_t mapped;
+   uint64_t start, elapsed;
+   int i, mismatches = 0;
+
+   /* The MMAL flags that have an OMX equivalent */
+   mapped = mmalil_buffer_flags_to_mmal(mmalil_buffer_flags_to_omx(~0u));
+
+   memset(&mmal, 0, sizeof(mmal));
+   memset(&back, 0, sizeof(back));
+   memset(&omx, 0, sizeof(omx));
+   mmal.data = il_bench_data;
+   mmal.alloc_size = sizeof(il_bench_data);
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < iterations; i++)
+   {
+      mmal.length = i & 0xffff;
+      mmal.offset = i & 0xff;
+      mmal.flags = i & mapped;
+      mmal.pts = (i & 0xff) ? (int64_t)i * 1000 : MMAL_TIME_UNKNOWN;
+
+      mmalil_buffer_header_to_omx(&omx, &mmal);
+      mmalil_buffer_header_to_mmal(&back, &omx);
+
+      if (back.data != mmal.data || back.alloc_size != mmal.alloc_size ||
+          back.length != mmal.length || back.offset != mmal.offset ||
+          back.flags != mmal.flags || back.pts != mmal.pts)
+         mismatches++;
+   }
+   elapsed = vcos_getmicrosecs64() - start;
+
+   report("buffer header round trip", (unsigned long)iterations, elapsed);
+   if (mismatches)
+      printf("%d buffer headers changed in the round trip\n", mismatches);
+   return mismatches;
+}
+
+static int bench_color_formats(int iterations)
+{
+   uint64_t start, elapsed;
+   uint32_t sum = 0;
+   int i, j, mismatches = 0;
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < iterations; i++)
+   {
+      for (j = 0; j < IL_BENCH_KEYS; j++)
+      {
+         uint32_t encoding = mmalil_omx_color_format_to_encoding((OMX_COLOR_FORMATTYPE)il_bench_key(j));
+         sum += mmalil_encoding_to_omx_color_format(encoding);
+      }
+   }
+   elapsed = vcos_getmicrosecs64() - start;
+   il_bench_sink = sum;
+   report("colour format lookups", (unsigned long)iterations * IL_BENCH_KEYS * 2, elapsed);
+
+   /* The first table row for an encoding wins, so check encoding -> OMX -> encoding */
+   for (j = 0; j < IL_BENCH_KEYS; j++)
+   {
+      uint32_t encoding = mmalil_omx_color_format_to_encoding((OMX_COLOR_FORMATTYPE)il_bench_key(j));
+      if (encoding != MMAL_ENCODING_UNKNOWN &&
+          mmalil_omx_color_format_to_encoding(mmalil_encoding_to_omx_color_format(encoding)) != encoding)
+      {
+         printf("colour format %u does not round trip\n", il_bench_key(j));
+         mismatches++;
+      }
+   }
+   return mismatches;
+}
+
+static int bench_video_codings(int iterations)
+{
+   uint64_t start, elapsed;
+   uint32_t sum = 0;
+   int i, j, mismatches = 0;
+
+   start = vcos_getmicrosecs64();
+   for (i = 0; i < iterations; i++)
+   {
+      for (j = 0; j < IL_BENCH_KEYS; j++)
+      {
+         uint32_t encoding = mmalil_omx_video_coding_to_encoding((OMX_VIDEO_CODINGTYPE)il_bench_key(j));
+         sum += mmalil_encoding_to_omx_video_coding(encoding);
+      }
+   }
+   elapsed = vcos_getmicrosecs64() - start;
+   il_bench_sink = sum;
+   report("video coding lookups", (unsigned long)iterations * IL_BENCH_KEYS * 2, elapsed);
+
+   for (j = 0; j < IL_BENCH_KEYS; j++)
+   {
+      uint32_t encoding = mmalil_omx_video_coding_to_encoding((OMX_VIDEO_CODINGTYPE)il_bench_key(j));
+      if (encoding != MMAL_ENCODING_UNKNOWN &&
+          mmalil_omx_video_coding_to_encoding(mmalil_encoding_to_omx_video_coding(encoding)) != encoding)
+      {
+         printf("video coding %u does not round trip\n", il_bench_key(j));
+         mismatches++;
+      }
+   }
+   return mismatches;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   int iterations = 1000000, opt, failures = 0;
+
+   while ((opt = getopt(argc, argv, "n:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'n': iterations = atoi(optarg); break;
+      default:
+         printf("Usage: %s [-n iterations]\n", argv[0]);
+         return -1;
+      }
+   }
+
+   vcos_init();
+
+   failures += bench_buffer_headers(iterations);
+   failures += bench_color_formats(iterations / IL_BENCH_KEYS);
+   failures += bench_video_codings(iterations / IL_BENCH_KEYS);
+
+   vcos_deinit();
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Opaque image allocation benchmark.
+ *
+ * mmal_opaque_bench [-n images] [-r rounds] [-a acquires]
+ *
+ * Each round allocates <images> opaque images as a pool would, takes and
+ * drops <acquires> extra references on each, then releases them all. The
+ * time per call and the number of commands VideoCore executed for each
+ * phase are reported.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/vc/mmal_vc_api.h"
+#include "interface/mmal/vc/mmal_vc_opaque_alloc.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+#define OPAQUE_BENCH_MAX_IMAGES 1024
+
+typedef enum {
+   PHASE_ALLOC,
+   PHASE_ACQUIRE,
+   PHASE_RELEASE,
+   PHASE_MAX
+} PHASE_T;
+
+static const char *phase_names[PHASE_MAX] = { "alloc", "acquire+release", "release" };
+
+static MMAL_OPAQUE_IMAGE_HANDLE_T handles[OPAQUE_BENCH_MAX_IMAGES];
+
+/* ---- Private Functions ------------------------------------------------ */
+
+static uint32_t commands_executed(void)
+{
+   MMAL_VC_STATS_T stats;
+
+   if (mmal_vc_get_stats(&stats, 0) != MMAL_SUCCESS)
+      return 0;
+   return stats.commands.executed;
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   uint64_t time[PHASE_MAX] = { 0 };
+   uint32_t commands[PHASE_MAX] = { 0 };
+   unsigned long calls[PHASE_MAX] = { 0 };
+   int images = 64, rounds = 100, acquires = 1;
+   uint32_t overhead;
+   int opt, round, i, j, failures = 0;
+
+   while ((opt = getopt(argc, argv, "n:r:a:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'n': images = atoi(optarg); break;
+      case 'r': rounds = atoi(optarg); break;
+      case 'a': acquires = atoi(optarg); break;
+      default:
+         printf("Usage: %s [-n images] [-r rounds] [-a acquires]\n", argv[0]);
+         return -1;
+      }
+   }
+   if (images < 1 || images > OPAQUE_BENCH_MAX_IMAGES || rounds < 0 || acquires < 0)
+   {
+      printf("Between 1 and %d images\n", OPAQUE_BENCH_MAX_IMAGES);
+      return -1;
+   }
+
+   vcos_init();
+   if (mmal_vc_init() != MMAL_SUCCESS)
+   {
+      printf("Failed to open the MMAL service\n");
+      return -1;
+   }
+
+   /* Reading the stats may itself count as a command */
+   overhead = commands_executed();
+   overhead = commands_executed() - overhead;
+
+   for (round = 0; round < rounds; round++)
+   {
+      uint64_t start;
+      uint32_t executed;
+
+      executed = commands_executed();
+      start = vcos_getmicrosecs64();
+      for (i = 0; i < images; i++)
+      {
+         handles[i] = mmal_vc_opaque_alloc();
+         if (!handles[i])
+            failures++;
+      }
+      time[PHASE_ALLOC] += vcos_getmicrosecs64() - start;
+      commands[PHASE_ALLOC] += commands_executed() - executed - overhead;
+      calls[PHASE_ALLOC] += images;
+
+      executed = commands_executed();
+      start = vcos_getmicrosecs64();
+      for (i = 0; i < images; i++)
+      {
+         if (!handles[i])
+            continue;
+         for (j = 0; j < acquires; j++)
+         {
+            if (mmal_vc_opaque_acquire(handles[i]) != MMAL_SUCCESS ||
+                mmal_vc_opaque_release(handles[i]) != MMAL_SUCCESS)
+               failures++;
+         }
+      }
+      time[PHASE_ACQUIRE] += vcos_getmicrosecs64() - start;
+      commands[PHASE_ACQUIRE] += commands_executed() - executed - overhead;
+      calls[PHASE_ACQUIRE] += (unsigned long)images * acquires;
+
+      executed = commands_executed();
+      start = vcos_getmicrosecs64();
+      for (i = 0; i < images; i++)
+      {
+         if (handles[i] && mmal_vc_opaque_release(handles[i]) != MMAL_SUCCESS)
+            failures++;
+      }
+      time[PHASE_RELEASE] += vcos_getmicrosecs64() - start;
+      commands[PHASE_RELEASE] += commands_executed() - executed - overhead;
+      calls[PHASE_RELEASE] += images;
+   }
+
+   printf("%d images, %d rounds, %d acquires per image\n", images, rounds, acquires);
+   for (i = 0; i < PHASE_MAX; i++)
+   {
+      printf("%-16s %8lu calls, %.3f us/call, %.3f VideoCore commands/call\n",
+             phase_names[i], calls[i],
+             calls[i] ? (double)time[i] / calls[i] : 0.0,
+             calls[i] ? (double)commands[i] / calls[i] : 0.0);
+   }
+   printf("%d failures\n", failures);
+
+   mmal_vc_deinit();
+   return failures ? 1 : 0;
+}
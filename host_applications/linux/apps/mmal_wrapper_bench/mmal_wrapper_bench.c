@@ -0,0 +1,314 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Component wrapper wait benchmark.
+ *
+ * mmal_wrapper_bench [-w wrappers] [-n buffers] [-p] [component]
+ *
+ * Creates <wrappers> wrappers around <component> (vc.null_sink by default),
+ * enables the first input port of each and sends <buffers> buffers through
+ * every wrapper, resending each buffer as soon as the component returns it.
+ * By default each wrapper has its own thread, which waits for its port with
+ * mmal_wrapper_buffer_get_empty_timeout. With -p one thread services all the
+ * wrappers, waiting on their event descriptors with poll. Reports the
+ * buffer rate, the number of waits that timed out and, with -p, the poll
+ * wakeups per buffer.
+ */
+
+/* ---- Include Files ---------------------------------------------------- */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/util/mmal_util.h"
+#include "interface/mmal/util/mmal_component_wrapper.h"
+
+/* ---- Private Constants and Types -------------------------------------- */
+
+#define WRAPPER_BENCH_MAX_WRAPPERS 16
+#define WRAPPER_BENCH_TIMEOUT_MS   1000
+
+typedef struct {
+   VCOS_THREAD_T   thread;
+   MMAL_WRAPPER_T *wrapper;
+   MMAL_PORT_T    *port;
+   int             count;     /* buffers to send */
+   int             sent;
+   int             timeouts;
+   int             failures;
+} WRAPPER_BENCH_T;
+
+static WRAPPER_BENCH_T wrappers[WRAPPER_BENCH_MAX_WRAPPERS];
+
+/* ---- Private Functions ------------------------------------------------ */
+
+static void send_buffer(WRAPPER_BENCH_T *w, MMAL_BUFFER_HEADER_T *buffer)
+{
+   buffer->offset = 0;
+   buffer->length = buffer->alloc_size;
+   buffer->flags = 0;
+   if (mmal_port_send_buffer(w->port, buffer) != MMAL_SUCCESS)
+   {
+      mmal_buffer_header_release(buffer);
+      w->failures++;
+      return;
+   }
+   w->sent++;
+}
+
+static void *wait_thread(void *arg)
+{
+   WRAPPER_BENCH_T *w = (WRAPPER_BENCH_T *)arg;
+
+   while (w->sent < w->count && !w->failures)
+   {
+      MMAL_BUFFER_HEADER_T *buffer;
+      MMAL_STATUS_T status;
+
+      status = mmal_wrapper_buffer_get_empty_timeout(w->port, &buffer, MMAL_WRAPPER_FLAG_WAIT,
+                                                     WRAPPER_BENCH_TIMEOUT_MS);
+      if (status == MMAL_EAGAIN)
+      {
+         w->timeouts++;
+         break;
+      }
+      if (status != MMAL_SUCCESS)
+      {
+         w->failures++;
+         break;
+      }
+      send_buffer(w, buffer);
+   }
+   return NULL;
+}
+
+/** Send buffers on every wrapper from one thread, waiting with poll.
+ * Returns the number of wakeups, or -1 if the event descriptors are not
+ * available. */
+static int poll_loop(int num_wrappers)
+{
+   struct pollfd fds[WRAPPER_BENCH_MAX_WRAPPERS];
+   int i, active = num_wrappers, wakeups = 0;
+
+   for (i = 0; i < num_wrappers; i++)
+   {
+      fds[i].fd = mmal_wrapper_event_fd(wrappers[i].wrapper);
+      fds[i].events = POLLIN;
+      fds[i].revents = POLLIN; /* the pools start full */
+      if (fds[i].fd < 0)
+         return -1;
+   }
+
+   for (;;)
+   {
+      for (i = 0; i < num_wrappers; i++)
+      {
+         WRAPPER_BENCH_T *w = &wrappers[i];
+         MMAL_BUFFER_HEADER_T *buffer;
+         uint64_t value;
+         ssize_t ret;
+
+         if (!(fds[i].revents & POLLIN))
+            continue;
+         /* reset the descriptor; it may not be signalled yet on the first pass */
+         ret = read(fds[i].fd, &value, sizeof(value));
+         MMAL_PARAM_UNUSED(ret);
+
+         while (w->sent < w->count && !w->failures &&
+                mmal_wrapper_buffer_get_empty(w->port, &buffer, 0) == MMAL_SUCCESS)
+            send_buffer(w, buffer);
+
+         if (w->sent == w->count || w->failures)
+         {
+            fds[i].fd = -1;
+            active--;
+         }
+      }
+      if (!active)
+         break;
+
+      i = poll(fds, num_wrappers, WRAPPER_BENCH_TIMEOUT_MS);
+      if (i <= 0)
+      {
+         for (i = 0; i < num_wrappers; i++)
+            if (fds[i].fd >= 0)
+               wrappers[i].timeouts++;
+         break;
+      }
+      wakeups++;
+   }
+   return wakeups;
+}
+
+/** Wait for the component to return every buffer in the pool. */
+static void wait_for_buffers(WRAPPER_BENCH_T *w)
+{
+   MMAL_POOL_T *pool = w->wrapper->input_pool[w->port->index];
+   MMAL_BUFFER_HEADER_T *buffers[64];
+   unsigned int i, n = 0;
+
+   while (n < pool->headers_num && n < vcos_countof(buffers))
+   {
+      if (mmal_wrapper_buffer_get_empty_timeout(w->port, &buffers[n], MMAL_WRAPPER_FLAG_WAIT,
+                                                WRAPPER_BENCH_TIMEOUT_MS) != MMAL_SUCCESS)
+      {
+         w->timeouts++;
+         break;
+      }
+      n++;
+   }
+   for (i = 0; i < n; i++)
+      mmal_buffer_header_release(buffers[i]);
+}
+
+/* ---- Public Functions ------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+   const char *name = "vc.null_sink";
+   uint64_t start, elapsed;
+   int num_wrappers = 1, count = 10000, use_poll = 0, created = 0, started = 0;
+   int wakeups = 0, sent = 0, timeouts = 0, failures = 0;
+   int opt, i;
+
+   while ((opt = getopt(argc, argv, "w:n:p")) != -1)
+   {
+      switch (opt)
+      {
+      case 'w': num_wrappers = atoi(optarg); break;
+      case 'n': count = atoi(optarg); break;
+      case 'p': use_poll = 1; break;
+      default:
+         printf("Usage: %s [-w wrappers] [-n buffers] [-p] [component]\n", argv[0]);
+         return -1;
+      }
+   }
+   if (num_wrappers < 1 || num_wrappers > WRAPPER_BENCH_MAX_WRAPPERS || count < 0)
+   {
+      printf("Up to %d wrappers\n", WRAPPER_BENCH_MAX_WRAPPERS);
+      return -1;
+   }
+   if (optind < argc)
+      name = argv[optind];
+
+   vcos_init();
+
+   for (i = 0; i < num_wrappers; i++)
+   {
+      WRAPPER_BENCH_T *w = &wrappers[i];
+      MMAL_STATUS_T status;
+
+      status = mmal_wrapper_create(&w->wrapper, name);
+      if (status != MMAL_SUCCESS)
+      {
+         printf("Failed to create %s: %s\n", name, mmal_status_to_string(status));
+         break;
+      }
+      created++;
+      if (!w->wrapper->input_num)
+      {
+         printf("%s has no input port\n", name);
+         break;
+      }
+
+      w->port = w->wrapper->input[0];
+      w->count = count;
+      if (w->port->buffer_num < w->port->buffer_num_recommended)
+         w->port->buffer_num = w->port->buffer_num_recommended;
+      if (w->port->buffer_size < w->port->buffer_size_recommended)
+         w->port->buffer_size = w->port->buffer_size_recommended;
+      status = mmal_wrapper_port_enable(w->port, MMAL_WRAPPER_FLAG_PAYLOAD_ALLOCATE);
+      if (status != MMAL_SUCCESS)
+      {
+         printf("Failed to enable %s: %s\n", w->port->name, mmal_status_to_string(status));
+         break;
+      }
+      started++;
+   }
+
+   if (started == num_wrappers)
+   {
+      start = vcos_getmicrosecs64();
+      if (use_poll)
+      {
+         wakeups = poll_loop(num_wrappers);
+         if (wakeups < 0)
+         {
+            printf("Event descriptors are not supported here\n");
+            failures++;
+         }
+      }
+      else
+      {
+         for (i = 0; i < num_wrappers; i++)
+            if (vcos_thread_create(&wrappers[i].thread, "wrapper_bench", NULL, wait_thread, &wrappers[i]) != VCOS_SUCCESS)
+               break;
+         if (i < num_wrappers)
+         {
+            printf("Failed to start thread %d\n", i);
+            failures++;
+         }
+         while (i-- > 0)
+            vcos_thread_join(&wrappers[i].thread, NULL);
+      }
+      for (i = 0; i < num_wrappers; i++)
+         wait_for_buffers(&wrappers[i]);
+      elapsed = vcos_getmicrosecs64() - start;
+
+      for (i = 0; i < num_wrappers; i++)
+      {
+         sent += wrappers[i].sent;
+         timeouts += wrappers[i].timeouts;
+         failures += wrappers[i].failures;
+      }
+
+      printf("%s: %d wrappers, %u buffers of %u bytes each, %s: %llu us, %.1f buffers/s, "
+             "%d timed out, %d failed\n", name, num_wrappers,
+             (unsigned)wrappers[0].port->buffer_num, (unsigned)wrappers[0].port->buffer_size,
+             use_poll ? "poll" : "one thread each", (unsigned long long)elapsed,
+             elapsed ? sent * 1000000.0 / elapsed : 0.0, timeouts, failures);
+      if (use_poll && wakeups >= 0)
+         printf("%d poll wakeups, %.2f per buffer\n", wakeups, sent ? (double)wakeups / sent : 0.0);
+   }
+   else
+      failures++;
+
+   for (i = 0; i < created; i++)
+   {
+      if (i < started)
+         mmal_wrapper_port_disable(wrappers[i].port);
+      mmal_wrapper_destroy(wrappers[i].wrapper);
+   }
+
+   return failures || timeouts || sent != num_wrappers * count ? 1 : 0;
+}
@@ -26,16 +26,86 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <stdio.h>
+#include <string.h>
 #include "interface/vmcs_host/vc_dispmanx.h"
 #include "interface/vmcs_host/vc_vchi_gencmd.h"
 #include "interface/vmcs_host/vc_vchi_bufman.h"
 #include "interface/vmcs_host/vc_tvservice.h"
 #include "interface/vmcs_host/vc_cecservice.h"
+#include "interface/vmcs_host/vc_service_common.h"
 #include "interface/vchiq_arm/vchiq_if.h"
+#include "bcm_host.h"
 
 static VCHI_INSTANCE_T global_initialise_instance;
 static VCHI_CONNECTION_T *global_connection;
 
+// Display sizes are cached per display, and dropped whenever the TV service
+// reports a change (hotplug, mode change and so on), or that it lost some
+#define DISPLAY_SIZE_CACHE_SIZE 8
+
+typedef struct {
+   int valid;
+   uint32_t width;
+   uint32_t height;
+} DISPLAY_SIZE_T;
+
+static int bcm_host_service_is_open(VC_SERVICE_ID_T service);
+
+static VCOS_MUTEX_T display_size_lock;
+static DISPLAY_SIZE_T display_size_cache[DISPLAY_SIZE_CACHE_SIZE];
+static uint32_t display_size_generation;
+static int display_size_notify;  // display_size_tv_callback is registered
+
+static void display_size_tv_callback(void *callback_data, uint32_t reason, uint32_t param1, uint32_t param2)
+{
+   vcos_mutex_lock(&display_size_lock);
+   memset(display_size_cache, 0, sizeof(display_size_cache));
+   display_size_generation++;
+   vcos_mutex_unlock(&display_size_lock);
+}
+
+// Listen for TV service changes, if we aren't already.  Returns non-zero if
+// we are, as sizes may only be cached then.
+static int display_size_listen(void)
+{
+   int notify;
+
+   vcos_mutex_lock(&display_size_lock);
+   notify = display_size_notify;
+   if (!notify && vc_tv_register_callback(display_size_tv_callback, NULL) == 0)
+      notify = display_size_notify = 1;
+   vcos_mutex_unlock(&display_size_lock);
+   return notify;
+}
+
+int32_t graphics_get_display_size_cached( const uint16_t display_number,
+                                          uint32_t *width,
+                                          uint32_t *height)
+{
+   int32_t success = -1;
+
+   if (display_number >= DISPLAY_SIZE_CACHE_SIZE)
+      return success;
+
+   vcos_mutex_lock(&display_size_lock);
+   if (display_size_cache[display_number].valid)
+   {
+      if( NULL != width )
+      {
+         *width = display_size_cache[display_number].width;
+      }
+
+      if( NULL != height )
+      {
+         *height = display_size_cache[display_number].height;
+      }
+      success = 0;
+   }
+   vcos_mutex_unlock(&display_size_lock);
+
+   return success;
+}
+
 int32_t graphics_get_display_size( const uint16_t display_number,
                                                     uint32_t *width,
                                                     uint32_t *height)
@@ -43,6 +113,21 @@ int32_t graphics_get_display_size( const uint16_t display_number,
    DISPMANX_DISPLAY_HANDLE_T display_handle = 0;
    DISPMANX_MODEINFO_T mode_info;
    int32_t success = -1;
+   uint32_t generation;
+   int cache;
+
+   if (graphics_get_display_size_cached(display_number, width, height) == 0)
+      return 0;
+
+   // Caching relies on the TV service telling us about changes.  Don't open
+   // it just for that: dispmanx-only applications get uncached queries, as do
+   // all if there is no room for our callback.  Listen before asking, so no
+   // change can be missed.
+   cache = bcm_host_service_is_open(VC_SERVICE_TVSERVICE) && display_size_listen();
+
+   vcos_mutex_lock(&display_size_lock);
+   generation = display_size_generation;
+   vcos_mutex_unlock(&display_size_lock);
 
    if (display_handle == 0) {
       // Display must be opened first.
@@ -63,6 +148,16 @@ int32_t graphics_get_display_size( const uint16_t display_number,
          {
             *height = mode_info.height;
          }
+
+         // only keep it if nothing changed while we were asking
+         vcos_mutex_lock(&display_size_lock);
+         if (cache && display_number < DISPLAY_SIZE_CACHE_SIZE && generation == display_size_generation)
+         {
+            display_size_cache[display_number].valid = 1;
+            display_size_cache[display_number].width = mode_info.width;
+            display_size_cache[display_number].height = mode_info.height;
+         }
+         vcos_mutex_unlock(&display_size_lock);
       }
    }
       
@@ -86,18 +181,100 @@ void vc_host_get_vchi_state(VCHI_INSTANCE_T *initialise_instance, VCHI_CONNECTIO
    if (connection) *connection = global_connection;
 }
 
-void bcm_host_init(void)
+static VCOS_MUTEX_T service_lock[BCM_HOST_NUM_SERVICES];
+static int service_opened[BCM_HOST_NUM_SERVICES];
+static BCM_HOST_INIT_TIMING_T init_timing;
+
+// Open one service, if it isn't already.  Installed as the services' lazy
+// open function, so also called on every service entry.
+static void bcm_host_open_service(VC_SERVICE_ID_T service)
+{
+   uint32_t start;
+   char response[ 128 ];
+   int success;
+   int opened = 0;
+
+   if ((unsigned int)service >= BCM_HOST_NUM_SERVICES)
+   {
+      vcos_assert(0);
+      return;
+   }
+
+   vcos_mutex_lock(&service_lock[service]);
+   if (!service_opened[service])
+   {
+      start = vcos_getmicrosecs();
+
+      switch (service)
+      {
+      case VC_SERVICE_GENCMD:
+         vc_vchi_gencmd_init (global_initialise_instance, &global_connection, 1);
+         break;
+      case VC_SERVICE_DISPMANX:
+         vc_vchi_dispmanx_init (global_initialise_instance, &global_connection, 1);
+         break;
+      case VC_SERVICE_TVSERVICE:
+         vc_vchi_tv_init (global_initialise_instance, &global_connection, 1);
+         break;
+      case VC_SERVICE_CEC:
+         vc_vchi_cec_init (global_initialise_instance, &global_connection, 1);
+         break;
+      default:
+         break;
+      }
+
+      init_timing.service_open_us[service] = vcos_getmicrosecs() - start;
+      service_opened[service] = 1;
+      opened = 1;
+   }
+   vcos_mutex_unlock(&service_lock[service]);
+
+   // outside the lock, as using the service comes back here
+   if (opened && service == VC_SERVICE_GENCMD)
+   {
+      success = vc_gencmd( response, sizeof(response), "set_vll_dir /sd/vlls" );
+      vcos_assert( success == 0 );
+   }
+}
+
+// Whether a service has been opened, without opening it
+static int bcm_host_service_is_open(VC_SERVICE_ID_T service)
+{
+   int opened;
+
+   vcos_mutex_lock(&service_lock[service]);
+   opened = service_opened[service];
+   vcos_mutex_unlock(&service_lock[service]);
+   return opened;
+}
+
+static void *bcm_host_open_task(void *arg)
+{
+   bcm_host_open_service((VC_SERVICE_ID_T)(intptr_t)arg);
+   return NULL;
+}
+
+void bcm_host_init_flags(uint32_t flags)
 {
    VCHIQ_INSTANCE_T vchiq_instance;
+   VCOS_THREAD_T open_thread[BCM_HOST_NUM_SERVICES];
+   int open_threaded[BCM_HOST_NUM_SERVICES];
    static int initted;
    int success = -1;
-   char response[ 128 ];
+   uint32_t start, phase;
+   int i;
    
+   vcos_static_assert(BCM_HOST_NUM_SERVICES == VC_SERVICE_MAX);
+
    if (initted)
 	return;
    initted = 1;
+
+   start = phase = vcos_getmicrosecs();
    vcos_init();
+   init_timing.vcos_init_us = vcos_getmicrosecs() - phase;
 
+   phase = vcos_getmicrosecs();
    if (vchiq_initialise(&vchiq_instance) != VCHIQ_SUCCESS)
    {
       printf("* failed to open vchiq instance\n");
@@ -111,25 +288,79 @@ void bcm_host_init(void)
 
    global_connection = vchi_create_connection(single_get_func_table(),
                                               vchi_mphi_message_driver_func_table());
+   init_timing.vchi_init_us = vcos_getmicrosecs() - phase;
 
+   phase = vcos_getmicrosecs();
    vcos_log("vchi_connect");
    vchi_connect(&global_connection, 1, global_initialise_instance);
-  
-   vc_vchi_gencmd_init (global_initialise_instance, &global_connection, 1);
-   vc_vchi_dispmanx_init (global_initialise_instance, &global_connection, 1);
-   vc_vchi_tv_init (global_initialise_instance, &global_connection, 1);
-   vc_vchi_cec_init (global_initialise_instance, &global_connection, 1);
+   init_timing.vchi_connect_us = vcos_getmicrosecs() - phase;
+
+   for (i = 0; i < BCM_HOST_NUM_SERVICES; i++)
+   {
+      success = vcos_mutex_create(&service_lock[i], "bcm_host");
+      vcos_assert(success == VCOS_SUCCESS);
+   }
+   success = vcos_mutex_create(&display_size_lock, "bcm_host");
+   vcos_assert(success == VCOS_SUCCESS);
    //vc_vchi_bufman_init (global_initialise_instance, &global_connection, 1);
 
-   if ( success == 0 )
+   // anything not opened now is opened on first use
+   vc_service_set_lazy_open(bcm_host_open_service);
+
+   phase = vcos_getmicrosecs();
+   for (i = 0; i < BCM_HOST_NUM_SERVICES; i++)
    {
-      success = vc_gencmd( response, sizeof(response), "set_vll_dir /sd/vlls" );
-      vcos_assert( success == 0 );
+      open_threaded[i] = 0;
+      if (!(flags & (1<<i)))
+         continue;
+
+      if ((flags & BCM_HOST_INIT_PARALLEL) &&
+          vcos_thread_create(&open_thread[i], "bcm_host open", NULL,
+                             bcm_host_open_task, (void *)(intptr_t)i) == VCOS_SUCCESS)
+         open_threaded[i] = 1;
+      else
+         bcm_host_open_service((VC_SERVICE_ID_T)i);
+   }
+   for (i = 0; i < BCM_HOST_NUM_SERVICES; i++)
+   {
+      if (open_threaded[i])
+      {
+         void *dummy;
+         vcos_thread_join(&open_thread[i], &dummy);
+      }
    }
+   init_timing.services_us = vcos_getmicrosecs() - phase;
+   init_timing.total_us = vcos_getmicrosecs() - start;
+
+   vcos_log("bcm_host_init: vcos %u vchi %u connect %u services %u total %u us",
+            init_timing.vcos_init_us, init_timing.vchi_init_us, init_timing.vchi_connect_us,
+            init_timing.services_us, init_timing.total_us);
+}
+
+void bcm_host_init(void)
+{
+   bcm_host_init_flags(BCM_HOST_INIT_ALL_SERVICES);
+}
+
+void bcm_host_get_init_timing(BCM_HOST_INIT_TIMING_T *timing)
+{
+   *timing = init_timing;
 }
 
 void bcm_host_deinit(void)
 {
+   int notify;
+
+   vcos_mutex_lock(&display_size_lock);
+   notify = display_size_notify;
+   display_size_notify = 0;
+   memset(display_size_cache, 0, sizeof(display_size_cache));
+   display_size_generation++;
+   vcos_mutex_unlock(&display_size_lock);
+
+   // not under the lock, this waits for a running callback which takes it
+   if (notify)
+      vc_tv_unregister_callback(display_size_tv_callback);
 }
 
 // Fix linking problems. These are referenced by libs, but shouldn't be called
@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Header file with useful bits from other headers
+
+#ifndef BCM_HOST_H
+#define BCM_HOST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void bcm_host_init(void);
+void bcm_host_deinit(void);
+
+int32_t graphics_get_display_size( const uint16_t display_number,
+                                   uint32_t *width,
+                                   uint32_t *height);
+
+// As graphics_get_display_size, but never waits on VideoCore: returns -1
+// unless the size is already known from an earlier call.
+int32_t graphics_get_display_size_cached( const uint16_t display_number,
+                                          uint32_t *width,
+                                          uint32_t *height);
+
+// Services to open during bcm_host_init_flags.  Any not selected are
+// opened the first time they are used.
+#define BCM_HOST_INIT_GENCMD        (1<<0)
+#define BCM_HOST_INIT_DISPMANX      (1<<1)
+#define BCM_HOST_INIT_TVSERVICE     (1<<2)
+#define BCM_HOST_INIT_CEC           (1<<3)
+#define BCM_HOST_INIT_ALL_SERVICES  (0xf)
+
+// Open the selected services concurrently rather than one after another
+#define BCM_HOST_INIT_PARALLEL      (1<<8)
+
+// Same as bcm_host_init, but only opening the services selected in flags
+// straight away.  bcm_host_init is bcm_host_init_flags(BCM_HOST_INIT_ALL_SERVICES).
+void bcm_host_init_flags(uint32_t flags);
+
+// Number of services, in the order of the BCM_HOST_INIT_ flags above
+#define BCM_HOST_NUM_SERVICES 4
+
+// Time taken by each phase of startup, in microseconds
+typedef struct {
+   uint32_t vcos_init_us;
+   uint32_t vchi_init_us;      // vchiq/vchi initialise and connection creation
+   uint32_t vchi_connect_us;
+   uint32_t services_us;       // opening the services selected at init, wall clock
+   uint32_t total_us;          // all of bcm_host_init_flags
+   uint32_t service_open_us[BCM_HOST_NUM_SERVICES]; // per service, 0 if not opened yet
+} BCM_HOST_INIT_TIMING_T;
+
+void bcm_host_get_init_timing(BCM_HOST_INIT_TIMING_T *timing);
+
+#include "interface/vmcs_host/vc_dispmanx.h"
+#include "interface/vmcs_host/vc_tvservice.h"
+#include "interface/vmcs_host/vc_cec.h"
+#include "interface/vmcs_host/vc_cecservice.h"
+#include "interface/vmcs_host/vc_vchi_gencmd.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
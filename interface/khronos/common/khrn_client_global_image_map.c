@@ -43,7 +43,6 @@ static INLINE void release_value(uint64_t value)
 }
 
 #define KHRN_GENERIC_MAP_VALUE_NONE ((uint64_t)0)
-#define KHRN_GENERIC_MAP_VALUE_DELETED ((uint64_t)-1)
 #define KHRN_GENERIC_MAP_ACQUIRE_VALUE acquire_value
 #define KHRN_GENERIC_MAP_RELEASE_VALUE release_value
 #define KHRN_GENERIC_MAP_ALLOC khrn_platform_malloc
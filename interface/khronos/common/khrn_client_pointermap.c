@@ -29,7 +29,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/khronos/common/khrn_client_platform.h"
 
 #define KHRN_GENERIC_MAP_VALUE_NONE NULL
-#define KHRN_GENERIC_MAP_VALUE_DELETED ((void *)(uintptr_t)-1)
 #define KHRN_GENERIC_MAP_ALLOC khrn_platform_malloc
 #define KHRN_GENERIC_MAP_FREE khrn_platform_free
 
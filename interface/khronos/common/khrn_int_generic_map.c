@@ -32,45 +32,113 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define KHRN_GENERIC_MAP_CMP_VALUE(x, y) (x==y)
 #endif
 
+/*
+   keys are often allocated sequentially or with a fixed stride (eg pointers),
+   so mix them before masking to stop them piling up in a few runs of slots
+*/
+
 static INLINE uint32_t hash(KHRN_GENERIC_MAP_KEY_T key, uint32_t capacity)
 {
-   return (uint32_t)key & (capacity - 1);
+   uint32_t h = (uint32_t)key * 0x9e3779b1;
+   return (h ^ (h >> 16)) & (capacity - 1);
 }
 
+/*
+   how far the entry in slot i is from the slot its key hashes to
+*/
+
+static INLINE uint32_t probe_distance(KHRN_GENERIC_MAP(ENTRY_T) *base, uint32_t capacity, uint32_t i)
+{
+   return (i - hash(base[i].key, capacity)) & (capacity - 1);
+}
+
+/*
+   entries are kept in robin hood order: along a run of occupied slots, no
+   entry is further from its home slot than the entry before it is from its
+   own plus one. a lookup can therefore give up as soon as it reaches an entry
+   that is closer to home than the key being looked for would be
+*/
+
 static KHRN_GENERIC_MAP(ENTRY_T) *get_entry(KHRN_GENERIC_MAP(ENTRY_T) *base, uint32_t capacity, KHRN_GENERIC_MAP_KEY_T key)
 {
    uint32_t h = hash(key, capacity);
+   uint32_t distance = 0;
    while (!KHRN_GENERIC_MAP_CMP_VALUE(base[h].value, KHRN_GENERIC_MAP_VALUE_NONE)) {
       if (base[h].key == key) {
-         return (KHRN_GENERIC_MAP_CMP_VALUE(base[h].value, KHRN_GENERIC_MAP_VALUE_DELETED)) ? NULL : (base + h);
+         return base + h;
+      }
+      if (probe_distance(base, capacity, h) < distance) {
+         return NULL;
       }
       if (++h == capacity) {
          h = 0;
       }
+      ++distance;
    }
    return NULL;
 }
 
-static KHRN_GENERIC_MAP(ENTRY_T) *get_free_entry(KHRN_GENERIC_MAP(ENTRY_T) *base, uint32_t capacity, KHRN_GENERIC_MAP_KEY_T key)
+/*
+   key must not already be in the map and there must be a free slot
+*/
+
+static void insert_entry(KHRN_GENERIC_MAP(ENTRY_T) *base, uint32_t capacity, KHRN_GENERIC_MAP_KEY_T key, KHRN_GENERIC_MAP_VALUE_T value)
 {
+   KHRN_GENERIC_MAP(ENTRY_T) entry;
    uint32_t h = hash(key, capacity);
-   while ((!KHRN_GENERIC_MAP_CMP_VALUE(base[h].value, KHRN_GENERIC_MAP_VALUE_DELETED)) && (!KHRN_GENERIC_MAP_CMP_VALUE(base[h].value, KHRN_GENERIC_MAP_VALUE_NONE))) {
+   uint32_t distance = 0;
+
+   entry.key = key;
+   entry.value = value;
+   while (!KHRN_GENERIC_MAP_CMP_VALUE(base[h].value, KHRN_GENERIC_MAP_VALUE_NONE)) {
+      uint32_t d = probe_distance(base, capacity, h);
+      if (d < distance) {
+         /* take the slot from the entry closer to home and carry on inserting that */
+         KHRN_GENERIC_MAP(ENTRY_T) displaced = base[h];
+         base[h] = entry;
+         entry = displaced;
+         distance = d;
+      }
       if (++h == capacity) {
          h = 0;
       }
+      ++distance;
+   }
+   base[h] = entry;
+}
+
+/*
+   rather than leaving a deleted marker behind, shift the following entries in
+   the run back a slot until we reach a free slot or an entry that is already
+   in its home slot. lookups never have to step over dead slots, and the
+   robin hood order is preserved
+*/
+
+static void remove_entry(KHRN_GENERIC_MAP(ENTRY_T) *base, uint32_t capacity, KHRN_GENERIC_MAP(ENTRY_T) *entry)
+{
+   uint32_t i = (uint32_t)(entry - base);
+   for (;;) {
+      uint32_t next = (i + 1) & (capacity - 1);
+      if (KHRN_GENERIC_MAP_CMP_VALUE(base[next].value, KHRN_GENERIC_MAP_VALUE_NONE) ||
+         (probe_distance(base, capacity, next) == 0)) {
+         break;
+      }
+      base[i] = base[next];
+      i = next;
    }
-   return base + h;
+   base[i].value = KHRN_GENERIC_MAP_VALUE_NONE;
 }
 
 static bool realloc_storage(KHRN_GENERIC_MAP(T) *map, uint32_t new_capacity)
 {
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
    MEM_HANDLE_T handle = map->storage;
-   KHRN_GENERIC_MAP(ENTRY_T) *base;
+   KHRN_GENERIC_MAP(ENTRY_T) *base, *new_base;
 #else
-   KHRN_GENERIC_MAP(ENTRY_T) *base = map->storage;
+   KHRN_GENERIC_MAP(ENTRY_T) *base = map->storage, *new_base;
 #endif
    uint32_t capacity = map->capacity;
+   uint32_t entries = map->entries;
    uint32_t i;
 
    /*
@@ -84,21 +152,24 @@ static bool realloc_storage(KHRN_GENERIC_MAP(T) *map, uint32_t new_capacity)
    }
 
    /*
-      copy entries across to new map and destroy old map
+      move entries across to new map and destroy old map. the references held
+      on the values move with them, so there's no need to acquire or release
    */
 
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
    base = (KHRN_GENERIC_MAP(ENTRY_T) *)mem_lock(handle);
+   new_base = (KHRN_GENERIC_MAP(ENTRY_T) *)mem_lock(map->storage);
+#else
+   new_base = map->storage;
 #endif
    for (i = 0; i != capacity; ++i) {
-      if ((!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_DELETED)) && (!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_NONE))) {
-         verify(khrn_generic_map(insert)(map, base[i].key, base[i].value)); /* khrn_generic_map(insert) can only fail if the map is too small */
-#ifdef KHRN_GENERIC_MAP_RELEASE_VALUE
-         KHRN_GENERIC_MAP_RELEASE_VALUE(base[i].value); /* new reference added by khrn_generic_map(insert) */
-#endif
+      if (!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_NONE)) {
+         insert_entry(new_base, new_capacity, base[i].key, base[i].value);
       }
    }
+   map->entries = entries;
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
+   mem_unlock(map->storage);
    mem_unlock(handle);
    mem_release(handle);
 #else
@@ -118,10 +189,12 @@ bool khrn_generic_map(init)(KHRN_GENERIC_MAP(T) *map, uint32_t capacity)
 #endif
 
    /*
-      we need (capacity - 1) > (capacity / 2) and (capacity - 1) > ((3 * capacity) / 4)
-      to ensure we always have at least 1 unused slot
+      we grow once there are more than (capacity / 2) entries, so a map holds at
+      most (capacity / 2) + 1. we need (capacity - 1) > ((capacity / 2) + 1) to
+      ensure we always have at least 1 unused slot (lookups, inserts and
+      iteration rely on this)
 
-      the smallest number that satisfies these constraints is 8 (7 > 4, 7 > 6)
+      we keep the smallest capacity at 8 (7 > 5)
    */
 
    vcos_assert(capacity >= 8);
@@ -160,7 +233,6 @@ bool khrn_generic_map(init)(KHRN_GENERIC_MAP(T) *map, uint32_t capacity)
    */
 
    map->entries = 0;
-   map->deletes = 0;
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
    map->storage = handle;
 #else
@@ -191,7 +263,7 @@ void khrn_generic_map(term)(KHRN_GENERIC_MAP(T) *map)
 #endif
       uint32_t i;
       for (i = 0; i != map->capacity; ++i) {
-         if ((!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_DELETED)) && (!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_NONE))) {
+         if (!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_NONE)) {
             KHRN_GENERIC_MAP_RELEASE_VALUE(base[i].value);
          }
       }
@@ -213,7 +285,6 @@ bool khrn_generic_map(insert)(KHRN_GENERIC_MAP(T) *map, KHRN_GENERIC_MAP_KEY_T k
    uint32_t capacity = map->capacity;
    KHRN_GENERIC_MAP(ENTRY_T) *entry;
 
-   vcos_assert(!KHRN_GENERIC_MAP_CMP_VALUE(value, KHRN_GENERIC_MAP_VALUE_DELETED));
    vcos_assert(!KHRN_GENERIC_MAP_CMP_VALUE(value, KHRN_GENERIC_MAP_VALUE_NONE));
 
    entry = get_entry(
@@ -242,26 +313,18 @@ bool khrn_generic_map(insert)(KHRN_GENERIC_MAP(T) *map, KHRN_GENERIC_MAP_KEY_T k
       if (map->entries > (capacity / 2)) {
          capacity *= 2;
          if (!realloc_storage(map, capacity)) { return false; }
-      } else if ((map->entries + map->deletes) > ((3 * capacity) / 4)) {
-         if (!realloc_storage(map, capacity)) { return false; }
       }
 
 #ifdef KHRN_GENERIC_MAP_ACQUIRE_VALUE
       KHRN_GENERIC_MAP_ACQUIRE_VALUE(value);
 #endif
-      entry = get_free_entry(
+      insert_entry(
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
          (KHRN_GENERIC_MAP(ENTRY_T) *)mem_lock(map->storage),
 #else
          map->storage,
 #endif
-         capacity, key);
-      if (KHRN_GENERIC_MAP_CMP_VALUE(entry->value, KHRN_GENERIC_MAP_VALUE_DELETED)) {
-         vcos_assert(map->deletes > 0);
-         --map->deletes;
-      }
-      entry->key = key;
-      entry->value = value;
+         capacity, key, value);
       ++map->entries;
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
       mem_unlock(map->storage);
@@ -273,19 +336,17 @@ bool khrn_generic_map(insert)(KHRN_GENERIC_MAP(T) *map, KHRN_GENERIC_MAP_KEY_T k
 
 bool khrn_generic_map(delete)(KHRN_GENERIC_MAP(T) *map, KHRN_GENERIC_MAP_KEY_T key)
 {
-   KHRN_GENERIC_MAP(ENTRY_T) *entry = get_entry(
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
-      (KHRN_GENERIC_MAP(ENTRY_T) *)mem_lock(map->storage),
+   KHRN_GENERIC_MAP(ENTRY_T) *base = (KHRN_GENERIC_MAP(ENTRY_T) *)mem_lock(map->storage);
 #else
-      map->storage,
+   KHRN_GENERIC_MAP(ENTRY_T) *base = map->storage;
 #endif
-      map->capacity, key);
+   KHRN_GENERIC_MAP(ENTRY_T) *entry = get_entry(base, map->capacity, key);
    if (entry) {
 #ifdef KHRN_GENERIC_MAP_RELEASE_VALUE
       KHRN_GENERIC_MAP_RELEASE_VALUE(entry->value);
 #endif
-      entry->value = KHRN_GENERIC_MAP_VALUE_DELETED;
-      ++map->deletes;
+      remove_entry(base, map->capacity, entry);
       vcos_assert(map->entries > 0);
       --map->entries;
    }
@@ -328,11 +389,29 @@ void khrn_generic_map(iterate)(KHRN_GENERIC_MAP(T) *map, KHRN_GENERIC_MAP(CALLBA
 #else
    KHRN_GENERIC_MAP(ENTRY_T) *base = map->storage;
 #endif
-   uint32_t i;
-   for (i = 0; i != map->capacity; ++i) {
-      if ((!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_DELETED)) && (!KHRN_GENERIC_MAP_CMP_VALUE(base[i].value, KHRN_GENERIC_MAP_VALUE_NONE))) {
-         func(map, base[i].key, base[i].value, data);
+   uint32_t capacity = map->capacity;
+   uint32_t start, i;
+
+   /*
+      func may delete the entry it is given, which shifts later entries in the
+      run back a slot. start at a free slot: entries never shift across one, so
+      each entry is still visited exactly once if we look at a slot again
+      whenever an unvisited entry has just been shifted into it
+   */
+
+   for (start = 0; !KHRN_GENERIC_MAP_CMP_VALUE(base[start].value, KHRN_GENERIC_MAP_VALUE_NONE); ++start) {
+      vcos_assert(start + 1 < capacity);
+   }
+   for (i = 0; i != capacity;) {
+      KHRN_GENERIC_MAP(ENTRY_T) *entry = base + ((start + i) & (capacity - 1));
+      if (!KHRN_GENERIC_MAP_CMP_VALUE(entry->value, KHRN_GENERIC_MAP_VALUE_NONE)) {
+         KHRN_GENERIC_MAP_KEY_T key = entry->key;
+         func(map, key, entry->value, data);
+         if (!KHRN_GENERIC_MAP_CMP_VALUE(entry->value, KHRN_GENERIC_MAP_VALUE_NONE) && (entry->key != key)) {
+            continue;
+         }
       }
+      ++i;
    }
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
    mem_unlock(map->storage);
@@ -36,7 +36,6 @@ typedef struct {
 
 typedef struct {
    uint32_t entries;
-   uint32_t deletes;
 
 #ifdef KHRN_GENERIC_MAP_RELOCATABLE
    MEM_HANDLE_T storage;
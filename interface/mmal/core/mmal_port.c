@@ -691,6 +691,57 @@ MMAL_STATUS_T mmal_port_parameter_set(MMAL_PORT_T *port,
    return status;
 }
 
+/* Set several parameters on a port. */
+MMAL_STATUS_T mmal_port_parameter_set_multi(MMAL_PORT_T *port,
+   const MMAL_PARAMETER_HEADER_T * const *params, unsigned int num)
+{
+   MMAL_STATUS_T status[MMAL_PORT_PARAMETER_SET_MULTI_MAX];
+   MMAL_STATUS_T ret = MMAL_SUCCESS;
+   unsigned int i, j, count;
+
+   if (!port || !port->priv)
+   {
+      LOG_ERROR("no port or port not configured");
+      return MMAL_EINVAL;
+   }
+   if (!params && num)
+   {
+      LOG_ERROR("params not supplied");
+      return MMAL_EINVAL;
+   }
+   for (i = 0; i < num; i++)
+      if (!params[i])
+         return MMAL_EINVAL;
+
+   LOG_TRACE("%s(%i:%i) port %p, %u params", port->component->name,
+             (int)port->type, (int)port->index, port, num);
+
+   LOCK_PORT(port);
+   for (i = 0; i < num; i += count)
+   {
+      count = vcos_min(num - i, MMAL_PORT_PARAMETER_SET_MULTI_MAX);
+
+      if (port->priv->pf_parameter_set_multi)
+         port->priv->pf_parameter_set_multi(port, params + i, status, count);
+      else for (j = 0; j < count; j++)
+         status[j] = port->priv->pf_parameter_set ?
+            port->priv->pf_parameter_set(port, params[i + j]) : MMAL_ENOSYS;
+
+      for (j = 0; j < count; j++)
+      {
+         if (status[j] == MMAL_ENOSYS)
+         {
+            /* is this a core parameter? */
+            status[j] = mmal_port_private_parameter_set(port, params[i + j]);
+         }
+         if (status[j] != MMAL_SUCCESS && ret == MMAL_SUCCESS)
+            ret = status[j];
+      }
+   }
+   UNLOCK_PORT(port);
+   return ret;
+}
+
 /* Get a port parameter */
 MMAL_STATUS_T mmal_port_parameter_get(MMAL_PORT_T *port,
    MMAL_PARAMETER_HEADER_T *param)
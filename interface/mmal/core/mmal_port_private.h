@@ -43,6 +43,10 @@ typedef struct MMAL_PORT_PRIVATE_T
    MMAL_STATUS_T (*pf_flush)(MMAL_PORT_T *port);
    MMAL_STATUS_T (*pf_parameter_set)(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param);
    MMAL_STATUS_T (*pf_parameter_get)(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param);
+   /** Optional. Set up to MMAL_PORT_PARAMETER_SET_MULTI_MAX parameters at once, filling in
+    * the status of each. MMAL_ENOSYS statuses get the same fallback as pf_parameter_set. */
+   MMAL_STATUS_T (*pf_parameter_set_multi)(MMAL_PORT_T *port,
+      const MMAL_PARAMETER_HEADER_T * const *params, MMAL_STATUS_T *status, unsigned int num);
    MMAL_STATUS_T (*pf_connect)(MMAL_PORT_T *port, MMAL_PORT_T *other_port);
 
    uint8_t *(*pf_payload_alloc)(MMAL_PORT_T *port, uint32_t payload_size);
@@ -188,6 +188,27 @@ MMAL_STATUS_T mmal_port_flush(MMAL_PORT_T *port);
 MMAL_STATUS_T mmal_port_parameter_set(MMAL_PORT_T *port,
    const MMAL_PARAMETER_HEADER_T *param);
 
+/** Most parameters a port implementation is handed at once by \ref mmal_port_parameter_set_multi.
+ * Larger sets are split up. */
+#define MMAL_PORT_PARAMETER_SET_MULTI_MAX 16
+
+/** Set several parameters on a port.
+ * This is equivalent to calling \ref mmal_port_parameter_set for each parameter in turn,
+ * except that ports which live on another processor can send them all in one go.
+ * All the parameters are attempted even if some of them fail.
+ *
+ * \note The parameters may be applied concurrently, so a parameter which is only valid
+ * once another has taken effect should be set with a separate call.
+ *
+ * @param port The port to which the request is sent.
+ * @param params Array of pointers to the headers of the parameters to set.
+ * @param num Number of parameters in the array.
+ * @return MMAL_SUCCESS if all the parameters were set, otherwise the status of the
+ * first one which failed.
+ */
+MMAL_STATUS_T mmal_port_parameter_set_multi(MMAL_PORT_T *port,
+   const MMAL_PARAMETER_HEADER_T * const *params, unsigned int num);
+
 /** Get a parameter from a port.
  * The size field must be set on input to the maximum size of the parameter
  * (including the header) and will be set on output to the actual size of the
@@ -30,15 +30,65 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "util/mmal_component_wrapper.h"
 #include "mmal_logging.h"
 #include <stdio.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#endif
 
+struct MMAL_WRAPPER_PRIVATE_T;
+
+/** Something a client can block on: the empty pool of a port or the
+ * full queue of an output port. Each has its own semaphore so that a
+ * client waiting on one port isn't woken by traffic on the others. */
 typedef struct
+{
+   struct MMAL_WRAPPER_PRIVATE_T *private;
+   VCOS_SEMAPHORE_T sema;
+
+} MMAL_WRAPPER_WAIT_T;
+
+typedef struct MMAL_WRAPPER_PRIVATE_T
 {
    MMAL_WRAPPER_T wrapper; /**< Must be the first member! */
 
-   VCOS_SEMAPHORE_T sema;
+   /** input_num empty waits, then output_num empty waits, then
+    * output_num full waits */
+   MMAL_WRAPPER_WAIT_T *wait;
+   unsigned int wait_num; /**< Number of wait semaphores created */
+
+   int event_fd; /**< Created on demand by mmal_wrapper_event_fd, -1 until then */
 
 } MMAL_WRAPPER_PRIVATE_T;
 
+#define WAIT_INPUT(p, i) (&(p)->wait[(i)])
+#define WAIT_OUTPUT(p, i) (&(p)->wait[(p)->wrapper.input_num + (i)])
+#define WAIT_OUTPUT_FULL(p, i) (&(p)->wait[(p)->wrapper.input_num + (p)->wrapper.output_num + (i)])
+
+/** Tell anyone interested that a buffer is available (wait != NULL) or
+ * that the wrapper status has changed (wait == NULL). */
+static void mmal_wrapper_signal(MMAL_WRAPPER_PRIVATE_T *private, MMAL_WRAPPER_WAIT_T *wait)
+{
+   unsigned int i;
+
+   if (wait)
+      vcos_semaphore_post(&wait->sema);
+   else for (i = 0; i < private->wait_num; i++)
+      vcos_semaphore_post(&private->wait[i].sema);
+
+#ifdef __linux__
+   if (private->event_fd >= 0)
+   {
+      uint64_t one = 1;
+      ssize_t ret = write(private->event_fd, &one, sizeof(one));
+      MMAL_PARAM_UNUSED(ret);
+   }
+#endif
+
+   if (private->wrapper.callback)
+      private->wrapper.callback(&private->wrapper);
+}
+
 /** Callback from a control port. Error events will be received there. */
 static void mmal_wrapper_control_cb(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
 {
@@ -50,10 +100,8 @@ static void mmal_wrapper_control_cb(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buf
       private->wrapper.status = *(MMAL_STATUS_T *)buffer->data;
       mmal_buffer_header_release(buffer);
 
-      vcos_semaphore_post(&private->sema);
-
-      if (private->wrapper.callback)
-         private->wrapper.callback(&private->wrapper);
+      /* Wake up every waiter so they all see the error */
+      mmal_wrapper_signal(private, NULL);
       return;
    }
 
@@ -78,23 +126,17 @@ static void mmal_wrapper_bh_out_cb(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buff
 
    /* Queue the buffer produced by the output port */
    mmal_queue_put(private->wrapper.output_queue[port->index], buffer);
-   vcos_semaphore_post(&private->sema);
-
-   if (private->wrapper.callback)
-      private->wrapper.callback(&private->wrapper);
+   mmal_wrapper_signal(private, WAIT_OUTPUT_FULL(private, port->index));
 }
 
 /** Callback from the pool. Buffer is available. */
 static MMAL_BOOL_T mmal_wrapper_bh_release_cb(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *buffer,
    void *userdata)
 {
-   MMAL_WRAPPER_PRIVATE_T *private = (MMAL_WRAPPER_PRIVATE_T *)userdata;
+   MMAL_WRAPPER_WAIT_T *wait = (MMAL_WRAPPER_WAIT_T *)userdata;
 
    mmal_queue_put(pool->queue, buffer);
-   vcos_semaphore_post(&private->sema);
-
-   if (private->wrapper.callback)
-      private->wrapper.callback(&private->wrapper);
+   mmal_wrapper_signal(wait->private, wait);
 
    return 0;
 }
@@ -124,7 +166,12 @@ MMAL_STATUS_T mmal_wrapper_destroy(MMAL_WRAPPER_T *wrapper)
          mmal_queue_destroy(wrapper->output_queue[i]);
    }
 
-   vcos_semaphore_delete(&private->sema);
+   for (i = 0; i < private->wait_num; i++)
+      vcos_semaphore_delete(&private->wait[i].sema);
+#ifdef __linux__
+   if (private->event_fd >= 0)
+      close(private->event_fd);
+#endif
    vcos_free(private);
    return MMAL_SUCCESS;
 }
@@ -137,7 +184,7 @@ MMAL_STATUS_T mmal_wrapper_create(MMAL_WRAPPER_T **ctx, const char *name)
    MMAL_WRAPPER_PRIVATE_T *private;
    MMAL_WRAPPER_T *wrapper;
    int64_t start_time;
-   unsigned int i, extra_size;
+   unsigned int i, wait_num, extra_size;
 
    LOG_TRACE("wrapper %p, name %s", ctx, name);
 
@@ -151,16 +198,28 @@ MMAL_STATUS_T mmal_wrapper_create(MMAL_WRAPPER_T **ctx, const char *name)
    if (status != MMAL_SUCCESS)
       return status;
 
-   extra_size = (component->input_num + component->output_num) * 2;
+   wait_num = component->input_num + component->output_num * 2;
+   extra_size = wait_num * sizeof(MMAL_WRAPPER_WAIT_T) +
+      (component->input_num + component->output_num * 2) * sizeof(void *);
    private = vcos_calloc(1, sizeof(*private) + extra_size, "mmal wrapper");
    if (!private)
    {
       mmal_component_destroy(component);
       return MMAL_ENOMEM;
    }
+   private->event_fd = -1;
+   private->wait = (MMAL_WRAPPER_WAIT_T *)&private[1];
 
-   if (vcos_semaphore_create(&private->sema, "mmal wrapper", 0) != VCOS_SUCCESS)
+   for (i = 0; i < wait_num; i++, private->wait_num++)
+   {
+      private->wait[i].private = private;
+      if (vcos_semaphore_create(&private->wait[i].sema, "mmal wrapper", 0) != VCOS_SUCCESS)
+         break;
+   }
+   if (private->wait_num != wait_num)
    {
+      for (i = 0; i < private->wait_num; i++)
+         vcos_semaphore_delete(&private->wait[i].sema);
       mmal_component_destroy(component);
       vcos_free(private);
       return MMAL_ENOMEM;
@@ -173,7 +232,7 @@ MMAL_STATUS_T mmal_wrapper_create(MMAL_WRAPPER_T **ctx, const char *name)
    wrapper->input = component->input;
    wrapper->output_num = component->output_num;
    wrapper->output = component->output;
-   wrapper->input_pool = (MMAL_POOL_T **)&private[1];
+   wrapper->input_pool = (MMAL_POOL_T **)&private->wait[wait_num];
    wrapper->output_pool = (MMAL_POOL_T **)&wrapper->input_pool[component->input_num];
    wrapper->output_queue = (MMAL_QUEUE_T **)&wrapper->output_pool[component->output_num];
 
@@ -183,7 +242,8 @@ MMAL_STATUS_T mmal_wrapper_create(MMAL_WRAPPER_T **ctx, const char *name)
       wrapper->input_pool[i] = mmal_port_pool_create(wrapper->input[i], 0, 0);
       if (!wrapper->input_pool[i])
          goto error;
-      mmal_pool_callback_set(wrapper->input_pool[i], mmal_wrapper_bh_release_cb, (void *)wrapper);
+      mmal_pool_callback_set(wrapper->input_pool[i], mmal_wrapper_bh_release_cb,
+                             (void *)WAIT_INPUT(private, i));
 
       wrapper->input[i]->userdata = (void *)wrapper;
    }
@@ -193,7 +253,8 @@ MMAL_STATUS_T mmal_wrapper_create(MMAL_WRAPPER_T **ctx, const char *name)
       wrapper->output_queue[i] = mmal_queue_create();
       if (!wrapper->output_pool[i] || !wrapper->output_queue[i])
          goto error;
-      mmal_pool_callback_set(wrapper->output_pool[i], mmal_wrapper_bh_release_cb, (void *)wrapper);
+      mmal_pool_callback_set(wrapper->output_pool[i], mmal_wrapper_bh_release_cb,
+                             (void *)WAIT_OUTPUT(private, i));
 
       wrapper->output[i]->userdata = (void *)wrapper;
    }
@@ -315,54 +376,105 @@ MMAL_STATUS_T mmal_wrapper_port_disable(MMAL_PORT_T *port)
    return status;
 }
 
+/** Get a buffer from a queue, waiting on the given semaphore for it to be
+ * refilled if requested. */
+static MMAL_STATUS_T mmal_wrapper_buffer_get(MMAL_WRAPPER_T *wrapper, MMAL_QUEUE_T *queue,
+   MMAL_WRAPPER_WAIT_T *wait, MMAL_BUFFER_HEADER_T **buffer, uint32_t flags, uint32_t timeout)
+{
+   uint64_t deadline = 0;
+
+   /* 64-bit clock, the 32-bit one wraps every 71 minutes */
+   if (timeout != MMAL_WRAPPER_TIMEOUT_INFINITE)
+      deadline = vcos_getmicrosecs64() + (uint64_t)timeout * 1000;
+
+   while (wrapper->status == MMAL_SUCCESS &&
+          (*buffer = mmal_queue_get(queue)) == NULL)
+   {
+      if (!(flags & MMAL_WRAPPER_FLAG_WAIT))
+         break;
+
+      if (timeout == MMAL_WRAPPER_TIMEOUT_INFINITE)
+         vcos_semaphore_wait(&wait->sema);
+      else
+      {
+         uint64_t now = vcos_getmicrosecs64(), left;
+         if (now >= deadline)
+            break;
+         left = deadline - now;
+         /* Go round again whether or not this timed out so the queue
+          * gets a last look before giving up */
+         vcos_semaphore_wait_timeout(&wait->sema, (VCOS_UNSIGNED)((left + 999) / 1000));
+      }
+   }
+
+   return wrapper->status == MMAL_SUCCESS && !*buffer ? MMAL_EAGAIN : wrapper->status;
+}
+
 /** Wait for an empty buffer to be available on a port */
 MMAL_STATUS_T mmal_wrapper_buffer_get_empty(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer,
    uint32_t flags)
+{
+   return mmal_wrapper_buffer_get_empty_timeout(port, buffer, flags, MMAL_WRAPPER_TIMEOUT_INFINITE);
+}
+
+/** Wait for a limited time for an empty buffer to be available on a port */
+MMAL_STATUS_T mmal_wrapper_buffer_get_empty_timeout(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer,
+   uint32_t flags, uint32_t timeout)
 {
    MMAL_WRAPPER_PRIVATE_T *private = (MMAL_WRAPPER_PRIVATE_T *)port->userdata;
    MMAL_WRAPPER_T *wrapper = &private->wrapper;
-   MMAL_POOL_T *pool;
 
    LOG_TRACE("%p, %s", wrapper, port->name);
 
    if (!buffer || (port->type != MMAL_PORT_TYPE_INPUT && port->type != MMAL_PORT_TYPE_OUTPUT))
       return MMAL_EINVAL;
 
-   pool = port->type == MMAL_PORT_TYPE_INPUT ?
-      wrapper->input_pool[port->index] : wrapper->output_pool[port->index];
-
-   while (wrapper->status == MMAL_SUCCESS &&
-          (*buffer = mmal_queue_get(pool->queue)) == NULL)
-   {
-      if (!(flags & MMAL_WRAPPER_FLAG_WAIT))
-         break;
-      vcos_semaphore_wait(&private->sema);
-   }
-
-   return wrapper->status == MMAL_SUCCESS && !*buffer ? MMAL_EAGAIN : wrapper->status;
+   if (port->type == MMAL_PORT_TYPE_INPUT)
+      return mmal_wrapper_buffer_get(wrapper, wrapper->input_pool[port->index]->queue,
+         WAIT_INPUT(private, port->index), buffer, flags, timeout);
+   else
+      return mmal_wrapper_buffer_get(wrapper, wrapper->output_pool[port->index]->queue,
+         WAIT_OUTPUT(private, port->index), buffer, flags, timeout);
 }
 
 /** Wait for a full buffer to be available on a port */
 MMAL_STATUS_T mmal_wrapper_buffer_get_full(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer,
    uint32_t flags)
+{
+   return mmal_wrapper_buffer_get_full_timeout(port, buffer, flags, MMAL_WRAPPER_TIMEOUT_INFINITE);
+}
+
+/** Wait for a limited time for a full buffer to be available on a port */
+MMAL_STATUS_T mmal_wrapper_buffer_get_full_timeout(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer,
+   uint32_t flags, uint32_t timeout)
 {
    MMAL_WRAPPER_PRIVATE_T *private = (MMAL_WRAPPER_PRIVATE_T *)port->userdata;
    MMAL_WRAPPER_T *wrapper = &private->wrapper;
-   MMAL_QUEUE_T *queue;
 
    LOG_TRACE("%p, %s", wrapper, port->name);
 
    if (!buffer || port->type != MMAL_PORT_TYPE_OUTPUT)
       return MMAL_EINVAL;
-   queue = wrapper->output_queue[port->index];
 
-   while (wrapper->status == MMAL_SUCCESS &&
-          (*buffer = mmal_queue_get(queue)) == NULL)
+   return mmal_wrapper_buffer_get(wrapper, wrapper->output_queue[port->index],
+      WAIT_OUTPUT_FULL(private, port->index), buffer, flags, timeout);
+}
+
+/** Get a file descriptor which becomes readable when the wrapper has news */
+int mmal_wrapper_event_fd(MMAL_WRAPPER_T *wrapper)
+{
+   MMAL_WRAPPER_PRIVATE_T *private = (MMAL_WRAPPER_PRIVATE_T *)wrapper;
+
+   LOG_TRACE("%p", wrapper);
+
+#ifdef __linux__
+   if (private->event_fd < 0)
    {
-      if (!(flags & MMAL_WRAPPER_FLAG_WAIT))
-         break;
-      vcos_semaphore_wait(&private->sema);
+      private->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (private->event_fd < 0)
+         LOG_ERROR("could not create eventfd for %s", wrapper->component->name);
    }
+#endif
 
-   return wrapper->status == MMAL_SUCCESS && !*buffer ? MMAL_EAGAIN : wrapper->status;
+   return private->event_fd;
 }
@@ -100,6 +100,9 @@ MMAL_STATUS_T mmal_wrapper_create(MMAL_WRAPPER_T **wrapper, const char *name);
 #define MMAL_WRAPPER_FLAG_PAYLOAD_USE_SHARED_MEMORY 4
 /* @} */
 
+/** Timeout value meaning wait for as long as it takes */
+#define MMAL_WRAPPER_TIMEOUT_INFINITE 0xFFFFFFFF
+
 /** Enable a port on a component wrapper.
  *
  * @param port port to enable
@@ -133,6 +136,41 @@ MMAL_STATUS_T mmal_wrapper_buffer_get_empty(MMAL_PORT_T *port, MMAL_BUFFER_HEADE
  */
 MMAL_STATUS_T mmal_wrapper_buffer_get_full(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer, uint32_t flags);
 
+/** Wait for a limited time for an empty buffer to be available on a port.
+ * Only buffers coming back to this port wake the caller up.
+ *
+ * @param port port to get an empty buffer from
+ * @param buffer points to the retreived buffer on return
+ * @param flags specify MMAL_WRAPPER_FLAG_WAIT for a blocking operation
+ * @param timeout maximum time to block for, in milliseconds, or MMAL_WRAPPER_TIMEOUT_INFINITE
+ * @return MMAL_SUCCESS on success, MMAL_EAGAIN if no buffer became available in time.
+ */
+MMAL_STATUS_T mmal_wrapper_buffer_get_empty_timeout(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer,
+   uint32_t flags, uint32_t timeout);
+
+/** Wait for a limited time for a full buffer to be available on a port.
+ * Only buffers produced by this port wake the caller up.
+ *
+ * @param port port to get a full buffer from
+ * @param buffer points to the retreived buffer on return
+ * @param flags specify MMAL_WRAPPER_FLAG_WAIT for a blocking operation
+ * @param timeout maximum time to block for, in milliseconds, or MMAL_WRAPPER_TIMEOUT_INFINITE
+ * @return MMAL_SUCCESS on success, MMAL_EAGAIN if no buffer became available in time.
+ */
+MMAL_STATUS_T mmal_wrapper_buffer_get_full_timeout(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T **buffer,
+   uint32_t flags, uint32_t timeout);
+
+/** Get a file descriptor for waiting on a wrapper from a poll/select/epoll loop.
+ * The descriptor becomes readable whenever a buffer becomes available on any port
+ * of the wrapper or an error is reported. The client should read it (8 bytes) to
+ * reset it and then fetch buffers without MMAL_WRAPPER_FLAG_WAIT until MMAL_EAGAIN.
+ * The descriptor is owned by the wrapper and closed by mmal_wrapper_destroy.
+ *
+ * @param wrapper The wrapper to get the descriptor for.
+ * @return the file descriptor, or -1 if not supported on this platform.
+ */
+int mmal_wrapper_event_fd(MMAL_WRAPPER_T *wrapper);
+
 /** Cancel any ongoing blocking operation on a component wrapper.
  *
  * @param wrapper The wrapper on which to cancel operations.
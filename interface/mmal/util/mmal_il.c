@@ -28,6 +28,126 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mmal.h"
 #include "util/mmal_il.h"
 #include "interface/vmcs_host/khronos/IL/OMX_Broadcom.h"
+#include <string.h>
+
+/*****************************************************************************/
+/* The conversion tables below are the reference for each mapping, including
+ * which row wins when a value appears more than once. Rather than scanning
+ * them on every conversion, each column we look up by gets a small hash index
+ * built from the table the first time any conversion is done. */
+
+#define MMALIL_INDEX_BITS 7
+#define MMALIL_INDEX_SIZE (1 << MMALIL_INDEX_BITS) /**< At least twice the rows of any table */
+#define MMALIL_NO_KEY ((size_t)-1)
+
+typedef struct {
+   uint32_t key[MMALIL_INDEX_SIZE];
+   uint32_t key2[MMALIL_INDEX_SIZE];
+   uint8_t row[MMALIL_INDEX_SIZE]; /**< Table row + 1, or 0 for a free slot */
+   unsigned int rows;              /**< Row of the terminator, used when there's no match */
+} MMALIL_INDEX_T;
+
+static unsigned int mmalil_index_hash(uint32_t key, uint32_t key2)
+{
+   return ((key ^ (key2 * 0x9E3779B9u)) * 2654435761u) >> (32 - MMALIL_INDEX_BITS);
+}
+
+/** Read a key column, which may be an enum or an OMX_U32 (which is wider on some hosts) */
+static uint32_t mmalil_index_key(const uint8_t *field, size_t size)
+{
+   uint32_t key32;
+   uint64_t key64;
+
+   if (size == sizeof(key64))
+   {
+      memcpy(&key64, field, sizeof(key64));
+      return (uint32_t)key64;
+   }
+   vcos_assert(size == sizeof(key32));
+   memcpy(&key32, field, sizeof(key32));
+   return key32;
+}
+
+static void mmalil_index_build(MMALIL_INDEX_T *index, const void *table, unsigned int rows,
+   size_t stride, size_t offset, size_t size, size_t offset2, size_t size2)
+{
+   unsigned int r, i;
+
+   vcos_assert(rows * 2 <= MMALIL_INDEX_SIZE);
+   index->rows = rows;
+
+   for (r = 0; r < rows; r++)
+   {
+      const uint8_t *entry = (const uint8_t *)table + r * stride;
+      uint32_t key, key2 = 0;
+
+      key = mmalil_index_key(entry + offset, size);
+      if (offset2 != MMALIL_NO_KEY)
+         key2 = mmalil_index_key(entry + offset2, size2);
+
+      for (i = mmalil_index_hash(key, key2); index->row[i]; i = (i + 1) & (MMALIL_INDEX_SIZE - 1))
+         if (index->key[i] == key && index->key2[i] == key2)
+            break;
+      if (index->row[i])
+         continue; /* An earlier row already maps this value */
+
+      index->key[i] = key;
+      index->key2[i] = key2;
+      index->row[i] = r + 1;
+   }
+}
+
+/** Find the table row for a value, or the terminating row if there is none */
+static unsigned int mmalil_index_find(const MMALIL_INDEX_T *index, uint32_t key, uint32_t key2)
+{
+   unsigned int i;
+
+   for (i = mmalil_index_hash(key, key2); index->row[i]; i = (i + 1) & (MMALIL_INDEX_SIZE - 1))
+      if (index->key[i] == key && index->key2[i] == key2)
+         return index->row[i] - 1;
+   return index->rows;
+}
+
+#define MMALIL_FIELD_OFFSET(table, field) \
+   ((size_t)((const uint8_t *)&(table)[0].field - (const uint8_t *)&(table)[0]))
+
+/* Index a table by one column, or by a pair of columns. The terminator is always the last row. */
+#define MMALIL_INDEX_BUILD(index, table, field) \
+   mmalil_index_build(&(index), (table), MMAL_COUNTOF(table) - 1, sizeof((table)[0]), \
+      MMALIL_FIELD_OFFSET(table, field), sizeof((table)[0].field), MMALIL_NO_KEY, 0)
+#define MMALIL_INDEX_BUILD2(index, table, field, field2) \
+   mmalil_index_build(&(index), (table), MMAL_COUNTOF(table) - 1, sizeof((table)[0]), \
+      MMALIL_FIELD_OFFSET(table, field), sizeof((table)[0].field), \
+      MMALIL_FIELD_OFFSET(table, field2), sizeof((table)[0].field2))
+
+static MMALIL_INDEX_T mmalil_index_error_by_mmal;
+static MMALIL_INDEX_T mmalil_index_error_by_omx;
+static MMALIL_INDEX_T mmalil_index_es_type_by_type;
+static MMALIL_INDEX_T mmalil_index_es_type_by_domain;
+static MMALIL_INDEX_T mmalil_index_audio_coding_by_coding;
+static MMALIL_INDEX_T mmalil_index_audio_coding_by_encoding;
+static MMALIL_INDEX_T mmalil_index_video_coding_by_coding;
+static MMALIL_INDEX_T mmalil_index_video_coding_by_encoding;
+static MMALIL_INDEX_T mmalil_index_image_coding_by_coding;
+static MMALIL_INDEX_T mmalil_index_image_coding_by_encoding;
+static MMALIL_INDEX_T mmalil_index_colorformat_coding_by_coding;
+static MMALIL_INDEX_T mmalil_index_colorformat_coding_by_encoding;
+static MMALIL_INDEX_T mmalil_index_video_profile_by_omx_coding;
+static MMALIL_INDEX_T mmalil_index_video_profile_by_mmal;
+static MMALIL_INDEX_T mmalil_index_video_level_by_omx_coding;
+static MMALIL_INDEX_T mmalil_index_video_level_by_mmal;
+static MMALIL_INDEX_T mmalil_index_video_ratecontrol_by_omx;
+static MMALIL_INDEX_T mmalil_index_video_ratecontrol_by_mmal;
+
+static VCOS_ONCE_T mmalil_index_once = VCOS_ONCE_INIT;
+static void mmalil_index_init(void);
+
+#define MMALIL_LOOKUP(table, index, value, field) \
+   (vcos_once(&mmalil_index_once, mmalil_index_init), \
+    (table)[mmalil_index_find(&(index), (uint32_t)(value), 0)].field)
+#define MMALIL_LOOKUP2(table, index, value, value2, field) \
+   (vcos_once(&mmalil_index_once, mmalil_index_init), \
+    (table)[mmalil_index_find(&(index), (uint32_t)(value), (uint32_t)(value2))].field)
 
 /*****************************************************************************/
 static struct {
@@ -45,63 +165,73 @@ static struct {
 
 OMX_ERRORTYPE mmalil_error_to_omx(MMAL_STATUS_T status)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_error[i].mmal != (MMAL_STATUS_T)-1; i++)
-      if(mmal_omx_error[i].mmal == status) break;
-   return mmal_omx_error[i].omx;
+   return MMALIL_LOOKUP(mmal_omx_error, mmalil_index_error_by_mmal, status, omx);
 }
 
 MMAL_STATUS_T mmalil_error_to_mmal(OMX_ERRORTYPE error)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_error[i].mmal != (MMAL_STATUS_T)-1; i++)
-      if(mmal_omx_error[i].omx == error) break;
-   return mmal_omx_error[i].mmal;
+   return MMALIL_LOOKUP(mmal_omx_error, mmalil_index_error_by_omx, error, mmal);
 }
 
 /*****************************************************************************/
+/* Buffer flags are converted a nibble at a time through tables worked out by
+ * the compiler from these two mappings. */
+#define MMALIL_FLAGS_TO_OMX(f) ( \
+   ((f) & MMAL_BUFFER_HEADER_FLAG_KEYFRAME ? OMX_BUFFERFLAG_SYNCFRAME : 0) | \
+   ((f) & MMAL_BUFFER_HEADER_FLAG_FRAME_END ? OMX_BUFFERFLAG_ENDOFFRAME : 0) | \
+   ((f) & MMAL_BUFFER_HEADER_FLAG_EOS ? OMX_BUFFERFLAG_EOS : 0) | \
+   ((f) & MMAL_BUFFER_HEADER_FLAG_CONFIG ? OMX_BUFFERFLAG_CODECCONFIG : 0) | \
+   ((f) & MMAL_BUFFER_HEADER_FLAG_DISCONTINUITY ? OMX_BUFFERFLAG_DISCONTINUITY : 0) | \
+   ((f) & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO ? OMX_BUFFERFLAG_CODECSIDEINFO : 0) | \
+   ((f) & MMAL_BUFFER_HEADER_FLAGS_SNAPSHOT ? OMX_BUFFERFLAG_CAPTURE_PREVIEW : 0) )
+
+#define MMALIL_FLAGS_TO_MMAL(f) ( \
+   ((f) & OMX_BUFFERFLAG_SYNCFRAME ? MMAL_BUFFER_HEADER_FLAG_KEYFRAME : 0) | \
+   ((f) & OMX_BUFFERFLAG_ENDOFFRAME ? MMAL_BUFFER_HEADER_FLAG_FRAME_END : 0) | \
+   ((f) & OMX_BUFFERFLAG_EOS ? MMAL_BUFFER_HEADER_FLAG_EOS : 0) | \
+   ((f) & OMX_BUFFERFLAG_CODECCONFIG ? MMAL_BUFFER_HEADER_FLAG_CONFIG : 0) | \
+   ((f) & OMX_BUFFERFLAG_DISCONTINUITY ? MMAL_BUFFER_HEADER_FLAG_DISCONTINUITY : 0) | \
+   ((f) & OMX_BUFFERFLAG_CODECSIDEINFO ? MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO : 0) | \
+   ((f) & OMX_BUFFERFLAG_CAPTURE_PREVIEW ? MMAL_BUFFER_HEADER_FLAGS_SNAPSHOT : 0) )
+
+/* Every flag we map must fall within the nibbles covered by the tables */
+#define MMALIL_FLAGS_MMAL_NIBBLES 3
+#define MMALIL_FLAGS_OMX_NIBBLES 4
+vcos_static_assert(MMALIL_FLAGS_TO_OMX(~0u << (4 * MMALIL_FLAGS_MMAL_NIBBLES)) == 0);
+vcos_static_assert(MMALIL_FLAGS_TO_MMAL(~0u << (4 * MMALIL_FLAGS_OMX_NIBBLES)) == 0);
+
+#define MMALIL_NIBBLE_TABLE(M, s) { \
+   M(0u<<(s)),  M(1u<<(s)),  M(2u<<(s)),  M(3u<<(s)),  M(4u<<(s)),  M(5u<<(s)),  M(6u<<(s)),  M(7u<<(s)), \
+   M(8u<<(s)),  M(9u<<(s)),  M(10u<<(s)), M(11u<<(s)), M(12u<<(s)), M(13u<<(s)), M(14u<<(s)), M(15u<<(s)) }
+
+static const OMX_U32 mmalil_flags_to_omx_table[MMALIL_FLAGS_MMAL_NIBBLES][16] =
+{
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_OMX, 0),
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_OMX, 4),
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_OMX, 8),
+};
+
+static const uint32_t mmalil_flags_to_mmal_table[MMALIL_FLAGS_OMX_NIBBLES][16] =
+{
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_MMAL, 0),
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_MMAL, 4),
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_MMAL, 8),
+   MMALIL_NIBBLE_TABLE(MMALIL_FLAGS_TO_MMAL, 12),
+};
+
 OMX_U32 mmalil_buffer_flags_to_omx(uint32_t flags)
 {
-   OMX_U32 omx_flags = 0;
-
-   if(flags & MMAL_BUFFER_HEADER_FLAG_KEYFRAME)
-      omx_flags |= OMX_BUFFERFLAG_SYNCFRAME;
-   if(flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)
-      omx_flags |= OMX_BUFFERFLAG_ENDOFFRAME;
-   if(flags & MMAL_BUFFER_HEADER_FLAG_EOS)
-      omx_flags |= OMX_BUFFERFLAG_EOS;
-   if(flags & MMAL_BUFFER_HEADER_FLAG_CONFIG)
-      omx_flags |= OMX_BUFFERFLAG_CODECCONFIG;
-   if(flags & MMAL_BUFFER_HEADER_FLAG_DISCONTINUITY)
-      omx_flags |= OMX_BUFFERFLAG_DISCONTINUITY;
-   if (flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO)
-      omx_flags |= OMX_BUFFERFLAG_CODECSIDEINFO;
-   if (flags & MMAL_BUFFER_HEADER_FLAGS_SNAPSHOT)
-      omx_flags |= OMX_BUFFERFLAG_CAPTURE_PREVIEW;
-
-   return omx_flags;
+   return mmalil_flags_to_omx_table[0][flags & 0xf] |
+          mmalil_flags_to_omx_table[1][(flags >> 4) & 0xf] |
+          mmalil_flags_to_omx_table[2][(flags >> 8) & 0xf];
 }
 
 uint32_t mmalil_buffer_flags_to_mmal(OMX_U32 flags)
 {
-   uint32_t mmal_flags = 0;
-
-   if (flags & OMX_BUFFERFLAG_SYNCFRAME)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAG_KEYFRAME;
-   if (flags & OMX_BUFFERFLAG_ENDOFFRAME)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAG_FRAME_END;
-   if (flags & OMX_BUFFERFLAG_EOS)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAG_EOS;
-   if (flags & OMX_BUFFERFLAG_CODECCONFIG)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAG_CONFIG;
-   if (flags & OMX_BUFFERFLAG_DISCONTINUITY)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAG_DISCONTINUITY;
-   if (flags & OMX_BUFFERFLAG_CODECSIDEINFO)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO;
-   if (flags & OMX_BUFFERFLAG_CAPTURE_PREVIEW)
-      mmal_flags |= MMAL_BUFFER_HEADER_FLAGS_SNAPSHOT;
-
-   return mmal_flags;
+   return mmalil_flags_to_mmal_table[0][flags & 0xf] |
+          mmalil_flags_to_mmal_table[1][(flags >> 4) & 0xf] |
+          mmalil_flags_to_mmal_table[2][(flags >> 8) & 0xf] |
+          mmalil_flags_to_mmal_table[3][(flags >> 12) & 0xf];
 }
 
 /*****************************************************************************/
@@ -148,18 +278,12 @@ static struct {
 
 OMX_PORTDOMAINTYPE mmalil_es_type_to_omx_domain(MMAL_ES_TYPE_T type)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_es_type_table[i].type != MMAL_ES_TYPE_UNKNOWN; i++)
-      if(mmal_omx_es_type_table[i].type == type) break;
-   return mmal_omx_es_type_table[i].domain;
+   return MMALIL_LOOKUP(mmal_omx_es_type_table, mmalil_index_es_type_by_type, type, domain);
 }
 
 MMAL_ES_TYPE_T mmalil_omx_domain_to_es_type(OMX_PORTDOMAINTYPE domain)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_es_type_table[i].type != MMAL_ES_TYPE_UNKNOWN; i++)
-      if(mmal_omx_es_type_table[i].domain == domain) break;
-   return mmal_omx_es_type_table[i].type;
+   return MMALIL_LOOKUP(mmal_omx_es_type_table, mmalil_index_es_type_by_domain, domain, type);
 }
 
 /*****************************************************************************/
@@ -174,18 +298,12 @@ static struct {
 
 uint32_t mmalil_omx_audio_coding_to_encoding(OMX_AUDIO_CODINGTYPE coding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_audio_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_audio_coding_table[i].coding == coding) break;
-   return mmal_omx_audio_coding_table[i].encoding;
+   return MMALIL_LOOKUP(mmal_omx_audio_coding_table, mmalil_index_audio_coding_by_coding, coding, encoding);
 }
 
 OMX_VIDEO_CODINGTYPE mmalil_encoding_to_omx_audio_coding(uint32_t encoding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_audio_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_audio_coding_table[i].encoding == encoding) break;
-   return mmal_omx_audio_coding_table[i].coding;
+   return MMALIL_LOOKUP(mmal_omx_audio_coding_table, mmalil_index_audio_coding_by_encoding, encoding, coding);
 }
 
 /*****************************************************************************/
@@ -213,18 +331,12 @@ static struct {
 
 uint32_t mmalil_omx_video_coding_to_encoding(OMX_VIDEO_CODINGTYPE coding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_video_coding_table[i].coding == coding) break;
-   return mmal_omx_video_coding_table[i].encoding;
+   return MMALIL_LOOKUP(mmal_omx_video_coding_table, mmalil_index_video_coding_by_coding, coding, encoding);
 }
 
 OMX_VIDEO_CODINGTYPE mmalil_encoding_to_omx_video_coding(uint32_t encoding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_video_coding_table[i].encoding == encoding) break;
-   return mmal_omx_video_coding_table[i].coding;
+   return MMALIL_LOOKUP(mmal_omx_video_coding_table, mmalil_index_video_coding_by_encoding, encoding, coding);
 }
 
 /*****************************************************************************/
@@ -244,18 +356,12 @@ static struct {
 
 uint32_t mmalil_omx_image_coding_to_encoding(OMX_IMAGE_CODINGTYPE coding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_image_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_image_coding_table[i].coding == coding) break;
-   return mmal_omx_image_coding_table[i].encoding;
+   return MMALIL_LOOKUP(mmal_omx_image_coding_table, mmalil_index_image_coding_by_coding, coding, encoding);
 }
 
 OMX_IMAGE_CODINGTYPE mmalil_encoding_to_omx_image_coding(uint32_t encoding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_image_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_image_coding_table[i].encoding == encoding) break;
-   return mmal_omx_image_coding_table[i].coding;
+   return MMALIL_LOOKUP(mmal_omx_image_coding_table, mmalil_index_image_coding_by_encoding, encoding, coding);
 }
 
 uint32_t mmalil_omx_coding_to_encoding(uint32_t encoding, OMX_PORTDOMAINTYPE domain)
@@ -295,18 +401,12 @@ static struct {
 
 uint32_t mmalil_omx_color_format_to_encoding(OMX_COLOR_FORMATTYPE coding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_colorformat_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_colorformat_coding_table[i].coding == coding) break;
-   return mmal_omx_colorformat_coding_table[i].encoding;
+   return MMALIL_LOOKUP(mmal_omx_colorformat_coding_table, mmalil_index_colorformat_coding_by_coding, coding, encoding);
 }
 
 OMX_COLOR_FORMATTYPE mmalil_encoding_to_omx_color_format(uint32_t encoding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_colorformat_coding_table[i].encoding != MMAL_ENCODING_UNKNOWN; i++)
-      if(mmal_omx_colorformat_coding_table[i].encoding == encoding) break;
-   return mmal_omx_colorformat_coding_table[i].coding;
+   return MMALIL_LOOKUP(mmal_omx_colorformat_coding_table, mmalil_index_colorformat_coding_by_encoding, encoding, coding);
 }
 
 /*****************************************************************************/
@@ -353,19 +453,12 @@ static struct {
 
 uint32_t mmalil_omx_video_profile_to_mmal(OMX_U32 profile, OMX_VIDEO_CODINGTYPE coding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_profile_table[i].mmal != MMAL_VIDEO_PROFILE_DUMMY; i++)
-      if(mmal_omx_video_profile_table[i].omx == profile
-         && mmal_omx_video_profile_table[i].omx_coding == coding) break;
-   return mmal_omx_video_profile_table[i].mmal;
+   return MMALIL_LOOKUP2(mmal_omx_video_profile_table, mmalil_index_video_profile_by_omx_coding, profile, coding, mmal);
 }
 
 OMX_U32 mmalil_video_profile_to_omx(uint32_t profile)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_profile_table[i].mmal != MMAL_VIDEO_PROFILE_DUMMY; i++)
-      if(mmal_omx_video_profile_table[i].mmal == profile) break;
-   return mmal_omx_video_profile_table[i].omx;
+   return MMALIL_LOOKUP(mmal_omx_video_profile_table, mmalil_index_video_profile_by_mmal, profile, omx);
 }
 
 /*****************************************************************************/
@@ -413,19 +506,12 @@ static struct {
 
 uint32_t mmalil_omx_video_level_to_mmal(OMX_U32 level, OMX_VIDEO_CODINGTYPE coding)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_level_table[i].mmal != MMAL_VIDEO_LEVEL_DUMMY; i++)
-      if(mmal_omx_video_level_table[i].omx == level
-         && mmal_omx_video_level_table[i].omx_coding == coding) break;
-   return mmal_omx_video_level_table[i].mmal;
+   return MMALIL_LOOKUP2(mmal_omx_video_level_table, mmalil_index_video_level_by_omx_coding, level, coding, mmal);
 }
 
 OMX_U32 mmalil_video_level_to_omx(uint32_t level)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_level_table[i].mmal != MMAL_VIDEO_LEVEL_DUMMY; i++)
-      if(mmal_omx_video_level_table[i].mmal == level) break;
-   return mmal_omx_video_level_table[i].omx;
+   return MMALIL_LOOKUP(mmal_omx_video_level_table, mmalil_index_video_level_by_mmal, level, omx);
 }
 
 /*****************************************************************************/
@@ -444,16 +530,33 @@ static struct {
 
 MMAL_VIDEO_RATECONTROL_T mmalil_omx_video_ratecontrol_to_mmal(OMX_VIDEO_CONTROLRATETYPE omx)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_ratecontrol_table[i].mmal != MMAL_VIDEO_RATECONTROL_DUMMY; i++)
-      if(mmal_omx_video_ratecontrol_table[i].omx == omx) break;
-   return mmal_omx_video_ratecontrol_table[i].mmal;
+   return MMALIL_LOOKUP(mmal_omx_video_ratecontrol_table, mmalil_index_video_ratecontrol_by_omx, omx, mmal);
 }
 
 OMX_VIDEO_CONTROLRATETYPE mmalil_video_ratecontrol_to_omx(MMAL_VIDEO_RATECONTROL_T mmal)
 {
-   unsigned int i;
-   for(i = 0; mmal_omx_video_ratecontrol_table[i].mmal != MMAL_VIDEO_RATECONTROL_DUMMY; i++)
-      if(mmal_omx_video_ratecontrol_table[i].mmal == mmal) break;
-   return mmal_omx_video_ratecontrol_table[i].omx;
+   return MMALIL_LOOKUP(mmal_omx_video_ratecontrol_table, mmalil_index_video_ratecontrol_by_mmal, mmal, omx);
+}
+
+/*****************************************************************************/
+static void mmalil_index_init(void)
+{
+   MMALIL_INDEX_BUILD(mmalil_index_error_by_mmal, mmal_omx_error, mmal);
+   MMALIL_INDEX_BUILD(mmalil_index_error_by_omx, mmal_omx_error, omx);
+   MMALIL_INDEX_BUILD(mmalil_index_es_type_by_type, mmal_omx_es_type_table, type);
+   MMALIL_INDEX_BUILD(mmalil_index_es_type_by_domain, mmal_omx_es_type_table, domain);
+   MMALIL_INDEX_BUILD(mmalil_index_audio_coding_by_coding, mmal_omx_audio_coding_table, coding);
+   MMALIL_INDEX_BUILD(mmalil_index_audio_coding_by_encoding, mmal_omx_audio_coding_table, encoding);
+   MMALIL_INDEX_BUILD(mmalil_index_video_coding_by_coding, mmal_omx_video_coding_table, coding);
+   MMALIL_INDEX_BUILD(mmalil_index_video_coding_by_encoding, mmal_omx_video_coding_table, encoding);
+   MMALIL_INDEX_BUILD(mmalil_index_image_coding_by_coding, mmal_omx_image_coding_table, coding);
+   MMALIL_INDEX_BUILD(mmalil_index_image_coding_by_encoding, mmal_omx_image_coding_table, encoding);
+   MMALIL_INDEX_BUILD(mmalil_index_colorformat_coding_by_coding, mmal_omx_colorformat_coding_table, coding);
+   MMALIL_INDEX_BUILD(mmalil_index_colorformat_coding_by_encoding, mmal_omx_colorformat_coding_table, encoding);
+   MMALIL_INDEX_BUILD2(mmalil_index_video_profile_by_omx_coding, mmal_omx_video_profile_table, omx, omx_coding);
+   MMALIL_INDEX_BUILD(mmalil_index_video_profile_by_mmal, mmal_omx_video_profile_table, mmal);
+   MMALIL_INDEX_BUILD2(mmalil_index_video_level_by_omx_coding, mmal_omx_video_level_table, omx, omx_coding);
+   MMALIL_INDEX_BUILD(mmalil_index_video_level_by_mmal, mmal_omx_video_level_table, mmal);
+   MMALIL_INDEX_BUILD(mmalil_index_video_ratecontrol_by_omx, mmal_omx_video_ratecontrol_table, omx);
+   MMALIL_INDEX_BUILD(mmalil_index_video_ratecontrol_by_mmal, mmal_omx_video_ratecontrol_table, mmal);
 }
@@ -54,6 +54,8 @@ typedef struct MMAL_PORT_MODULE_T
    MMAL_BOOL_T zero_copy_workaround;
 
    MMAL_PORT_T *connected;           /**< Connected port if any */
+
+   struct MMAL_VC_PARAM_CACHE_T *param_cache; /**< Allocated on first cacheable get */
 } MMAL_PORT_MODULE_T;
 
 typedef struct MMAL_COMPONENT_MODULE_T
@@ -65,8 +67,71 @@ typedef struct MMAL_COMPONENT_MODULE_T
 
    MMAL_QUEUE_T *callback_queue;   /**< Used to queue the callbacks we need to make to the client */
 
+   /** Bumped whenever something may have changed the cached parameters of any port */
+   uint32_t param_generation;
+   VCOS_MUTEX_T param_lock;        /**< Protects param_generation, which any port may use */
+
 } MMAL_COMPONENT_MODULE_T;
 
+/** Parameters which only change when the component is reconfigured, so are
+ * worth keeping a copy of on the host. The list ones are always fetched in
+ * full so that a caller retrying with a bigger buffer after MMAL_ENOSPC
+ * (e.g. mmal_port_parameter_alloc_get) doesn't cost a second round trip. */
+static const struct {
+   uint32_t id;
+   MMAL_BOOL_T fetch_all;
+} mmal_vc_cached_params[] = {
+   {MMAL_PARAMETER_SUPPORTED_ENCODINGS, MMAL_TRUE},
+   {MMAL_PARAMETER_SUPPORTED_PROFILES, MMAL_TRUE},
+   {MMAL_PARAMETER_CAMERA_INFO, MMAL_FALSE},
+   {MMAL_PARAMETER_SENSOR_INFORMATION, MMAL_FALSE},
+};
+#define MMAL_VC_CACHED_PARAMS_NUM (sizeof(mmal_vc_cached_params)/sizeof(mmal_vc_cached_params[0]))
+
+/** A cached reply to a parameter get, one per entry in mmal_vc_cached_params */
+typedef struct MMAL_VC_PARAM_CACHE_T
+{
+   struct
+   {
+      uint32_t size;              /**< Size asked of VideoCore, 0 if nothing cached */
+      uint32_t generation;        /**< Component param_generation when fetched */
+      MMAL_STATUS_T status;       /**< MMAL_SUCCESS or MMAL_ENOSPC */
+      union
+      {
+         MMAL_PARAMETER_HEADER_T param;
+         uint8_t data[MMAL_WORKER_PORT_PARAMETER_GET_MAX];
+      } u;
+   } entry[MMAL_VC_CACHED_PARAMS_NUM];
+} MMAL_VC_PARAM_CACHE_T;
+
+/** Forget the cached parameters of every port of a component */
+static void mmal_vc_param_cache_invalidate(MMAL_COMPONENT_T *component)
+{
+   MMAL_COMPONENT_MODULE_T *module = component->priv->module;
+   vcos_mutex_lock(&module->param_lock);
+   module->param_generation++;
+   vcos_mutex_unlock(&module->param_lock);
+}
+
+static uint32_t mmal_vc_param_cache_generation(MMAL_COMPONENT_T *component)
+{
+   MMAL_COMPONENT_MODULE_T *module = component->priv->module;
+   uint32_t generation;
+   vcos_mutex_lock(&module->param_lock);
+   generation = module->param_generation;
+   vcos_mutex_unlock(&module->param_lock);
+   return generation;
+}
+
+static int mmal_vc_param_cache_index(uint32_t id)
+{
+   unsigned int i;
+   for (i = 0; i < MMAL_VC_CACHED_PARAMS_NUM; i++)
+      if (mmal_vc_cached_params[i].id == id)
+         return i;
+   return -1;
+}
+
 /*****************************************************************************
  * Local function prototypes
  *****************************************************************************/
@@ -590,6 +655,7 @@ static MMAL_STATUS_T mmal_vc_component_enable(MMAL_COMPONENT_T *component)
 static MMAL_STATUS_T mmal_vc_component_destroy(MMAL_COMPONENT_T *component)
 {
    MMAL_STATUS_T status;
+   unsigned int i;
    mmal_worker_component_destroy msg;
    mmal_worker_reply reply;
    size_t replylen = sizeof(reply);
@@ -613,11 +679,15 @@ static MMAL_STATUS_T mmal_vc_component_destroy(MMAL_COMPONENT_T *component)
       goto fail;
    }
 
+   for (i = 0; i < component->priv->module->ports_num; i++)
+      vcos_free(component->priv->module->ports[i]->param_cache);
+
    if(component->input_num)
       mmal_ports_free(component->input, component->input_num);
    if(component->output_num)
       mmal_ports_free(component->output, component->output_num);
 
+   vcos_mutex_delete(&component->priv->module->param_lock);
    vcos_free(component->priv->module);
    component->priv->module = NULL;
 
@@ -822,7 +892,15 @@ static MMAL_STATUS_T mmal_vc_port_set_format(MMAL_PORT_T *port)
    MMAL_STATUS_T status;
    unsigned int i;
 
+   /* The new format may change what the ports support */
+   mmal_vc_param_cache_invalidate(component);
+
    status = mmal_vc_port_info_set(port);
+
+   /* And again now it has been applied, so that a get on another port which
+    * was answered while the set was in flight is not kept */
+   mmal_vc_param_cache_invalidate(component);
+
    if (status != MMAL_SUCCESS)
    {
       LOG_ERROR("mmal_vc_port_info_set failed %p (%s)", port,
@@ -860,21 +938,12 @@ static MMAL_STATUS_T mmal_vc_port_set_format(MMAL_PORT_T *port)
    return MMAL_SUCCESS;
 }
 
-/** Set parameter on a port */
-static MMAL_STATUS_T mmal_vc_port_parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param)
+/** Fill in a parameter set message, intercepting anything we need to know about.
+ * Returns the length of the message. */
+static size_t mmal_vc_port_parameter_set_prepare(MMAL_PORT_T *port,
+   const MMAL_PARAMETER_HEADER_T *param, mmal_worker_port_param_set *msg)
 {
    MMAL_PORT_MODULE_T *module = port->priv->module;
-   MMAL_STATUS_T status;
-   mmal_worker_port_param_set msg;
-   size_t msglen = MMAL_OFFSET(mmal_worker_port_param_set, param) + param->size;
-   mmal_worker_reply reply;
-   size_t replylen = sizeof(reply);
-
-   if(param->size > MMAL_WORKER_PORT_PARAMETER_SET_MAX)
-   {
-      LOG_ERROR("parameter too large (%u > %u)", param->size, MMAL_WORKER_PORT_PARAMETER_SET_MAX);
-      return MMAL_ENOSPC;
-   }
 
    /* Intercept the zero copy parameter */
    if (param->id == MMAL_PARAMETER_ZERO_COPY &&
@@ -885,22 +954,23 @@ static MMAL_STATUS_T mmal_vc_port_parameter_set(MMAL_PORT_T *port, const MMAL_PA
       LOG_DEBUG("%s zero copy on port %p", module->is_zero_copy ? "enable" : "disable", port);
    }
 
-   msg.component_handle = module->component_handle;
-   msg.port_handle = module->port_handle;
-   memcpy(&msg.param, param, param->size);
+   msg->component_handle = module->component_handle;
+   msg->port_handle = module->port_handle;
+   memcpy(&msg->param, param, param->size);
 
-   status = mmal_vc_sendwait_message(mmal_vc_get_client(), &msg.header, msglen,
-                                     MMAL_WORKER_PORT_PARAMETER_SET, &reply, &replylen);
+   return MMAL_OFFSET(mmal_worker_port_param_set, param) + param->size;
+}
+
+/** Deal with the outcome of a parameter set */
+static MMAL_STATUS_T mmal_vc_port_parameter_set_done(MMAL_PORT_T *port,
+   const MMAL_PARAMETER_HEADER_T *param, MMAL_STATUS_T status)
+{
+   MMAL_PORT_MODULE_T *module = port->priv->module;
 
-   if (status == MMAL_SUCCESS)
-   {
-      vcos_assert(replylen == sizeof(reply));
-      status = reply.status;
-   }
    if (status != MMAL_SUCCESS)
    {
-      LOG_ERROR("failed to set port parameter %u:%u:%s", msg.component_handle, msg.port_handle,
-                mmal_status_to_string(status));
+      LOG_ERROR("failed to set port parameter %u:%u:%s", module->component_handle,
+                module->port_handle, mmal_status_to_string(status));
       return status;
    }
 
@@ -918,14 +988,105 @@ static MMAL_STATUS_T mmal_vc_port_parameter_set(MMAL_PORT_T *port, const MMAL_PA
    return status;
 }
 
+/** Set parameter on a port */
+static MMAL_STATUS_T mmal_vc_port_parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param)
+{
+   MMAL_STATUS_T status;
+   mmal_worker_port_param_set msg;
+   size_t msglen;
+   mmal_worker_reply reply;
+   size_t replylen = sizeof(reply);
+
+   if(param->size > MMAL_WORKER_PORT_PARAMETER_SET_MAX)
+   {
+      LOG_ERROR("parameter too large (%u > %u)", param->size, MMAL_WORKER_PORT_PARAMETER_SET_MAX);
+      return MMAL_ENOSPC;
+   }
+
+   msglen = mmal_vc_port_parameter_set_prepare(port, param, &msg);
+
+   /* Any parameter may affect what the ports report */
+   mmal_vc_param_cache_invalidate(port->component);
+
+   status = mmal_vc_sendwait_message(mmal_vc_get_client(), &msg.header, msglen,
+                                     MMAL_WORKER_PORT_PARAMETER_SET, &reply, &replylen);
+
+   /* And again now it has been applied, so that a get on another port which
+    * was answered while the set was in flight is not kept */
+   mmal_vc_param_cache_invalidate(port->component);
+
+   if (status == MMAL_SUCCESS)
+   {
+      vcos_assert(replylen == sizeof(reply));
+      status = reply.status;
+   }
+
+   return mmal_vc_port_parameter_set_done(port, param, status);
+}
+
+/** Set several parameters on a port, sending them all before waiting for the replies */
+static MMAL_STATUS_T mmal_vc_port_parameter_set_multi(MMAL_PORT_T *port,
+   const MMAL_PARAMETER_HEADER_T * const *params, MMAL_STATUS_T *status, unsigned int num)
+{
+   union
+   {
+      mmal_worker_port_param_set msg;
+      mmal_worker_reply reply;
+   } *msgs;
+   size_t sizes[MMAL_PORT_PARAMETER_SET_MULTI_MAX];
+   unsigned int index[MMAL_PORT_PARAMETER_SET_MULTI_MAX];
+   unsigned int i, count = 0, replies;
+
+   vcos_assert(num <= MMAL_PORT_PARAMETER_SET_MULTI_MAX);
+
+   msgs = vcos_malloc(num * sizeof(*msgs), "mmal_vc param set");
+   if (!msgs)
+   {
+      for (i = 0; i < num; i++)
+         status[i] = mmal_vc_port_parameter_set(port, params[i]);
+      return MMAL_SUCCESS;
+   }
+
+   for (i = 0; i < num; i++)
+   {
+      if(params[i]->size > MMAL_WORKER_PORT_PARAMETER_SET_MAX)
+      {
+         LOG_ERROR("parameter too large (%u > %u)", params[i]->size,
+                   (unsigned int)MMAL_WORKER_PORT_PARAMETER_SET_MAX);
+         status[i] = MMAL_ENOSPC;
+         continue;
+      }
+      sizes[count] = mmal_vc_port_parameter_set_prepare(port, params[i], &msgs[count].msg);
+      index[count++] = i;
+   }
+
+   mmal_vc_param_cache_invalidate(port->component);
+
+   mmal_vc_sendwait_messages(mmal_vc_get_client(), msgs, sizeof(*msgs), sizes, count,
+                             MMAL_WORKER_PORT_PARAMETER_SET, &replies);
+
+   mmal_vc_param_cache_invalidate(port->component);
+
+   for (i = 0; i < count; i++)
+      status[index[i]] = mmal_vc_port_parameter_set_done(port, params[index[i]],
+                                                        i < replies ? msgs[i].reply.status : MMAL_EIO);
+
+   vcos_free(msgs);
+   return MMAL_SUCCESS;
+}
+
 /** Get parameter on a port */
 static MMAL_STATUS_T mmal_vc_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param)
 {
    MMAL_PORT_MODULE_T *module = port->priv->module;
+   MMAL_COMPONENT_MODULE_T *component_module = port->component->priv->module;
    MMAL_STATUS_T status;
    mmal_worker_port_param_get msg;
    mmal_worker_port_param_get_reply reply;
-   size_t replylen = MMAL_OFFSET(mmal_worker_port_param_get_reply, param) + param->size;
+   const MMAL_PARAMETER_HEADER_T *result = &reply.param;
+   size_t replylen;
+   uint32_t generation = mmal_vc_param_cache_generation(port->component);
+   int cache_index = mmal_vc_param_cache_index(param->id);
 
    if(param->size > MMAL_WORKER_PORT_PARAMETER_GET_MAX)
    {
@@ -937,6 +1098,25 @@ static MMAL_STATUS_T mmal_vc_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETE
    msg.port_handle = module->port_handle;
    msg.param = *param;
 
+   if (cache_index >= 0)
+   {
+      if (mmal_vc_cached_params[cache_index].fetch_all)
+         msg.param.size = MMAL_WORKER_PORT_PARAMETER_GET_MAX;
+
+      if (!module->param_cache)
+         module->param_cache = vcos_calloc(1, sizeof(*module->param_cache), "mmal_vc param cache");
+
+      if (module->param_cache &&
+          module->param_cache->entry[cache_index].size == msg.param.size &&
+          module->param_cache->entry[cache_index].generation == generation)
+      {
+         status = module->param_cache->entry[cache_index].status;
+         result = &module->param_cache->entry[cache_index].u.param;
+         goto copy;
+      }
+   }
+
+   replylen = MMAL_OFFSET(mmal_worker_port_param_get_reply, param) + msg.param.size;
    status = mmal_vc_sendwait_message(mmal_vc_get_client(), &msg.header, sizeof(msg),
                                      MMAL_WORKER_PORT_PARAMETER_GET, &reply, &replylen);
    if (status == MMAL_SUCCESS)
@@ -951,8 +1131,8 @@ static MMAL_STATUS_T mmal_vc_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETE
        */
       if ( status == MMAL_SUCCESS )
       {
-         /* Reply mustn't be bigger than the parameter given */
-         vcos_assert(replylen <= (MMAL_OFFSET(mmal_worker_port_param_get_reply, param) + param->size));
+         /* Reply mustn't be bigger than the parameter asked for */
+         vcos_assert(replylen <= (MMAL_OFFSET(mmal_worker_port_param_get_reply, param) + msg.param.size));
          /* Reply must be consistent with the parameter size embedded in it */
          vcos_assert(replylen == (MMAL_OFFSET(mmal_worker_port_param_get_reply, param) + reply.param.size));
       }
@@ -963,16 +1143,38 @@ static MMAL_STATUS_T mmal_vc_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETE
       LOG_ERROR("failed to get port parameter %u:%u", msg.component_handle, msg.port_handle);
       return status;
    }
-   
+
+   /* Only keep it if nothing was changed while we were asking */
+   if (cache_index >= 0 && module->param_cache)
+   {
+      vcos_mutex_lock(&component_module->param_lock);
+      if (generation == component_module->param_generation)
+      {
+         module->param_cache->entry[cache_index].size = msg.param.size;
+         module->param_cache->entry[cache_index].generation = generation;
+         module->param_cache->entry[cache_index].status = status;
+         memcpy(&module->param_cache->entry[cache_index].u, &reply.param,
+                vcos_min(reply.param.size, msg.param.size));
+         module->param_cache->entry[cache_index].u.param.size = reply.param.size;
+      }
+      vcos_mutex_unlock(&component_module->param_lock);
+   }
+
+ copy:
+   /* We may have asked for more than the caller has room for */
+   if (status == MMAL_SUCCESS && result->size > param->size)
+      status = MMAL_ENOSPC;
+
    if (status == MMAL_ENOSPC)
    {
       /* Copy only as much as we have space for but report true size of parameter */
-      memcpy(param, &reply.param, param->size);
-      param->size = reply.param.size;
+      uint32_t size = result->size;
+      memcpy(param, result, param->size);
+      param->size = size;
    }
    else
    {
-      memcpy(param, &reply.param, reply.param.size);
+      memcpy(param, result, result->size);
    }
 
    return status;
@@ -1111,6 +1313,11 @@ static MMAL_STATUS_T mmal_vc_component_create(const char *name, MMAL_COMPONENT_T
    status = MMAL_ENOMEM;
    ports_num = 1 + reply.input_num + reply.output_num;
    module = vcos_calloc(1, sizeof(*module) + ports_num * sizeof(*module->ports), "mmal_vc_module");
+   if (module && vcos_mutex_create(&module->param_lock, "mmal_vc param") != VCOS_SUCCESS)
+   {
+      vcos_free(module);
+      module = NULL;
+   }
    if (!module)
    {
       mmal_worker_component_destroy msg;
@@ -1187,6 +1394,7 @@ static MMAL_STATUS_T mmal_vc_component_create(const char *name, MMAL_COMPONENT_T
       port->priv->pf_connect = mmal_vc_port_connect;
       port->priv->pf_parameter_set = mmal_vc_port_parameter_set;
       port->priv->pf_parameter_get = mmal_vc_port_parameter_get;
+      port->priv->pf_parameter_set_multi = mmal_vc_port_parameter_set_multi;
       port->priv->pf_payload_alloc = mmal_vc_port_payload_alloc;
       port->priv->pf_payload_free = mmal_vc_port_payload_free;
       port->priv->module->component_handle = module->component_handle;
@@ -135,14 +135,12 @@ static void destroy_waitpool(MMAL_WAITPOOL_T *waitpool)
    vcos_semaphore_delete(&waitpool->sem);
 }
 
-/** Grab a waiter from the pool. Return immediately if one already
-  * available, or wait for one to become available.
+/** Claim a free waiter once the pool semaphore has been taken.
   */
-static MMAL_WAITER_T *get_waiter(MMAL_CLIENT_T *client)
+static MMAL_WAITER_T *take_waiter(MMAL_CLIENT_T *client)
 {
    int i;
    MMAL_WAITER_T *waiter = NULL;
-   vcos_semaphore_wait(&client->waitpool.sem);
    vcos_mutex_lock(&client->lock);
    for (i=0; i<MAX_WAITERS; i++)
    {
@@ -157,6 +155,15 @@ static MMAL_WAITER_T *get_waiter(MMAL_CLIENT_T *client)
    return waiter;
 }
 
+/** Grab a waiter from the pool. Return immediately if one already
+  * available, or wait for one to become available.
+  */
+static MMAL_WAITER_T *get_waiter(MMAL_CLIENT_T *client)
+{
+   vcos_semaphore_wait(&client->waitpool.sem);
+   return take_waiter(client);
+}
+
 /** Return a waiter to the pool.
   */
 static void release_waiter(MMAL_CLIENT_T *client, MMAL_WAITER_T *waiter)
@@ -515,6 +522,96 @@ fail_msg:
    return ret;
 }
 
+/** Send a run of messages of the same type and wait for all the replies.
+  *
+  * The messages are queued back to back so that VideoCore can work on one
+  * while the next is in flight, rather than paying a full round trip for
+  * each. A waiter is only blocked for when we have no replies of our own
+  * outstanding, so this can't deadlock against other threads doing the same.
+  *
+  * @param client       client to send messages for
+  * @param msgs         array of count buffers, each starting with a message
+  *                     header; each reply overwrites the message it answers
+  * @param stride       size of each buffer, and so the longest reply allowed
+  * @param sizes        length of each message, including header, or NULL if
+  *                     they are all stride bytes long
+  * @param count        number of messages
+  * @param msgid        message id
+  * @param replies      if not NULL, set to the number of messages answered;
+  *                     these are always the first ones in the array
+  * @return MMAL_SUCCESS if every message was sent and answered, otherwise
+  *         MMAL_EIO.
+  */
+MMAL_STATUS_T mmal_vc_sendwait_messages(MMAL_CLIENT_T *client,
+                                        void *msgs, size_t stride,
+                                        const size_t *sizes,
+                                        unsigned int count,
+                                        uint32_t msgid,
+                                        unsigned int *replies)
+{
+   MMAL_WAITER_T *waiters[MAX_WAITERS];
+   MMAL_STATUS_T ret = MMAL_SUCCESS;
+   unsigned int sent = 0, done = 0;
+
+   vcos_assert(stride >= sizeof(mmal_worker_msg_header));
+   if (replies)
+      *replies = 0;
+
+   if (!client->inited)
+   {
+      vcos_assert(0);
+      return MMAL_EINVAL;
+   }
+
+   vchiq_use_service(client->service);
+
+   while (done < sent || (sent < count && ret == MMAL_SUCCESS))
+   {
+      MMAL_WAITER_T *waiter = NULL;
+
+      if (sent < count && ret == MMAL_SUCCESS)
+      {
+         if (done == sent)
+            waiter = get_waiter(client);
+         else if (vcos_semaphore_trywait(&client->waitpool.sem) == VCOS_SUCCESS)
+            waiter = take_waiter(client);
+      }
+
+      if (waiter)
+      {
+         mmal_worker_msg_header *msg_header =
+            (mmal_worker_msg_header *)((uint8_t *)msgs + sent * stride);
+         VCHIQ_ELEMENT_T elems[] = {{msg_header, sizes ? sizes[sent] : stride}};
+
+         vcos_assert((size_t)elems[0].size >= sizeof(mmal_worker_msg_header));
+         msg_header->msgid  = msgid;
+         msg_header->u.waiter = waiter;
+         msg_header->magic  = MMAL_MAGIC;
+         waiter->dest    = msg_header;
+         waiter->destlen = stride;
+
+         if (vchiq_queue_message(client->service, elems, 1) != VCHIQ_SUCCESS)
+         {
+            release_waiter(client, waiter);
+            ret = MMAL_EIO;
+            continue;
+         }
+         waiters[sent++ % MAX_WAITERS] = waiter;
+         continue;
+      }
+
+      /* Out of waiters (or nothing left to send): collect our oldest reply */
+      waiter = waiters[done++ % MAX_WAITERS];
+      vcos_semaphore_wait(&waiter->sem);
+      release_waiter(client, waiter);
+   }
+
+   vchiq_release_service(client->service);
+   if (replies)
+      *replies = done;
+   return ret;
+}
+
 /** Send a message and do not wait for a reply.
   *
   * @param client       client to send message for
@@ -67,6 +67,13 @@ MMAL_STATUS_T mmal_vc_sendwait_message(MMAL_CLIENT_T *client,
                                        void *dest,
                                        size_t *destlen);
 
+MMAL_STATUS_T mmal_vc_sendwait_messages(MMAL_CLIENT_T *client,
+                                        void *msgs, size_t stride,
+                                        const size_t *sizes,
+                                        unsigned int count,
+                                        uint32_t msgid,
+                                        unsigned int *replies);
+
 MMAL_STATUS_T mmal_vc_send_message(MMAL_CLIENT_T *client,
                                    mmal_worker_msg_header *header, size_t size,
                                    uint8_t *data, size_t data_size,
@@ -29,53 +29,241 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mmal_vc_msgs.h"
 #include "mmal_vc_client_priv.h"
 
-MMAL_OPAQUE_IMAGE_HANDLE_T mmal_vc_opaque_alloc(void)
+/** Most messages sent to VideoCore in one go, as many as the client
+ * can have waiting for replies at once */
+#define OPAQUE_BATCH_MAX 16
+
+/** References we hold on a handle. VideoCore only ever sees one of them;
+ * the rest are counted here so acquire/release pairs cost nothing. */
+typedef struct
+{
+   MMAL_OPAQUE_IMAGE_HANDLE_T handle; /**< 0 for an empty slot */
+   unsigned int refs;
+} OPAQUE_REF_T;
+
+static struct
+{
+   VCOS_MUTEX_T lock;
+
+   /** Handles allocated ahead of time and not yet handed out */
+   MMAL_OPAQUE_IMAGE_HANDLE_T spare[OPAQUE_BATCH_MAX];
+   unsigned int spare_num;
+
+   /** Open-addressed hash of the handles we hold references on */
+   OPAQUE_REF_T *ref;
+   unsigned int ref_size;  /**< power of 2, or 0 before first use */
+   unsigned int ref_num;
+} opaque;
+
+static VCOS_ONCE_T opaque_once = VCOS_ONCE_INIT;
+
+static void opaque_init_once(void)
+{
+   vcos_mutex_create(&opaque.lock, "mmal opaque");
+}
+
+static unsigned int opaque_hash(MMAL_OPAQUE_IMAGE_HANDLE_T h)
+{
+   return (h * 2654435761u) & (opaque.ref_size - 1);
+}
+
+static OPAQUE_REF_T *opaque_ref_find(MMAL_OPAQUE_IMAGE_HANDLE_T h)
+{
+   unsigned int i;
+
+   if (!opaque.ref_size)
+      return NULL;
+
+   for (i = opaque_hash(h); opaque.ref[i].handle; i = (i + 1) & (opaque.ref_size - 1))
+      if (opaque.ref[i].handle == h)
+         return &opaque.ref[i];
+   return NULL;
+}
+
+static OPAQUE_REF_T *opaque_ref_insert(MMAL_OPAQUE_IMAGE_HANDLE_T h, unsigned int refs)
+{
+   unsigned int i;
+
+   /* Keep the table at most half full */
+   if ((opaque.ref_num + 1) * 2 > opaque.ref_size)
+   {
+      unsigned int old_size = opaque.ref_size, size = old_size ? old_size * 2 : 64;
+      OPAQUE_REF_T *old = opaque.ref, *ref = vcos_calloc(size, sizeof(*ref), "mmal opaque refs");
+
+      if (!ref)
+         return NULL;
+      opaque.ref = ref;
+      opaque.ref_size = size;
+      opaque.ref_num = 0;
+      for (i = 0; i < old_size; i++)
+         if (old[i].handle)
+            opaque_ref_insert(old[i].handle, old[i].refs);
+      vcos_free(old);
+   }
+
+   for (i = opaque_hash(h); opaque.ref[i].handle; i = (i + 1) & (opaque.ref_size - 1))
+      continue;
+   opaque.ref[i].handle = h;
+   opaque.ref[i].refs = refs;
+   opaque.ref_num++;
+   return &opaque.ref[i];
+}
+
+static void opaque_ref_remove(OPAQUE_REF_T *ref)
 {
+   unsigned int mask = opaque.ref_size - 1, i = ref - opaque.ref, j = i;
+
+   /* Shift back any entries in the same run that hash at or before the hole */
+   for (;;)
+   {
+      unsigned int home;
+
+      j = (j + 1) & mask;
+      if (!opaque.ref[j].handle)
+         break;
+      home = opaque_hash(opaque.ref[j].handle);
+      if (((j - home) & mask) >= ((j - i) & mask))
+      {
+         opaque.ref[i] = opaque.ref[j];
+         i = j;
+      }
+   }
+   opaque.ref[i].handle = 0;
+   opaque.ref_num--;
+}
+
+/** Send the same operation for a number of handles in one pipelined batch.
+ * On return handles[] holds the handle from each reply and status[] (if
+ * not NULL) the status of each. */
+static MMAL_STATUS_T opaque_send(MMAL_WORKER_OPAQUE_MEM_OP op,
+   MMAL_OPAQUE_IMAGE_HANDLE_T *handles, MMAL_STATUS_T *status, unsigned int count)
+{
+   mmal_worker_opaque_allocator msg[OPAQUE_BATCH_MAX];
    MMAL_STATUS_T ret;
+   unsigned int i, replies;
+
+   vcos_assert(count <= OPAQUE_BATCH_MAX);
+   for (i = 0; i < count; i++)
+   {
+      msg[i].op = op;
+      msg[i].handle = handles[i];
+   }
+
+   ret = mmal_vc_sendwait_messages(mmal_vc_get_client(), msg, sizeof(msg[0]), NULL, count,
+                                   MMAL_WORKER_OPAQUE_ALLOCATOR, &replies);
+
+   for (i = 0; i < count; i++)
+   {
+      /* A message that never got a reply has no handle or status */
+      if (i >= replies)
+      {
+         msg[i].handle = 0;
+         msg[i].status = MMAL_EIO;
+      }
+      handles[i] = msg[i].handle;
+      if (status)
+         status[i] = msg[i].status;
+   }
+   return ret;
+}
+
+/** Give back spare handles beyond the number still in use, so a pool
+ * that shrinks (or goes away) doesn't leave them allocated */
+static void opaque_trim(void)
+{
+   unsigned int excess;
+
+   if (opaque.spare_num <= opaque.ref_num)
+      return;
+   excess = opaque.spare_num - opaque.ref_num;
+   opaque.spare_num -= excess;
+   opaque_send(MMAL_WORKER_OPAQUE_MEM_RELEASE, opaque.spare + opaque.spare_num, NULL, excess);
+}
+
+MMAL_OPAQUE_IMAGE_HANDLE_T mmal_vc_opaque_alloc(void)
+{
    MMAL_OPAQUE_IMAGE_HANDLE_T h = 0;
-   mmal_worker_opaque_allocator msg;
-   size_t len = sizeof(msg);
-   msg.op = MMAL_WORKER_OPAQUE_MEM_ALLOC;
-   ret = mmal_vc_sendwait_message(mmal_vc_get_client(),
-                                  &msg.header, sizeof(msg),
-                                  MMAL_WORKER_OPAQUE_ALLOCATOR,
-                                  &msg, &len);
-   if (ret == MMAL_SUCCESS)
+
+   vcos_once(&opaque_once, opaque_init_once);
+   vcos_mutex_lock(&opaque.lock);
+
+   if (!opaque.spare_num)
+   {
+      /* Allocate about as many again as are already in use, up to a
+       * batch, so filling a pool of N images takes log2(N) batches up to
+       * 2 * OPAQUE_BATCH_MAX images and one per OPAQUE_BATCH_MAX after
+       * that, without ever holding more spares than images in use */
+      MMAL_OPAQUE_IMAGE_HANDLE_T handles[OPAQUE_BATCH_MAX];
+      unsigned int i, count = vcos_max(1, vcos_min(opaque.ref_num, OPAQUE_BATCH_MAX));
+
+      opaque_send(MMAL_WORKER_OPAQUE_MEM_ALLOC, handles, NULL, count);
+      for (i = 0; i < count; i++)
+         if (handles[i])
+            opaque.spare[opaque.spare_num++] = handles[i];
+   }
+
+   if (opaque.spare_num)
    {
-      h = msg.handle;
+      h = opaque.spare[--opaque.spare_num];
+      /* If we can't track it, it will simply be released directly */
+      opaque_ref_insert(h, 1);
    }
+
+   vcos_mutex_unlock(&opaque.lock);
    return h;
 }
 
 MMAL_STATUS_T mmal_vc_opaque_acquire(unsigned int handle)
 {
-   MMAL_STATUS_T ret;
-   mmal_worker_opaque_allocator msg;
-   size_t len = sizeof(msg);
-   msg.handle = handle;
-   msg.op = MMAL_WORKER_OPAQUE_MEM_ACQUIRE;
-   ret = mmal_vc_sendwait_message(mmal_vc_get_client(),
-                                  &msg.header, sizeof(msg),
-                                  MMAL_WORKER_OPAQUE_ALLOCATOR,
-                                  &msg, &len);
-   if (ret == MMAL_SUCCESS)
-      ret = msg.status;
+   OPAQUE_REF_T *ref;
+   MMAL_STATUS_T ret = MMAL_SUCCESS, status;
+
+   vcos_once(&opaque_once, opaque_init_once);
+   vcos_mutex_lock(&opaque.lock);
+
+   ref = opaque_ref_find(handle);
+   if (ref)
+   {
+      /* We already hold one on VideoCore, which keeps the image alive */
+      ref->refs++;
+   }
+   else
+   {
+      ret = opaque_send(MMAL_WORKER_OPAQUE_MEM_ACQUIRE, &handle, &status, 1);
+      if (ret == MMAL_SUCCESS)
+         ret = status;
+      if (ret == MMAL_SUCCESS)
+         opaque_ref_insert(handle, 1);
+   }
+
+   vcos_mutex_unlock(&opaque.lock);
    return ret;
 }
 
 MMAL_STATUS_T mmal_vc_opaque_release(unsigned int handle)
 {
-   MMAL_STATUS_T ret;
-   mmal_worker_opaque_allocator msg;
-   size_t len = sizeof(msg);
-   msg.handle = handle;
-   msg.op = MMAL_WORKER_OPAQUE_MEM_RELEASE;
-   ret = mmal_vc_sendwait_message(mmal_vc_get_client(),
-                                  &msg.header, sizeof(msg),
-                                  MMAL_WORKER_OPAQUE_ALLOCATOR,
-                                  &msg, &len);
-   if (ret == MMAL_SUCCESS)
-      ret = msg.status;
+   OPAQUE_REF_T *ref;
+   MMAL_STATUS_T ret = MMAL_SUCCESS, status;
+
+   vcos_once(&opaque_once, opaque_init_once);
+   vcos_mutex_lock(&opaque.lock);
+
+   ref = opaque_ref_find(handle);
+   if (ref && ref->refs > 1)
+   {
+      ref->refs--;
+   }
+   else
+   {
+      /* Last reference (or one we never tracked): drop it on VideoCore */
+      if (ref)
+         opaque_ref_remove(ref);
+      ret = opaque_send(MMAL_WORKER_OPAQUE_MEM_RELEASE, &handle, &status, 1);
+      if (ret == MMAL_SUCCESS)
+         ret = status;
+      opaque_trim();
+   }
+
+   vcos_mutex_unlock(&opaque.lock);
    return ret;
 }
-
@@ -0,0 +1,222 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Latency benchmark for the host application's input thread.
+ *
+ * input_latency_bench [-n presses] [-i idle_ms]
+ *
+ * Creates a uinput device with "vcbuttons" in its name, which
+ * message_queue_init opens as the button device, then presses and releases
+ * BTN_0 <presses> times. The handler measures the time from writing each
+ * event to the dispatch of its PLATFORM_MSG_BUTTON_PRESS or
+ * PLATFORM_MSG_BUTTON_RELEASE message. Before that it counts the context
+ * switches the process makes during <idle_ms> with no input, which is the
+ * cost of any polling.
+ *
+ * Needs write access to /dev/uinput, and the new device must be one of
+ * /dev/input/event0 to event7, since those are the only ones searched.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "interface/vcos/vcos.h"
+#include "host_applications/framework/host_app.h"
+#include "host_applications/framework/platform.h"
+#include "interface/usbdk/vmcs_rpc_client/message_dispatch.h"
+
+#define BENCH_TIMEOUT_MS  1000
+
+static VCOS_THREAD_T dispatcher;
+static VCOS_SEMAPHORE_T delivered;
+
+/* written by the main thread before each event, read by the handler */
+static volatile uint16_t expected_msg;
+static volatile uint64_t sent_at;
+static volatile uint64_t latency;
+
+void
+host_app_message_handler (const uint16_t msg, const uint32_t param1,
+                          const uint32_t param2)
+{
+  if (msg != expected_msg)
+    return;
+  latency = vcos_getmicrosecs64 () - sent_at;
+  expected_msg = 0;
+  vcos_semaphore_post (&delivered);
+}
+
+static void *
+dispatcher_task (void *arg)
+{
+  dispatch_messages ();
+  return NULL;
+}
+
+static int
+emit (int fd, int type, int code, int value)
+{
+  struct input_event ev;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  return write (fd, &ev, sizeof (ev)) == sizeof (ev) ? 0 : -1;
+}
+
+static int
+uinput_create (void)
+{
+  struct uinput_user_dev dev;
+  int fd;
+
+  fd = open ("/dev/uinput", O_WRONLY | O_NONBLOCK);
+  if (fd < 0)
+    return -1;
+
+  memset (&dev, 0, sizeof (dev));
+  snprintf (dev.name, sizeof (dev.name), "input_latency_bench vcbuttons");
+  dev.id.bustype = BUS_VIRTUAL;
+
+  if (ioctl (fd, UI_SET_EVBIT, EV_KEY) < 0 ||
+      ioctl (fd, UI_SET_KEYBIT, BTN_0) < 0 ||
+      write (fd, &dev, sizeof (dev)) != sizeof (dev) ||
+      ioctl (fd, UI_DEV_CREATE) < 0)
+    {
+      close (fd);
+      return -1;
+    }
+  return fd;
+}
+
+static long
+context_switches (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const uint16_t msgs[2] = { PLATFORM_MSG_BUTTON_RELEASE, PLATFORM_MSG_BUTTON_PRESS };
+  uint64_t total[2] = { 0, 0 }, max[2] = { 0, 0 };
+  int count[2] = { 0, 0 };
+  int presses = 1000, idle_ms = 1000, timeouts = 0;
+  int fd, opt, i, value;
+  long switches;
+
+  while ((opt = getopt (argc, argv, "n:i:")) != -1)
+    {
+      switch (opt)
+        {
+        case 'n': presses = atoi (optarg); break;
+        case 'i': idle_ms = atoi (optarg); break;
+        default:
+          printf ("Usage: %s [-n presses] [-i idle_ms]\n", argv[0]);
+          return -1;
+        }
+    }
+  if (presses < 0 || idle_ms < 0)
+    {
+      printf ("Counts must not be negative\n");
+      return -1;
+    }
+
+  fd = uinput_create ();
+  if (fd < 0)
+    {
+      perror ("Could not create a uinput device");
+      return -1;
+    }
+  /* give udev time to create the device node */
+  usleep (500000);
+
+  vcos_init ();
+  vcos_semaphore_create (&delivered, "bench delivered", 0);
+  message_queue_init ();
+  if (vcos_thread_create (&dispatcher, "dispatcher", NULL, dispatcher_task, NULL) != VCOS_SUCCESS)
+    {
+      printf ("Failed to start the dispatcher\n");
+      return -1;
+    }
+
+  /* let the new threads settle; sleeping once counts as one switch for
+     this thread */
+  vcos_sleep (100);
+  switches = context_switches ();
+  vcos_sleep (idle_ms);
+  switches = context_switches () - switches - 1;
+  printf ("idle for %d ms: %ld context switches\n", idle_ms, switches);
+
+  for (i = 0; i < presses * 2; i++)
+    {
+      value = !(i & 1);
+      expected_msg = msgs[value];
+      sent_at = vcos_getmicrosecs64 ();
+      if (emit (fd, EV_KEY, BTN_0, value) < 0 || emit (fd, EV_SYN, SYN_REPORT, 0) < 0)
+        {
+          perror ("Could not write to the uinput device");
+          break;
+        }
+      if (vcos_semaphore_wait_timeout (&delivered, BENCH_TIMEOUT_MS) != VCOS_SUCCESS)
+        {
+          timeouts++;
+          if (timeouts == 1)
+            printf ("No button message for event %d; is the device one of event0-7?\n", i);
+          continue;
+        }
+      count[value]++;
+      total[value] += latency;
+      if (latency > max[value])
+        max[value] = latency;
+    }
+
+  printf ("%d presses: press latency mean %.1f us, max %llu us; "
+          "release latency mean %.1f us, max %llu us; %d timed out\n",
+          presses,
+          count[1] ? (double) total[1] / count[1] : 0.0, (unsigned long long) max[1],
+          count[0] ? (double) total[0] / count[0] : 0.0, (unsigned long long) max[0],
+          timeouts);
+
+  ioctl (fd, UI_DEV_DESTROY);
+  close (fd);
+
+  /* dispatch_messages never returns, so neither does the dispatcher thread */
+  return (timeouts || i < presses * 2) ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Throughput benchmark for the host application's message queue.
+ *
+ * message_queue_bench [-t producers] [-n messages] [-w window]
+ *
+ * Each producer thread posts <messages> messages with add_message while a
+ * dispatcher thread runs dispatch_messages. Producers take a credit from a
+ * semaphore of <window> credits before each message and the handler gives
+ * it back, so at most <window> messages wait in the 256 entry queue and it
+ * never overflows. The handler
+ * checks that every producer's messages arrive in order and measures the
+ * time from add_message to delivery.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "interface/vcos/vcos.h"
+#include "host_applications/framework/host_app.h"
+#include "interface/usbdk/vmcs_rpc_client/message_dispatch.h"
+
+#define BENCH_MAX_PRODUCERS  16
+#define BENCH_MAX_WINDOW     256   /*< MESSAGE_Q_SIZE in message_dispatch.c */
+
+static VCOS_THREAD_T producers[BENCH_MAX_PRODUCERS];
+static VCOS_THREAD_T dispatcher;
+static int messages_each = 1000000;
+static unsigned int window = 128;
+static unsigned long total;
+static VCOS_SEMAPHORE_T credits;
+static VCOS_SEMAPHORE_T done;
+
+/* only touched by the dispatcher thread until done is posted */
+static uint32_t next_seq[BENCH_MAX_PRODUCERS];
+static unsigned long handled;
+static unsigned long order_errors;
+static uint64_t latency_total;
+static uint32_t latency_max;
+
+void
+host_app_message_handler (const uint16_t msg, const uint32_t param1,
+                          const uint32_t param2)
+{
+  uint32_t latency = (uint32_t) vcos_getmicrosecs64 () - param2;
+
+  if (msg >= BENCH_MAX_PRODUCERS || param1 != next_seq[msg])
+    order_errors++;
+  else
+    next_seq[msg]++;
+
+  latency_total += latency;
+  if (latency > latency_max)
+    latency_max = latency;
+
+  vcos_semaphore_post (&credits);
+  if (++handled == total)
+    vcos_semaphore_post (&done);
+}
+
+static void *
+producer_task (void *arg)
+{
+  long id = (long) arg;
+  int i;
+
+  for (i = 0; i < messages_each; i++)
+    {
+      vcos_semaphore_wait (&credits);
+      add_message (id, i, (uint32_t) vcos_getmicrosecs64 ());
+    }
+  return NULL;
+}
+
+static void *
+dispatcher_task (void *arg)
+{
+  dispatch_messages ();
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  MESSAGE_QUEUE_STATS_T stats;
+  int num_producers = 1, opt;
+  uint64_t start, elapsed;
+  long i;
+
+  while ((opt = getopt (argc, argv, "t:n:w:")) != -1)
+    {
+      switch (opt)
+        {
+        case 't': num_producers = atoi (optarg); break;
+        case 'n': messages_each = atoi (optarg); break;
+        case 'w': window = strtoul (optarg, NULL, 0); break;
+        default:
+          printf ("Usage: %s [-t producers] [-n messages] [-w window]\n", argv[0]);
+          return -1;
+        }
+    }
+  if (num_producers < 1 || num_producers > BENCH_MAX_PRODUCERS ||
+      messages_each < 0 || window < 1 || window > BENCH_MAX_WINDOW)
+    {
+      printf ("Up to %d producers and a window of 1 to %d\n",
+              BENCH_MAX_PRODUCERS, BENCH_MAX_WINDOW);
+      return -1;
+    }
+
+  total = (unsigned long) num_producers * messages_each;
+  if (total == 0)
+    return 0;
+
+  vcos_init ();
+  vcos_semaphore_create (&credits, "bench credits", window);
+  vcos_semaphore_create (&done, "bench done", 0);
+  message_queue_init ();
+  if (vcos_thread_create (&dispatcher, "dispatcher", NULL, dispatcher_task, NULL) != VCOS_SUCCESS)
+    {
+      printf ("Failed to start the dispatcher\n");
+      return -1;
+    }
+
+  start = vcos_getmicrosecs64 ();
+  for (i = 0; i < num_producers; i++)
+    {
+      if (vcos_thread_create (&producers[i], "producer", NULL, producer_task, (void *) i) != VCOS_SUCCESS)
+        {
+          printf ("Failed to start producer %ld\n", i);
+          return -1;
+        }
+    }
+  for (i = 0; i < num_producers; i++)
+    vcos_thread_join (&producers[i], NULL);
+
+  vcos_semaphore_wait (&done);
+  elapsed = vcos_getmicrosecs64 () - start;
+
+  /* the handler returns before its message is counted as dispatched */
+  message_queue_get_stats (&stats);
+  while (stats.dispatched < total)
+    {
+      vcos_sleep (1);
+      message_queue_get_stats (&stats);
+    }
+
+  printf ("%lu messages, %d producers, window %u: %llu us, %.1f messages/s\n",
+          total, num_producers, window, (unsigned long long) elapsed,
+          elapsed ? total * 1000000.0 / elapsed : 0.0);
+  printf ("latency: mean %.2f us, max %u us\n",
+          (double) latency_total / handled,
+          latency_max);
+  printf ("posted %u, dispatched %u, overflows %u, wakeups %u, max depth %u, order errors %lu\n",
+          stats.posted, stats.dispatched, stats.overflows, stats.wakeups,
+          stats.max_depth, order_errors);
+
+  /* dispatch_messages never returns, so neither does the dispatcher thread */
+  return (stats.overflows || order_errors) ? 1 : 0;
+}
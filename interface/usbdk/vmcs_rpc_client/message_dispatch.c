@@ -375,12 +375,49 @@ static int buttons_poll_keypad(buttons_t *buttons,
                     uint32_t *keys_released );
 
 
-static PLT_msg message_q[256];
-static int start_p = 0, end_p = 0;
-static VCOS_MUTEX_T msg_latch;
+/* The message queue is a bounded lock-free ring (after Vyukov's bounded
+ * queue) with any number of producers - input, timer and application
+ * threads - and the dispatch thread as its only consumer.  Each slot's
+ * sequence number says whether it is free for the producer at that
+ * position or holds a message for the consumer.  The consumer only
+ * sleeps on msg_semaphore when the ring is empty, and producers only
+ * post it when the consumer has said it is going to sleep.
+ *
+ * The lock-free path needs the GCC __atomic builtins.  Other compilers
+ * use the same ring with producers serialised by msg_latch.
+ */
+#define MESSAGE_Q_SIZE  256          /*< must be a power of 2 */
+#define MESSAGE_BATCH   16           /*< messages taken per pass */
+
+#ifdef __GNUC__
+#define MESSAGE_Q_LOCK_FREE
+#define MSGQ_LOAD(p)        __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define MSGQ_STORE(p, v)    __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define MSGQ_COUNT(p, v)    __atomic_add_fetch(p, v, __ATOMIC_RELAXED)
+#define MSGQ_READ(p)        __atomic_load_n(p, __ATOMIC_RELAXED)
+#else
+/* producers hold msg_latch; the rest are single-writer counters */
+#define MSGQ_LOAD(p)        (*(p))
+#define MSGQ_STORE(p, v)    (*(p) = (v))
+#define MSGQ_COUNT(p, v)    (*(p) += (v))
+#define MSGQ_READ(p)        (*(p))
+#endif
+
+typedef struct {
+  uint32_t seq;
+  PLT_msg msg;
+} message_slot_t;
+
+static message_slot_t message_q[MESSAGE_Q_SIZE];
+static uint32_t enqueue_pos, dequeue_pos;
+static uint32_t dispatch_sleeping;
 static VCOS_SEMAPHORE_T msg_semaphore;
+#ifndef MESSAGE_Q_LOCK_FREE
+static VCOS_MUTEX_T msg_latch;
+#endif
+static MESSAGE_QUEUE_STATS_T msg_stats;
 #ifndef WIN32
-static VCOS_THREAD_T button_thread, touch_thread;
+static VCOS_THREAD_T input_thread;
 #endif
 
 #ifndef WIN32
@@ -390,6 +427,8 @@ static VCOS_THREAD_T button_thread, touch_thread;
 #include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 static int fd_buttons=-1, fd_touch=-1;
 char *events[EV_MAX + 1] = {
@@ -763,7 +802,7 @@ static int touch_read_init()
 		return 1;
 	}
 
-	if ((fd_touch = open(fname, O_RDONLY)) < 0) {
+	if ((fd_touch = open(fname, O_RDONLY|O_NONBLOCK)) < 0) {
 		perror("evtest: could not open /dev/input/event");
 		return 1;
 	}
@@ -876,7 +915,7 @@ void sig_handler(int s)
 static int getkey() 
 {
   static int first_time = 1;
-  int character, c;
+  int character = 0, c;
   if (first_time) {
 	  struct termios new_termios;
 
@@ -900,6 +939,8 @@ static int getkey()
           first_time = 0;
   }
   while((c = fgetc(stdin)) != EOF) character = (character << 8) | c;
+  /* no more input for now; let the next read try again */
+  clearerr(stdin);
 
   return character;
 }
@@ -1022,31 +1063,180 @@ static int touch_read(void *touchscreen)
 	return 0;
 }
 
-#endif
+/* All input is handled by one thread waiting in epoll on the button, touch
+ * and keyboard fds, so an event is dispatched as soon as it arrives and an
+ * idle device costs no wakeups.  Time based events (button repeats, and
+ * touch press-and-hold) are driven by a timerfd armed only while a button
+ * or finger is down.
+ */
+enum {
+   INPUT_SRC_BUTTONS,
+   INPUT_SRC_TOUCH,
+   INPUT_SRC_KEYBOARD,
+   INPUT_SRC_TIMER
+};
 
-static void *button_task(void *param)
+/* milliseconds until the next button repeat is due, or -1 for none */
+static int32_t buttons_next_repeat_ms(buttons_t *buttons, uint32_t now_ms)
 {
-  while(1)
-    {
-      if (button_read(param) && keyboard_read(param))
-        vcos_sleep(10);
-    }
-  return NULL;
+   int32_t next = -1;
+   int bit_count;
+
+   if (0 == buttons->repeat_rate_ms)
+      return -1;
+
+   for (bit_count = 0; bit_count < BUTTONS_NUM_OF_KEYS; bit_count++)
+   {
+      uint32_t current_held_time = buttons->button_held_time[bit_count].current;
+      if (0 != current_held_time)
+      {
+         int32_t due = (int32_t)(current_held_time + buttons->repeat_rate_ms - now_ms);
+         if (due < 0)
+            due = 0;
+         if (next < 0 || due < next)
+            next = due;
+      }
+   }
+   return next;
 }
-static void *touch_task(void *param)
+
+/* milliseconds until a finger held down becomes a hold, or -1 for none */
+static int32_t touchscreen_next_hold_ms(touchscreen_t *touchscreen, uint32_t now_ms)
 {
-  while(1)
-    {
-      touch_read(param);
-    }
-  return NULL;
+   finger_state_t *finger_state = &touchscreen->finger[0];
+   int32_t due;
+
+   if (!finger_state->down || finger_state->held_down)
+      return -1;
+
+   /* touchscreen_handle_events wants the time strictly past the hold time */
+   due = (int32_t)(finger_state->down_time + TOUCH_REPEAT_MS + 1 - now_ms);
+   return due < 0 ? 0 : due;
 }
 
+static void input_arm_timer(int fd_timer, touchscreen_t *touchscreen, buttons_t *buttons)
+{
+   struct itimerspec its;
+   uint32_t now_ms = vcos_get_ms();
+   int32_t next = buttons_next_repeat_ms(buttons, now_ms);
+   int32_t hold = touchscreen_next_hold_ms(touchscreen, now_ms);
+
+   if (hold >= 0 && (next < 0 || hold < next))
+      next = hold;
+
+   memset(&its, 0, sizeof(its));
+   if (next >= 0)
+   {
+      /* a zero it_value would disarm the timer */
+      its.it_value.tv_sec = next / 1000;
+      its.it_value.tv_nsec = (next % 1000) * 1000000 + 1;
+   }
+   timerfd_settime(fd_timer, 0, &its, NULL);
+}
+
+static void input_timer_expired(int fd_timer, touchscreen_t *touchscreen, buttons_t *buttons)
+{
+   uint64_t expirations;
+   uint32_t keys_pressed, keys_held, keys_released;
+
+   if (read(fd_timer, &expirations, sizeof(expirations)) != sizeof(expirations))
+      return;
+
+   if (buttons_poll_keypad(buttons, &keys_pressed, &keys_held, &keys_released))
+      buttons_handle_events(buttons, keys_pressed, keys_held, keys_released);
+
+   if (touchscreen_next_hold_ms(touchscreen, vcos_get_ms()) == 0)
+   {
+      /* the finger hasn't moved, so the screen may have stopped reporting
+       * coordinates: repeat the last one to let the hold be recognised */
+      TOUCHSCREEN_EVENT_T event = {0};
+      event.type = TOUCHSCREEN_EVENT_TYPE_ABS_Y;
+      event.param = touchscreen->cur_coord.y;
+      touchscreen_handle_events(touchscreen, event);
+   }
+}
+
+static int input_watch(int fd_epoll, int fd, int source)
+{
+   struct epoll_event ev;
+
+   memset(&ev, 0, sizeof(ev));
+   ev.events = EPOLLIN;
+   ev.data.u32 = source;
+   return fd >= 0 ? epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev) : -1;
+}
+
+static void *input_task(void *param)
+{
+   LOCAL_TOUCH_SERVICE_T *touch = param;
+   struct epoll_event events[4];
+   int fd_epoll, fd_timer;
+
+   fd_epoll = epoll_create(4);
+   fd_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+   if (fd_epoll < 0 || fd_timer < 0)
+   {
+      vcos_assert(0);
+      return NULL;
+   }
+
+   input_watch(fd_epoll, fd_buttons, INPUT_SRC_BUTTONS);
+   input_watch(fd_epoll, fd_touch, INPUT_SRC_TOUCH);
+   input_watch(fd_epoll, fd_timer, INPUT_SRC_TIMER);
+
+   /* put the terminal into raw mode before waiting on it; stdin can't be
+    * watched if it is a plain file, in which case it is just ignored */
+   keyboard_read(&touch->buttons);
+   input_watch(fd_epoll, STDIN_FILENO, INPUT_SRC_KEYBOARD);
+
+   while (1)
+   {
+      int n, i;
+
+      input_arm_timer(fd_timer, &touch->screen, &touch->buttons);
+
+      n = epoll_wait(fd_epoll, events, countof(events), -1);
+      for (i = 0; i < n; i++)
+      {
+         switch (events[i].data.u32)
+         {
+         case INPUT_SRC_BUTTONS:
+            button_read(&touch->buttons);
+            break;
+         case INPUT_SRC_TOUCH:
+            touch_read(&touch->screen);
+            break;
+         case INPUT_SRC_KEYBOARD:
+            if (events[i].events & (EPOLLHUP | EPOLLERR))
+               epoll_ctl(fd_epoll, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+            else
+               keyboard_read(&touch->buttons);
+            break;
+         case INPUT_SRC_TIMER:
+            input_timer_expired(fd_timer, &touch->screen, &touch->buttons);
+            break;
+         }
+      }
+   }
+   return NULL;
+}
+
+#endif
+
 
 void
 message_queue_init ()
 {
-  vcos_mutex_create (&msg_latch, "message latch");  
+  uint32_t i;
+
+  for (i = 0; i < MESSAGE_Q_SIZE; i++)
+    message_q[i].seq = i;
+  enqueue_pos = dequeue_pos = 0;
+  dispatch_sleeping = 0;
+  memset(&msg_stats, 0, sizeof(msg_stats));
+#ifndef MESSAGE_Q_LOCK_FREE
+  vcos_mutex_create (&msg_latch, "message latch");
+#endif
   vcos_semaphore_create(&msg_semaphore, "message semaphore", 0);
 
 #ifndef WIN32
@@ -1077,50 +1267,186 @@ message_queue_init ()
 
     vcos_thread_attr_init(&attrs);
     vcos_thread_attr_setpriority(&attrs, VCOS_THREAD_PRI_ABOVE_NORMAL);
-    vcos_thread_create(&button_thread, "button thread", &attrs, button_task, &touchserv_state.touch.buttons);
-    vcos_thread_attr_init(&attrs);
-    vcos_thread_attr_setpriority(&attrs, VCOS_THREAD_PRI_ABOVE_NORMAL);
-    vcos_thread_create(&touch_thread, "touch thread", &attrs, touch_task, &touchserv_state.touch.screen);
+    vcos_thread_create(&input_thread, "input thread", &attrs, input_task, &touchserv_state.touch);
   }
 #endif
 }
 
+#ifdef MESSAGE_Q_LOCK_FREE
+void
+add_message (long msg, long param1, long param2)
+{
+  uint32_t pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+  message_slot_t *slot;
+
+  for (;;)
+    {
+      int32_t dif;
+
+      slot = &message_q[pos & (MESSAGE_Q_SIZE - 1)];
+      dif = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+      if (dif == 0)
+        {
+          /* slot is free: claim it, or retry from wherever the winner left pos */
+          if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        }
+      else if (dif < 0)
+        {
+          /* ring full: the dispatcher is too far behind, drop the message */
+          __atomic_add_fetch(&msg_stats.overflows, 1, __ATOMIC_RELAXED);
+          vcos_assert (0);  /* Overlapping messages! */
+          return;
+        }
+      else
+        pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    }
+
+  slot->msg.msg = msg;
+  slot->msg.param1 = param1;
+  slot->msg.param2 = param2;
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&msg_stats.posted, 1, __ATOMIC_RELAXED);
+
+  /* pairs with the fence in wait_messages: either it sees this
+   * message before sleeping, or we see that it is asleep */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_exchange_n(&dispatch_sleeping, 0, __ATOMIC_RELAXED))
+    vcos_semaphore_post(&msg_semaphore);
+}
+#else
 void
 add_message (long msg, long param1, long param2)
 {
+  message_slot_t *slot;
+  uint32_t wake;
+
   vcos_mutex_lock (&msg_latch);
-  int i = end_p + 1;
-  vcos_assert (i != start_p);  /* Overlapping messages! */
-  if (i == countof(message_q))
-    i = 0;
-  message_q[i].msg = msg;
-  message_q[i].param1 = param1;
-  message_q[i].param2 = param2;
-  end_p = i;
+  slot = &message_q[enqueue_pos & (MESSAGE_Q_SIZE - 1)];
+  if (slot->seq != enqueue_pos)
+    {
+      /* ring full: the dispatcher is too far behind, drop the message */
+      msg_stats.overflows++;
+      vcos_mutex_unlock (&msg_latch);
+      vcos_assert (0);  /* Overlapping messages! */
+      return;
+    }
+
+  slot->msg.msg = msg;
+  slot->msg.param1 = param1;
+  slot->msg.param2 = param2;
+  slot->seq = enqueue_pos + 1;
+  enqueue_pos++;
+  msg_stats.posted++;
+
+  wake = dispatch_sleeping;
+  dispatch_sleeping = 0;
   vcos_mutex_unlock (&msg_latch);
-  vcos_semaphore_post(&msg_semaphore);
+  if (wake)
+    vcos_semaphore_post(&msg_semaphore);
 }
+#endif
 
-void
-dispatch_messages ()
+/* take up to max messages off the queue; only the dispatch thread calls this */
+static int
+take_messages (PLT_msg *batch, int max)
 {
-  while (1)
+  int n = 0;
+
+  while (n < max)
+    {
+      message_slot_t *slot = &message_q[dequeue_pos & (MESSAGE_Q_SIZE - 1)];
+
+      if (MSGQ_LOAD(&slot->seq) != dequeue_pos + 1)
+        break;
+
+      batch[n++] = slot->msg;
+      /* hand the slot back to producers for the next lap */
+      MSGQ_STORE(&slot->seq, dequeue_pos + MESSAGE_Q_SIZE);
+      dequeue_pos++;
+    }
+  return n;
+}
+
+/* take up to max messages off the queue, sleeping until there are some */
+static int
+wait_messages (PLT_msg *batch, int max)
+{
+  int n;
+
+#ifdef MESSAGE_Q_LOCK_FREE
+  while ((n = take_messages(batch, max)) == 0)
     {
+      __atomic_store_n(&dispatch_sleeping, 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      n = take_messages(batch, max);
+      if (n != 0)
+        {
+          /* found work after all; if a producer has already cleared the
+           * flag its post just makes a later wait return early */
+          __atomic_store_n(&dispatch_sleeping, 0, __ATOMIC_RELAXED);
+          break;
+        }
       vcos_semaphore_wait(&msg_semaphore);
-      vcos_mutex_lock (&msg_latch);
-      vcos_assert(start_p != end_p);
-      start_p++;
-      if (start_p == countof(message_q))
-        start_p = 0;
+      __atomic_add_fetch(&msg_stats.wakeups, 1, __ATOMIC_RELAXED);
+    }
+#else
+  vcos_mutex_lock (&msg_latch);
+  while ((n = take_messages(batch, max)) == 0)
+    {
+      dispatch_sleeping = 1;
       vcos_mutex_unlock (&msg_latch);
+      vcos_semaphore_wait(&msg_semaphore);
+      vcos_mutex_lock (&msg_latch);
+      msg_stats.wakeups++;
+    }
+  vcos_mutex_unlock (&msg_latch);
+#endif
+  return n;
+}
 
-      /* Call the handler routine */
-      host_app_message_handler (message_q[start_p].msg,
-                                message_q[start_p].param1,
-                                message_q[start_p].param2);
+void
+dispatch_messages ()
+{
+  PLT_msg batch[MESSAGE_BATCH];
+
+  while (1)
+    {
+      uint32_t depth = MSGQ_READ(&enqueue_pos) - dequeue_pos;
+      int n, i;
+
+      if (depth <= MESSAGE_Q_SIZE && depth > msg_stats.max_depth)
+        msg_stats.max_depth = depth;
+
+      n = wait_messages(batch, countof(batch));
+      for (i = 0; i < n; i++)
+        {
+          /* Call the handler routine */
+          host_app_message_handler (batch[i].msg,
+                                    batch[i].param1,
+                                    batch[i].param2);
+          MSGQ_COUNT(&msg_stats.dispatched, 1);
+        }
     }
 }
 
+void
+message_queue_get_stats (MESSAGE_QUEUE_STATS_T *stats)
+{
+#ifndef MESSAGE_Q_LOCK_FREE
+  vcos_mutex_lock (&msg_latch);
+#endif
+  stats->posted = MSGQ_READ(&msg_stats.posted);
+  stats->dispatched = MSGQ_READ(&msg_stats.dispatched);
+  stats->overflows = MSGQ_READ(&msg_stats.overflows);
+  stats->wakeups = MSGQ_READ(&msg_stats.wakeups);
+  stats->max_depth = MSGQ_READ(&msg_stats.max_depth);
+#ifndef MESSAGE_Q_LOCK_FREE
+  vcos_mutex_unlock (&msg_latch);
+#endif
+}
+
 
 #ifdef WIN32
 int
@@ -28,6 +28,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _MESSAGE_DISPATCH_H
 
 
+/**
+  * Counters for the host application's message queue.
+  */
+typedef struct
+{
+   unsigned int posted;       /**< messages added */
+   unsigned int dispatched;   /**< messages delivered to host_app_message_handler */
+   unsigned int overflows;    /**< messages dropped because the queue was full */
+   unsigned int wakeups;      /**< times the dispatcher slept and was woken */
+   unsigned int max_depth;    /**< most messages seen waiting at once */
+} MESSAGE_QUEUE_STATS_T;
+
 /**
   * Initialise the host application's message queue.
   */
@@ -50,4 +62,12 @@ add_message (long msg, long param1, long param2);
 void
 dispatch_messages (void);
 
+/**
+  * Read the message queue counters.
+  *
+  * @param stats   Filled in with the counters so far.
+  */
+void
+message_queue_get_stats (MESSAGE_QUEUE_STATS_T *stats);
+
 #endif /* _MESSAGE_DISPATCH_H */
@@ -292,12 +292,19 @@ VCOS_INLINE_IMPL
 VCOS_STATUS_T vcos_semaphore_wait_timeout(VCOS_SEMAPHORE_T *sem, VCOS_UNSIGNED timeout) {
    struct timespec ts;
    int ret;
-   ts.tv_sec  = timeout/1000;
-   ts.tv_nsec = (timeout%1000)*1000*1000;
-   ret = sem_timedwait( sem, &ts );
+   /* sem_timedwait takes an absolute CLOCK_REALTIME deadline */
+   clock_gettime(CLOCK_REALTIME, &ts);
+   ts.tv_sec  += timeout/1000;
+   ts.tv_nsec += (timeout%1000)*1000*1000;
+   if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+   }
+   while ((ret = sem_timedwait( sem, &ts )) == -1 && errno == EINTR)
+      continue;
    if (ret == 0)
       return VCOS_SUCCESS;
-   else if (ret == ETIMEDOUT)
+   else if (errno == ETIMEDOUT)
       return VCOS_EAGAIN;
    else {
       vcos_assert(0);
@@ -62,4 +62,27 @@ typedef struct OMX_PARAM_TUNNELSTATUSTYPE {
    OMX_U32 nTunneledPort;    /**< Port on tunnelled component */
 } OMX_PARAM_TUNNELSTATUSTYPE;
 
+/* A group of port enables, a state change and buffer registrations for
+ * one component, sent together with OMX_SendTransaction.  The commands
+ * are issued in the order port enables then state change, followed by
+ * the buffers, without waiting for each to be accepted before sending
+ * the next.  Completion is still signalled by the usual events. */
+typedef struct OMX_TRANSACTION_BUFFERTYPE {
+   OMX_U32 nPortIndex;       /**< Port to add the buffer to */
+   OMX_U32 nSizeBytes;       /**< Size of the buffer */
+   OMX_U8 *pBuffer;          /**< Buffer to use, or NULL to have one allocated */
+   OMX_PTR pAppPrivate;      /**< Copied to the buffer header */
+   OMX_BUFFERHEADERTYPE *pBufferHdr; /**< Set to the new buffer header */
+   OMX_ERRORTYPE eError;     /**< Set to the result of adding this buffer */
+} OMX_TRANSACTION_BUFFERTYPE;
+
+typedef struct OMX_TRANSACTIONTYPE {
+   OMX_U32 nEnablePorts;     /**< Number of entries in pEnablePorts */
+   OMX_U32 *pEnablePorts;    /**< Ports to send OMX_CommandPortEnable for */
+   OMX_BOOL bSetState;       /**< If OMX_TRUE send OMX_CommandStateSet */
+   OMX_STATETYPE eState;     /**< State to move to if bSetState */
+   OMX_U32 nBuffers;         /**< Number of entries in pBuffers */
+   OMX_TRANSACTION_BUFFERTYPE *pBuffers; /**< Buffers to add */
+} OMX_TRANSACTIONTYPE;
+
 #endif
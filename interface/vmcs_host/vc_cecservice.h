@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/vchi/vchi.h"
 #include "interface/vmcs_host/vc_cecservice_defs.h"
 #include "interface/vmcs_host/vc_cec.h"
+#include "interface/vmcs_host/vc_notify_defs.h"
 
 /**
  * \file
@@ -73,6 +74,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 typedef void (*CECSERVICE_CALLBACK_T)(void *callback_data, uint32_t reason, uint32_t param1, uint32_t param2, uint32_t param3, uint32_t param4);
 
+/**
+ * Reason (bits 15-0) passed to a CECSERVICE_CALLBACK_T in place of
+ * notifications it missed because it fell more than a queue's worth behind.
+ * param1 is the number lost. Logical address and topology changes may be
+ * among them, so the callback should re-read those rather than rely on the
+ * last notification it saw. Generated by the host, not by VideoCore.
+ */
+#define VC_CEC_NOTIFY_OVERFLOW (1 << 14)
+
 //API at application start time
 /**
  * Call <DFN>vc_vchi_cec_init</DFN> to initialise the CEC service for use.
@@ -97,6 +107,11 @@ VCHPRE_ void vc_vchi_cec_stop( void );
  * callback to handle all CEC notifications. If more than one applications 
  * need to use CEC, there should be ONE central application which acts on
  * behalf of all clients and handles all communications with CEC services.
+ * The callback is called on a thread of its own, one notification at a
+ * time in the order they arrived, so it may run at the same time as the
+ * application's other threads calling into the CEC service. If it falls
+ * behind it is passed <DFN>VC_CEC_NOTIFY_OVERFLOW</DFN> in place of what
+ * it missed.
  *
  * @param callback function 
  * @param context to be passed when function is called
@@ -104,6 +119,17 @@ VCHPRE_ void vc_vchi_cec_stop( void );
  ***********************************************************/
 VCHPRE_ void vc_cec_register_callback(CECSERVICE_CALLBACK_T callback, void *callback_data);
 
+/**
+ * <DFN>vc_cec_get_notify_stats</DFN> reports how many notifications have
+ * been received and delivered, and how long they took to reach the callback.
+ * The callback is called on a thread of its own, so the service keeps
+ * reading notifications while it runs.
+ *
+ * @param stats is filled in
+ * @return void
+ ***********************************************************/
+VCHPRE_ void vc_cec_get_notify_stats(VC_NOTIFY_STATS_T *stats);
+
 //Service API
 /**
  * Use <DFN>vc_cec_register_command</DFN> to register an opcode to
@@ -247,6 +273,8 @@ VCHPRE_ int VCHPOST_ vc_cec_release_logical_address( void );
  *         If successful, the topology will be set, otherwise it is unchanged
  *         A topology with only 1 device (us) means CEC is not supported.
  *         If there is no topology available, this also returns a failure.
+ *         The topology is cached on the host until the next VC_CEC_TOPOLOGY
+ *         or logical address notification.
  ***********************************************************/
 VCHPRE_ int VCHPOST_ vc_cec_get_topology( VC_CEC_TOPOLOGY_T* topology);
 
@@ -278,6 +306,8 @@ VCHPRE_ int VCHPOST_ vc_cec_set_osd_name( const char* name );
  * @return zero if the command is successful, non-zero otherwise
  *          If failed, physical address argument will not be changed
  *          A physical address of 0xFFFF means CEC is not supported
+ *          The address is cached on the host and kept up to date by
+ *          logical address notifications.
  ***********************************************************/
 VCHPRE_ int VCHPOST_ vc_cec_get_physical_address(uint16_t *physical_address);
 
@@ -321,6 +351,26 @@ VCHPRE_ CEC_DEVICE_TYPE_T VCHPOST_ vc_cec_device_type(const CEC_AllDevices_T log
  */
 VCHPRE_ int VCHPOST_ vc_cec_send_message2(const VC_CEC_MESSAGE_T *message);
 
+/**
+ * <DFN>vc_cec_send_message_batch</DFN> sends a number of encapsulated
+ * messages in order, as vc_cec_send_message2 would, but without a
+ * round trip to Videocore between each of them.
+ *
+ * @param messages is the array of messages to send
+ *
+ * @param num_messages is the number of messages in the array
+ *
+ * @param status is an array of num_messages results (can be NULL),
+ *        each being what vc_cec_send_message2 would have returned,
+ *        or -1 if the message was not sent
+ *
+ * @return zero if all messages were sent successfully, non-zero otherwise
+ *         There will be a Tx callback for each message sent
+ ***********************************************************/
+VCHPRE_ int VCHPOST_ vc_cec_send_message_batch(const VC_CEC_MESSAGE_T *messages,
+                                               uint32_t num_messages,
+                                               int *status);
+
 VCHPRE_ int VCHPOST_ vc_cec_param2message( const uint32_t reason, const uint32_t param1, 
                                            const uint32_t param2, const uint32_t param3,
                                            const uint32_t param4, VC_CEC_MESSAGE_T *message);
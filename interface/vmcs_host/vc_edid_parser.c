@@ -0,0 +1,615 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#if !defined(__KERNEL__)
+#include <string.h>
+#endif
+
+#include "interface/vcos/vcos.h"
+
+#include "vchost_config.h"
+#include "vc_edid_parser.h"
+
+/******************************************************************************
+Local types and defines.
+******************************************************************************/
+#define EDID_EXTENSION_COUNT_OFFSET    0x7E
+#define EDID_ESTABLISHED_OFFSET        0x23
+#define EDID_STANDARD_OFFSET           0x26
+#define EDID_DESCRIPTOR_OFFSET         0x36
+#define EDID_DESCRIPTOR_SIZE           18
+#define EDID_NUM_DESCRIPTORS           4
+
+#define EDID_TAG_CEA                   0x02
+
+#define CEA_DB_AUDIO                   1
+#define CEA_DB_VIDEO                   2
+#define CEA_DB_VENDOR                  3
+#define CEA_DB_SPEAKER                 4
+#define CEA_DB_EXTENDED                7
+
+#define CEA_EXT_DB_VIDEO_CAPABILITY    0
+#define CEA_EXT_DB_COLORIMETRY         5
+#define CEA_EXT_DB_HDR_STATIC          6
+#define CEA_EXT_DB_YCBCR420_VIDEO      14
+
+#define HDMI_OUI                       0x000C03
+#define HDMI_FORUM_OUI                 0xC45DD8
+
+//DMT modes which can be described by established or standard timings,
+//reduced blanking modes are only matched against detailed timings
+typedef struct {
+   uint8_t  code;
+   uint8_t  reduced_blanking;
+   uint16_t width;
+   uint16_t height;
+   uint16_t frame_rate;
+} EDID_DMT_MODE_T;
+
+static const EDID_DMT_MODE_T edid_dmt_modes[] = {
+   {HDMI_DMT_640x350_85,    0,  640,  350, 85}, {HDMI_DMT_640x400_85,    0,  640,  400, 85},
+   {HDMI_DMT_IBM_VGA_85,    0,  720,  400, 85}, {HDMI_DMT_VGA_60,        0,  640,  480, 60},
+   {HDMI_DMT_VGA_72,        0,  640,  480, 72}, {HDMI_DMT_VGA_75,        0,  640,  480, 75},
+   {HDMI_DMT_VGA_85,        0,  640,  480, 85}, {HDMI_DMT_SVGA_56,       0,  800,  600, 56},
+   {HDMI_DMT_SVGA_60,       0,  800,  600, 60}, {HDMI_DMT_SVGA_72,       0,  800,  600, 72},
+   {HDMI_DMT_SVGA_75,       0,  800,  600, 75}, {HDMI_DMT_SVGA_85,       0,  800,  600, 85},
+   {HDMI_DMT_SVGA_120,      1,  800,  600,120}, {HDMI_DMT_848x480_60,    0,  848,  480, 60},
+   {HDMI_DMT_XGA_60,        0, 1024,  768, 60}, {HDMI_DMT_XGA_70,        0, 1024,  768, 70},
+   {HDMI_DMT_XGA_75,        0, 1024,  768, 75}, {HDMI_DMT_XGA_85,        0, 1024,  768, 85},
+   {HDMI_DMT_XGA_120,       1, 1024,  768,120}, {HDMI_DMT_XGAP_75,       0, 1152,  864, 75},
+   {HDMI_DMT_WXGA_RB,       1, 1280,  768, 60}, {HDMI_DMT_WXGA_60,       0, 1280,  768, 60},
+   {HDMI_DMT_WXGA_75,       0, 1280,  768, 75}, {HDMI_DMT_WXGA_85,       0, 1280,  768, 85},
+   {HDMI_DMT_WXGA_120,      1, 1280,  768,120}, {HDMI_DMT_1280x800_RB,   1, 1280,  800, 60},
+   {HDMI_DMT_1280x800_60,   0, 1280,  800, 60}, {HDMI_DMT_1280x800_75,   0, 1280,  800, 75},
+   {HDMI_DMT_1280x800_85,   0, 1280,  800, 85}, {HDMI_DMT_1280x800_120,  1, 1280,  800,120},
+   {HDMI_DMT_1280x960_60,   0, 1280,  960, 60}, {HDMI_DMT_1280x960_85,   0, 1280,  960, 85},
+   {HDMI_DMT_1280x960_120,  1, 1280,  960,120}, {HDMI_DMT_SXGA_60,       0, 1280, 1024, 60},
+   {HDMI_DMT_SXGA_75,       0, 1280, 1024, 75}, {HDMI_DMT_SXGA_85,       0, 1280, 1024, 85},
+   {HDMI_DMT_SXGA_120,      1, 1280, 1024,120}, {HDMI_DMT_1360x768_60,   0, 1360,  768, 60},
+   {HDMI_DMT_1360x768_120,  1, 1360,  768,120}, {HDMI_DMT_SXGAP_RB,      1, 1400, 1050, 60},
+   {HDMI_DMT_SXGAP_60,      0, 1400, 1050, 60}, {HDMI_DMT_SXGAP_75,      0, 1400, 1050, 75},
+   {HDMI_DMT_SXGAP_85,      0, 1400, 1050, 85}, {HDMI_DMT_SXGAP_120,     1, 1400, 1050,120},
+   {HDMI_DMT_1440x900_RB,   1, 1440,  900, 60}, {HDMI_DMT_1440x900_60,   0, 1440,  900, 60},
+   {HDMI_DMT_1440x900_75,   0, 1440,  900, 75}, {HDMI_DMT_1440x900_85,   0, 1440,  900, 85},
+   {HDMI_DMT_1440x900_120,  1, 1440,  900,120}, {HDMI_DMT_UXGA_60,       0, 1600, 1200, 60},
+   {HDMI_DMT_UXGA_65,       0, 1600, 1200, 65}, {HDMI_DMT_UXGA_70,       0, 1600, 1200, 70},
+   {HDMI_DMT_UXGA_75,       0, 1600, 1200, 75}, {HDMI_DMT_UXGA_85,       0, 1600, 1200, 85},
+   {HDMI_DMT_UXGA_120,      1, 1600, 1200,120}, {HDMI_DMT_SWXGAP_RB,     1, 1680, 1050, 60},
+   {HDMI_DMT_SWXGAP_60,     0, 1680, 1050, 60}, {HDMI_DMT_SWXGAP_75,     0, 1680, 1050, 75},
+   {HDMI_DMT_SWXGAP_85,     0, 1680, 1050, 85}, {HDMI_DMT_SWXGAP_120,    1, 1680, 1050,120},
+   {HDMI_DMT_1792x1344_60,  0, 1792, 1344, 60}, {HDMI_DMT_1792x1344_75,  0, 1792, 1344, 75},
+   {HDMI_DMT_1792x1344_120, 1, 1792, 1344,120}, {HDMI_DMT_1856x1392_60,  0, 1856, 1392, 60},
+   {HDMI_DMT_1856x1392_75,  0, 1856, 1392, 75}, {HDMI_DMT_1856x1392_120, 1, 1856, 1392,120},
+   {HDMI_DMT_WUXGA_RB,      1, 1920, 1200, 60}, {HDMI_DMT_WUXGA_60,      0, 1920, 1200, 60},
+   {HDMI_DMT_WUXGA_75,      0, 1920, 1200, 75}, {HDMI_DMT_WUXGA_85,      0, 1920, 1200, 85},
+   {HDMI_DMT_WUXGA_120,     1, 1920, 1200,120}, {HDMI_DMT_1920x1440_60,  0, 1920, 1440, 60},
+   {HDMI_DMT_1920x1440_75,  0, 1920, 1440, 75}, {HDMI_DMT_1920x1440_120, 1, 1920, 1440,120},
+   {HDMI_DMT_2560x1600_RB,  1, 2560, 1600, 60}, {HDMI_DMT_2560x1600_60,  0, 2560, 1600, 60},
+   {HDMI_DMT_2560x1600_75,  0, 2560, 1600, 75}, {0x4F /* _85 in DMT */,  0, 2560, 1600, 85},
+   {HDMI_DMT_2560x1600_120, 1, 2560, 1600,120}, {HDMI_DMT_1366x768_60,   0, 1366,  768, 60},
+   {HDMI_DMT_1080p_60,      0, 1920, 1080, 60}, {HDMI_DMT_1600x900_RB,   1, 1600,  900, 60},
+   {HDMI_DMT_2048x1152_RB,  1, 2048, 1152, 60}, {HDMI_DMT_720p_60,       0, 1280,  720, 60},
+   {HDMI_DMT_1366x768_RB,   1, 1366,  768, 60},
+};
+
+//DMT codes of the established timing bits, indexed by bit (byte 0x23 in bits 16-23)
+static const uint8_t edid_established_dmt[24] = {
+   0, 0, 0, 0, 0, 0, 0, 0,                          //0x25: manufacturer timings
+   HDMI_DMT_SXGA_75, HDMI_DMT_XGA_75, HDMI_DMT_XGA_70, HDMI_DMT_XGA_60,
+   HDMI_DMT_XGA_43, 0, HDMI_DMT_SVGA_75, HDMI_DMT_SVGA_72,      //0x24
+   HDMI_DMT_SVGA_60, HDMI_DMT_SVGA_56, HDMI_DMT_VGA_75, HDMI_DMT_VGA_72,
+   0, HDMI_DMT_VGA_60, 0, 0,                        //0x23
+};
+
+//Horizontal blanking of CVT reduced blanking timings
+#define EDID_CVT_RB_H_BLANKING         160
+
+/******************************************************************************
+Static functions.
+******************************************************************************/
+static int edid_count_bits(uint32_t x) {
+   int n = 0;
+   for(; x; x &= x - 1)
+      n++;
+   return n;
+}
+
+static int edid_block_checksum_ok(const uint8_t *block) {
+   uint8_t sum = 0;
+   int i;
+   for(i = 0; i < EDID_BLOCK_SIZE; i++)
+      sum += block[i];
+   return sum == 0;
+}
+
+static void edid_add_standard_timing(EDID_INFO_T *info, uint8_t b0, uint8_t b1) {
+   EDID_STANDARD_TIMING_T *timing;
+   uint32_t width, height;
+
+   //0x0101 (and 0x0000 in old EDIDs) mark unused entries
+   if((b0 == 0x01 && b1 == 0x01) || b0 == 0x00 || info->num_standard_timings >= EDID_MAX_STANDARD_TIMINGS)
+      return;
+
+   width = (b0 + 31) * 8;
+   switch(b1 >> 6) {
+   case 0:  //16:10, but 1:1 before EDID 1.3
+      height = (info->version == 1 && info->revision < 3)? width : width * 10 / 16;
+      break;
+   case 1:  height = width * 3 / 4;   break;
+   case 2:  height = width * 4 / 5;   break;
+   default: height = width * 9 / 16;  break;
+   }
+
+   timing = &info->standard_timings[info->num_standard_timings++];
+   timing->width = (uint16_t) width;
+   timing->height = (uint16_t) height;
+   timing->frame_rate = (uint16_t) ((b1 & 0x3F) + 60);
+}
+
+static void edid_parse_detailed_timing(EDID_INFO_T *info, const uint8_t *d) {
+   EDID_DETAILED_TIMING_T *timing;
+   uint32_t h_total, v_total;
+
+   if(info->num_detailed_timings >= EDID_MAX_DETAILED_TIMINGS)
+      return;
+
+   timing = &info->detailed_timings[info->num_detailed_timings++];
+   timing->pixel_clock   = (d[0] | (d[1] << 8)) * 10;
+   timing->h_active      = d[2] | ((d[4] & 0xF0) << 4);
+   timing->h_blanking    = d[3] | ((d[4] & 0x0F) << 8);
+   timing->v_active      = d[5] | ((d[7] & 0xF0) << 4);
+   timing->v_blanking    = d[6] | ((d[7] & 0x0F) << 8);
+   timing->h_sync_offset = d[8] | ((d[11] & 0xC0) << 2);
+   timing->h_sync_width  = d[9] | ((d[11] & 0x30) << 4);
+   timing->v_sync_offset = (d[10] >> 4) | ((d[11] & 0x0C) << 2);
+   timing->v_sync_width  = (d[10] & 0x0F) | ((d[11] & 0x03) << 4);
+   timing->width_mm      = d[12] | ((d[14] & 0xF0) << 4);
+   timing->height_mm     = d[13] | ((d[14] & 0x0F) << 8);
+   timing->flags         = d[17];
+   timing->interlaced    = (d[17] & 0x80) != 0;
+
+   h_total = timing->h_active + timing->h_blanking;
+   v_total = timing->v_active + timing->v_blanking;
+   timing->frame_rate = (h_total && v_total)?
+      (uint16_t) ((timing->pixel_clock * 1000 + (h_total * v_total) / 2) / (h_total * v_total)) : 0;
+}
+
+static void edid_copy_string(char *dest, const uint8_t *src) {
+   int i;
+   //Descriptor strings are up to 13 characters, terminated by 0x0A and padded with spaces
+   for(i = 0; i < EDID_MONITOR_NAME_LEN - 1 && src[i] != 0x0A && src[i] != 0x00; i++)
+      dest[i] = (src[i] >= 0x20 && src[i] < 0x7F)? (char) src[i] : '?';
+   while(i > 0 && dest[i-1] == ' ')
+      i--;
+   dest[i] = '\0';
+}
+
+static void edid_parse_descriptor(EDID_INFO_T *info, const uint8_t *d) {
+   int i;
+
+   if(d[0] || d[1]) {
+      edid_parse_detailed_timing(info, d);
+      return;
+   }
+
+   switch(d[3]) {
+   case 0xFC: //Monitor name
+      edid_copy_string(info->monitor_name, d + 5);
+      break;
+
+   case 0xFD: //Display range limits, byte 4 holds the +255 offset flags (EDID 1.4)
+      info->min_v_rate = d[5] + ((d[4] & 0x03) == 0x03? 255 : 0);
+      info->max_v_rate = d[6] + ((d[4] & 0x02)? 255 : 0);
+      info->min_h_rate = d[7] + ((d[4] & 0x0C) == 0x0C? 255 : 0);
+      info->max_h_rate = d[8] + ((d[4] & 0x08)? 255 : 0);
+      info->max_pixel_clock = d[9] * 10000;
+      info->flags |= EDID_FLAG_HAS_RANGE_LIMITS;
+      break;
+
+   case 0xFA: //Six more standard timings
+      for(i = 0; i < 6; i++)
+         edid_add_standard_timing(info, d[5 + i*2], d[6 + i*2]);
+      break;
+
+   default:
+      break;
+   }
+}
+
+static void edid_parse_base_block(EDID_INFO_T *info, const uint8_t *block) {
+   uint16_t id = (block[8] << 8) | block[9];
+   int i;
+
+   info->manufacturer[0] = (char) ('A' - 1 + ((id >> 10) & 0x1F));
+   info->manufacturer[1] = (char) ('A' - 1 + ((id >> 5) & 0x1F));
+   info->manufacturer[2] = (char) ('A' - 1 + (id & 0x1F));
+   info->manufacturer[3] = '\0';
+   info->product_code = block[10] | (block[11] << 8);
+   info->serial_number = block[12] | (block[13] << 8) | (block[14] << 16) | ((uint32_t) block[15] << 24);
+   info->week = block[16];
+   info->year = block[17] + 1990;
+   info->version = block[18];
+   info->revision = block[19];
+
+   info->input = block[20];
+   if(block[20] & 0x80)
+      info->flags |= EDID_FLAG_DIGITAL;
+   info->width_cm = block[21];
+   info->height_cm = block[22];
+   info->features = block[24];
+
+   info->established_timings = (block[EDID_ESTABLISHED_OFFSET] << 16) |
+                               (block[EDID_ESTABLISHED_OFFSET+1] << 8) |
+                               block[EDID_ESTABLISHED_OFFSET+2];
+
+   for(i = 0; i < 8; i++)
+      edid_add_standard_timing(info, block[EDID_STANDARD_OFFSET + i*2], block[EDID_STANDARD_OFFSET + i*2 + 1]);
+
+   for(i = 0; i < EDID_NUM_DESCRIPTORS; i++)
+      edid_parse_descriptor(info, block + EDID_DESCRIPTOR_OFFSET + i*EDID_DESCRIPTOR_SIZE);
+}
+
+static void cea_add_svd(EDID_INFO_T *info, uint8_t svd, uint8_t ycbcr420_only) {
+   EDID_SVD_T *entry;
+
+   if(svd == 0 || svd == 128 || svd >= 254 || info->num_svds >= EDID_MAX_SVDS)
+      return;
+
+   entry = &info->svds[info->num_svds++];
+   //Bit 7 is the native flag for VICs 1-64 only, 193 upwards are plain VICs
+   if(svd >= 129 && svd <= 192) {
+      entry->code = svd & 0x7F;
+      entry->native = 1;
+   } else {
+      entry->code = svd;
+      entry->native = 0;
+   }
+   entry->ycbcr420_only = ycbcr420_only;
+}
+
+static void cea_parse_vendor_block(EDID_INFO_T *info, const uint8_t *p, uint32_t len) {
+   uint32_t oui, i;
+
+   if(len < 3)
+      return;
+   oui = p[0] | (p[1] << 8) | (p[2] << 16);
+
+   if(oui == HDMI_OUI && len >= 5) {
+      info->flags |= EDID_FLAG_HAS_HDMI_VSDB;
+      info->physical_address = (p[3] << 8) | p[4];
+      if(len >= 6)
+         info->hdmi_vsdb_flags = p[5];
+      if(len >= 7)
+         info->max_tmds_clock = p[6] * 5000;
+      if(len >= 8) {
+         i = 8;
+         if((p[7] & 0x80) && len >= i + 2) {
+            info->video_latency = p[i];
+            info->audio_latency = p[i+1];
+            i += 2;
+            if((p[7] & 0x40) && len >= i + 2) {
+               info->interlaced_video_latency = p[i];
+               info->interlaced_audio_latency = p[i+1];
+            }
+         }
+      }
+   } else if(oui == HDMI_FORUM_OUI && len >= 5) {
+      info->flags |= EDID_FLAG_HAS_HF_VSDB;
+      info->max_tmds_character_rate = p[4] * 5000;
+   }
+}
+
+static void cea_parse_extended_block(EDID_INFO_T *info, const uint8_t *p, uint32_t len) {
+   uint32_t i;
+
+   if(len < 1)
+      return;
+
+   switch(p[0]) {
+   case CEA_EXT_DB_VIDEO_CAPABILITY:
+      if(len >= 2) {
+         info->video_capability = p[1];
+         info->flags |= EDID_FLAG_HAS_VCDB;
+      }
+      break;
+
+   case CEA_EXT_DB_COLORIMETRY:
+      if(len >= 3) {
+         info->colorimetry = p[1] | (p[2] << 8);
+         info->flags |= EDID_FLAG_HAS_COLORIMETRY;
+      }
+      break;
+
+   case CEA_EXT_DB_HDR_STATIC:
+      if(len >= 3) {
+         info->hdr.eotfs = p[1];
+         info->hdr.metadata_types = p[2];
+         info->hdr.max_luminance = (len >= 4)? p[3] : 0;
+         info->hdr.max_frame_avg_luminance = (len >= 5)? p[4] : 0;
+         info->hdr.min_luminance = (len >= 6)? p[5] : 0;
+         info->flags |= EDID_FLAG_HAS_HDR;
+      }
+      break;
+
+   case CEA_EXT_DB_YCBCR420_VIDEO:
+      for(i = 1; i < len; i++)
+         cea_add_svd(info, p[i], 1);
+      break;
+
+   default:
+      break;
+   }
+}
+
+static void cea_parse_data_blocks(EDID_INFO_T *info, const uint8_t *p, uint32_t length) {
+   uint32_t offset = 0, i;
+
+   while(offset < length) {
+      uint32_t tag = p[offset] >> 5;
+      uint32_t len = p[offset] & 0x1F;
+      const uint8_t *payload = p + offset + 1;
+
+      if(offset + 1 + len > length)
+         break; //Block runs past the DTD offset, ignore the rest
+
+      switch(tag) {
+      case CEA_DB_AUDIO:
+         for(i = 0; i + 3 <= len && info->num_sads < EDID_MAX_SADS; i += 3) {
+            EDID_SAD_T *sad = &info->sads[info->num_sads++];
+            sad->format = (payload[i] >> 3) & 0x0F;
+            sad->max_channels = (payload[i] & 0x07) + 1;
+            sad->sample_rates = payload[i+1] & 0x7F;
+            sad->detail = payload[i+2];
+            sad->extension = (sad->format == EDID_AudioFormat_eExtended)? (payload[i+2] >> 3) : 0;
+         }
+         break;
+
+      case CEA_DB_VIDEO:
+         for(i = 0; i < len; i++)
+            cea_add_svd(info, payload[i], 0);
+         break;
+
+      case CEA_DB_VENDOR:
+         cea_parse_vendor_block(info, payload, len);
+         break;
+
+      case CEA_DB_SPEAKER:
+         if(len >= 3)
+            info->speaker_allocation = payload[0] | (payload[1] << 8) | (payload[2] << 16);
+         break;
+
+      case CEA_DB_EXTENDED:
+         cea_parse_extended_block(info, payload, len);
+         break;
+
+      default:
+         break;
+      }
+      offset += 1 + len;
+   }
+}
+
+static void edid_parse_cea_block(EDID_INFO_T *info, const uint8_t *block) {
+   uint32_t dtd_offset = block[2];
+   uint32_t offset;
+
+   info->flags |= EDID_FLAG_HAS_CEA;
+   if(block[1] >= 2) {
+      if(block[3] & 0x80) info->flags |= EDID_FLAG_UNDERSCAN;
+      if(block[3] & 0x40) info->flags |= EDID_FLAG_BASIC_AUDIO;
+      if(block[3] & 0x20) info->flags |= EDID_FLAG_YCBCR444;
+      if(block[3] & 0x10) info->flags |= EDID_FLAG_YCBCR422;
+      //The count covers the whole EDID, so every CEA block repeats it
+      if(info->num_native_detailed_timings == 0)
+         info->num_native_detailed_timings = block[3] & 0x0F;
+   }
+
+   //Offset zero means there is neither a data block collection nor DTDs
+   if(dtd_offset < 4 || dtd_offset > EDID_BLOCK_SIZE - 1)
+      return;
+
+   if(block[1] >= 3)
+      cea_parse_data_blocks(info, block + 4, dtd_offset - 4);
+
+   for(offset = dtd_offset; offset + EDID_DESCRIPTOR_SIZE < EDID_BLOCK_SIZE; offset += EDID_DESCRIPTOR_SIZE) {
+      if(block[offset] == 0 && block[offset+1] == 0)
+         break; //Padding
+      edid_parse_detailed_timing(info, block + offset);
+   }
+}
+
+/******************************************************************************
+EDID parser API
+******************************************************************************/
+/***********************************************************
+ * Name: vc_edid_parse
+ *
+ * Arguments:
+ *       EDID data, length in bytes, structure to fill in
+ *
+ * Description: Parse the EDID base block and any CEA-861 extensions
+ *
+ * Returns: zero if the base block was recognised
+ *
+ ***********************************************************/
+VCHPRE_ int VCHPOST_ vc_edid_parse(const uint8_t *data, uint32_t length, EDID_INFO_T *info) {
+   static const uint8_t edid_header[8] = {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+   uint32_t num_extensions, i;
+
+   if(!vcos_verify(data && info))
+      return -1;
+
+   memset(info, 0, sizeof(EDID_INFO_T));
+   info->physical_address = 0xFFFF;
+
+   if(length < EDID_BLOCK_SIZE || memcmp(data, edid_header, sizeof(edid_header)) != 0)
+      return -1;
+
+   if(!edid_block_checksum_ok(data))
+      info->flags |= EDID_FLAG_BAD_CHECKSUM;
+   edid_parse_base_block(info, data);
+   info->num_blocks = 1;
+
+   num_extensions = data[EDID_EXTENSION_COUNT_OFFSET];
+   for(i = 1; i <= num_extensions; i++) {
+      const uint8_t *block = data + i * EDID_BLOCK_SIZE;
+
+      if((i + 1) * EDID_BLOCK_SIZE > length) {
+         info->flags |= EDID_FLAG_TRUNCATED;
+         break;
+      }
+      if(!edid_block_checksum_ok(block))
+         info->flags |= EDID_FLAG_BAD_CHECKSUM;
+      if(block[0] == EDID_TAG_CEA)
+         edid_parse_cea_block(info, block);
+      info->num_blocks++;
+   }
+
+   if(info->num_native_detailed_timings > info->num_detailed_timings)
+      info->num_native_detailed_timings = info->num_detailed_timings;
+
+   return 0;
+}
+
+/***********************************************************
+ * Name: vc_edid_mode_supported
+ *
+ * Arguments:
+ *       parsed EDID, resolution group, mode code
+ *
+ * Description: Decide mode support from the EDID alone
+ *
+ * Returns: > 0 supported, 0 unsupported, < 0 if the EDID can't tell
+ *
+ ***********************************************************/
+VCHPRE_ int VCHPOST_ vc_edid_mode_supported(const EDID_INFO_T *info, HDMI_RES_GROUP_T group, uint32_t mode) {
+   uint32_t i, j;
+
+   if(!vcos_verify(info))
+      return -1;
+
+   switch(group) {
+   case HDMI_RES_GROUP_CEA:
+      for(i = 0; i < info->num_svds; i++) {
+         if(info->svds[i].code == mode && !info->svds[i].ycbcr420_only)
+            return 1;
+      }
+      return 0;
+
+   case HDMI_RES_GROUP_DMT:
+      for(i = 0; i < 24; i++) {
+         if(edid_established_dmt[i] == mode && (info->established_timings & (1 << i)))
+            return 1;
+      }
+      for(i = 0; i < vcos_countof(edid_dmt_modes); i++) {
+         const EDID_DMT_MODE_T *dmt = &edid_dmt_modes[i];
+         if(dmt->code != mode)
+            continue;
+         if(!dmt->reduced_blanking) {
+            for(j = 0; j < info->num_standard_timings; j++) {
+               if(info->standard_timings[j].width == dmt->width &&
+                  info->standard_timings[j].height == dmt->height &&
+                  info->standard_timings[j].frame_rate == dmt->frame_rate)
+                  return 1;
+            }
+         }
+         for(j = 0; j < info->num_detailed_timings; j++) {
+            const EDID_DETAILED_TIMING_T *dtd = &info->detailed_timings[j];
+            if(!dtd->interlaced && dtd->h_active == dmt->width && dtd->v_active == dmt->height &&
+               dtd->frame_rate == dmt->frame_rate &&
+               (dtd->h_blanking == EDID_CVT_RB_H_BLANKING) == (dmt->reduced_blanking != 0))
+               return 1;
+         }
+      }
+      return 0;
+
+   default:
+      //3D support lives in the HDMI VSDB 3D fields which are not decoded
+      return -1;
+   }
+}
+
+/***********************************************************
+ * Name: vc_edid_audio_supported
+ *
+ * Arguments:
+ *       parsed EDID, audio format (+ coding extension), channels, sample rate,
+ *       bitrate in kbps (or sample size for PCM)
+ *
+ * Description: Decide audio support from the EDID alone
+ *
+ * Returns: flags of EDID_AUDIO_SUPPORT_FLAG_T, zero means supported
+ *
+ ***********************************************************/
+VCHPRE_ int VCHPOST_ vc_edid_audio_supported(const EDID_INFO_T *info, uint32_t audio_format,
+                                             uint32_t num_channels, EDID_AudioSampleRate fs,
+                                             uint32_t bitrate) {
+   uint32_t format = audio_format, extension = 0, i;
+   int best = EDID_AUDIO_NO_SUPPORT;
+
+   if(!vcos_verify(info && num_channels > 0 && num_channels <= 8 && fs != EDID_AudioSampleRate_eReferToHeader))
+      return -1;
+
+   if(audio_format >= EDID_AudioFormat_eExtended) {
+      format = EDID_AudioFormat_eExtended;
+      extension = audio_format - EDID_AudioFormat_eExtended;
+   }
+
+   for(i = 0; i < info->num_sads; i++) {
+      const EDID_SAD_T *sad = &info->sads[i];
+      int flags = 0;
+
+      if(sad->format != format || sad->extension != extension)
+         continue;
+
+      if(num_channels > sad->max_channels)
+         flags |= EDID_AUDIO_CHAN_UNSUPPORTED;
+      if((sad->sample_rates & fs) == 0)
+         flags |= EDID_AUDIO_FS_UNSUPPORTED;
+      if(format == EDID_AudioFormat_ePCM) {
+         if((sad->detail & bitrate) == 0)
+            flags |= EDID_AUDIO_SAMP_UNSUPPORTED;
+      } else if(format >= EDID_AudioFormat_eAC3 && format <= EDID_AudioFormat_eATRAC) {
+         if(bitrate > sad->detail * 8u)
+            flags |= EDID_AUDIO_BR_UNSUPPORTED;
+      }
+
+      //Several descriptors may cover one format, report the closest match
+      if(best == EDID_AUDIO_NO_SUPPORT || edid_count_bits(flags) < edid_count_bits(best))
+         best = flags;
+      if(best == 0)
+         break;
+   }
+
+   //Basic audio implies 2 channel 16-bit PCM at 32, 44.1 and 48kHz without a descriptor
+   if(best != 0 && format == EDID_AudioFormat_ePCM && (info->flags & EDID_FLAG_BASIC_AUDIO) &&
+      num_channels <= 2 && (fs & (EDID_AudioSampleRate_e32KHz|EDID_AudioSampleRate_e44KHz|EDID_AudioSampleRate_e48KHz)) &&
+      (bitrate & EDID_AudioSampleSize_16bit))
+      best = 0;
+
+   return best;
+}
@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Host side EDID parser. Decodes the EDID base block and any CEA-861
+ * extensions (as read with vc_tv_hdmi_ddc_read) into EDID_INFO_T so that
+ * mode and audio support can be decided without asking VideoCore.
+ * See vc_hdmi.h for the CEA/DMT mode codes and audio enums used here.
+ */
+
+#ifndef _VC_EDID_PARSER_H_
+#define _VC_EDID_PARSER_H_
+
+#include "vcinclude/common.h"
+#include "interface/vcos/vcos.h"
+#include "interface/vmcs_host/vc_hdmi.h"
+
+#define EDID_BLOCK_SIZE                128
+#define EDID_MAX_DETAILED_TIMINGS      16
+#define EDID_MAX_STANDARD_TIMINGS      16
+#define EDID_MAX_SVDS                  64
+#define EDID_MAX_SADS                  16
+#define EDID_MONITOR_NAME_LEN          14 /**< 13 characters plus terminator */
+
+/**
+ * Parse status flags returned in EDID_INFO_T.flags
+ */
+typedef enum {
+   EDID_FLAG_BAD_CHECKSUM         = (1 << 0), /**<At least one block failed its checksum */
+   EDID_FLAG_TRUNCATED            = (1 << 1), /**<Fewer extension blocks supplied than announced */
+   EDID_FLAG_DIGITAL              = (1 << 2), /**<Digital input (bit 7 of the video input byte) */
+   EDID_FLAG_HAS_CEA              = (1 << 3), /**<At least one CEA-861 extension was found */
+   EDID_FLAG_HAS_RANGE_LIMITS     = (1 << 4), /**<Display range limits descriptor is valid */
+   EDID_FLAG_HAS_HDMI_VSDB        = (1 << 5), /**<HDMI 1.x vendor specific data block present (HDMI sink) */
+   EDID_FLAG_HAS_HF_VSDB          = (1 << 6), /**<HDMI Forum vendor specific data block present */
+   EDID_FLAG_HAS_HDR              = (1 << 7), /**<HDR static metadata data block present */
+   EDID_FLAG_HAS_COLORIMETRY      = (1 << 8), /**<Colorimetry data block present */
+   EDID_FLAG_HAS_VCDB             = (1 << 9), /**<Video capability data block present */
+   EDID_FLAG_UNDERSCAN            = (1 << 10),/**<CEA: sink underscans IT formats by default */
+   EDID_FLAG_BASIC_AUDIO          = (1 << 11),/**<CEA: basic audio (2ch PCM 32/44.1/48kHz) */
+   EDID_FLAG_YCBCR444             = (1 << 12),/**<CEA: YCbCr 4:4:4 supported */
+   EDID_FLAG_YCBCR422             = (1 << 13) /**<CEA: YCbCr 4:2:2 supported */
+} EDID_PARSE_FLAG_T;
+
+/**
+ * A detailed timing descriptor, either from the base block or a CEA extension
+ */
+typedef struct {
+   uint32_t pixel_clock;     /**<Pixel clock in kHz */
+   uint16_t h_active;
+   uint16_t h_blanking;
+   uint16_t h_sync_offset;
+   uint16_t h_sync_width;
+   uint16_t v_active;        /**<Lines per field if interlaced */
+   uint16_t v_blanking;
+   uint16_t v_sync_offset;
+   uint16_t v_sync_width;
+   uint16_t width_mm;        /**<Image size, zero if unknown */
+   uint16_t height_mm;
+   uint16_t frame_rate;      /**<Vertical refresh in Hz (field rate if interlaced), rounded */
+   uint8_t  interlaced;
+   uint8_t  flags;           /**<Raw flags byte (stereo/sync definition) */
+} EDID_DETAILED_TIMING_T;
+
+/**
+ * A standard timing (base block bytes 0x26-0x35 or a 0xFA descriptor)
+ */
+typedef struct {
+   uint16_t width;
+   uint16_t height;
+   uint16_t frame_rate;
+} EDID_STANDARD_TIMING_T;
+
+/**
+ * CEA short video descriptor
+ */
+typedef struct {
+   uint8_t code;             /**<HDMI_CEA_RES_CODE_T (VIC) */
+   uint8_t native;           /**<Non-zero if flagged as a native format */
+   uint8_t ycbcr420_only;    /**<Only supported with YCbCr 4:2:0 sampling */
+} EDID_SVD_T;
+
+/**
+ * CEA short audio descriptor
+ */
+typedef struct {
+   uint8_t format;           /**<EDID_AudioFormat */
+   uint8_t extension;        /**<EDID_AudioCodingExtension when format is eExtended */
+   uint8_t max_channels;     /**<1-8 */
+   uint8_t sample_rates;     /**<Bit mask of EDID_AudioSampleRate */
+   uint8_t detail;           /**<PCM: mask of EDID_AudioSampleSize, AC3 to ATRAC: max bitrate / 8kbps,
+                                 otherwise the format dependent third byte */
+} EDID_SAD_T;
+
+/**
+ * CEA-861.3 HDR static metadata data block. Luminance values are the raw
+ * codes from the block: max = 50*2^(code/32) cd/m2, min = max*(code/255)^2/100
+ */
+typedef struct {
+   uint8_t eotfs;            /**<Bit 0 SDR, 1 traditional HDR, 2 SMPTE ST 2084, 3 HLG */
+   uint8_t metadata_types;   /**<Bit 0 static metadata type 1 */
+   uint8_t max_luminance;    /**<Zero if not given */
+   uint8_t max_frame_avg_luminance;
+   uint8_t min_luminance;
+} EDID_HDR_STATIC_METADATA_T;
+
+/**
+ * Everything the parser extracts from an EDID
+ */
+typedef struct {
+   uint32_t flags;           /**<EDID_PARSE_FLAG_T */
+   uint32_t num_blocks;      /**<Blocks actually parsed, including the base block */
+
+   //Vendor and product identification
+   char     manufacturer[4]; /**<Three letter PNP id */
+   uint16_t product_code;
+   uint32_t serial_number;
+   uint8_t  week;
+   uint16_t year;
+   uint8_t  version;
+   uint8_t  revision;
+   char     monitor_name[EDID_MONITOR_NAME_LEN];
+
+   //Basic display parameters
+   uint8_t  input;           /**<Raw video input definition byte */
+   uint8_t  width_cm;
+   uint8_t  height_cm;
+   uint8_t  features;        /**<Raw feature support byte */
+
+   //Display range limits (valid if EDID_FLAG_HAS_RANGE_LIMITS)
+   uint16_t min_v_rate;      /**<Hz */
+   uint16_t max_v_rate;
+   uint16_t min_h_rate;      /**<kHz */
+   uint16_t max_h_rate;
+   uint32_t max_pixel_clock; /**<kHz, zero if not given */
+
+   //Timings
+   uint32_t established_timings; /**<Bytes 0x23-0x25, byte 0x23 in bits 16-23 */
+   uint32_t num_standard_timings;
+   EDID_STANDARD_TIMING_T standard_timings[EDID_MAX_STANDARD_TIMINGS];
+   uint32_t num_detailed_timings;
+   EDID_DETAILED_TIMING_T detailed_timings[EDID_MAX_DETAILED_TIMINGS];
+   uint32_t num_native_detailed_timings; /**<CEA: number of native formats among the DTDs */
+
+   //CEA-861 data blocks
+   uint32_t num_svds;
+   EDID_SVD_T svds[EDID_MAX_SVDS];
+   uint32_t num_sads;
+   EDID_SAD_T sads[EDID_MAX_SADS];
+   uint32_t speaker_allocation; /**<Speaker allocation data block payload */
+
+   //HDMI vendor specific data blocks
+   uint16_t physical_address;   /**<CEC physical address, 0xFFFF if none */
+   uint8_t  hdmi_vsdb_flags;    /**<Supports_AI/deep colour byte */
+   uint32_t max_tmds_clock;     /**<kHz, zero if not given */
+   uint8_t  video_latency;      /**<Raw latency codes: ms = (code-1)*2, 0 unknown, 255 no video/audio */
+   uint8_t  audio_latency;
+   uint8_t  interlaced_video_latency;
+   uint8_t  interlaced_audio_latency;
+   uint32_t max_tmds_character_rate; /**<HDMI Forum VSDB, kHz */
+
+   //Extended data blocks
+   uint8_t  video_capability;   /**<Video capability data block payload */
+   uint16_t colorimetry;        /**<Colorimetry data block, byte 3 in bits 0-7 and byte 4 in bits 8-15 */
+   EDID_HDR_STATIC_METADATA_T hdr;
+} EDID_INFO_T;
+
+/**
+ * <DFN>vc_edid_parse</DFN> decodes an EDID into an <DFN>EDID_INFO_T</DFN>.
+ * Parsing is lenient: checksum failures and missing extension blocks are
+ * reported in info->flags and everything readable is still returned.
+ *
+ * @param pointer to EDID data (base block followed by extension blocks)
+ *
+ * @param length of the data in bytes
+ *
+ * @param pointer to the structure to fill in
+ *
+ * @return zero if the base block was recognised, non-zero otherwise
+ */
+VCHPRE_ int VCHPOST_ vc_edid_parse(const uint8_t *data, uint32_t length, EDID_INFO_T *info);
+
+/**
+ * <DFN>vc_edid_mode_supported</DFN> answers the same question as
+ * <DFN>vc_tv_hdmi_mode_supported</DFN> from a parsed EDID alone.
+ *
+ * @param parsed EDID
+ *
+ * @param resolution standard (HDMI_RES_GROUP_CEA/HDMI_RES_GROUP_DMT)
+ *
+ * @param mode code
+ *
+ * @return > 0 means supported, 0 means unsupported, < 0 means the EDID does not
+ *         say (e.g. CEA 3D), ask VideoCore instead
+ */
+VCHPRE_ int VCHPOST_ vc_edid_mode_supported(const EDID_INFO_T *info, HDMI_RES_GROUP_T group, uint32_t mode);
+
+/**
+ * <DFN>vc_edid_audio_supported</DFN> answers the same question as
+ * <DFN>vc_tv_hdmi_audio_supported</DFN> from a parsed EDID alone.
+ *
+ * @param parsed EDID
+ *
+ * @param audio format supplied as (<DFN>EDID_AudioFormat</DFN> + <DFN>EDID_AudioCodingExtension</DFN>)
+ *
+ * @param no. of channels (1-8)
+ *
+ * @param sample rate <DFN>EDID_AudioSampleRate</DFN> but NOT "refer to header"
+ *
+ * @param bit rate in kbps, or sample size if pcm (use <DFN>EDID_AudioSampleSize</DFN>)
+ *
+ * @return flags in <DFN>EDID_AUDIO_SUPPORT_FLAG_T</DFN>, zero means everything is supported,
+ *         < 0 means invalid arguments
+ */
+VCHPRE_ int VCHPOST_ vc_edid_audio_supported(const EDID_INFO_T *info, uint32_t audio_format,
+                                             uint32_t num_channels, EDID_AudioSampleRate fs,
+                                             uint32_t bitrate);
+
+#endif
@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Types shared by the TV and CEC service APIs for reporting on the delivery
+ * of their notifications.
+ */
+
+#ifndef _VC_NOTIFY_DEFS_H_
+#define _VC_NOTIFY_DEFS_H_
+
+#include "vcinclude/common.h"
+
+/**
+ * Dispatch statistics, see vc_tv_get_notify_stats and vc_cec_get_notify_stats
+ */
+typedef struct {
+   uint32_t received;         /**<Notifications received from VideoCore */
+   uint32_t batches;          /**<Number of batches they arrived in */
+   uint32_t max_batch;        /**<Largest batch */
+   uint32_t delivered;        /**<Callbacks made, over all subscribers */
+   uint32_t dropped;          /**<Notifications lost because a subscriber queue was full */
+   uint32_t max_latency_us;   /**<Longest time from receipt to callback */
+   uint64_t total_latency_us; /**<Divide by delivered for the average */
+} VC_NOTIFY_STATS_T;
+
+#endif //#ifndef _VC_NOTIFY_DEFS_H_
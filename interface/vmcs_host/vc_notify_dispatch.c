@@ -0,0 +1,358 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <string.h>
+
+#include "interface/vcos/vcos.h"
+#include "vc_notify_dispatch.h"
+
+#define VC_NOTIFY_QUEUE_MASK (VC_NOTIFY_QUEUE_SIZE - 1)
+
+/***********************************************************
+ * Name: notify_subscriber_func
+ *
+ * Arguments: subscriber
+ *
+ * Description: Subscriber thread, delivers queued notifications
+ *              in order until told to exit, followed by an
+ *              overflow notification if any were lost
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+static void *notify_subscriber_func(void *arg) {
+   VC_NOTIFY_SUBSCRIBER_T *subscriber = (VC_NOTIFY_SUBSCRIBER_T *) arg;
+
+   while(1) {
+      VC_NOTIFY_T notify;
+      uint32_t latency;
+
+      vcos_mutex_lock(&subscriber->lock);
+      if(subscriber->to_exit) {
+         vcos_mutex_unlock(&subscriber->lock);
+         break;
+      }
+      if(subscriber->read == subscriber->write && subscriber->lost) {
+         //Caught up after the queue overflowed, report the gap and start queuing again
+         memset(&notify, 0, sizeof(notify));
+         notify.reason = subscriber->overflow_reason;
+         notify.param[0] = subscriber->lost;
+         subscriber->lost = 0;
+         vcos_mutex_unlock(&subscriber->lock);
+
+         subscriber->deliver(subscriber->callback, subscriber->callback_data, &notify);
+         continue;
+      }
+      if(subscriber->read == subscriber->write) {
+         vcos_mutex_unlock(&subscriber->lock);
+         vcos_event_wait(&subscriber->available);
+         continue;
+      }
+      notify = subscriber->queue[subscriber->read++ & VC_NOTIFY_QUEUE_MASK];
+      latency = vcos_getmicrosecs() - notify.timestamp;
+      subscriber->stats.delivered++;
+      subscriber->stats.total_latency_us += latency;
+      if(latency > subscriber->stats.max_latency_us)
+         subscriber->stats.max_latency_us = latency;
+      vcos_mutex_unlock(&subscriber->lock);
+
+      subscriber->deliver(subscriber->callback, subscriber->callback_data, &notify);
+   }
+   return 0;
+}
+
+//Join and free the subscriber, whose thread has been told to exit.
+//Called without the dispatcher lock so the thread can finish a callback
+//that calls back into the service.
+static void notify_subscriber_join(VC_NOTIFY_DISPATCHER_T *dispatcher, VC_NOTIFY_SUBSCRIBER_T *subscriber) {
+   void *dummy;
+   vcos_thread_join(&subscriber->thread, &dummy);
+   vcos_event_delete(&subscriber->available);
+   vcos_mutex_delete(&subscriber->lock);
+
+   vcos_mutex_lock(&dispatcher->lock);
+   //Keep the totals of departed subscribers
+   dispatcher->stats.delivered += subscriber->stats.delivered;
+   dispatcher->stats.dropped += subscriber->stats.dropped;
+   dispatcher->stats.total_latency_us += subscriber->stats.total_latency_us;
+   if(subscriber->stats.max_latency_us > dispatcher->stats.max_latency_us)
+      dispatcher->stats.max_latency_us = subscriber->stats.max_latency_us;
+   subscriber->state = VC_NOTIFY_SUBSCRIBER_FREE;
+   vcos_mutex_unlock(&dispatcher->lock);
+}
+
+//Tell a subscriber thread to exit, the dispatcher lock must be held
+static void notify_subscriber_stop(VC_NOTIFY_SUBSCRIBER_T *subscriber) {
+   vcos_mutex_lock(&subscriber->lock);
+   subscriber->to_exit = 1;
+   vcos_mutex_unlock(&subscriber->lock);
+   vcos_event_signal(&subscriber->available);
+}
+
+//Join subscribers that unsubscribed from their own callback, other than the caller
+static void notify_reap(VC_NOTIFY_DISPATCHER_T *dispatcher) {
+   VCOS_THREAD_T *self = vcos_thread_current();
+   uint32_t i;
+   for(i = 0; i < VC_NOTIFY_MAX_SUBSCRIBERS; i++) {
+      VC_NOTIFY_SUBSCRIBER_T *subscriber = &dispatcher->subscriber[i];
+      int reap = 0;
+      vcos_mutex_lock(&dispatcher->lock);
+      if(subscriber->state == VC_NOTIFY_SUBSCRIBER_EXITING && &subscriber->thread != self) {
+         subscriber->state = VC_NOTIFY_SUBSCRIBER_JOINING;
+         reap = 1;
+      }
+      vcos_mutex_unlock(&dispatcher->lock);
+      if(reap)
+         notify_subscriber_join(dispatcher, subscriber);
+   }
+}
+
+/***********************************************************
+ * Name: vc_notify_dispatch_init
+ *
+ * Arguments: dispatcher, name for its threads, deliver function,
+ *            reason for overflow notifications
+ *
+ * Description: Initialise a dispatcher with no subscribers
+ *
+ * Returns: VCOS_SUCCESS or an error from creating the lock
+ *
+ ***********************************************************/
+VCOS_STATUS_T vc_notify_dispatch_init(VC_NOTIFY_DISPATCHER_T *dispatcher, const char *name,
+                                      VC_NOTIFY_DELIVER_T deliver, uint32_t overflow_reason) {
+   memset(dispatcher, 0, sizeof(*dispatcher));
+   dispatcher->name = name;
+   dispatcher->deliver = deliver;
+   dispatcher->overflow_reason = overflow_reason;
+   return vcos_mutex_create(&dispatcher->lock, name);
+}
+
+/***********************************************************
+ * Name: vc_notify_dispatch_deinit
+ *
+ * Arguments: dispatcher
+ *
+ * Description: Stop all subscriber threads, dropping anything
+ *              still queued, and free the dispatcher
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+void vc_notify_dispatch_deinit(VC_NOTIFY_DISPATCHER_T *dispatcher) {
+   uint32_t i;
+   for(i = 0; i < VC_NOTIFY_MAX_SUBSCRIBERS; i++) {
+      VC_NOTIFY_SUBSCRIBER_T *subscriber = &dispatcher->subscriber[i];
+      int join = 0;
+      vcos_mutex_lock(&dispatcher->lock);
+      if(subscriber->state == VC_NOTIFY_SUBSCRIBER_ACTIVE ||
+         subscriber->state == VC_NOTIFY_SUBSCRIBER_EXITING) {
+         notify_subscriber_stop(subscriber);
+         subscriber->state = VC_NOTIFY_SUBSCRIBER_JOINING;
+         join = 1;
+      }
+      vcos_mutex_unlock(&dispatcher->lock);
+      if(join)
+         notify_subscriber_join(dispatcher, subscriber);
+   }
+   vcos_mutex_delete(&dispatcher->lock);
+}
+
+/***********************************************************
+ * Name: vc_notify_dispatch_subscribe
+ *
+ * Arguments: dispatcher, callback, context passed to callback
+ *
+ * Description: Start delivering notifications to callback on
+ *              a thread of its own
+ *
+ * Returns: VCOS_SUCCESS, VCOS_ENOSPC if there are already
+ *          VC_NOTIFY_MAX_SUBSCRIBERS, or a vcos error
+ *
+ ***********************************************************/
+VCOS_STATUS_T vc_notify_dispatch_subscribe(VC_NOTIFY_DISPATCHER_T *dispatcher,
+                                           VC_NOTIFY_CALLBACK_T callback, void *callback_data) {
+   VC_NOTIFY_SUBSCRIBER_T *subscriber = NULL;
+   VCOS_THREAD_ATTR_T attrs;
+   VCOS_STATUS_T status;
+   uint32_t i;
+
+   notify_reap(dispatcher);
+
+   vcos_mutex_lock(&dispatcher->lock);
+   for(i = 0; i < VC_NOTIFY_MAX_SUBSCRIBERS && subscriber == NULL; i++) {
+      if(dispatcher->subscriber[i].state == VC_NOTIFY_SUBSCRIBER_FREE)
+         subscriber = &dispatcher->subscriber[i];
+   }
+   if(subscriber == NULL) {
+      vcos_mutex_unlock(&dispatcher->lock);
+      return VCOS_ENOSPC;
+   }
+
+   memset(subscriber, 0, sizeof(*subscriber));
+   subscriber->callback = callback;
+   subscriber->callback_data = callback_data;
+   subscriber->deliver = dispatcher->deliver;
+   subscriber->overflow_reason = dispatcher->overflow_reason;
+
+   status = vcos_mutex_create(&subscriber->lock, dispatcher->name);
+   if(status == VCOS_SUCCESS) {
+      status = vcos_event_create(&subscriber->available, dispatcher->name);
+      if(status == VCOS_SUCCESS) {
+         vcos_thread_attr_init(&attrs);
+         vcos_thread_attr_setstacksize(&attrs, 4096);
+         vcos_thread_attr_settimeslice(&attrs, 1);
+         status = vcos_thread_create(&subscriber->thread, dispatcher->name, &attrs,
+                                     notify_subscriber_func, subscriber);
+         if(status != VCOS_SUCCESS)
+            vcos_event_delete(&subscriber->available);
+      }
+      if(status != VCOS_SUCCESS)
+         vcos_mutex_delete(&subscriber->lock);
+   }
+   if(status == VCOS_SUCCESS)
+      subscriber->state = VC_NOTIFY_SUBSCRIBER_ACTIVE;
+   vcos_mutex_unlock(&dispatcher->lock);
+   return status;
+}
+
+/***********************************************************
+ * Name: vc_notify_dispatch_unsubscribe
+ *
+ * Arguments: dispatcher, callback
+ *
+ * Description: Stop delivering notifications to callback.
+ *              Anything still in its queue is dropped.
+ *
+ * Returns: VCOS_SUCCESS or VCOS_ENOENT
+ *
+ ***********************************************************/
+VCOS_STATUS_T vc_notify_dispatch_unsubscribe(VC_NOTIFY_DISPATCHER_T *dispatcher,
+                                             VC_NOTIFY_CALLBACK_T callback) {
+   VC_NOTIFY_SUBSCRIBER_T *subscriber = NULL;
+   uint32_t i;
+
+   vcos_mutex_lock(&dispatcher->lock);
+   for(i = 0; i < VC_NOTIFY_MAX_SUBSCRIBERS && subscriber == NULL; i++) {
+      if(dispatcher->subscriber[i].state == VC_NOTIFY_SUBSCRIBER_ACTIVE &&
+         dispatcher->subscriber[i].callback == callback)
+         subscriber = &dispatcher->subscriber[i];
+   }
+   if(subscriber == NULL) {
+      vcos_mutex_unlock(&dispatcher->lock);
+      return VCOS_ENOENT;
+   }
+   notify_subscriber_stop(subscriber);
+   if(&subscriber->thread == vcos_thread_current()) {
+      //Can't join ourselves, the next subscribe or deinit will
+      subscriber->state = VC_NOTIFY_SUBSCRIBER_EXITING;
+      vcos_mutex_unlock(&dispatcher->lock);
+      return VCOS_SUCCESS;
+   }
+   subscriber->state = VC_NOTIFY_SUBSCRIBER_JOINING;
+   vcos_mutex_unlock(&dispatcher->lock);
+
+   notify_subscriber_join(dispatcher, subscriber);
+   return VCOS_SUCCESS;
+}
+
+/***********************************************************
+ * Name: vc_notify_dispatch_post
+ *
+ * Arguments: dispatcher, array of notifications, count
+ *
+ * Description: Queue a batch of notifications to every subscriber
+ *              and wake each of them once. A subscriber whose queue
+ *              is full loses notifications rather than holding up the
+ *              caller, and is told how many once it has caught up.
+ *
+ * Returns: the number of subscribers
+ *
+ ***********************************************************/
+uint32_t vc_notify_dispatch_post(VC_NOTIFY_DISPATCHER_T *dispatcher,
+                                 const VC_NOTIFY_T *notify, uint32_t count) {
+   uint32_t i, j, subscribers = 0;
+
+   vcos_mutex_lock(&dispatcher->lock);
+   dispatcher->stats.received += count;
+   dispatcher->stats.batches++;
+   if(count > dispatcher->stats.max_batch)
+      dispatcher->stats.max_batch = count;
+
+   for(i = 0; i < VC_NOTIFY_MAX_SUBSCRIBERS; i++) {
+      VC_NOTIFY_SUBSCRIBER_T *subscriber = &dispatcher->subscriber[i];
+      uint32_t dropped = 0;
+      if(subscriber->state != VC_NOTIFY_SUBSCRIBER_ACTIVE)
+         continue;
+
+      vcos_mutex_lock(&subscriber->lock);
+      for(j = 0; j < count; j++) {
+         //Once anything is lost queue nothing more until the overflow is reported,
+         //so the subscriber sees it in the place of what it missed
+         if(subscriber->lost == 0 && subscriber->write - subscriber->read < VC_NOTIFY_QUEUE_SIZE)
+            subscriber->queue[subscriber->write++ & VC_NOTIFY_QUEUE_MASK] = notify[j];
+         else
+            dropped++;
+      }
+      subscriber->lost += dropped;
+      subscriber->stats.dropped += dropped;
+      vcos_mutex_unlock(&subscriber->lock);
+      vcos_event_signal(&subscriber->available);
+      subscribers++;
+   }
+   vcos_mutex_unlock(&dispatcher->lock);
+   return subscribers;
+}
+
+/***********************************************************
+ * Name: vc_notify_dispatch_get_stats
+ *
+ * Arguments: dispatcher, stats to fill in
+ *
+ * Description: Totals over all current and past subscribers
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+void vc_notify_dispatch_get_stats(VC_NOTIFY_DISPATCHER_T *dispatcher, VC_NOTIFY_STATS_T *stats) {
+   uint32_t i;
+   vcos_mutex_lock(&dispatcher->lock);
+   *stats = dispatcher->stats;
+   for(i = 0; i < VC_NOTIFY_MAX_SUBSCRIBERS; i++) {
+      VC_NOTIFY_SUBSCRIBER_T *subscriber = &dispatcher->subscriber[i];
+      //A joining subscriber's totals are added once its lock is gone
+      if(subscriber->state != VC_NOTIFY_SUBSCRIBER_ACTIVE &&
+         subscriber->state != VC_NOTIFY_SUBSCRIBER_EXITING)
+         continue;
+      vcos_mutex_lock(&subscriber->lock);
+      stats->delivered += subscriber->stats.delivered;
+      stats->dropped += subscriber->stats.dropped;
+      stats->total_latency_us += subscriber->stats.total_latency_us;
+      if(subscriber->stats.max_latency_us > stats->max_latency_us)
+         stats->max_latency_us = subscriber->stats.max_latency_us;
+      vcos_mutex_unlock(&subscriber->lock);
+   }
+   vcos_mutex_unlock(&dispatcher->lock);
+}
@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2012, Broadcom Europe Ltd
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Notification dispatcher shared by the TV and CEC services. The service's
+ * notify thread drains notifications from VideoCore in batches and posts
+ * them here; each subscriber has its own queue and thread, so a slow
+ * callback only delays its own notifications.
+ */
+
+#ifndef _VC_NOTIFY_DISPATCH_H_
+#define _VC_NOTIFY_DISPATCH_H_
+
+#include "vcinclude/common.h"
+#include "interface/vcos/vcos.h"
+#include "vc_notify_defs.h"
+
+#define VC_NOTIFY_MAX_PARAMS      4
+#define VC_NOTIFY_MAX_SUBSCRIBERS 4
+#define VC_NOTIFY_QUEUE_SIZE      32 /**< Per subscriber, must be a power of two */
+
+/**
+ * A notification as received from VideoCore
+ */
+typedef struct {
+   uint32_t reason;
+   uint32_t param[VC_NOTIFY_MAX_PARAMS];
+   uint32_t timestamp; /**<vcos_getmicrosecs() when it was dequeued */
+} VC_NOTIFY_T;
+
+//Subscriber callbacks are stored untyped; the service's deliver
+//function casts back to its own callback type and unpacks the parameters
+typedef void (*VC_NOTIFY_CALLBACK_T)(void);
+typedef void (*VC_NOTIFY_DELIVER_T)(VC_NOTIFY_CALLBACK_T callback, void *callback_data,
+                                    const VC_NOTIFY_T *notify);
+
+typedef enum {
+   VC_NOTIFY_SUBSCRIBER_FREE = 0,
+   VC_NOTIFY_SUBSCRIBER_ACTIVE,
+   VC_NOTIFY_SUBSCRIBER_EXITING, //Unsubscribed from its own callback, thread still to be joined
+   VC_NOTIFY_SUBSCRIBER_JOINING
+} VC_NOTIFY_SUBSCRIBER_STATE_T;
+
+typedef struct {
+   VC_NOTIFY_SUBSCRIBER_STATE_T state;
+   VC_NOTIFY_CALLBACK_T callback;
+   void                *callback_data;
+   VC_NOTIFY_DELIVER_T  deliver;
+   uint32_t             overflow_reason;
+   VCOS_THREAD_T        thread;
+   VCOS_EVENT_T         available;
+   VCOS_MUTEX_T         lock;  //Only held to move notifications in or out of the queue
+   int                  to_exit;
+   uint32_t             lost;  //Dropped since the queue filled, reported in one overflow notification
+   uint32_t             read;
+   uint32_t             write;
+   VC_NOTIFY_T          queue[VC_NOTIFY_QUEUE_SIZE];
+   VC_NOTIFY_STATS_T    stats; //delivered, dropped and latency only
+} VC_NOTIFY_SUBSCRIBER_T;
+
+typedef struct {
+   const char          *name;
+   VC_NOTIFY_DELIVER_T  deliver;
+   uint32_t             overflow_reason; //Reason delivered in place of notifications a subscriber lost
+   VCOS_MUTEX_T         lock;  //Subscriber table and batch stats, never held across a callback
+   VC_NOTIFY_SUBSCRIBER_T subscriber[VC_NOTIFY_MAX_SUBSCRIBERS];
+   VC_NOTIFY_STATS_T    stats;
+} VC_NOTIFY_DISPATCHER_T;
+
+//When a subscriber's queue fills, nothing more is queued to it until it has
+//caught up. It is then delivered a notification with reason overflow_reason
+//and the number of notifications it lost in param[0], so it can re-read
+//whatever state it was tracking.
+extern VCOS_STATUS_T vc_notify_dispatch_init(VC_NOTIFY_DISPATCHER_T *dispatcher, const char *name,
+                                             VC_NOTIFY_DELIVER_T deliver, uint32_t overflow_reason);
+
+//Stops and joins all subscriber threads, must not be called from a callback
+extern void vc_notify_dispatch_deinit(VC_NOTIFY_DISPATCHER_T *dispatcher);
+
+extern VCOS_STATUS_T vc_notify_dispatch_subscribe(VC_NOTIFY_DISPATCHER_T *dispatcher,
+                                                  VC_NOTIFY_CALLBACK_T callback, void *callback_data);
+
+//No further calls are made to callback once this returns, unless it is called
+//from callback itself, in which case that call is the last one.
+//Returns VCOS_ENOENT if the callback was not subscribed.
+extern VCOS_STATUS_T vc_notify_dispatch_unsubscribe(VC_NOTIFY_DISPATCHER_T *dispatcher,
+                                                    VC_NOTIFY_CALLBACK_T callback);
+
+//Queue a batch of notifications to every subscriber. Returns the number of subscribers.
+extern uint32_t vc_notify_dispatch_post(VC_NOTIFY_DISPATCHER_T *dispatcher,
+                                        const VC_NOTIFY_T *notify, uint32_t count);
+
+extern void vc_notify_dispatch_get_stats(VC_NOTIFY_DISPATCHER_T *dispatcher, VC_NOTIFY_STATS_T *stats);
+
+#endif //#ifndef _VC_NOTIFY_DISPATCH_H_
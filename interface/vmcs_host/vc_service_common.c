@@ -55,3 +55,14 @@ const char* vchi2service_status_string(VC_SERVICE_VCHI_STATUS_T status) {
    }
    return string;
 }
+
+static VC_SERVICE_OPEN_T vc_service_lazy_open;
+
+void vc_service_set_lazy_open(VC_SERVICE_OPEN_T open) {
+   vc_service_lazy_open = open;
+}
+
+void vc_service_open_lazily(VC_SERVICE_ID_T service) {
+   if(vc_service_lazy_open)
+      vc_service_lazy_open(service);
+}
@@ -45,4 +45,23 @@ typedef enum {
 extern VC_SERVICE_VCHI_STATUS_T vchi2service_status(int32_t x);
 extern const char* vchi2service_status_string(VC_SERVICE_VCHI_STATUS_T status);
 
+//Services that the host may open on first use rather than at startup
+typedef enum {
+   VC_SERVICE_GENCMD = 0,
+   VC_SERVICE_DISPMANX,
+   VC_SERVICE_TVSERVICE,
+   VC_SERVICE_CEC,
+   VC_SERVICE_MAX
+} VC_SERVICE_ID_T;
+
+typedef void (*VC_SERVICE_OPEN_T)(VC_SERVICE_ID_T service);
+
+//Installs the function which opens a service on demand (NULL for none).
+//Must be set before any service is used.
+extern void vc_service_set_lazy_open(VC_SERVICE_OPEN_T open);
+
+//Called by a service on entry, opens it if the host deferred opening it.
+//Returns once the service is open, or immediately if there is nothing to do.
+extern void vc_service_open_lazily(VC_SERVICE_ID_T service);
+
 #endif //#ifndef _VC_SERVICE_COMMON_DEFS_H_
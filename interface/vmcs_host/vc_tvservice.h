@@ -40,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/vmcs_host/vc_tvservice_defs.h"
 #include "interface/vmcs_host/vc_hdmi.h"
 #include "interface/vmcs_host/vc_sdtv.h"
+#include "interface/vmcs_host/vc_notify_defs.h"
 
 /**
  * \file
@@ -72,6 +73,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 typedef void (*TVSERVICE_CALLBACK_T)(void *callback_data, uint32_t reason, uint32_t param1, uint32_t param2);
 
+/**
+ * Reason passed to a TVSERVICE_CALLBACK_T in place of notifications it
+ * missed because it fell more than a queue's worth behind. param1 is the
+ * number lost. The callback should re-read the state with
+ * <DFN>vc_tv_get_state</DFN> rather than rely on the last
+ * notification it saw. Does not clash with the HDMI or SDTV reasons.
+ */
+#define VC_TV_NOTIFY_OVERFLOW 0x80000000
+
 /* API at application start time */
 /**
  * <DFN>vc_vchi_tv_init</DFN> is called at the beginning of the application
@@ -100,14 +110,21 @@ VCHPRE_ void vc_vchi_tv_stop( void );
  * Host applications should call <DFN>vc_tv_register_callback</DNF> at
  * the beginning to register a callback function to handle all notifications.
  * See <DFN>TVSERVICE_CALLBACK_T </DFN>
+ * Each callback is called on a thread of its own, in the order the
+ * notifications arrived, so a slow callback does not delay the others.
+ * Different callbacks may therefore run at the same time as each other and
+ * as the service reading further notifications; only the calls to any one
+ * callback are serialised. A callback which falls behind is passed
+ * <DFN>VC_TV_NOTIFY_OVERFLOW</DFN> in place of what it missed.
  *
  * @param callback function
  *
  * @param callback_data is the context to be passed when function is called
  *
- * @return void
+ * @return zero if the callback was registered, non-zero if the service is
+ *         not running or too many callbacks are registered already
  */
-VCHPRE_ void vc_tv_register_callback(TVSERVICE_CALLBACK_T callback, void *callback_data);
+VCHPRE_ int vc_tv_register_callback(TVSERVICE_CALLBACK_T callback, void *callback_data);
 
 /**
  * <DFN>vc_tv_unregister_callback</DNF> removes a function registered with
@@ -119,6 +136,16 @@ VCHPRE_ void vc_tv_register_callback(TVSERVICE_CALLBACK_T callback, void *callba
  */
 VCHPRE_ void vc_tv_unregister_callback(TVSERVICE_CALLBACK_T callback);
 
+/**
+ * <DFN>vc_tv_get_notify_stats</DNF> reports how many notifications have
+ * been received and delivered, and how long they took to reach the callbacks.
+ *
+ * @param stats is filled in
+ *
+ * @return void
+ */
+VCHPRE_ void vc_tv_get_notify_stats(VC_NOTIFY_STATS_T *stats);
+
 /**
  * In the following API any functions applying to HDMI only will have hdmi_
  * in the name, ditto for SDTV only will have sdtv_ in the name,
@@ -129,6 +156,7 @@ VCHPRE_ void vc_tv_unregister_callback(TVSERVICE_CALLBACK_T callback);
  * <DFN>vc_tv_get_state</DFN> is used to obtain the current TV state.
  * Host applications should call this function right after registering
  * a callback in case any notifications are missed.
+ * The state is cached on the host until the next TV notification.
  *
  * @param pointer to TV_GET_STATE_RESP_T
  *
@@ -258,7 +286,7 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_get_supported_modes(HDMI_RES_GROUP_T group,
 
 /**
  * <DFN>vc_tv_hdmi_mode_supported</DFN> is used to query whether a particular mode
- * is supported or not.
+ * is supported or not. Answers are cached on the host until the next hotplug.
  *
  * @param resolution standard (HDMI_RES_GROUP_CEA/HDMI_RES_GROUP_DMT)
  *
@@ -279,6 +307,7 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_mode_supported(HDMI_RES_GROUP_T group,
  * Any non-zero values are interpreted as bit mask (EDID_AUDIO_SUPPORT_FLAG_T).
  * For example, if EDID_AUDIO_NO_SUPPORT is set, the audio format is not supported.
  * If EDID_AUDIO_CHAN_UNSUPPORTED is set, the max no. of channels has exceeded.
+ * Answers are cached on the host until the next hotplug.
  *
  * @param audio format supplied as (<DFN>EDID_AudioFormat</DFN> + <DFN>EDID_AudioCodingExtension</DFN>)
  *
@@ -428,7 +457,8 @@ VCHPRE_ int VCHPOST_ vc_tv_test_mode_stop( void );
 
 /**
  * <DFN>vc_tv_hdmi_ddc_read</DFN> allows an host application to read EDID
- * with DDC protocol.
+ * with DDC protocol. Whole EDID blocks are cached on the host until the next hotplug,
+ * so repeated reads of the same blocks do not go to VideoCore.
  *
  * @param offset
  *
@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/vchi/message_drivers/message.h"
 #include "vc_cecservice.h"
 #include "vc_service_common.h"
+#include "vc_notify_dispatch.h"
 
 /******************************************************************************
 Local types and defines.
@@ -46,6 +47,13 @@ Local types and defines.
 #define _max(x,y) (((x) >= (y))? (x) : (y))
 #endif
 
+//Maximum number of send_msg commands vc_cec_send_message_batch has
+//queued to the server before it starts reading their replies
+#define CECSERVICE_MAX_BATCH_PENDING 8
+
+//Notifications are read from VideoCore this many at a time
+#define CECSERVICE_NOTIFY_BATCH 16
+
 //TV service host side state (mostly the same as Videocore side - TVSERVICE_STATE_T)
 typedef struct {
    //Generic service stuff
@@ -59,8 +67,9 @@ typedef struct {
    uint32_t              notify_length;
    uint32_t              num_connections;
    VCOS_MUTEX_T          lock;
-   CECSERVICE_CALLBACK_T notify_fn;
-   void                 *notify_data;
+   VCOS_MUTEX_T          register_lock; //Serialises changing the subscribed callback
+   CECSERVICE_CALLBACK_T notify_fn;  //Currently subscribed to dispatcher
+   VC_NOTIFY_DISPATCHER_T dispatcher;
    int                   initialised;
    int                   to_exit;
 
@@ -70,6 +79,15 @@ typedef struct {
    CEC_DEVICE_TYPE_T      logical_address;  //logical address
    VC_CEC_TOPOLOGY_T     *topology; //16-byte aligned for the transfer
 
+   //Host side copies of the physical address and topology. Both are refreshed
+   //from notifications, so queries only go to Videocore when these are invalid.
+   //cache_generation is bumped on every invalidation so that a reply which
+   //raced with a notification is not stored.
+   uint32_t               cache_generation;
+   int                    physical_address_valid;
+   int                    topology_cache_valid;
+   VC_CEC_TOPOLOGY_T      topology_cache;
+
 } CECSERVICE_HOST_STATE_T;
 
 /******************************************************************************
@@ -143,6 +161,7 @@ Static functions.
 //Lock the host state
 static __inline int lock_obtain (void) {
    VCOS_STATUS_T status = VCOS_EAGAIN;
+   vc_service_open_lazily(VC_SERVICE_CEC);
    if(cecservice_client.initialised && (status = vcos_mutex_lock(&cecservice_client.lock)) == VCOS_SUCCESS) {
       if(cecservice_client.initialised) { // check service hasn't been closed while we were waiting for the lock.
          vchi_service_use(cecservice_client.client_handle[0]);
@@ -166,6 +185,22 @@ static __inline void lock_release (void) {
    vcos_mutex_unlock(&cecservice_client.lock);
 }
 
+//Lock the host state for cache access only, the service is not used
+static __inline int cecservice_cache_lock (void) {
+   vc_service_open_lazily(VC_SERVICE_CEC);
+   return cecservice_client.initialised && vcos_mutex_lock(&cecservice_client.lock) == VCOS_SUCCESS;
+}
+
+static __inline void cecservice_cache_unlock (void) {
+   vcos_mutex_unlock(&cecservice_client.lock);
+}
+
+//Drop the cached topology, the caller must hold the lock
+static void cecservice_invalidate_topology (void) {
+   cecservice_client.topology_cache_valid = 0;
+   cecservice_client.cache_generation++;
+}
+
 //Forward declarations
 static void cecservice_client_callback( void *callback_param,
                                        VCHI_CALLBACK_REASON_T reason,
@@ -186,6 +221,9 @@ static int32_t cecservice_send_command_reply( uint32_t command, void *buffer, ui
 
 static void *cecservice_notify_func(void *arg);
 
+static void cecservice_notify_deliver(VC_NOTIFY_CALLBACK_T callback, void *callback_data,
+                                      const VC_NOTIFY_T *notify);
+
 static void cecservice_logging_init(void);
 
 /******************************************************************************
@@ -225,6 +263,8 @@ VCHPRE_ void VCHPOST_ vc_vchi_cec_init(VCHI_INSTANCE_T initialise_instance, VCHI
 
    status = vcos_mutex_create(&cecservice_client.lock, "HCEC");
    vcos_assert(status == VCOS_SUCCESS);
+   status = vcos_mutex_create(&cecservice_client.register_lock, "HCEC register");
+   vcos_assert(status == VCOS_SUCCESS);
    status = vcos_event_create(&cecservice_message_available_event, "HCEC");
    vcos_assert(status == VCOS_SUCCESS);
    status = vcos_event_create(&cecservice_notify_available_event, "HCEC");
@@ -277,6 +317,10 @@ VCHPRE_ void VCHPOST_ vc_vchi_cec_init(VCHI_INSTANCE_T initialise_instance, VCHI
       vchi_service_release(cecservice_client.notify_handle[i]);
    }
 
+   status = vc_notify_dispatch_init(&cecservice_client.dispatcher, "HCEC Callback", cecservice_notify_deliver,
+                                    VC_CEC_NOTIFY_OVERFLOW);
+   vcos_assert(status == VCOS_SUCCESS);
+
    //Create the notifier task
    vcos_thread_attr_init(&attrs);
    vcos_thread_attr_setstacksize(&attrs, 2048);
@@ -326,7 +370,9 @@ VCHPRE_ void VCHPOST_ vc_vchi_cec_stop( void ) {
       cecservice_client.to_exit = 1;
       vcos_event_signal(&cecservice_notify_available_event);
       vcos_thread_join(&cecservice_notify_task, &dummy);
+      vc_notify_dispatch_deinit(&cecservice_client.dispatcher);
       vcos_mutex_delete(&cecservice_client.lock);
+      vcos_mutex_delete(&cecservice_client.register_lock);
       vcos_event_delete(&cecservice_message_available_event);
       vcos_event_delete(&cecservice_notify_available_event);
       vcos_free(cecservice_client.topology);
@@ -346,16 +392,49 @@ VCHPRE_ void VCHPOST_ vc_vchi_cec_stop( void ) {
  *
  ***********************************************************/
 VCHPRE_ void VCHPOST_ vc_cec_register_callback(CECSERVICE_CALLBACK_T callback, void *callback_data) {
-   if(lock_obtain() == 0){
-      cecservice_client.notify_fn   = callback;
-      cecservice_client.notify_data = callback_data;
-      vc_cec_log_info("CEC service registered callback 0x%x", (uint32_t) callback);
-      lock_release();
+   //The swap is serialised by its own lock rather than the service lock, as
+   //unsubscribing waits for a running callback, which may use the service
+   if(cecservice_client.initialised &&
+      vcos_mutex_lock(&cecservice_client.register_lock) == VCOS_SUCCESS){
+      CECSERVICE_CALLBACK_T previous = cecservice_client.notify_fn;
+      VCOS_STATUS_T status = VCOS_SUCCESS;
+
+      if(previous)
+         vc_notify_dispatch_unsubscribe(&cecservice_client.dispatcher, (VC_NOTIFY_CALLBACK_T) previous);
+      if(callback)
+         status = vc_notify_dispatch_subscribe(&cecservice_client.dispatcher,
+                                               (VC_NOTIFY_CALLBACK_T) callback, callback_data);
+      cecservice_client.notify_fn = status == VCOS_SUCCESS ? callback : NULL;
+      vcos_mutex_unlock(&cecservice_client.register_lock);
+
+      if(status != VCOS_SUCCESS)
+         vc_cec_log_error("CEC service register callback failed");
+      else
+         vc_cec_log_info("CEC service registered callback");
    } else {
-      vc_cec_log_error("CEC service registered callback 0x%x failed", (uint32_t) callback);
+      vc_cec_log_error("CEC service register callback failed");
    }
 }
 
+/***********************************************************
+ * Name: vc_cec_get_notify_stats
+ *
+ * Arguments:
+ *       pointer to stats
+ *
+ * Description: Get the notification dispatch statistics
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+VCHPRE_ void VCHPOST_ vc_cec_get_notify_stats(VC_NOTIFY_STATS_T *stats) {
+   vcos_assert(stats);
+   if(cecservice_client.initialised)
+      vc_notify_dispatch_get_stats(&cecservice_client.dispatcher, stats);
+   else
+      vcos_memset(stats, 0, sizeof(*stats));
+}
+
 /*********************************************************************************
  *
  *  Static functions definitions
@@ -533,6 +612,34 @@ static int32_t cecservice_send_command_reply(  uint32_t command, void *buffer, u
    return success;
 }
 
+//Name of a notification, for logging
+static const char *cecservice_notify_string(uint32_t reason) {
+   uint32_t cb_reason_str_idx = max_notify_strings - 1;
+   switch(CEC_CB_REASON(reason)) {
+   case VC_CEC_NOTIFY_NONE:
+      cb_reason_str_idx = 0; break;
+   case VC_CEC_TX:
+      cb_reason_str_idx = 1; break;
+   case VC_CEC_RX:
+      cb_reason_str_idx = 2; break;
+   case VC_CEC_BUTTON_PRESSED:
+      cb_reason_str_idx = 3; break;
+   case VC_CEC_BUTTON_RELEASE:
+      cb_reason_str_idx = 4; break;
+   case VC_CEC_REMOTE_PRESSED:
+      cb_reason_str_idx = 5; break;
+   case VC_CEC_REMOTE_RELEASE:
+      cb_reason_str_idx = 6; break;
+   case VC_CEC_LOGICAL_ADDR:
+      cb_reason_str_idx = 7; break;
+   case VC_CEC_TOPOLOGY:
+      cb_reason_str_idx = 8; break;
+   case VC_CEC_LOGICAL_ADDR_LOST:
+      cb_reason_str_idx = 9; break;
+   }
+   return cecservice_notify_strings[cb_reason_str_idx];
+}
+
 /***********************************************************
  * Name: cecservice_notify_func
  *
@@ -551,68 +658,72 @@ static void *cecservice_notify_func(void *arg) {
    vc_cec_log_info("CEC service async thread started");
    while(1) {
       VCOS_STATUS_T status = vcos_event_wait(&cecservice_notify_available_event);
-      uint32_t cb_reason_str_idx = max_notify_strings - 1;
       if(status != VCOS_SUCCESS || !state->initialised || state->to_exit)
          break;
 
       do {
-         uint32_t reason, param1, param2, param3, param4;
-         //Get all notifications in the queue
-         success = vchi_msg_dequeue( state->notify_handle[0], state->notify_buffer, sizeof(state->notify_buffer), &state->notify_length, VCHI_FLAGS_NONE );
-         if(success != 0 || state->notify_length < sizeof(uint32_t)*5 ) { //reason + 4x32-bit parameter
-            continue;
+         //Get all notifications in the queue, a batch at a time
+         VC_NOTIFY_T batch[CECSERVICE_NOTIFY_BATCH];
+         uint32_t count = 0, i;
+         int update = 0;
+         while(count < CECSERVICE_NOTIFY_BATCH) {
+            success = vchi_msg_dequeue( state->notify_handle[0], state->notify_buffer, sizeof(state->notify_buffer), &state->notify_length, VCHI_FLAGS_NONE );
+            if(success != 0)
+               break;
+            if(state->notify_length < sizeof(uint32_t)*5 ) { //reason + 4x32-bit parameter
+               continue;
+            }
+            //All notifications are of format: reason, param1, param2, param3, param4 (all 32-bit unsigned int)
+            batch[count].reason = VC_VTOH32(state->notify_buffer[0]);
+            for(i = 0; i < 4; i++) {
+               batch[count].param[i] = VC_VTOH32(state->notify_buffer[i+1]);
+            }
+            batch[count].timestamp = vcos_getmicrosecs();
+            switch(CEC_CB_REASON(batch[count].reason)) {
+            case VC_CEC_LOGICAL_ADDR:
+            case VC_CEC_LOGICAL_ADDR_LOST:
+            case VC_CEC_TOPOLOGY:
+               update = 1;
+               break;
+            default:
+               break;
+            }
+            count++;
          }
-
-         //if(lock_obtain() != 0)
-         //   break;
-         //All notifications are of format: reason, param1, param2, param3, param4 (all 32-bit unsigned int)
-         reason = VC_VTOH32(state->notify_buffer[0]);
-         param1 = VC_VTOH32(state->notify_buffer[1]);
-         param2 = VC_VTOH32(state->notify_buffer[2]);
-         param3 = VC_VTOH32(state->notify_buffer[3]);
-         param4 = VC_VTOH32(state->notify_buffer[4]);
-         //lock_release();
-
-         //Store away physical/logical addresses
-         if(CEC_CB_REASON(reason) == VC_CEC_LOGICAL_ADDR) {
-            state->logical_address = (CEC_DEVICE_TYPE_T) param1;
-            state->physical_address = (uint16_t) (param2 & 0xFFFF);
+         if(count == 0)
+            break;
+
+         //Store away physical/logical addresses, and drop the topology
+         //whenever it or our address changes
+         if(update && cecservice_cache_lock()) {
+            for(i = 0; i < count; i++) {
+               uint32_t reason = CEC_CB_REASON(batch[i].reason);
+               if(reason == VC_CEC_LOGICAL_ADDR) {
+                  state->logical_address = (CEC_DEVICE_TYPE_T) batch[i].param[0];
+               }
+               if(reason == VC_CEC_LOGICAL_ADDR || reason == VC_CEC_LOGICAL_ADDR_LOST) {
+                  state->physical_address = (uint16_t) (batch[i].param[1] & 0xFFFF);
+                  state->physical_address_valid = 1;
+               }
+            }
+            cecservice_invalidate_topology();
+            cecservice_cache_unlock();
          }
-         
-         switch(CEC_CB_REASON(reason)) {
-         case VC_CEC_NOTIFY_NONE:
-            cb_reason_str_idx = 0; break;
-         case VC_CEC_TX:
-            cb_reason_str_idx = 1; break;
-         case VC_CEC_RX:
-            cb_reason_str_idx = 2; break;
-         case VC_CEC_BUTTON_PRESSED:
-            cb_reason_str_idx = 3; break;
-         case VC_CEC_BUTTON_RELEASE:
-            cb_reason_str_idx = 4; break;
-         case VC_CEC_REMOTE_PRESSED:
-            cb_reason_str_idx = 5; break;
-         case VC_CEC_REMOTE_RELEASE:
-            cb_reason_str_idx = 6; break;
-         case VC_CEC_LOGICAL_ADDR:
-            cb_reason_str_idx = 7; break;
-         case VC_CEC_TOPOLOGY:
-            cb_reason_str_idx = 8; break;
-         case VC_CEC_LOGICAL_ADDR_LOST:
-            cb_reason_str_idx = 9; break;
-         }
-
-         vc_cec_log_info("CEC service callback [%s]: 0x%x, 0x%x, 0x%x, 0x%x",
-                         cecservice_notify_strings[cb_reason_str_idx], param1, param2, param3, param4);
 
-         if(state->notify_fn) {
-            (*state->notify_fn)(state->notify_data, reason, param1, param2, param3, param4);
-         } else {
-            vc_cec_log_info("CEC service: No callback handler specified, callback [%s] swallowed",
-                            cecservice_notify_strings[cb_reason_str_idx]);
+         for(i = 0; i < count; i++) {
+            vc_cec_log_info("CEC service callback [%s]: 0x%x, 0x%x, 0x%x, 0x%x",
+                            cecservice_notify_string(batch[i].reason),
+                            batch[i].param[0], batch[i].param[1], batch[i].param[2], batch[i].param[3]);
          }
 
-      } while(success == 0 && state->notify_length >= sizeof(uint32_t)*5); //read the next message if any
+         //Now queue them to the host app, without holding up the next batch
+         if(vc_notify_dispatch_post(&state->dispatcher, batch, count) == 0) {
+            for(i = 0; i < count; i++) {
+               vc_cec_log_info("CEC service: No callback handler specified, callback [%s] swallowed",
+                               cecservice_notify_string(batch[i].reason));
+            }
+         }
+      } while(success == 0); //read the next batch if any
    } //while (1)
 
    if(state->to_exit)
@@ -621,6 +732,24 @@ static void *cecservice_notify_func(void *arg) {
    return 0;
 }
 
+/***********************************************************
+ * Name: cecservice_notify_deliver
+ *
+ * Arguments: callback, its context, notification
+ *
+ * Description: Called on the subscriber's own thread to pass
+ *              a notification to its callback
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+static void cecservice_notify_deliver(VC_NOTIFY_CALLBACK_T callback, void *callback_data,
+                                      const VC_NOTIFY_T *notify) {
+   ((CECSERVICE_CALLBACK_T) callback)(callback_data, notify->reason,
+                                      notify->param[0], notify->param[1],
+                                      notify->param[2], notify->param[3]);
+}
+
 /***********************************************************
  * Name: cecservice_logging_init
  *
@@ -721,6 +850,43 @@ VCHPRE_ int VCHPOST_ vc_cec_deregister_all( void ) {
    return cecservice_send_command( VC_CEC_DEREGISTER_ALL, NULL, 0, 0);
 }
 
+/***********************************************************
+ * Name: cecservice_fill_send_param
+ *
+ * Arguments:
+ *       parameter block to fill in, then as vc_cec_send_message
+ *
+ * Description
+ *       Build the send_msg parameters, length must already
+ *       have been checked
+ *
+ * Returns: -
+ ***********************************************************/
+static void cecservice_fill_send_param(CEC_SEND_MSG_PARAM_T *param,
+                                       const uint32_t follower,
+                                       const uint8_t *payload,
+                                       uint32_t length,
+                                       bool_t is_reply) {
+   param->follower = VC_HTOV32(follower);
+   param->length = VC_HTOV32(length);
+   param->is_reply = VC_HTOV32(is_reply);
+   vcos_memset(param->payload, 0, sizeof(param->payload));
+   vc_cec_log_info("CEC service sending CEC message (%d->%d) (0x%02X) length %d%s",
+                   cecservice_client.logical_address, follower,
+                   (payload)? payload[0] : 0xFF, length, (is_reply)? " as reply" : "");
+
+   if(length > 0 && vcos_verify(payload)) {
+      char s[96] = {0}, *p = &s[0];
+      int i;
+      vcos_memcpy(param->payload, payload, _min(length, CEC_MAX_XMIT_LENGTH));
+      p += sprintf(p, "0x%02X",  (cecservice_client.logical_address << 4) | (follower & 0xF));
+      for(i = 0; i < _min(length, CEC_MAX_XMIT_LENGTH); i++) {
+         p += sprintf(p, " %02X", payload[i]);
+      }
+      vc_cec_log_info("CEC message: %s", s);
+   }
+}
+
 /***********************************************************
  * Name: vc_cec_send_message
  *
@@ -749,27 +915,97 @@ VCHPRE_ int VCHPOST_ vc_cec_send_message(const uint32_t follower,
    if(!vcos_verify(length <= CEC_MAX_XMIT_LENGTH))
       return -1;
 
-   param.follower = VC_HTOV32(follower);
-   param.length = VC_HTOV32(length);
-   param.is_reply = VC_HTOV32(is_reply);
-   vcos_memset(param.payload, 0, sizeof(param.payload));
-   vc_cec_log_info("CEC service sending CEC message (%d->%d) (0x%02X) length %d%s",
-                   cecservice_client.logical_address, follower,
-                   (payload)? payload[0] : 0xFF, length, (is_reply)? " as reply" : "");
+   cecservice_fill_send_param(&param, follower, payload, length, is_reply);
+   success = cecservice_send_command( VC_CEC_SEND_MSG, &param, sizeof(param), 1);
+   return success;
+}
 
-   if(length > 0 && vcos_verify(payload)) {
-      char s[96] = {0}, *p = &s[0];
-      int i;
-      vcos_memcpy(param.payload, payload, _min(length, CEC_MAX_XMIT_LENGTH));
-      p += sprintf(p, "0x%02X",  (cecservice_client.logical_address << 4) | (follower & 0xF));
-      for(i = 0; i < _min(length, CEC_MAX_XMIT_LENGTH); i++) {
-         p += sprintf(p, " %02X", payload[i]);
+/***********************************************************
+ * Name: vc_cec_send_message_batch
+ *
+ * Arguments:
+ *       array of encapsulated messages
+ *       number of messages
+ *       array of per message status (can be NULL)
+ *
+ * Description
+ *       Send a number of messages as non-reply, like
+ *       vc_cec_send_message2. Up to CECSERVICE_MAX_BATCH_PENDING
+ *       send_msg commands are queued to the server before their
+ *       replies are read, and the service lock is only taken once.
+ *       Messages are sent in array order.
+ *
+ * Returns: zero if all messages were sent, non-zero otherwise.
+ *          If status is not NULL, status[i] is what vc_cec_send_message
+ *          would have returned for message i, or -1 if it was not sent
+ *          because of an earlier VCHI failure.
+ ***********************************************************/
+VCHPRE_ int VCHPOST_ vc_cec_send_message_batch(const VC_CEC_MESSAGE_T *messages,
+                                               uint32_t num_messages,
+                                               int *status) {
+   int result = 0;
+   uint32_t i, sent = 0;
+
+   if(!vcos_verify(messages || num_messages == 0))
+      return -1;
+   for(i = 0; i < num_messages; i++) {
+      if(status)
+         status[i] = -1;
+      if(!vcos_verify(messages[i].length <= CEC_MAX_XMIT_LENGTH))
+         result = -1;
+   }
+   if(result != 0 || num_messages == 0)
+      return result;
+
+   vc_cec_log_info("CEC sending batch of %d messages", num_messages);
+   if(lock_obtain() != 0)
+      return -1;
+
+   while(sent < num_messages) {
+      uint32_t window = _min(num_messages - sent, CECSERVICE_MAX_BATCH_PENDING);
+      uint32_t queued = 0;
+      int32_t vchi_status = VC_SERVICE_VCHI_SUCCESS;
+
+      //Queue a window of send_msg commands, then collect their replies in order
+      for(i = 0; i < window; i++) {
+         const VC_CEC_MESSAGE_T *message = &messages[sent + i];
+         uint32_t command = VC_CEC_SEND_MSG;
+         CEC_SEND_MSG_PARAM_T param;
+         VCHI_MSG_VECTOR_T vector[] = { {&command, sizeof(command)},
+                                        {&param, sizeof(param)} };
+         cecservice_fill_send_param(&param, message->follower,
+                                    (message->length)? message->payload : NULL,
+                                    message->length, VC_FALSE);
+         vchi_status = (int32_t) vchi2service_status(vchi_msg_queuev(cecservice_client.client_handle[0],
+                                                                     vector, sizeof(vector)/sizeof(vector[0]),
+                                                                     VCHI_FLAGS_BLOCK_UNTIL_QUEUED, NULL ));
+         if(vchi_status != VC_SERVICE_VCHI_SUCCESS) {
+            vc_cec_log_error("CEC failed to send batched message %d, error: %s",
+                             sent + i, vchi2service_status_string(vchi_status));
+            break;
+         }
+         queued++;
+      }
+
+      for(i = 0; i < queued; i++) {
+         int32_t response = -1;
+         int32_t success = cecservice_wait_for_reply(&response, sizeof(response));
+         response = (success == VC_SERVICE_VCHI_SUCCESS)? (int32_t) VC_VTOH32(response) : success;
+         if(status)
+            status[sent + i] = response;
+         if(response != 0)
+            result = -1;
+      }
+
+      sent += queued;
+      if(vchi_status != VC_SERVICE_VCHI_SUCCESS) {
+         result = -1;
+         break;
       }
-      vc_cec_log_info("CEC message: %s", s);
    }
 
-   success = cecservice_send_command( VC_CEC_SEND_MSG, &param, sizeof(param), 1);
-   return success;
+   lock_release();
+   return result;
 }
 
 /***********************************************************
@@ -853,6 +1089,19 @@ VCHPRE_ int VCHPOST_ vc_cec_release_logical_address( void ) {
  ***********************************************************/
 VCHPRE_ int VCHPOST_ vc_cec_get_topology( VC_CEC_TOPOLOGY_T* topology) {
    int32_t success = -1;
+   uint32_t generation = 0;
+
+   if(cecservice_cache_lock()) {
+      int cached = cecservice_client.topology_cache_valid;
+      if(cached) {
+         vcos_memcpy(topology, &cecservice_client.topology_cache, sizeof(VC_CEC_TOPOLOGY_T));
+      }
+      generation = cecservice_client.cache_generation;
+      cecservice_cache_unlock();
+      if(cached)
+         return 0;
+   }
+
    vchi_service_use(cecservice_client.client_handle[0]);
    success = cecservice_send_command( VC_CEC_GET_TOPOLOGY, NULL, 0, 1);
    if(success == 0) {
@@ -870,6 +1119,15 @@ VCHPRE_ int VCHPOST_ vc_cec_get_topology( VC_CEC_TOPOLOGY_T* topology) {
          cecservice_client.topology->device_attr[i] = VC_VTOH32(cecservice_client.topology->device_attr[i]);
       }
       vcos_memcpy(topology, cecservice_client.topology, sizeof(VC_CEC_TOPOLOGY_T));
+
+      //Only keep it if no topology notification arrived in the meantime
+      if(cecservice_cache_lock()) {
+         if(generation == cecservice_client.cache_generation) {
+            vcos_memcpy(&cecservice_client.topology_cache, topology, sizeof(VC_CEC_TOPOLOGY_T));
+            cecservice_client.topology_cache_valid = 1;
+         }
+         cecservice_cache_unlock();
+      }
    }
    return success;
 }
@@ -922,10 +1180,31 @@ VCHPRE_ int VCHPOST_ vc_cec_set_osd_name( const char* name ) {
  ***********************************************************/
 VCHPRE_ int VCHPOST_ vc_cec_get_physical_address(uint16_t *physical_address) {
    uint32_t response;
-   int32_t success = cecservice_send_command_reply( VC_CEC_GET_PHYSICAL_ADDR, NULL, 0, 
-                                                    &response, sizeof(response));
+   int32_t success;
+
+   //Kept up to date by VC_CEC_LOGICAL_ADDR(_LOST) notifications
+   if(cecservice_cache_lock()) {
+      int cached = cecservice_client.physical_address_valid;
+      if(cached) {
+         *physical_address = cecservice_client.physical_address;
+      }
+      cecservice_cache_unlock();
+      if(cached)
+         return 0;
+   }
+
+   success = cecservice_send_command_reply( VC_CEC_GET_PHYSICAL_ADDR, NULL, 0, 
+                                            &response, sizeof(response));
    if(success == 0) {
       *physical_address = (uint16_t)(VC_VTOH32(response) & 0xFFFF);
+      if(cecservice_cache_lock()) {
+         //A notification may have got here first with a newer address
+         if(!cecservice_client.physical_address_valid) {
+            cecservice_client.physical_address = *physical_address;
+            cecservice_client.physical_address_valid = 1;
+         }
+         cecservice_cache_unlock();
+      }
       vc_cec_log_info("CEC got physical address: %d.%d.%d.%d",
                       (*physical_address >> 12), (*physical_address >> 8) & 0xF,
                       (*physical_address >> 4) & 0xF, (*physical_address) & 0xF);
@@ -1177,6 +1456,10 @@ VCHPRE_ int VCHPOST_ vc_cec_add_device(const CEC_AllDevices_T logical_address,
                       cecservice_devicetype_strings[device_type]);
       success = cecservice_send_command_reply( VC_CEC_ADD_DEVICE, &param, sizeof(param), 
                                                &response, sizeof(response));
+      if(cecservice_cache_lock()) {
+         cecservice_invalidate_topology();
+         cecservice_cache_unlock();
+      }
    } else {
       vc_cec_log_error("CEC invalid arguments for add_device");
    }
@@ -37,6 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/vchi/common/endian.h"
 #include "interface/vchi/message_drivers/message.h"
 #include "vc_vchi_dispmanx.h"
+#include "vc_service_common.h"
 
 /******************************************************************************
 Local types and defines.
@@ -82,6 +83,7 @@ Static functions.
 static __inline void lock_obtain (void) {
    VCOS_STATUS_T status;
    uint32_t i;
+   vc_service_open_lazily(VC_SERVICE_DISPMANX);
    vcos_assert(dispmanx_client.initialised);
    status = vcos_mutex_lock( &dispmanx_client.lock );
    if(dispmanx_client.initialised)
@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/vchi/vchi.h"
 #include "interface/vchi/common/endian.h"
 #include "interface/vmcs_host/vc_gencmd_defs.h"
+#include "vc_service_common.h"
 
 #ifdef HAVE_GENCMD_VERSION
 extern const char *gencmd_get_build_version(void);
@@ -48,16 +49,43 @@ extern const char *gencmd_get_build_version(void);
 Local types and defines.
 ******************************************************************************/
 #define GENCMD_MAX_LENGTH 512
+
+//Commands which may be in flight at once. VideoCore answers commands in the
+//order they were queued, so each request gets a sequence number and its
+//response is matched to it by order of arrival.
+#define GENCMD_MAX_PENDING 8
+
+typedef struct {
+   char                  buffer[GENCMDSERVICE_MSGFIFO_SIZE];
+   uint32_t              length;           //Length of response including the error code
+   uint32_t              seq;              //Sequence number of the response held
+   int                   ready;
+} GENCMD_RESPONSE_SLOT_T;
+
 typedef struct {
    VCHI_SERVICE_HANDLE_T open_handle[VCHI_MAX_NUM_CONNECTIONS];
    uint32_t              msg_flag[VCHI_MAX_NUM_CONNECTIONS];
    char                  command_buffer[GENCMD_MAX_LENGTH+1];
-   char                  response_buffer[GENCMDSERVICE_MSGFIFO_SIZE];
-   uint32_t              response_length;  //Length of response minus the error code
    int                   num_connections;
-   VCOS_MUTEX_T          lock;
+   VCOS_MUTEX_T          lock;             //Held while queuing a command
    int                   initialised;
    VCOS_EVENT_T          message_available_event;
+
+   //Request/response matching
+   uint32_t              next_send;        //Sequence number of the next command (under lock)
+   uint32_t              next_receive;     //Sequence number of the next response (under receive_lock)
+   VCOS_MUTEX_T          receive_lock;     //Held by the thread dequeuing responses
+   VCOS_SEMAPHORE_T      free_slots;       //Bounds the commands sent and not yet consumed to GENCMD_MAX_PENDING
+   GENCMD_RESPONSE_SLOT_T slot[GENCMD_MAX_PENDING]; //Responses dequeued and not yet consumed (under receive_lock)
+
+   //Threads sending or awaiting a response (under lock), which vc_gencmd_stop
+   //wakes and waits for before deleting anything they use
+   int                   users;
+   VCOS_SEMAPHORE_T      users_left;       //Posted as each leaves once stopping
+
+   //Command sent by vc_gencmd_send and not yet read by vc_gencmd_read_response (under lock)
+   int                   unread_pending;
+   uint32_t              unread_seq;
 } GENCMD_SERVICE_T;
 
 static GENCMD_SERVICE_T gencmd_client;
@@ -72,6 +100,7 @@ static void gencmd_callback( void *callback_param,
 
 static __inline int lock_obtain (void) {
    int ret = -1;
+   vc_service_open_lazily(VC_SERVICE_GENCMD);
    if(gencmd_client.initialised && vcos_mutex_lock(&gencmd_client.lock) == VCOS_SUCCESS)
    {
       ret = 0;
@@ -83,6 +112,28 @@ static __inline void lock_release (void) {
    vcos_mutex_unlock(&gencmd_client.lock);
 }
 
+//Register a thread about to use the service, fails once it has been stopped
+static int gencmd_enter (void) {
+   int ret = -1;
+   if(lock_obtain() == 0)
+   {
+      if(gencmd_client.initialised)
+      {
+         gencmd_client.users++;
+         ret = 0;
+      }
+      lock_release();
+   }
+   return ret;
+}
+static void gencmd_leave (void) {
+   vcos_mutex_lock(&gencmd_client.lock);
+   gencmd_client.users--;
+   if(!gencmd_client.initialised)
+      vcos_semaphore_post(&gencmd_client.users_left);
+   vcos_mutex_unlock(&gencmd_client.lock);
+}
+
 int use_gencmd_service(void) {
    int ret = 0;
    int i=0;
@@ -137,6 +188,12 @@ void vc_vchi_gencmd_init (VCHI_INSTANCE_T initialise_instance, VCHI_CONNECTION_T
    vcos_assert(status == VCOS_SUCCESS);
    status = vcos_event_create(&gencmd_client.message_available_event, "HGencmd");
    vcos_assert(status == VCOS_SUCCESS);
+   status = vcos_mutex_create(&gencmd_client.receive_lock, "HGencmdRx");
+   vcos_assert(status == VCOS_SUCCESS);
+   status = vcos_semaphore_create(&gencmd_client.free_slots, "HGencmdSlots", GENCMD_MAX_PENDING);
+   vcos_assert(status == VCOS_SUCCESS);
+   status = vcos_semaphore_create(&gencmd_client.users_left, "HGencmdUsers", 0);
+   vcos_assert(status == VCOS_SUCCESS);
 
    for (i=0; i<gencmd_client.num_connections; i++) {
 
@@ -218,32 +275,65 @@ void vc_gencmd_stop () {
       }
 
       gencmd_client.initialised = 0;
+      gencmd_client.unread_pending = 0;
+
+      //Wake anyone waiting for a slot or a response; they see the service has
+      //stopped and leave. Keep at it until they have all gone.
+      while(gencmd_client.users)
+      {
+         vcos_semaphore_post(&gencmd_client.free_slots);
+         vcos_event_signal(&gencmd_client.message_available_event);
+         lock_release();
+         vcos_semaphore_wait_timeout(&gencmd_client.users_left, 10);
+         vcos_mutex_lock(&gencmd_client.lock);
+      }
 
       lock_release();
             
       vcos_mutex_delete(&gencmd_client.lock);
       vcos_event_delete(&gencmd_client.message_available_event);
+      vcos_mutex_delete(&gencmd_client.receive_lock);
+      vcos_semaphore_delete(&gencmd_client.free_slots);
+      vcos_semaphore_delete(&gencmd_client.users_left);
    }
 }
 
 /******************************************************************************
 NAME
-   vc_gencmd_send
+   gencmd_send_request
 
 SYNOPSIS
-   int vc_gencmd_send( const char *format, ... )
+   int gencmd_send_request( uint32_t *seq, int block, const char *format, va_list a )
 
 FUNCTION
-   Send a string to general command service.
+   Queue a command to general command service and return the sequence number
+   its response will carry. While GENCMD_MAX_PENDING commands are awaiting
+   their responses to be consumed this blocks, or returns GENCMD_SLOTS_BUSY if
+   block is zero.
 
 RETURNS
    int
 ******************************************************************************/
-int vc_gencmd_send_list ( const char *format, va_list a )
+#define GENCMD_SLOTS_BUSY 1
+
+static int gencmd_send_request ( uint32_t *seq, int block, const char *format, va_list a )
 {
    int success = -1;
 
-   // Obtain the lock and keep it so no one else can butt in while we await the response.
+   if(gencmd_enter() != 0)
+      return success;
+   if(!block && vcos_semaphore_trywait(&gencmd_client.free_slots) != VCOS_SUCCESS)
+   {
+      gencmd_leave();
+      return GENCMD_SLOTS_BUSY;
+   }
+   if(block && vcos_semaphore_wait(&gencmd_client.free_slots) != VCOS_SUCCESS)
+   {
+      gencmd_leave();
+      return success;
+   }
+
+   // Only held while queuing, other threads can send while we await the response.
    if(lock_obtain() == 0)
    {
       int length = vsnprintf( gencmd_client.command_buffer, GENCMD_MAX_LENGTH, format, a );
@@ -266,78 +356,198 @@ int vc_gencmd_send_list ( const char *format, va_list a )
          release_gencmd_service();
       }
 
+      if(success == 0)
+         *seq = gencmd_client.next_send++;
+
       lock_release();
    }
 
+   if(success != 0)
+      vcos_semaphore_post(&gencmd_client.free_slots);
+
+   gencmd_leave();
    return success;
 }
 
-int vc_gencmd_send ( const char *format, ... )
+//The slot holding the response to seq, once it has been dequeued
+static GENCMD_RESPONSE_SLOT_T *gencmd_find_slot ( uint32_t seq )
 {
-   va_list a;
-   int     rv;
+   int i;
+   for(i = 0; i < GENCMD_MAX_PENDING; i++) {
+      if(gencmd_client.slot[i].ready && gencmd_client.slot[i].seq == seq)
+         return &gencmd_client.slot[i];
+   }
+   return NULL;
+}
 
-   va_start ( a, format );
-   rv = vc_gencmd_send_list( format, a );
-   va_end ( a );
-   return rv;
+//A free slot for the next response, or failing that the one holding the
+//oldest response, which can only be left over from a waiter that gave up
+static GENCMD_RESPONSE_SLOT_T *gencmd_free_slot ( void )
+{
+   GENCMD_RESPONSE_SLOT_T *oldest = &gencmd_client.slot[0];
+   int i;
+   for(i = 0; i < GENCMD_MAX_PENDING; i++) {
+      GENCMD_RESPONSE_SLOT_T *slot = &gencmd_client.slot[i];
+      if(!slot->ready)
+         return slot;
+      if(gencmd_client.next_receive - slot->seq > gencmd_client.next_receive - oldest->seq)
+         oldest = slot;
+   }
+   return oldest;
 }
 
 /******************************************************************************
 NAME
-   vc_gencmd_read_response
+   gencmd_receive_response
 
 SYNOPSIS
-   int vc_gencmd_read_response
+   int gencmd_receive_response( uint32_t seq, char *response, int maxlen )
 
 FUNCTION
-   Block until something comes back
+   Block until the response to command seq has come back. Whichever waiter
+   holds receive_lock dequeues responses in order into free slots tagged
+   with their sequence number, so a response read on behalf of another
+   thread is left there for it. A slot is only freed when its response is
+   consumed, and free_slots counts commands until then, so there is always
+   a free slot for the next response even while one sent by vc_gencmd_send
+   sits unread.
 
 RETURNS
    Error code from dequeue message
 ******************************************************************************/
-int vc_gencmd_read_response (char *response, int maxlen) {
-   int i = 0;
+static int gencmd_receive_response ( uint32_t seq, char *response, int maxlen )
+{
+   GENCMD_RESPONSE_SLOT_T *slot = NULL;
    int success = -1;
-   int ret_code = 0;
-   int32_t sem_ok = 0;
+   int i;
 
-   if(lock_obtain() == 0)
+   if(gencmd_enter() != 0)
+      return success;
+
+   use_gencmd_service();
+   if(vcos_mutex_lock(&gencmd_client.receive_lock) == VCOS_SUCCESS)
    {
-      //Note this will ALWAYS reset response buffer and overwrite any partially read responses
-      use_gencmd_service();
-      do {
+      while((slot = gencmd_find_slot(seq)) == NULL && gencmd_client.initialised)
+      {
+         GENCMD_RESPONSE_SLOT_T *next = gencmd_free_slot();
+         int dequeued = 0;
+
          //TODO : we need to deal with messages coming through on more than one connections properly
          //At the moment it will always try to read the first connection if there is something there
          for(i = 0; i < gencmd_client.num_connections; i++) {
             //Check if there is something in the queue, if so return immediately
             //otherwise wait for the event and read again
-            success = (int) vchi_msg_dequeue( gencmd_client.open_handle[i], gencmd_client.response_buffer,
-                                              sizeof(gencmd_client.response_buffer), &gencmd_client.response_length, VCHI_FLAGS_NONE);
-            if(success == 0) {
-               ret_code = VC_VTOH32( *(int *)gencmd_client.response_buffer );
+            if(vchi_msg_dequeue( gencmd_client.open_handle[i], next->buffer, sizeof(next->buffer),
+                                 &next->length, VCHI_FLAGS_NONE) == 0 && next->length >= sizeof(int)) {
+               next->seq = gencmd_client.next_receive++;
+               next->ready = 1;
+               dequeued = 1;
                break;
-            } else {
-               gencmd_client.response_length = 0;
             }
          }
-      } while(!gencmd_client.response_length && vcos_event_wait(&gencmd_client.message_available_event) == VCOS_SUCCESS);
-      
-      if(gencmd_client.response_length && sem_ok == 0) {
-         gencmd_client.response_length -= sizeof(int); //first word is error code
-         memcpy(response, gencmd_client.response_buffer+sizeof(int), (size_t) vcos_min((int)gencmd_client.response_length, (int)maxlen));
+
+         if(!dequeued && vcos_event_wait(&gencmd_client.message_available_event) != VCOS_SUCCESS)
+            break;
+      }
+
+      if(slot) {
+         //first word is error code
+         memcpy(response, slot->buffer+sizeof(int),
+                (size_t) vcos_min((int)(slot->length - sizeof(int)), (int)maxlen));
+         slot->ready = 0;
+         success = 0;
       }
+      vcos_mutex_unlock(&gencmd_client.receive_lock);
+   }
+   release_gencmd_service();
+
+   //Another command may now be sent whether or not the response arrived
+   vcos_semaphore_post(&gencmd_client.free_slots);
 
-      release_gencmd_service();
+   gencmd_leave();
+   return success;
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_send
+
+SYNOPSIS
+   int vc_gencmd_send( const char *format, ... )
+
+FUNCTION
+   Send a string to general command service. The response is collected by
+   vc_gencmd_read_response; if it is never read it is discarded when the next
+   command is sent this way.
+
+RETURNS
+   int
+******************************************************************************/
+int vc_gencmd_send_list ( const char *format, va_list a )
+{
+   char discard[1];
+   uint32_t seq;
+   int success, pending = 0;
+
+   if(lock_obtain() == 0) {
+      pending = gencmd_client.unread_pending;
+      seq = gencmd_client.unread_seq;
+      gencmd_client.unread_pending = 0;
+      lock_release();
+   }
+   if(pending)
+      gencmd_receive_response(seq, discard, 0);
+
+   success = gencmd_send_request(&seq, 1, format, a);
+   if(success == 0 && lock_obtain() == 0) {
+      gencmd_client.unread_seq = seq;
+      gencmd_client.unread_pending = 1;
       lock_release();
    }
+   return success;
+}
+
+int vc_gencmd_send ( const char *format, ... )
+{
+   va_list a;
+   int     rv;
+
+   va_start ( a, format );
+   rv = vc_gencmd_send_list( format, a );
+   va_end ( a );
+   return rv;
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_read_response
+
+SYNOPSIS
+   int vc_gencmd_read_response
+
+FUNCTION
+   Block until the response to the last vc_gencmd_send comes back
+
+RETURNS
+   Error code from dequeue message
+******************************************************************************/
+int vc_gencmd_read_response (char *response, int maxlen) {
+   uint32_t seq;
+   int pending = 0;
+
+   if(lock_obtain() == 0) {
+      pending = gencmd_client.unread_pending;
+      seq = gencmd_client.unread_seq;
+      gencmd_client.unread_pending = 0;
+      lock_release();
+   }
+   if(!pending)
+      return -1;
 
    // If we read anything, return the VideoCore code. Error codes < 0 mean we failed to
    // read anything...
    //How do we let the caller know the response code of gencmd?
-   //return ret_code;
-
-   return success;
+   return gencmd_receive_response(seq, response, maxlen);
 }
 
 /******************************************************************************
@@ -349,22 +559,24 @@ SYNOPSIS
 
 FUNCTION
    Send a gencmd and receive the response as per vc_gencmd read_response.
+   Safe to call from several threads at once, the commands are pipelined.
 
 RETURNS
    int
 ******************************************************************************/
 int vc_gencmd(char *response, int maxlen, const char *format, ...) {
    va_list args;
+   uint32_t seq;
    int ret = -1;
 
    use_gencmd_service();
 
    va_start(args, format);
-   ret = vc_gencmd_send_list(format, args);
+   ret = gencmd_send_request(&seq, 1, format, args);
    va_end (args);
 
    if (ret >= 0) {
-      ret = vc_gencmd_read_response(response, maxlen);
+      ret = gencmd_receive_response(seq, response, maxlen);
    }
 
    release_gencmd_service();
@@ -374,28 +586,98 @@ int vc_gencmd(char *response, int maxlen, const char *format, ...) {
 
 /******************************************************************************
 NAME
-   vc_gencmd_string_property
+   vc_gencmd_batch
 
 SYNOPSIS
-   int vc_gencmd_string_property(char *text, char *property, char **value, int *length)
+   int vc_gencmd_batch(int num_commands, const char * const *commands,
+                       char * const *responses, int maxlen)
 
 FUNCTION
-   Given a text string, containing items of the form property=value,
-   look for the named property and return the value. The start of the value
-   is returned, along with its length. The value may contain spaces, in which
-   case it is enclosed in double quotes. The double quotes are not included in
-   the return parameters. Return non-zero if the property is found.
+   Send several commands without waiting for each response in turn and
+   collect the responses in order. Up to GENCMD_MAX_PENDING commands are in
+   flight at once. The responses of commands which failed are set to "".
 
 RETURNS
-   int
+   0 if every command was sent and answered, otherwise the first error
 ******************************************************************************/
+static int gencmd_send_one ( uint32_t *seq, int block, const char *format, ... )
+{
+   va_list a;
+   int     rv;
 
-int vc_gencmd_string_property(char *text, const char *property, char **value, int *length) {
+   va_start ( a, format );
+   rv = gencmd_send_request( seq, block, format, a );
+   va_end ( a );
+   return rv;
+}
+
+int vc_gencmd_batch(int num_commands, const char * const *commands,
+                    char * const *responses, int maxlen) {
+   uint32_t seq[GENCMD_MAX_PENDING];
+   int sent_ok[GENCMD_MAX_PENDING];
+   int sent = 0, received = 0;
+   int ret = 0, rv;
+
+   if(!vcos_verify(num_commands >= 0 && commands && responses))
+      return -1;
+
+   use_gencmd_service();
+   while(received < num_commands) {
+      //Keep the pipe full, then collect the oldest response. Only block for a free
+      //slot when we have nothing outstanding, otherwise two batches could each
+      //hold slots while waiting for the other's.
+      while(sent < num_commands && sent - received < GENCMD_MAX_PENDING) {
+         rv = gencmd_send_one(&seq[sent % GENCMD_MAX_PENDING], sent == received, "%s", commands[sent]);
+         if(rv == GENCMD_SLOTS_BUSY)
+            break;
+         sent_ok[sent % GENCMD_MAX_PENDING] = (rv == 0);
+         sent++;
+      }
+
+      if(sent_ok[received % GENCMD_MAX_PENDING]) {
+         rv = gencmd_receive_response(seq[received % GENCMD_MAX_PENDING], responses[received], maxlen);
+         if(rv != 0 && ret == 0)
+            ret = rv;
+         if(rv != 0 && maxlen > 0)
+            responses[received][0] = '\0';
+      } else {
+         if(ret == 0)
+            ret = -1;
+         if(maxlen > 0)
+            responses[received][0] = '\0';
+      }
+      received++;
+   }
+   release_gencmd_service();
+
+   return ret;
+}
+
+/******************************************************************************
+NAME
+   gencmd_next_property
+
+SYNOPSIS
+   char *gencmd_next_property(char *text, char **name, int *name_length,
+                              char **value, int *value_length)
+
+FUNCTION
+   Tokenizer shared by the property functions below. Finds the next item of
+   the form property=value in text and returns where to carry on scanning, or
+   NULL if there are no more. The value may contain spaces, in which case it
+   is enclosed in double quotes which are not included in the value.
+
+RETURNS
+   char *
+******************************************************************************/
 #define READING_PROPERTY 0
 #define READING_VALUE 1
 #define READING_VALUE_QUOTED 2
+
+static char *gencmd_next_property(char *text, char **name, int *name_length,
+                                  char **value, int *value_length) {
    int state = READING_PROPERTY;
-   int delimiter = 1, match = 0, len = (int)strlen(property);
+   int delimiter = 1;
    char *prop_start=text, *value_start=text;
    for (; *text; text++) {
       int ch = *text;
@@ -405,18 +687,16 @@ int vc_gencmd_string_property(char *text, const char *property, char **value, in
          if (isspace(ch)) delimiter = 1;
          else if (ch == '=') {
             delimiter = 1;
-            match = (text-prop_start==len && strncmp(prop_start, property, (size_t)(text-prop_start))==0);
+            *name = prop_start;
+            *name_length = text - prop_start;
+            value_start = text + 1;
             state = READING_VALUE;
          }
          else delimiter = 0;
          break;
       case READING_VALUE:
          if (delimiter) value_start = text;
-         if (isspace(ch)) {
-            if (match) goto success;
-            delimiter = 1;
-            state = READING_PROPERTY;
-         }
+         if (isspace(ch)) goto found;
          else if (delimiter && ch == '"') {
             delimiter = 1;
             state = READING_VALUE_QUOTED;
@@ -425,21 +705,61 @@ int vc_gencmd_string_property(char *text, const char *property, char **value, in
          break;
       case READING_VALUE_QUOTED:
          if (delimiter) value_start = text;
-         if (ch == '"') {
-            if (match) goto success;
-            delimiter = 1;
-            state = READING_PROPERTY;
-         }
+         if (ch == '"') goto found;
          else delimiter = 0;
          break;
       }
    }
-   if (match) goto success;
-   return 0;
-success:
+   if (state == READING_PROPERTY)
+      return NULL;
+found:
    *value = value_start;
-   *length = text - value_start;
-   return 1;
+   *value_length = text - value_start;
+   return *text ? text + 1 : text;
+}
+
+static int gencmd_parse_number(const char *value, int length, int *number) {
+   char temp[32];
+   int retval;
+   length = vcos_min(length, (int)sizeof(temp) - 1);
+   memcpy(temp, value, (size_t)length);
+   temp[length] = 0;
+   retval = sscanf(temp, "0x%x", (unsigned int*)number);
+   if (retval != 1)
+      retval = sscanf(temp, "%d", number);
+   return retval;
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_string_property
+
+SYNOPSIS
+   int vc_gencmd_string_property(char *text, char *property, char **value, int *length)
+
+FUNCTION
+   Given a text string, containing items of the form property=value,
+   look for the named property and return the value. The start of the value
+   is returned, along with its length. The value may contain spaces, in which
+   case it is enclosed in double quotes. The double quotes are not included in
+   the return parameters. Return non-zero if the property is found.
+
+RETURNS
+   int
+******************************************************************************/
+
+int vc_gencmd_string_property(char *text, const char *property, char **value, int *length) {
+   int len = (int)strlen(property);
+   char *name, *item_value;
+   int name_length, item_length;
+   while ((text = gencmd_next_property(text, &name, &name_length, &item_value, &item_length)) != NULL) {
+      if (name_length == len && strncmp(name, property, (size_t)len) == 0) {
+         *value = item_value;
+         *length = item_length;
+         return 1;
+      }
+   }
+   return 0;
 }
 
 /******************************************************************************
@@ -459,18 +779,170 @@ RETURNS
 ******************************************************************************/
 
 int vc_gencmd_number_property(char *text, const char *property, int *number) {
-   char *value, temp;
-   int length, retval;
+   char *value;
+   int length;
    if (vc_gencmd_string_property(text, property, &value, &length) == 0)
       return 0;
-   temp = value[length];
-   value[length] = 0;
-   retval = sscanf(value, "0x%x", (unsigned int*)number);
-   if (retval != 1)
-      retval = sscanf(value, "%d", number);
-   value[length] = temp;
-   return retval;
+   return gencmd_parse_number(value, length, number);
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_parse_properties
+
+SYNOPSIS
+   int vc_gencmd_parse_properties(char *text, VC_GENCMD_PROPERTIES_T *properties)
+
+FUNCTION
+   Index every property=value item of a response in one pass, so that any
+   number of them can then be looked up with vc_gencmd_find_property without
+   scanning the text again. Nothing is allocated and the text is not
+   modified; values point into it. If a property appears twice the first
+   one is kept, as with vc_gencmd_string_property. Items beyond
+   VC_GENCMD_MAX_PROPERTIES are ignored.
+
+RETURNS
+   The number of properties indexed
+******************************************************************************/
+static uint32_t gencmd_property_hash(const char *name, int length) {
+   uint32_t hash = 2166136261u; //FNV-1a
+   while (length--)
+      hash = (hash ^ (uint8_t)*name++) * 16777619u;
+   return hash;
+}
 
+//Returns the index slot holding name, or the empty slot where it belongs
+static uint8_t *gencmd_property_slot(const VC_GENCMD_PROPERTIES_T *properties, const char *name, int length) {
+   uint32_t i = gencmd_property_hash(name, length) & (VC_GENCMD_PROPERTY_INDEX_SIZE - 1);
+   for (;; i = (i + 1) & (VC_GENCMD_PROPERTY_INDEX_SIZE - 1)) {
+      const uint8_t *slot = &properties->index[i];
+      const VC_GENCMD_PROPERTY_T *property;
+      if (*slot == 0)
+         return (uint8_t *)slot;
+      property = &properties->property[*slot - 1];
+      if (property->name_length == length && memcmp(property->name, name, (size_t)length) == 0)
+         return (uint8_t *)slot;
+   }
+}
+
+int vc_gencmd_parse_properties(char *text, VC_GENCMD_PROPERTIES_T *properties) {
+   char *name, *value;
+   int name_length, value_length;
+
+   properties->num_properties = 0;
+   memset(properties->index, 0, sizeof(properties->index));
+
+   while (properties->num_properties < VC_GENCMD_MAX_PROPERTIES &&
+          (text = gencmd_next_property(text, &name, &name_length, &value, &value_length)) != NULL) {
+      uint8_t *slot = gencmd_property_slot(properties, name, name_length);
+      if (*slot == 0) {
+         VC_GENCMD_PROPERTY_T *property = &properties->property[properties->num_properties++];
+         property->name = name;
+         property->name_length = name_length;
+         property->value = value;
+         property->value_length = value_length;
+         *slot = (uint8_t)properties->num_properties;
+      }
+   }
+   return properties->num_properties;
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_find_property
+
+SYNOPSIS
+   int vc_gencmd_find_property(const VC_GENCMD_PROPERTIES_T *properties, const char *property,
+                               char **value, int *length)
+
+FUNCTION
+   As vc_gencmd_string_property, on a response indexed by vc_gencmd_parse_properties.
+
+RETURNS
+   int
+******************************************************************************/
+int vc_gencmd_find_property(const VC_GENCMD_PROPERTIES_T *properties, const char *property,
+                            char **value, int *length) {
+   const uint8_t *slot = gencmd_property_slot(properties, property, (int)strlen(property));
+   if (*slot == 0)
+      return 0;
+   *value = properties->property[*slot - 1].value;
+   *length = properties->property[*slot - 1].value_length;
+   return 1;
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_find_number_property
+
+SYNOPSIS
+   int vc_gencmd_find_number_property(const VC_GENCMD_PROPERTIES_T *properties,
+                                      const char *property, int *number)
+
+FUNCTION
+   As vc_gencmd_number_property, on a response indexed by vc_gencmd_parse_properties.
+
+RETURNS
+   int
+******************************************************************************/
+int vc_gencmd_find_number_property(const VC_GENCMD_PROPERTIES_T *properties,
+                                   const char *property, int *number) {
+   char *value;
+   int length;
+   if (vc_gencmd_find_property(properties, property, &value, &length) == 0)
+      return 0;
+   return gencmd_parse_number(value, length, number);
+}
+
+/******************************************************************************
+NAME
+   vc_gencmd_wait
+
+SYNOPSIS
+   int vc_gencmd_wait(const char *cmd, VC_GENCMD_CONDITION_T condition, void *context, int timeout)
+
+FUNCTION
+   Sends the command repeatedly until the condition function returns non-zero
+   for the response, or until timeout milliseconds have passed. VideoCore has
+   no way of pushing property changes, so the response is polled, but the poll
+   interval starts at GENCMD_POLL_MIN_MS and doubles up to GENCMD_POLL_MAX_MS.
+   A change shortly after the call is therefore seen quickly, and the
+   deadline is measured rather than estimated from the number of polls.
+
+RETURNS
+   The non-zero value returned by the condition, or 0 on timeout.
+******************************************************************************/
+#define GENCMD_POLL_MIN_MS 1
+#define GENCMD_POLL_MAX_MS 10
+
+int vc_gencmd_wait( const char            *cmd,
+                    VC_GENCMD_CONDITION_T condition,
+                    void                  *context,
+                    int                   timeout) {
+   char response[128];
+   uint32_t start = vcos_get_ms(), elapsed;
+   uint32_t delay = GENCMD_POLL_MIN_MS;
+   int ret = 0;
+
+   if(!vcos_verify(cmd && condition))
+      return 0;
+
+   use_gencmd_service();
+   for (;;) {
+      memset(response, 0, sizeof(response));
+      if (vc_gencmd(response, (int)sizeof(response) - 1, "%s", cmd) == 0 &&
+          (ret = condition(response, context)) != 0)
+         break;
+
+      elapsed = vcos_get_ms() - start;
+      if (timeout <= 0 || elapsed >= (uint32_t)timeout)
+         break;
+      vcos_sleep(vcos_min(delay, (uint32_t)timeout - elapsed));
+      delay = vcos_min(delay * 2, GENCMD_POLL_MAX_MS);
+   }
+   release_gencmd_service();
+
+   return ret;
 }
 
 /******************************************************************************
@@ -486,38 +958,37 @@ FUNCTION
    The specified error string is found within the gencmd response.
    The timeout is reached.
 
-   The timeout is a rough value, do not use it for precise timing.
+   See vc_gencmd_wait for how often the command is sent.
 
 RETURNS
    0 if the requested response was detected.
    1 if the error string is detected or the timeout is reached.
 ******************************************************************************/
+typedef struct {
+   const char *property;
+   const char *value;
+   const char *error_string;
+} GENCMD_UNTIL_T;
+
+static int gencmd_until_condition(const char *response, void *context) {
+   GENCMD_UNTIL_T *until = (GENCMD_UNTIL_T *)context;
+   char *ret_value;
+   int length;
+
+   if (strstr(response, until->error_string))
+      return -1;
+   if (vc_gencmd_string_property((char *)response, until->property, &ret_value, &length) &&
+       strncmp(until->value, ret_value, (size_t)length) == 0)
+      return 1;
+   return 0;
+}
+
 int vc_gencmd_until( char        *cmd,
                      const char  *property,
                      char        *value,
                      const char  *error_string,
                      int         timeout) {
-   char response[128];
-   int length;
-   char *ret_value;
-   int ret = 1;
+   GENCMD_UNTIL_T until = { property, value, error_string };
 
-   use_gencmd_service();
-   for (;timeout > 0; timeout -= 10) {
-      vc_gencmd(response, (int)sizeof(response), cmd);
-      if (strstr(response,error_string)) {
-         ret = 1;
-         break;
-      }
-      else if (vc_gencmd_string_property(response, property, &ret_value, &length) &&
-               strncmp(value,ret_value,(size_t)length)==0) {
-         ret = 0;
-         break;
-      }
-      vcos_sleep(10);
-   }
-   release_gencmd_service();
-
-   return ret;
+   return vc_gencmd_wait(cmd, gencmd_until_condition, &until, timeout) > 0 ? 0 : 1;
 }
-
@@ -62,9 +62,15 @@ VCHPRE_ int VCHPOST_ vc_gencmd_send( const char *format, ... );
 /*  get resonse from general command serivce */
 VCHPRE_ int VCHPOST_ vc_gencmd_read_response(char *response, int maxlen);
 
-/* convenience function to send command and receive the response */
+/* convenience function to send command and receive the response, may be called
+   from several threads at once */
 VCHPRE_ int VCHPOST_ vc_gencmd(char *response, int maxlen, const char *format, ...);
 
+/* send several commands back to back and receive their responses in order, each
+   response buffer is maxlen bytes. Returns 0 if all commands were answered. */
+VCHPRE_ int VCHPOST_ vc_gencmd_batch(int num_commands, const char * const *commands,
+                                     char * const *responses, int maxlen);
+
 /******************************************************************************
 Utilities to help interpret the responses.
 ******************************************************************************/
@@ -77,6 +83,45 @@ VCHPRE_ int VCHPOST_ vc_gencmd_string_property(char *text, const char *property,
    non-zero if found. */
 VCHPRE_ int VCHPOST_ vc_gencmd_number_property(char *text, const char *property, int *number);
 
+/* Index of the property=value items of a response, filled in by vc_gencmd_parse_properties.
+   Names and values point into the response text, which must outlive the index. */
+#define VC_GENCMD_MAX_PROPERTIES 32
+#define VC_GENCMD_PROPERTY_INDEX_SIZE 64 /* power of two, larger than VC_GENCMD_MAX_PROPERTIES */
+
+typedef struct {
+   const char *name;
+   int         name_length;
+   char       *value;
+   int         value_length;
+} VC_GENCMD_PROPERTY_T;
+
+typedef struct {
+   int                  num_properties;
+   VC_GENCMD_PROPERTY_T property[VC_GENCMD_MAX_PROPERTIES];
+   uint8_t              index[VC_GENCMD_PROPERTY_INDEX_SIZE]; /* hash of name -> 1 + position in property[] */
+} VC_GENCMD_PROPERTIES_T;
+
+/* Scan a response once and index all its properties. Returns the number found. */
+VCHPRE_ int VCHPOST_ vc_gencmd_parse_properties(char *text, VC_GENCMD_PROPERTIES_T *properties);
+
+/* As vc_gencmd_string_property and vc_gencmd_number_property, but on an indexed response
+   so each lookup is constant time. */
+VCHPRE_ int VCHPOST_ vc_gencmd_find_property(const VC_GENCMD_PROPERTIES_T *properties, const char *property,
+                                             char **value, int *length);
+VCHPRE_ int VCHPOST_ vc_gencmd_find_number_property(const VC_GENCMD_PROPERTIES_T *properties,
+                                                    const char *property, int *number);
+
+/* Condition for vc_gencmd_wait. Return 0 to keep waiting, > 0 when the response shows the
+   awaited state and < 0 to give up (e.g. an error was reported). */
+typedef int (*VC_GENCMD_CONDITION_T)(const char *response, void *context);
+
+/* Send a command until the condition function returns non-zero for its response, or until
+   timeout milliseconds have passed. Returns the condition's result, or 0 on timeout. */
+VCHPRE_ int VCHPOST_ vc_gencmd_wait( const char            *cmd,
+                                     VC_GENCMD_CONDITION_T condition,
+                                     void                  *context,
+                                     int                   timeout);
+
 /* Send a command until the desired response is received, the error message is detected, or the timeout */
 VCHPRE_ int VCHPOST_ vc_gencmd_until( char        *cmd,
                                       const char  *property,
@@ -38,6 +38,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "interface/vchi/common/endian.h"
 #include "interface/vchi/message_drivers/message.h"
 #include "vc_tvservice.h"
+#include "vc_notify_dispatch.h"
+#include "vc_service_common.h"
 
 /******************************************************************************
 Local types and defines.
@@ -49,11 +51,8 @@ Local types and defines.
 #define _max(x,y) (((x) >= (y))? (x) : (y))
 #endif
 
-typedef struct
-{
-   TVSERVICE_CALLBACK_T  notify_fn;
-   void                 *notify_data;
-} TVSERVICE_HOST_CALLBACK_T;
+//Notifications are read from VideoCore this many at a time
+#define TVSERVICE_NOTIFY_BATCH 16
 
 typedef struct {
    int is_valid;
@@ -61,6 +60,30 @@ typedef struct {
    TV_SUPPORTED_MODE_T modes[TV_MAX_SUPPORTED_MODES];
 } TVSERVICE_MODE_CACHE_T;
 
+//EDID blocks read through vc_tv_hdmi_ddc_read are kept until the next hotplug
+#define TVSERVICE_EDID_BLOCK_SIZE   128
+#define TVSERVICE_EDID_CACHE_BLOCKS 8
+
+typedef struct {
+   uint32_t valid_blocks; //Bitmask of the blocks present in data
+   uint8_t  data[TVSERVICE_EDID_BLOCK_SIZE * TVSERVICE_EDID_CACHE_BLOCKS];
+} TVSERVICE_EDID_CACHE_T;
+
+//Answers to single value queries (mode and audio support), keyed by their parameters
+#define TVSERVICE_QUERY_CACHE_SIZE  64
+#define TVSERVICE_QUERY_KEY_LEN     4
+
+typedef struct {
+   uint32_t key[TVSERVICE_QUERY_KEY_LEN];
+   int32_t  result;
+} TVSERVICE_QUERY_CACHE_ENTRY_T;
+
+typedef struct {
+   uint32_t num_entries;
+   uint32_t next_victim;
+   TVSERVICE_QUERY_CACHE_ENTRY_T entries[TVSERVICE_QUERY_CACHE_SIZE];
+} TVSERVICE_QUERY_CACHE_T;
+
 //TV service host side state (mostly the same as Videocore side - TVSERVICE_STATE_T)
 typedef struct {
    //Generic service stuff
@@ -74,7 +97,7 @@ typedef struct {
    uint32_t              notify_length;
    uint32_t              num_connections;
    VCOS_MUTEX_T          lock;
-   TVSERVICE_HOST_CALLBACK_T  callbacks[TVSERVICE_MAX_CALLBACKS];
+   VC_NOTIFY_DISPATCHER_T dispatcher; //Delivers notifications to the registered callbacks
    int                   initialised;
    int                   to_exit;
 
@@ -93,6 +116,16 @@ typedef struct {
    TVSERVICE_MODE_CACHE_T cea_cache;
    TVSERVICE_MODE_CACHE_T cea_3d_cache;
 
+   //Everything else derived from the EDID is cached as well, and the last TV state
+   //until the next notification. cache_generation is bumped on every invalidation so
+   //that a reply which raced with a notification is not stored.
+   uint32_t              cache_generation;
+   TVSERVICE_EDID_CACHE_T edid_cache;
+   TVSERVICE_QUERY_CACHE_T mode_support_cache;
+   TVSERVICE_QUERY_CACHE_T audio_support_cache;
+   int                   tvstate_cache_valid;
+   TV_GET_STATE_RESP_T   tvstate_cache;
+
    //SDTV specific stuff
    SDTV_COLOUR_T         sdtv_current_colour;
    SDTV_MODE_T           sdtv_current_mode;
@@ -144,6 +177,7 @@ Static functions.
 ******************************************************************************/
 //Lock the host state
 static __inline int tvservice_lock_obtain (void) {
+   vc_service_open_lazily(VC_SERVICE_TVSERVICE);
    if(tvservice_client.initialised && vcos_mutex_lock(&tvservice_client.lock) == VCOS_SUCCESS) {
       //Check again in case the service has been stopped
       if (tvservice_client.initialised) {
@@ -165,6 +199,102 @@ static __inline void tvservice_lock_release (void) {
    vcos_mutex_unlock(&tvservice_client.lock);
 }
 
+//Lock the host state for cache access only (no need to bring VideoCore out of suspend)
+static __inline int tvservice_cache_lock (void) {
+   if(tvservice_client.initialised && vcos_mutex_lock(&tvservice_client.lock) == VCOS_SUCCESS) {
+      if (tvservice_client.initialised)
+         return 0;
+      vcos_mutex_unlock(&tvservice_client.lock);
+   }
+   return -1;
+}
+
+static __inline void tvservice_cache_unlock (void) {
+   vcos_mutex_unlock(&tvservice_client.lock);
+}
+
+//Drop the cached TV state only (lock must be held)
+static void tvservice_invalidate_state_cache(TVSERVICE_HOST_STATE_T *state) {
+   state->tvstate_cache_valid = 0;
+   state->cache_generation++;
+}
+
+//Drop everything derived from the EDID, called on hotplug (lock must be held)
+static void tvservice_invalidate_caches(TVSERVICE_HOST_STATE_T *state) {
+   vcos_log_trace("[%s] invalidating caches", VCOS_FUNCTION);
+   state->cea_cache.is_valid = 0;
+   state->dmt_cache.is_valid = 0;
+   state->cea_3d_cache.is_valid = 0;
+   state->edid_cache.valid_blocks = 0;
+   state->mode_support_cache.num_entries = 0;
+   state->mode_support_cache.next_victim = 0;
+   state->audio_support_cache.num_entries = 0;
+   state->audio_support_cache.next_victim = 0;
+   tvservice_invalidate_state_cache(state);
+}
+
+//Look up a single value query, returns zero on a hit. On a miss (1) the generation
+//is returned so that the answer can be filled in with tvservice_query_cache_store.
+//Returns -1 if the cache can't be used at all
+static int tvservice_query_cache_find(TVSERVICE_QUERY_CACHE_T *cache, const uint32_t *key,
+                                      int32_t *result, uint32_t *generation) {
+   int found = 1;
+   uint32_t i;
+
+   *generation = 0;
+   if(tvservice_cache_lock() != 0)
+      return -1;
+
+   *generation = tvservice_client.cache_generation;
+   for(i = 0; i < cache->num_entries; i++) {
+      if(memcmp(cache->entries[i].key, key, sizeof(cache->entries[i].key)) == 0) {
+         *result = cache->entries[i].result;
+         found = 0;
+         break;
+      }
+   }
+   tvservice_cache_unlock();
+   return found;
+}
+
+static void tvservice_query_cache_store(TVSERVICE_QUERY_CACHE_T *cache, const uint32_t *key,
+                                        int32_t result, uint32_t generation) {
+   TVSERVICE_QUERY_CACHE_ENTRY_T *entry;
+
+   if(tvservice_cache_lock() != 0)
+      return;
+
+   if(generation == tvservice_client.cache_generation) {
+      if(cache->num_entries < TVSERVICE_QUERY_CACHE_SIZE) {
+         entry = &cache->entries[cache->num_entries++];
+      } else {
+         entry = &cache->entries[cache->next_victim];
+         cache->next_victim = (cache->next_victim + 1) % TVSERVICE_QUERY_CACHE_SIZE;
+      }
+      memcpy(entry->key, key, sizeof(entry->key));
+      entry->result = result;
+   }
+   tvservice_cache_unlock();
+}
+
+//Commands which may change what vc_tv_get_state returns
+static int tvservice_command_changes_state(uint32_t command) {
+   switch(command) {
+   case VC_TV_GET_STATE:
+   case VC_TV_QUERY_SUPPORTED_MODES:
+   case VC_TV_QUERY_MODE_SUPPORT:
+   case VC_TV_QUERY_AUDIO_SUPPORT:
+   case VC_TV_SHOW_INFO:
+   case VC_TV_GET_AV_LATENCY:
+   case VC_TV_SET_SPD:
+   case VC_TV_DDC_READ:
+   case VC_TV_GET_PROP:
+      return 0;
+   default:
+      return 1;
+   }
+}
+
 //Forward declarations
 static void tvservice_client_callback( void *callback_param,
                                       VCHI_CALLBACK_REASON_T reason,
@@ -185,6 +315,9 @@ static int32_t tvservice_send_command_reply( uint32_t command, void *buffer, uin
 
 static void *tvservice_notify_func(void *arg);
 
+static void tvservice_notify_deliver(VC_NOTIFY_CALLBACK_T callback, void *callback_data,
+                                     const VC_NOTIFY_T *notify);
+
 
 /******************************************************************************
 TV service API
@@ -296,6 +429,10 @@ VCHPRE_ int VCHPOST_ vc_vchi_tv_init(VCHI_INSTANCE_T initialise_instance, VCHI_C
       }
    }
 
+   status = vc_notify_dispatch_init(&tvservice_client.dispatcher, "HTV Callback", tvservice_notify_deliver,
+                                    VC_TV_NOTIFY_OVERFLOW);
+   vcos_assert(status == VCOS_SUCCESS);
+
    //Create the notifier task
    vcos_thread_attr_init(&attrs);
    vcos_thread_attr_setstacksize(&attrs, 4096);
@@ -348,6 +485,7 @@ VCHPRE_ void VCHPOST_ vc_vchi_tv_stop( void ) {
       tvservice_client.to_exit = 1; //Signal to quit
       vcos_event_signal(&tvservice_notify_available_event);
       vcos_thread_join(&tvservice_notify_task, &dummy);
+      vc_notify_dispatch_deinit(&tvservice_client.dispatcher);
       vcos_mutex_delete(&tvservice_client.lock);
       vcos_event_delete(&tvservice_message_available_event);
       vcos_event_delete(&tvservice_notify_available_event);
@@ -363,30 +501,25 @@ VCHPRE_ void VCHPOST_ vc_vchi_tv_stop( void ) {
  *
  * Description: Register a callback function for all TV notifications
  *
- * Returns: -
+ * Returns: zero if the callback was registered, non-zero if the service
+ *          is not running or VC_NOTIFY_MAX_SUBSCRIBERS are registered
  *
  ***********************************************************/
-VCHPRE_ void VCHPOST_ vc_tv_register_callback(TVSERVICE_CALLBACK_T callback, void *callback_data) {
+VCHPRE_ int VCHPOST_ vc_tv_register_callback(TVSERVICE_CALLBACK_T callback, void *callback_data) {
+   VCOS_STATUS_T status = VCOS_EINVAL;
 
    vcos_assert_msg(callback != NULL, "Use vc_tv_unregister_callback() to remove a callback");
 
    vcos_log_trace("[%s]", VCOS_FUNCTION);
-   if(tvservice_lock_obtain() == 0)
+   vc_service_open_lazily(VC_SERVICE_TVSERVICE);
+   if(tvservice_client.initialised)
    {
-      uint32_t done = 0;
-      uint32_t i;
-      for(i = 0; (i < TVSERVICE_MAX_CALLBACKS) && !done; i++)
-      {
-         if(tvservice_client.callbacks[i].notify_fn == NULL)
-         {
-            tvservice_client.callbacks[i].notify_fn = callback;
-            tvservice_client.callbacks[i].notify_data = callback_data;
-            done = 1;
-         } // if
-      } // for
-      vcos_assert(done);
-      tvservice_lock_release();
+      status = vc_notify_dispatch_subscribe(&tvservice_client.dispatcher,
+                                            (VC_NOTIFY_CALLBACK_T) callback, callback_data);
+      if(status != VCOS_SUCCESS)
+         vcos_log_warn("[%s] could not register callback (%d)", VCOS_FUNCTION, status);
    }
+   return status == VCOS_SUCCESS ? 0 : -1;
 }
 
 /***********************************************************
@@ -402,27 +535,38 @@ VCHPRE_ void VCHPOST_ vc_tv_register_callback(TVSERVICE_CALLBACK_T callback, voi
  ***********************************************************/
 VCHPRE_ void VCHPOST_ vc_tv_unregister_callback(TVSERVICE_CALLBACK_T callback)
 {
+   VCOS_STATUS_T status;
+
    vcos_assert(callback != NULL);
 
    vcos_log_trace("[%s]", VCOS_FUNCTION);
-   if(tvservice_lock_obtain() == 0)
+   if(tvservice_client.initialised)
    {
-      uint32_t done = 0;
-      uint32_t i;
-      for(i = 0; (i < TVSERVICE_MAX_CALLBACKS) && !done; i++)
-      {
-         if(tvservice_client.callbacks[i].notify_fn == callback)
-         {
-            tvservice_client.callbacks[i].notify_fn = NULL;
-            tvservice_client.callbacks[i].notify_data = NULL;
-            done = 1;
-         } // if
-      } // for
-      vcos_assert(done);
-      tvservice_lock_release();
+      status = vc_notify_dispatch_unsubscribe(&tvservice_client.dispatcher, (VC_NOTIFY_CALLBACK_T) callback);
+      vcos_assert(status == VCOS_SUCCESS);
    }
 }
 
+/***********************************************************
+ * Name: vc_tv_get_notify_stats
+ *
+ * Arguments:
+ *       pointer to stats
+ *
+ * Description: Get the notification dispatch statistics
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+VCHPRE_ void VCHPOST_ vc_tv_get_notify_stats(VC_NOTIFY_STATS_T *stats)
+{
+   vcos_assert(stats != NULL);
+   if(tvservice_client.initialised)
+      vc_notify_dispatch_get_stats(&tvservice_client.dispatcher, stats);
+   else
+      memset(stats, 0, sizeof(*stats));
+}
+
 /*********************************************************************************
  *
  *  Static functions definitions
@@ -557,6 +701,8 @@ static int32_t tvservice_send_command(  uint32_t command, void *buffer, uint32_t
 
    if(tvservice_lock_obtain() == 0)
    {
+      if(tvservice_command_changes_state(command))
+         tvservice_invalidate_state_cache(&tvservice_client);
       success = vchi_msg_queuev( tvservice_client.client_handle[0],
                                  vector, sizeof(vector)/sizeof(vector[0]),
                                  VCHI_FLAGS_BLOCK_UNTIL_QUEUED, NULL );
@@ -597,6 +743,8 @@ static int32_t tvservice_send_command_reply(  uint32_t command, void *buffer, ui
 
    if(tvservice_lock_obtain() == 0)
    {
+      if(tvservice_command_changes_state(command))
+         tvservice_invalidate_state_cache(&tvservice_client);
       success = vchi_msg_queuev( tvservice_client.client_handle[0],
                                  vector, sizeof(vector)/sizeof(vector[0]),
                                  VCHI_FLAGS_BLOCK_UNTIL_QUEUED, NULL );
@@ -612,6 +760,152 @@ static int32_t tvservice_send_command_reply(  uint32_t command, void *buffer, ui
    return success;
 }
 
+/***********************************************************
+ * Name: tvservice_update_state
+ *
+ * Arguments: TV service state, tracked TV state, notification
+ *
+ * Description: Update the host side state for a notification,
+ *              called from the notify task with the lock held
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+static void tvservice_update_state(TVSERVICE_HOST_STATE_T *state, TV_GET_STATE_RESP_T *tvstate,
+                                   uint32_t reason, uint32_t param1, uint32_t param2) {
+   //Any notification means the TV state has moved on
+   tvservice_invalidate_state_cache(state);
+   switch(reason) {
+   case VC_HDMI_UNPLUGGED:
+      if(tvstate->state & (VC_HDMI_HDMI|VC_HDMI_DVI|VC_HDMI_STANDBY)) {
+         state->copy_protect = 0;
+         if((tvstate->state & VC_HDMI_STANDBY) == 0) {
+            vchi_service_release(state->notify_handle[0]);
+         }
+      }
+      tvstate->state &= ~(VC_HDMI_HDMI|VC_HDMI_DVI|VC_HDMI_STANDBY|VC_HDMI_HDCP_AUTH);
+      tvstate->state |= (VC_HDMI_UNPLUGGED | VC_HDMI_HDCP_UNAUTH);
+      tvservice_invalidate_caches(state);
+      break;
+
+   case VC_HDMI_STANDBY:
+      if(tvstate->state & VC_HDMI_UNPLUGGED) {
+         //Newly attached display, its EDID may differ from the previous one
+         tvservice_invalidate_caches(state);
+      }
+      if(tvstate->state & (VC_HDMI_HDMI|VC_HDMI_DVI)) {
+         state->copy_protect = 0;
+         vchi_service_release(state->notify_handle[0]);
+      }
+      tvstate->state &=  ~(VC_HDMI_HDMI|VC_HDMI_DVI|VC_HDMI_UNPLUGGED|VC_HDMI_HDCP_AUTH);
+      tvstate->state |= VC_HDMI_STANDBY;
+      state->hdmi_preferred_group = (HDMI_RES_GROUP_T) param1;
+      state->hdmi_preferred_mode = param2;
+      break;
+
+   case VC_HDMI_DVI:
+      if(tvstate->state & VC_HDMI_UNPLUGGED) {
+         tvservice_invalidate_caches(state);
+      }
+      if(tvstate->state & (VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED)) {
+         vchi_service_use(state->notify_handle[0]);
+      }
+      tvstate->state &= ~(VC_HDMI_HDMI|VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED);
+      tvstate->state |= VC_HDMI_DVI;
+      state->hdmi_current_group = (HDMI_RES_GROUP_T) param1;
+      state->hdmi_current_mode = param2;
+      break;
+
+   case VC_HDMI_HDMI:
+      if(tvstate->state & VC_HDMI_UNPLUGGED) {
+         tvservice_invalidate_caches(state);
+      }
+      if(tvstate->state & (VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED)) {
+         vchi_service_use(state->notify_handle[0]);
+      }
+      tvstate->state &= ~(VC_HDMI_DVI|VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED);
+      tvstate->state |= VC_HDMI_HDMI;
+      state->hdmi_current_group = (HDMI_RES_GROUP_T) param1;
+      state->hdmi_current_mode = param2;
+      break;
+
+   case VC_HDMI_HDCP_UNAUTH:
+      tvstate->state &= ~VC_HDMI_HDCP_AUTH;
+      tvstate->state |= VC_HDMI_HDCP_UNAUTH;
+      state->copy_protect = 0;
+      //Do we care about the reason for HDCP unauth in param1?
+      break;
+
+   case VC_HDMI_HDCP_AUTH:
+      tvstate->state &= ~VC_HDMI_HDCP_UNAUTH;
+      tvstate->state |= VC_HDMI_HDCP_AUTH;
+      state->copy_protect = 1;
+      break;
+
+   case VC_HDMI_HDCP_KEY_DOWNLOAD:
+   case VC_HDMI_HDCP_SRM_DOWNLOAD:
+      //Nothing to do here, just tell the host app whether it is successful or not (in param1)
+      break;
+
+   case VC_SDTV_UNPLUGGED: //Currently we don't get this
+      if(tvstate->state & (VC_SDTV_PAL | VC_SDTV_NTSC)) {
+         state->copy_protect = 0;
+      }
+      tvstate->state &= ~(VC_SDTV_STANDBY | VC_SDTV_PAL | VC_SDTV_NTSC);
+      tvstate->state |= (VC_SDTV_UNPLUGGED | VC_SDTV_CP_INACTIVE);
+      state->sdtv_current_mode = SDTV_MODE_OFF;
+      break;
+
+   case VC_SDTV_STANDBY: //Currently we don't get this either
+      tvstate->state &= ~(VC_SDTV_UNPLUGGED | VC_SDTV_PAL | VC_SDTV_NTSC);
+      tvstate->state |= VC_SDTV_STANDBY;
+      state->sdtv_current_mode = SDTV_MODE_OFF;
+      break;
+
+   case VC_SDTV_NTSC:
+      tvstate->state &= ~(VC_SDTV_UNPLUGGED | VC_SDTV_STANDBY | VC_SDTV_PAL);
+      tvstate->state |= VC_SDTV_NTSC;
+      state->sdtv_current_mode = (SDTV_MODE_T) param1;
+      state->sdtv_options.aspect = (SDTV_ASPECT_T) param2;
+      if(param1 & SDTV_COLOUR_RGB) {
+         state->sdtv_current_colour = SDTV_COLOUR_RGB;
+      } else if(param1 & SDTV_COLOUR_YPRPB) {
+         state->sdtv_current_colour = SDTV_COLOUR_YPRPB;
+      } else {
+         state->sdtv_current_colour = SDTV_COLOUR_UNKNOWN;
+      }
+      break;
+
+   case VC_SDTV_PAL:
+      tvstate->state &= ~(VC_SDTV_UNPLUGGED | VC_SDTV_STANDBY | VC_SDTV_NTSC);
+      tvstate->state |= VC_SDTV_PAL;
+      state->sdtv_current_mode = (SDTV_MODE_T) param1;
+      state->sdtv_options.aspect = (SDTV_ASPECT_T) param2;
+      if(param1 & SDTV_COLOUR_RGB) {
+         state->sdtv_current_colour = SDTV_COLOUR_RGB;
+      } else if(param1 & SDTV_COLOUR_YPRPB) {
+         state->sdtv_current_colour = SDTV_COLOUR_YPRPB;
+      } else {
+         state->sdtv_current_colour = SDTV_COLOUR_UNKNOWN;
+      }
+      break;
+
+   case VC_SDTV_CP_INACTIVE:
+      tvstate->state &= ~VC_SDTV_CP_ACTIVE;
+      tvstate->state |= VC_SDTV_CP_INACTIVE;
+      state->copy_protect = 0;
+      state->sdtv_current_cp_mode = SDTV_CP_NONE;
+      break;
+
+   case VC_SDTV_CP_ACTIVE:
+      tvstate->state &= ~VC_SDTV_CP_INACTIVE;
+      tvstate->state |= VC_SDTV_CP_ACTIVE;
+      state->copy_protect = 1;
+      state->sdtv_current_cp_mode = (SDTV_CP_MODE_T) param1;
+      break;
+   }
+}
+
 /***********************************************************
  * Name: tvservice_notify_func
  *
@@ -647,163 +941,45 @@ static void *tvservice_notify_func(void *arg) {
          break;
 
       do {
-         uint32_t reason, param1, param2;
-         //Get all notifications in the queue
-         success = vchi_msg_dequeue( state->notify_handle[0], state->notify_buffer, sizeof(state->notify_buffer), &state->notify_length, VCHI_FLAGS_NONE );
-         if(success != 0 || state->notify_length < sizeof(uint32_t)*3 ) {
-            continue;
+         //Get all notifications in the queue, a batch at a time
+         VC_NOTIFY_T batch[TVSERVICE_NOTIFY_BATCH];
+         uint32_t count = 0, i;
+         while(count < TVSERVICE_NOTIFY_BATCH) {
+            success = vchi_msg_dequeue( state->notify_handle[0], state->notify_buffer, sizeof(state->notify_buffer), &state->notify_length, VCHI_FLAGS_NONE );
+            if(success != 0)
+               break;
+            if(state->notify_length < sizeof(uint32_t)*3)
+               continue;
+            //All notifications are of format: reason, param1, param2 (all 32-bit unsigned int)
+            memset(&batch[count], 0, sizeof(batch[count]));
+            batch[count].reason = VC_VTOH32(state->notify_buffer[0]);
+            batch[count].param[0] = VC_VTOH32(state->notify_buffer[1]);
+            batch[count].param[1] = VC_VTOH32(state->notify_buffer[2]);
+            batch[count].timestamp = vcos_getmicrosecs();
+            count++;
          }
-
-         if(tvservice_lock_obtain() != 0)
-            break;
-
-         //Check what notification it is and update ourselves accordingly before notifying the host app
-         //All notifications are of format: reason, param1, param2 (all 32-bit unsigned int)
-         reason = VC_VTOH32(state->notify_buffer[0]), param1 = VC_VTOH32(state->notify_buffer[1]), param2 = VC_VTOH32(state->notify_buffer[2]);
-
-         vcos_log_trace("[%s] %s %d %d", VCOS_FUNCTION, vc_tv_notifcation_name(reason),
-                        param1, param2);
-         switch(reason) {
-         case VC_HDMI_UNPLUGGED:
-            if(tvstate.state & (VC_HDMI_HDMI|VC_HDMI_DVI|VC_HDMI_STANDBY)) {
-               state->copy_protect = 0;
-               if((tvstate.state & VC_HDMI_STANDBY) == 0) {
-                  vchi_service_release(state->notify_handle[0]);
-               }
-            }
-            tvstate.state &= ~(VC_HDMI_HDMI|VC_HDMI_DVI|VC_HDMI_STANDBY|VC_HDMI_HDCP_AUTH);
-            tvstate.state |= (VC_HDMI_UNPLUGGED | VC_HDMI_HDCP_UNAUTH);
-            vcos_log_trace("[%s] invalidating caches", VCOS_FUNCTION);
-            state->cea_cache.is_valid = 0;
-            state->dmt_cache.is_valid = 0;
-            state->cea_3d_cache.is_valid = 0;
-            break;
-
-         case VC_HDMI_STANDBY:
-            if(tvstate.state & (VC_HDMI_HDMI|VC_HDMI_DVI)) {
-               state->copy_protect = 0;
-               vchi_service_release(state->notify_handle[0]);
-            }
-            tvstate.state &=  ~(VC_HDMI_HDMI|VC_HDMI_DVI|VC_HDMI_UNPLUGGED|VC_HDMI_HDCP_AUTH);
-            tvstate.state |= VC_HDMI_STANDBY;
-            state->hdmi_preferred_group = (HDMI_RES_GROUP_T) param1;
-            state->hdmi_preferred_mode = param2;
-            break;
-
-         case VC_HDMI_DVI:
-            if(tvstate.state & (VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED)) {
-               vchi_service_use(state->notify_handle[0]);
-            }
-            tvstate.state &= ~(VC_HDMI_HDMI|VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED);
-            tvstate.state |= VC_HDMI_DVI;
-            state->hdmi_current_group = (HDMI_RES_GROUP_T) param1;
-            state->hdmi_current_mode = param2;
-            break;
-
-         case VC_HDMI_HDMI:
-            if(tvstate.state & (VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED)) {
-               vchi_service_use(state->notify_handle[0]);
-            }
-            tvstate.state &= ~(VC_HDMI_DVI|VC_HDMI_STANDBY|VC_HDMI_UNPLUGGED);
-            tvstate.state |= VC_HDMI_HDMI;
-            state->hdmi_current_group = (HDMI_RES_GROUP_T) param1;
-            state->hdmi_current_mode = param2;
-            break;
-
-         case VC_HDMI_HDCP_UNAUTH:
-            tvstate.state &= ~VC_HDMI_HDCP_AUTH;
-            tvstate.state |= VC_HDMI_HDCP_UNAUTH;
-            state->copy_protect = 0;
-            //Do we care about the reason for HDCP unauth in param1?
-            break;
-
-         case VC_HDMI_HDCP_AUTH:
-            tvstate.state &= ~VC_HDMI_HDCP_UNAUTH;
-            tvstate.state |= VC_HDMI_HDCP_AUTH;
-            state->copy_protect = 1;
-            break;
-
-         case VC_HDMI_HDCP_KEY_DOWNLOAD:
-         case VC_HDMI_HDCP_SRM_DOWNLOAD:
-            //Nothing to do here, just tell the host app whether it is successful or not (in param1)
+         if(count == 0)
             break;
 
-         case VC_SDTV_UNPLUGGED: //Currently we don't get this
-            if(tvstate.state & (VC_SDTV_PAL | VC_SDTV_NTSC)) {
-               state->copy_protect = 0;
-            }
-            tvstate.state &= ~(VC_SDTV_STANDBY | VC_SDTV_PAL | VC_SDTV_NTSC);
-            tvstate.state |= (VC_SDTV_UNPLUGGED | VC_SDTV_CP_INACTIVE);
-            state->sdtv_current_mode = SDTV_MODE_OFF;
-            break;
-
-         case VC_SDTV_STANDBY: //Currently we don't get this either
-            tvstate.state &= ~(VC_SDTV_UNPLUGGED | VC_SDTV_PAL | VC_SDTV_NTSC);
-            tvstate.state |= VC_SDTV_STANDBY;
-            state->sdtv_current_mode = SDTV_MODE_OFF;
-            break;
-
-         case VC_SDTV_NTSC:
-            tvstate.state &= ~(VC_SDTV_UNPLUGGED | VC_SDTV_STANDBY | VC_SDTV_PAL);
-            tvstate.state |= VC_SDTV_NTSC;
-            state->sdtv_current_mode = (SDTV_MODE_T) param1;
-            state->sdtv_options.aspect = (SDTV_ASPECT_T) param2;
-            if(param1 & SDTV_COLOUR_RGB) {
-               state->sdtv_current_colour = SDTV_COLOUR_RGB;
-            } else if(param1 & SDTV_COLOUR_YPRPB) {
-               state->sdtv_current_colour = SDTV_COLOUR_YPRPB;
-            } else {
-               state->sdtv_current_colour = SDTV_COLOUR_UNKNOWN;
-            }
-            break;
-
-         case VC_SDTV_PAL:
-            tvstate.state &= ~(VC_SDTV_UNPLUGGED | VC_SDTV_STANDBY | VC_SDTV_NTSC);
-            tvstate.state |= VC_SDTV_PAL;
-            state->sdtv_current_mode = (SDTV_MODE_T) param1;
-            state->sdtv_options.aspect = (SDTV_ASPECT_T) param2;
-            if(param1 & SDTV_COLOUR_RGB) {
-               state->sdtv_current_colour = SDTV_COLOUR_RGB;
-            } else if(param1 & SDTV_COLOUR_YPRPB) {
-               state->sdtv_current_colour = SDTV_COLOUR_YPRPB;
-            } else {
-               state->sdtv_current_colour = SDTV_COLOUR_UNKNOWN;
-            }
-            break;
-
-         case VC_SDTV_CP_INACTIVE:
-            tvstate.state &= ~VC_SDTV_CP_ACTIVE;
-            tvstate.state |= VC_SDTV_CP_INACTIVE;
-            state->copy_protect = 0;
-            state->sdtv_current_cp_mode = SDTV_CP_NONE;
+         if(tvservice_lock_obtain() != 0)
             break;
 
-         case VC_SDTV_CP_ACTIVE:
-            tvstate.state &= ~VC_SDTV_CP_INACTIVE;
-            tvstate.state |= VC_SDTV_CP_ACTIVE;
-            state->copy_protect = 1;
-            state->sdtv_current_cp_mode = (SDTV_CP_MODE_T) param1;
-            break;
+         //Check what notifications they are and update ourselves accordingly before notifying the host app
+         for(i = 0; i < count; i++) {
+            vcos_log_trace("[%s] %s %d %d", VCOS_FUNCTION, vc_tv_notifcation_name(batch[i].reason),
+                           batch[i].param[0], batch[i].param[1]);
+            tvservice_update_state(state, &tvstate, batch[i].reason, batch[i].param[0], batch[i].param[1]);
          }
 
          tvservice_lock_release();
 
-         //Now callback the host app(s)
-         uint32_t i, called = 0;
-         for(i = 0; i < TVSERVICE_MAX_CALLBACKS; i++)
-         {
-            if(state->callbacks[i].notify_fn != NULL)
-            {
-               called++;
-               state->callbacks[i].notify_fn
-                  (state->callbacks[i].notify_data, reason, param1, param2);
-            } // if
-         } // for
-         if(called == 0) {
-            vcos_log_info("TV service: No callback handler specified, callback [%s] swallowed",
-                          vc_tv_notifcation_name(reason));
+         //Now queue them to the host app(s), without holding up the next batch
+         if(vc_notify_dispatch_post(&state->dispatcher, batch, count) == 0) {
+            for(i = 0; i < count; i++)
+               vcos_log_info("TV service: No callback handler specified, callback [%s] swallowed",
+                             vc_tv_notifcation_name(batch[i].reason));
          }
-      } while(success == 0 && state->notify_length >= sizeof(uint32_t)*3); //read the next message if any
+      } while(success == 0); //read the next batch if any
    } //while (1)
    
    if(state->to_exit)
@@ -812,6 +988,22 @@ static void *tvservice_notify_func(void *arg) {
    return 0;
 }
 
+/***********************************************************
+ * Name: tvservice_notify_deliver
+ *
+ * Arguments: callback, its context, notification
+ *
+ * Description: Called on a subscriber's own thread to pass
+ *              a notification to its callback
+ *
+ * Returns: -
+ *
+ ***********************************************************/
+static void tvservice_notify_deliver(VC_NOTIFY_CALLBACK_T callback, void *callback_data,
+                                     const VC_NOTIFY_T *notify) {
+   ((TVSERVICE_CALLBACK_T) callback)(callback_data, notify->reason, notify->param[0], notify->param[1]);
+}
+
 /***********************************************************
  Actual TV service API starts here
 ***********************************************************/
@@ -830,17 +1022,36 @@ static void *tvservice_notify_func(void *arg) {
  ***********************************************************/
 VCHPRE_ int VCHPOST_ vc_tv_get_state(TV_GET_STATE_RESP_T *tvstate) {
    int success = -1;
+   uint32_t generation;
 
    vcos_log_trace("[%s]", VCOS_FUNCTION);
-   if(vcos_verify(tvstate)) {
-      success = tvservice_send_command_reply( VC_TV_GET_STATE, NULL, 0,
-                                              tvstate, sizeof(TV_GET_STATE_RESP_T));
-      if(success == 0) {
-         tvstate->state = VC_VTOH32(tvstate->state);
-         tvstate->width = VC_VTOH32(tvstate->width);
-         tvstate->height = VC_VTOH32(tvstate->height);
-         tvstate->frame_rate = VC_VTOH16(tvstate->frame_rate);
-         tvstate->scan_mode = VC_VTOH16(tvstate->scan_mode);
+   //Served from the cache until the next notification or state changing command
+   if(vcos_verify(tvstate) && tvservice_cache_lock() == 0) {
+      generation = tvservice_client.cache_generation;
+      if(tvservice_client.tvstate_cache_valid) {
+         *tvstate = tvservice_client.tvstate_cache;
+         success = 0;
+      }
+      tvservice_cache_unlock();
+
+      if(success != 0) {
+         success = tvservice_send_command_reply( VC_TV_GET_STATE, NULL, 0,
+                                                 tvstate, sizeof(TV_GET_STATE_RESP_T));
+         if(success == 0) {
+            tvstate->state = VC_VTOH32(tvstate->state);
+            tvstate->width = VC_VTOH32(tvstate->width);
+            tvstate->height = VC_VTOH32(tvstate->height);
+            tvstate->frame_rate = VC_VTOH16(tvstate->frame_rate);
+            tvstate->scan_mode = VC_VTOH16(tvstate->scan_mode);
+
+            if(tvservice_cache_lock() == 0) {
+               if(generation == tvservice_client.cache_generation) {
+                  tvservice_client.tvstate_cache = *tvstate;
+                  tvservice_client.tvstate_cache_valid = 1;
+               }
+               tvservice_cache_unlock();
+            }
+         }
       }
    }
    return success;
@@ -1025,6 +1236,7 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_get_supported_modes(HDMI_RES_GROUP_T group,
    TVSERVICE_MODE_CACHE_T *cache = NULL;
    int error = 0;
    int modes_copied = 0;
+   uint32_t generation = 0;
 
    vcos_log_trace("[%s]", VCOS_FUNCTION);
 
@@ -1049,6 +1261,11 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_get_supported_modes(HDMI_RES_GROUP_T group,
          VCOS_FUNCTION, group, cache->is_valid);
 
    if(!cache->is_valid) {
+      if(tvservice_cache_lock() != 0)
+         return -1;
+      generation = tvservice_client.cache_generation;
+      tvservice_cache_unlock();
+
       /* response needs to be 16 bytes aligned */
       response = vcos_malloc_aligned(sizeof(TV_QUERY_SUPPORTED_MODES_RESP_T), 16, "VC_TV response");
       error = !vcos_verify(response);
@@ -1061,11 +1278,13 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_get_supported_modes(HDMI_RES_GROUP_T group,
          error = tvservice_wait_for_bulk_receive(response, sizeof(TV_QUERY_SUPPORTED_MODES_RESP_T));
       vchi_service_release(tvservice_client.client_handle[0]);
 
-      if(!error) {
+      if(!error && tvservice_cache_lock() == 0) {
          uint32_t i;
 
          response->num_supported_modes = VC_VTOH32(response->num_supported_modes);
-         if(vcos_verify(response->num_supported_modes <= TV_MAX_SUPPORTED_MODES)) {
+         //Don't cache a list which raced with a hotplug notification
+         if(generation == tvservice_client.cache_generation &&
+            vcos_verify(response->num_supported_modes <= TV_MAX_SUPPORTED_MODES)) {
 
             cache->is_valid = 1;
             vcos_log_trace("[%s] cached resolutions", VCOS_FUNCTION);
@@ -1082,6 +1301,7 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_get_supported_modes(HDMI_RES_GROUP_T group,
             tvservice_client.hdmi_preferred_group = VC_VTOH32(response->preferred_group);
             tvservice_client.hdmi_preferred_mode  = VC_VTOH32(response->preferred_mode);
          }
+         tvservice_cache_unlock();
       }
 
       if(response) {
@@ -1116,9 +1336,20 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_get_supported_modes(HDMI_RES_GROUP_T group,
 VCHPRE_ int VCHPOST_ vc_tv_hdmi_mode_supported(HDMI_RES_GROUP_T group,
                                                uint32_t mode) {
    TV_QUERY_MODE_SUPPORT_PARAM_T param = {VC_HTOV32(group), VC_HTOV32(mode)};
+   uint32_t key[TVSERVICE_QUERY_KEY_LEN] = {group, mode, 0, 0};
+   uint32_t generation;
+   int32_t result;
+   int cached;
    vcos_log_trace("[%s]", VCOS_FUNCTION);
 
-   return tvservice_send_command( VC_TV_QUERY_MODE_SUPPORT, &param, sizeof(TV_QUERY_MODE_SUPPORT_PARAM_T), 1);
+   cached = tvservice_query_cache_find(&tvservice_client.mode_support_cache, key, &result, &generation);
+   if(cached == 0)
+      return result;
+
+   result = tvservice_send_command( VC_TV_QUERY_MODE_SUPPORT, &param, sizeof(TV_QUERY_MODE_SUPPORT_PARAM_T), 1);
+   if(result >= 0 && cached > 0)
+      tvservice_query_cache_store(&tvservice_client.mode_support_cache, key, result, generation);
+   return result;
 }
 
 /***********************************************************
@@ -1143,11 +1374,22 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_audio_supported(uint32_t audio_format, uint32_t
                                             VC_HTOV32(num_channels),
                                             VC_HTOV32(fs),
                                             VC_HTOV32(bitrate) };
+   uint32_t key[TVSERVICE_QUERY_KEY_LEN] = {audio_format, num_channels, fs, bitrate};
+   uint32_t generation;
+   int32_t result;
+   int cached;
    vcos_log_trace("[%s]", VCOS_FUNCTION);
    if(!vcos_verify(num_channels > 0 && num_channels <= 8 && fs != EDID_AudioSampleRate_eReferToHeader))
       return -1;
 
-   return tvservice_send_command( VC_TV_QUERY_AUDIO_SUPPORT, &param, sizeof(TV_QUERY_AUDIO_SUPPORT_PARAM_T), 1);
+   cached = tvservice_query_cache_find(&tvservice_client.audio_support_cache, key, &result, &generation);
+   if(cached == 0)
+      return result;
+
+   result = tvservice_send_command( VC_TV_QUERY_AUDIO_SUPPORT, &param, sizeof(TV_QUERY_AUDIO_SUPPORT_PARAM_T), 1);
+   if(result >= 0 && cached > 0)
+      tvservice_query_cache_store(&tvservice_client.audio_support_cache, key, result, generation);
+   return result;
 }
 
 /***********************************************************
@@ -1378,12 +1620,33 @@ VCHPRE_ int VCHPOST_ vc_tv_test_mode_stop( void ) {
 VCHPRE_ int VCHPOST_ vc_tv_hdmi_ddc_read(uint32_t offset, uint32_t length, uint8_t *buffer) {
    int success;
    TV_DDC_READ_PARAM_T param = {VC_HTOV32(offset), VC_HTOV32(length)};
+   TVSERVICE_EDID_CACHE_T *cache = &tvservice_client.edid_cache;
+   uint32_t first_block = offset / TVSERVICE_EDID_BLOCK_SIZE;
+   uint32_t last_block = (offset + length - 1) / TVSERVICE_EDID_BLOCK_SIZE;
+   uint32_t block_mask = 0, generation;
+   int cacheable;
 
    vcos_log_trace("[%s]", VCOS_FUNCTION);
 
    /*if(!vcos_verify(buffer && (((uint32_t) buffer) % 16) == 0))
       return -1;*/
 
+   //EDID does not change until the next hotplug, so blocks already read are served locally
+   cacheable = length > 0 && offset + length > offset &&
+               last_block < TVSERVICE_EDID_CACHE_BLOCKS;
+   if(cacheable)
+      block_mask = ((2u << last_block) - 1) & ~((1u << first_block) - 1);
+
+   if(tvservice_cache_lock() != 0)
+      return 0;
+   generation = tvservice_client.cache_generation;
+   if(cacheable && (cache->valid_blocks & block_mask) == block_mask) {
+      memcpy(buffer, cache->data + offset, length);
+      tvservice_cache_unlock();
+      return length;
+   }
+   tvservice_cache_unlock();
+
    vchi_service_use(tvservice_client.client_handle[0]);
    success = tvservice_send_command( VC_TV_DDC_READ, &param, sizeof(TV_DDC_READ_PARAM_T), 1);
 
@@ -1391,6 +1654,17 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_ddc_read(uint32_t offset, uint32_t length, uint8
       success = tvservice_wait_for_bulk_receive(buffer, length);
    }
    vchi_service_release(tvservice_client.client_handle[0]);
+
+   //Only whole blocks are stored, partial reads still go to VideoCore
+   if(success == 0 && cacheable &&
+      (offset % TVSERVICE_EDID_BLOCK_SIZE) == 0 && (length % TVSERVICE_EDID_BLOCK_SIZE) == 0 &&
+      tvservice_cache_lock() == 0) {
+      if(generation == tvservice_client.cache_generation) {
+         memcpy(cache->data + offset, buffer, length);
+         cache->valid_blocks |= block_mask;
+      }
+      tvservice_cache_unlock();
+   }
    return (success == 0)? length : 0; //Either return the whole block or nothing
 }
 
@@ -1401,6 +1675,11 @@ VCHPRE_ int VCHPOST_ vc_tv_hdmi_ddc_read(uint32_t offset, uint32_t length, uint8
 VCHPRE_ int VCHPOST_ vc_tv_hdmi_set_attached(uint32_t attached)
 {
    vcos_log_trace("[%s] attached %d", VCOS_FUNCTION, attached);
+   //Hotplug driven by the host, the notification may be missing so drop the caches here
+   if(tvservice_cache_lock() == 0) {
+      tvservice_invalidate_caches(&tvservice_client);
+      tvservice_cache_unlock();
+   }
    return tvservice_send_command(VC_TV_SET_ATTACHED, &attached, sizeof(uint32_t), 0);
 }
 
@@ -50,9 +50,11 @@ Private types and defines.
 // number of threads that can use ilcs
 #define ILCS_MAX_WAITING 4
 
-// maximum number of retries to grab a wait slot,
-// before the message is discarded and failure returned.
-#define ILCS_WAIT_TIMEOUT 250
+// the ->wait index is carried in the low bits of each xid, so responses
+// go straight to their slot.  xids for calls without a response use the
+// unused index ILCS_WAIT_XID_MASK.
+#define ILCS_WAIT_XID_SHIFT 3
+#define ILCS_WAIT_XID_MASK ((1<<ILCS_WAIT_XID_SHIFT)-1)
 
 // maximum number of concurrent function calls that can
 // be going at once.  Each function call requires to copy
@@ -62,13 +64,44 @@ Private types and defines.
 #define ILCS_MAX_NUM_MSGS (ILCS_MAX_WAITING+1)
 #define ILCS_MSG_INUSE_MASK ((1<<ILCS_MAX_NUM_MSGS)-1)
 
+// maximum number of payload elements following the function data
+// in a single message: the split header and trailer of a bulk buffer,
+// each as data, padding and length
+#define ILCS_MAX_ELEMENTS 6
+
+// largest buffer payload that fits in a message alongside its header
+#define ILCS_MAX_INLINE_DATA ((int) (VC_ILCS_MAX_INLINE - sizeof(IL_PASS_BUFFER_EXECUTE_T)))
+
 typedef struct {
-   int xid;
+   uint32_t xid;
    void *resp;
    int *rlen;
    VCOS_EVENT_T event;
 } ILCS_WAIT_T;
 
+// number of threads delivering deferred callbacks.  All callbacks for
+// one key go to the same worker, so they are delivered in order.
+#define ILCS_MAX_WORKERS 2
+
+typedef struct ILCS_DEFERRED_T {
+   struct ILCS_DEFERRED_T *next;
+   ILCS_DEFER_FN_T fn;
+   void *key;
+   uint32_t timestamp; // vcos_getmicrosecs() when queued
+   uint64_t data[ILCS_MAX_DEFER_DATA/8];
+} ILCS_DEFERRED_T;
+
+typedef struct {
+   struct ILCS_SERVICE_T *st;
+   VCOS_THREAD_T thread;
+   VCOS_EVENT_T work; // signalled when a callback is queued, or to quit
+   VCOS_SEMAPHORE_T done; // posted for each flush waiter when ->running returns
+   ILCS_DEFERRED_T *head, *tail;
+   void *running; // key of the callback in progress, if any
+   int flush_waiters;
+   int quit;
+} ILCS_WORKER_T;
+
 typedef enum {
    NORMAL_SERVICE  = 0,  // process all messages
    ABORTED_BULK    = 1,  // reject incoming calls
@@ -85,10 +118,7 @@ struct ILCS_SERVICE_T {
    VCHIQ_STATE_T *vchiq;
 #endif
    int fourcc;
-   VCOS_TIMER_T timer;
-   volatile int timer_expired;
    VCOS_THREAD_T thread;
-   int timer_needed;
    ILCS_QUIT_T kill_service;
    int use_memmgr;
 
@@ -99,16 +129,32 @@ struct ILCS_SERVICE_T {
    VCOS_EVENT_T bulk_rx;
 
    VCOS_SEMAPHORE_T send_sem; // for making control+bulk serialised
-   VCOS_MUTEX_T wait_mtx; // for protecting ->wait and ->next_xid
+   VCOS_MUTEX_T wait_mtx; // for protecting ->wait, ->free_wait and ->next_xid
    ILCS_WAIT_T wait[ILCS_MAX_WAITING];
-   int next_xid;
-   VCOS_EVENT_T wait_event;  // for signalling when a wait becomes free
+   int free_wait[ILCS_MAX_WAITING]; // stack of unused ->wait indices
+   int num_free_wait;
+   uint32_t next_xid;
+   VCOS_SEMAPHORE_T wait_sem; // counts unused ->wait entries
+   int thread_needs_wait; // ilcs thread is reading messages until a ->wait is freed
+   int thread_waits; // ->wait entries held by nested calls on the ilcs thread
+
+   int inline_max; // largest buffer payload sent within the message
+
+   uint32_t in_place; // bit per function whose handler runs from the vchiq message
+
+   VCOS_MUTEX_T defer_mtx; // for the worker queues, ->defer_free and ->callback_stats
+   int num_workers; // started on first use, -1 if they could not be
+   ILCS_WORKER_T worker[ILCS_MAX_WORKERS];
+   ILCS_DEFERRED_T *defer_free;
+   uint32_t defer_pending;
+   ILCS_CALLBACK_STATS_T callback_stats;
 
    // don't need locking around msg_inuse as only touched by
    // the server thread in ilcs_process_message
    unsigned int msg_inuse;
    unsigned char msg[ILCS_MAX_NUM_MSGS][VCHIQ_SLOT_SIZE];
    uint32_t header_array[(sizeof(VCHIQ_HEADER_T)+8)/4];
+   uint32_t wake_header_array[(sizeof(VCHIQ_HEADER_T)+8)/4];
 };
 
 /******************************************************************************
@@ -124,10 +170,11 @@ static void *ilcs_task(void *param);
 static void ilcs_response(ILCS_SERVICE_T *st, uint32_t xid, const unsigned char *msg, int len );
 static void ilcs_transmit(ILCS_SERVICE_T *st, uint32_t cmd, uint32_t xid,
                           const unsigned char *msg, int len,
-                          const unsigned char *msg2, int len2);
+                          const VCHIQ_ELEMENT_T *vec2, int count2);
 static void ilcs_command(ILCS_SERVICE_T *st, uint32_t cmd, uint32_t xid, unsigned char *msg, int len);
-static void ilcs_timer(void *param);
 static int ilcs_process_message(ILCS_SERVICE_T *st, int block);
+static void ilcs_stop_workers(ILCS_SERVICE_T *st);
+static int ilcs_reserve_deferred(ILCS_SERVICE_T *st);
 
 /* ----------------------------------------------------------------------
  * initialise OpenMAX IL component service
@@ -155,6 +202,8 @@ ILCS_SERVICE_T *ilcs_init(VCHIQ_STATE_T *state, void **connection, ILCS_CONFIG_T
    // buffer pointers, otherwise we interpret them to be real pointers
    st->use_memmgr = use_memmgr;
 
+   st->inline_max = ILCS_MAX_INLINE_DATA;
+
    // create semaphore for protecting wait/xid structures
    if(vcos_mutex_create(&st->wait_mtx, "ILCS") != VCOS_SUCCESS)
       goto fail_all;
@@ -163,20 +212,25 @@ ILCS_SERVICE_T *ilcs_init(VCHIQ_STATE_T *state, void **connection, ILCS_CONFIG_T
    if(vcos_semaphore_create(&st->send_sem, "ILCS", 1) != VCOS_SUCCESS)
       goto fail_send_sem;
 
-   // create event group for signalling when a waiting slot becomes free   
-   if(vcos_event_create(&st->wait_event, "ILCS") != VCOS_SUCCESS)
-      goto fail_wait_event;
+   // create semaphore counting the free waiting slots
+   vcos_static_assert(ILCS_MAX_WAITING <= ILCS_WAIT_XID_MASK);
+   if(vcos_semaphore_create(&st->wait_sem, "ILCS", ILCS_MAX_WAITING) != VCOS_SUCCESS)
+      goto fail_wait_sem;
 
    for(i=0; i<ILCS_MAX_WAITING; i++)
+   {
       if(vcos_event_create(&st->wait[i].event, "ILCS") != VCOS_SUCCESS)
       {
          while(--i >= 0)
             vcos_event_delete(&st->wait[i].event);
          goto fail_wait_events;
       }
+      st->free_wait[st->num_free_wait++] = i;
+   }
 
-   if(vcos_timer_create(&st->timer, "ILCS", ilcs_timer, st) != VCOS_SUCCESS)
-      goto fail_timer;
+   // create the lock for deferred callbacks, the workers start on first use
+   if(vcos_mutex_create(&st->defer_mtx, "ILCS") != VCOS_SUCCESS)
+      goto fail_defer_mtx;
 
    // create the queue of incoming messages
    if(!vchiu_queue_init(&st->queue, 64))
@@ -241,13 +295,13 @@ ILCS_SERVICE_T *ilcs_init(VCHIQ_STATE_T *state, void **connection, ILCS_CONFIG_T
  fail_bulk_event:
    vchiu_queue_delete(&st->queue);
  fail_queue:
-   vcos_timer_delete(&st->timer);
- fail_timer:
+   vcos_mutex_delete(&st->defer_mtx);
+ fail_defer_mtx:
    for(i=0; i<ILCS_MAX_WAITING; i++)
       vcos_event_delete(&st->wait[i].event);
  fail_wait_events:
-   vcos_event_delete(&st->wait_event);
- fail_wait_event:
+   vcos_semaphore_delete(&st->wait_sem);
+ fail_wait_sem:
    vcos_semaphore_delete(&st->send_sem);
  fail_send_sem:
    vcos_mutex_delete(&st->wait_mtx);
@@ -275,12 +329,13 @@ static void ilcs_send_quit(ILCS_SERVICE_T *st)
          
    vchiu_queue_push(&st->queue, header);
 
-   // force all currently waiting clients to wake up
+   // force all currently waiting clients to wake up.  Anyone waiting
+   // for a free slot passes the wakeup on, see ilcs_get_wait
    for(i=0; i<ILCS_MAX_WAITING; i++)
       if(st->wait[i].resp)
          vcos_event_signal(&st->wait[i].event);
 
-   vcos_event_signal(&st->wait_event);
+   vcos_semaphore_post(&st->wait_sem);
 }
 
 /* ----------------------------------------------------------------------
@@ -297,18 +352,6 @@ void ilcs_deinit(ILCS_SERVICE_T *st)
    vcos_free(st);
 }
 
-/* ----------------------------------------------------------------------
- * sets the wait event, to timeout blocked threads
- * -------------------------------------------------------------------- */
-static void ilcs_timer(void *param)
-{
-   ILCS_SERVICE_T *st = (ILCS_SERVICE_T *) param;
-
-   vcos_assert(st->timer_expired == 0);
-   st->timer_expired = 1;
-   vcos_event_signal(&st->wait_event);
-}
-
 /* ----------------------------------------------------------------------
  * returns pointer to common object
  * -------------------------------------------------------------------- */
@@ -409,16 +452,17 @@ static void *ilcs_task(void *param)
       ilcs_process_message(st, 1);
 
    // tidy up after ourselves
+   ilcs_stop_workers(st);
    st->config.ilcs_common_deinit(st->ilcs_common);
 #ifdef USE_VCHIQ_ARM
    vchiq_remove_service(st->service);
 #endif
    vcos_event_delete(&st->bulk_rx);
    vchiu_queue_delete(&st->queue);
-   vcos_timer_delete(&st->timer);
+   vcos_mutex_delete(&st->defer_mtx);
    for(i=0; i<ILCS_MAX_WAITING; i++)
       vcos_event_delete(&st->wait[i].event);
-   vcos_event_delete(&st->wait_event);
+   vcos_semaphore_delete(&st->wait_sem);
    vcos_semaphore_delete(&st->send_sem);
    vcos_mutex_delete(&st->wait_mtx);
 
@@ -458,6 +502,10 @@ static int ilcs_process_message(ILCS_SERVICE_T *st, int block)
 
    header = vchiu_queue_pop(&st->queue);
 
+   // just a nudge from ilcs_put_wait, the caller will check for a free slot
+   if(header == (VCHIQ_HEADER_T *) st->wake_header_array)
+      return 1;
+
    msg = (unsigned char *) header->data;
 
    cmd = UINT32(msg);
@@ -479,6 +527,18 @@ static int ilcs_process_message(ILCS_SERVICE_T *st, int block)
    {
       return 1;
    }
+   else if(cmd < IL_FUNCTION_MAX_NUM && (st->in_place & (1<<cmd)) && ilcs_reserve_deferred(st))
+   {
+      // the handler neither blocks nor calls back into ilcs, and a worker
+      // will make its callback, so there is no need to copy the message out
+      // of the vchiq slot first
+      ilcs_command(st, cmd, xid, msg, msg_len);
+#ifdef USE_VCHIQ_ARM
+      vchiq_release_message(st->service, header);
+#else
+      vchiq_release_message(st->vchiq, header);
+#endif
+   }
    else
    {
       // we can only handle commands if we have space to copy the message first
@@ -518,19 +578,17 @@ static int ilcs_process_message(ILCS_SERVICE_T *st, int block)
  * -------------------------------------------------------------------- */
 static void ilcs_response(ILCS_SERVICE_T *st, uint32_t xid, const unsigned char *msg, int len)
 {
-   ILCS_WAIT_T *wait;
-   int i, copy = len;
+   ILCS_WAIT_T *wait = NULL;
+   uint32_t i = xid & ILCS_WAIT_XID_MASK;
+   int copy = len;
 
    // atomically retrieve given ->wait entry
    vcos_mutex_lock(&st->wait_mtx);
-   for (i=0; i<ILCS_MAX_WAITING; i++) {
+   if(i < ILCS_MAX_WAITING && st->wait[i].resp && st->wait[i].xid == xid)
       wait = &st->wait[i];
-      if(wait->resp && wait->xid == xid)
-         break;
-   }
    vcos_mutex_unlock(&st->wait_mtx);
 
-   if(i == ILCS_MAX_WAITING) {
+   if(wait == NULL) {
       // something bad happened, someone has sent a response back
       // when the caller said they weren't expecting a response
       vcos_assert(0);
@@ -555,11 +613,13 @@ static void ilcs_response(ILCS_SERVICE_T *st, uint32_t xid, const unsigned char
  * -------------------------------------------------------------------- */
 static void ilcs_transmit(ILCS_SERVICE_T *st, uint32_t cmd, uint32_t xid,
                           const unsigned char *msg, int len,
-                          const unsigned char *msg2, int len2)
+                          const VCHIQ_ELEMENT_T *vec2, int count2)
 {
-   VCHIQ_ELEMENT_T vec[4];
+   VCHIQ_ELEMENT_T vec[3+ILCS_MAX_ELEMENTS];
    int32_t count = 3;
 
+   vcos_assert(count2 <= ILCS_MAX_ELEMENTS);
+
    vec[0].data = &cmd;
    vec[0].size = sizeof(cmd);
    vec[1].data = &xid;
@@ -567,12 +627,8 @@ static void ilcs_transmit(ILCS_SERVICE_T *st, uint32_t cmd, uint32_t xid,
    vec[2].data = msg;
    vec[2].size = len;
 
-   if(msg2)
-   {
-      vec[3].data = msg2;
-      vec[3].size = len2;
-      count++;
-   }
+   while(count2-- > 0)
+      vec[count++] = *vec2++;
 
 #ifdef USE_VCHIQ_ARM
    vchiq_queue_message(st->service, vec, count);
@@ -628,115 +684,148 @@ ilcs_command(ILCS_SERVICE_T *st, uint32_t cmd, uint32_t xid, unsigned char *msg,
       ilcs_transmit(st, IL_RESPONSE, xid, rbuf, rlen, NULL, 0);
 }
 
+/* ----------------------------------------------------------------------
+ * claim an unused ->wait entry, if block is set waiting until one is free.
+ * returns 0 with wait_mtx held, 1 if none is free and block is not set,
+ * or -1 if the service is closing.
+ * -------------------------------------------------------------------- */
+static int ilcs_get_wait(ILCS_SERVICE_T *st, int block, ILCS_WAIT_T **wait)
+{
+   if(!block)
+   {
+      if(vcos_semaphore_trywait(&st->wait_sem) != VCOS_SUCCESS)
+         return 1;
+      vcos_mutex_lock(&st->wait_mtx);
+      if(vcos_thread_current() == &st->thread)
+         st->thread_waits++;
+   }
+   else if(vcos_thread_current() != &st->thread)
+   {
+      vcos_semaphore_wait(&st->wait_sem);
+      vcos_mutex_lock(&st->wait_mtx);
+   }
+   else
+   {
+      // the ilcs thread can't just block: the responses that free up
+      // the slots are only read by this thread (the client can make an
+      // OMX call from one of the callbacks).  So keep handling messages,
+      // and have ilcs_put_wait nudge the message queue when a slot is freed.
+      vcos_mutex_lock(&st->wait_mtx);
+      if(st->thread_waits == ILCS_MAX_WAITING)
+      {
+         // every slot belongs to a call further up our own stack,
+         // none of which can complete until this one does
+         vcos_mutex_unlock(&st->wait_mtx);
+         vcos_assert(0);
+         return -1;
+      }
+      while(vcos_semaphore_trywait(&st->wait_sem) != VCOS_SUCCESS)
+      {
+         st->thread_needs_wait = 1;
+         vcos_mutex_unlock(&st->wait_mtx);
+
+         ilcs_process_message(st, 1);
+         if(st->kill_service >= CLOSED_CALLBACK)
+            return -1;
+
+         vcos_mutex_lock(&st->wait_mtx);
+      }
+      st->thread_needs_wait = 0;
+      st->thread_waits++;
+   }
+
+   if(st->kill_service)
+   {
+      // woken by ilcs_send_quit, pass it on to the next waiter
+      if(vcos_thread_current() == &st->thread)
+         st->thread_waits--;
+      vcos_mutex_unlock(&st->wait_mtx);
+      vcos_semaphore_post(&st->wait_sem);
+      return -1;
+   }
+
+   vcos_assert(st->num_free_wait > 0);
+   *wait = &st->wait[st->free_wait[--st->num_free_wait]];
+   return 0;
+}
+
+/* ----------------------------------------------------------------------
+ * return a ->wait entry claimed with ilcs_get_wait
+ * -------------------------------------------------------------------- */
+static void ilcs_put_wait(ILCS_SERVICE_T *st, ILCS_WAIT_T *wait)
+{
+   int nudge;
+
+   vcos_mutex_lock(&st->wait_mtx);
+   wait->resp = NULL;
+   st->free_wait[st->num_free_wait++] = wait - st->wait;
+   if(vcos_thread_current() == &st->thread)
+      st->thread_waits--;
+   vcos_semaphore_post(&st->wait_sem);
+   nudge = st->thread_needs_wait;
+   st->thread_needs_wait = 0;
+   vcos_mutex_unlock(&st->wait_mtx);
+
+   if(nudge)
+   {
+      VCHIQ_HEADER_T *header = (VCHIQ_HEADER_T *)st->wake_header_array;
+      header->size = 0;
+      vchiu_queue_push(&st->queue, header);
+   }
+}
+
 /**
  * send a string to the host side IL component service.  if resp is NULL
  * then there is no response to this call, so we should not wait for one.
  *
- * returns 0 on successful call made, -1 on failure to send call.
- * on success, the response is written to 'resp' pointer
+ * returns 0 on successful call made, -1 on failure to send call, or 1
+ * if block is not set and no ->wait entry is free.  on success *pwait is
+ * the entry to pass to ilcs_wait_function, or NULL if resp is NULL; the
+ * response is written to 'resp' pointer once that returns.
  *
  * @param data            function parameter data
  * @param len             length of function parameter data
- * @param data            optional second function parameter data
- * @param len2            length of second function parameter data
+ * @param vec2            optional further function parameter data
+ * @param count2          number of elements in vec2
  * @param msg_mem_handle  option mem handle to be sent as part of msg data
  * @param msg_offset      Offset with msg mem handle
  * @param msg_len         Length of msg mem handle
  * @param bulk_mem_handle Mem handle sent using VCHI bulk transfer
  * @param bulk_offset     Offset within memory handle
  * @param bulk_len        Length of bulk transfer
+ * @param block           Wait for a free ->wait entry if none available
  * 
  * -------------------------------------------------------------------- */
 
-static int ilcs_execute_function_ex(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
-                                    void *data, int len, 
-                                    void *data2, int len2,
-                                    VCHI_MEM_HANDLE_T bulk_mem_handle, void *bulk_offset, int bulk_len,
-                                    void *resp, int *rlen)
+static int ilcs_send_function(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
+                              void *data, int len, 
+                              const VCHIQ_ELEMENT_T *vec2, int count2,
+                              VCHI_MEM_HANDLE_T bulk_mem_handle, void *bulk_offset, int bulk_len,
+                              void *resp, int *rlen, int block, ILCS_WAIT_T **pwait)
 {
    ILCS_WAIT_T *wait = NULL;
-   int num = 0;
    uint32_t xid;
 
+   *pwait = NULL;
    if(st->kill_service)
       return -1;
 
-   // need to atomically find free ->wait entry
-   vcos_mutex_lock(&st->wait_mtx);
-
    // if resp is NULL, we do not expect any response
-   if(resp == NULL) {
-      xid = st->next_xid++;
+   if(resp == NULL)
+   {
+      vcos_mutex_lock(&st->wait_mtx);
+      xid = (st->next_xid++ << ILCS_WAIT_XID_SHIFT) | ILCS_WAIT_XID_MASK;
    }
    else
    {
-      int i;
-
-      if(st->timer_needed++ == 0)
-      {
-         vcos_timer_set(&st->timer, 10);
-      }
-
-      // we try a number of times then give up with an error message
-      // rather than just deadlocking
-
-      // Note: the real reason for the timeout is nothing to do with hardware
-      // errors, but is to ensure that if the ILCS thread is calling this function
-      // (because the client makes an OMX call from one of the callbacks) then
-      // the queue of messages from VideoCore still gets serviced.
+      int status = ilcs_get_wait(st, block, &wait);
+      if(status != 0)
+         return status;
 
-      for (i=0; i<ILCS_WAIT_TIMEOUT; i++) {
-         num = 0;
-         
-         while(num < ILCS_MAX_WAITING && st->wait[num].resp != NULL)
-            num++;
-         
-         if(num < ILCS_MAX_WAITING || i == ILCS_WAIT_TIMEOUT-1)
-            break;
-         
-         // the previous time round this loop, we woke up because the timer
-         // expired, so restart it
-         if (st->timer_expired)
-         {
-            st->timer_expired = 0;
-            vcos_timer_set(&st->timer, 10);
-         }
-
-         // might be a fatal error if another thread is relying
-         // on this call completing before it can complete
-         // we'll pause until we can carry on and hope that's sufficient.
-         vcos_mutex_unlock(&st->wait_mtx);
-
-         vcos_event_wait(&st->wait_event);
-
-         // if we're the ilcs thread, then the waiters might need
-         // us to handle their response, so try and clear those now
-         if(vcos_thread_current() == &st->thread)
-            while(ilcs_process_message(st, 0))
-               if(st->kill_service >= CLOSED_CALLBACK)
-                  return -1;
-
-         vcos_mutex_lock(&st->wait_mtx);
-      }
-
-      if(--st->timer_needed == 0)
-      {
-         vcos_timer_cancel(&st->timer);
-         st->timer_expired = 0;
-      }
-
-      if(num == ILCS_MAX_WAITING)
-      {
-         // failed to send message.
-         vcos_mutex_unlock(&st->wait_mtx);
-         return -1;
-      }
-
-      wait = &st->wait[num];
-      
+      // ilcs_get_wait returns with wait_mtx held
       wait->resp = resp;
       wait->rlen = rlen;
-      xid = wait->xid = st->next_xid++;
+      xid = wait->xid = (st->next_xid++ << ILCS_WAIT_XID_SHIFT) | (wait - st->wait);
    }
 
    vcos_mutex_unlock(&st->wait_mtx);
@@ -744,7 +833,7 @@ static int ilcs_execute_function_ex(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
    if(bulk_len != 0)
       vcos_semaphore_wait(&st->send_sem);
 
-   ilcs_transmit(st, func, xid, data, len, data2, len2);
+   ilcs_transmit(st, func, xid, data, len, vec2, count2);
       
    if(bulk_len != 0)
    {
@@ -756,12 +845,17 @@ static int ilcs_execute_function_ex(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
       vcos_semaphore_post(&st->send_sem);
    }
 
-   if(!wait)
-   {
-      // nothing more to do
-      return 0;
-   }
+   *pwait = wait;
+   return 0;
+}
 
+/* ----------------------------------------------------------------------
+ * wait for the response to a call made with ilcs_send_function, and
+ * release its ->wait entry.
+ * returns 0 on success, -1 if the service closed first.
+ * -------------------------------------------------------------------- */
+static int ilcs_wait_function(ILCS_SERVICE_T *st, ILCS_WAIT_T *wait)
+{
    if(vcos_thread_current() != &st->thread)
    {
       // block waiting for response
@@ -786,36 +880,459 @@ static int ilcs_execute_function_ex(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
       }
    }
 
-   // safe to do the following - the assignment of NULL is effectively atomic
-   wait->resp = NULL;
-   vcos_event_signal(&st->wait_event);
+   ilcs_put_wait(st, wait);
 
    return st->kill_service >= CLOSED_CALLBACK ? -1 : 0;
 }
 
+static int ilcs_execute_function_ex(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
+                                    void *data, int len, 
+                                    const VCHIQ_ELEMENT_T *vec2, int count2,
+                                    VCHI_MEM_HANDLE_T bulk_mem_handle, void *bulk_offset, int bulk_len,
+                                    void *resp, int *rlen)
+{
+   ILCS_WAIT_T *wait;
+
+   if(ilcs_send_function(st, func, data, len, vec2, count2, bulk_mem_handle, bulk_offset, bulk_len,
+                         resp, rlen, 1, &wait) < 0)
+      return -1;
+
+   if(!wait)
+   {
+      // nothing more to do
+      return 0;
+   }
+
+   return ilcs_wait_function(st, wait);
+}
+
 int ilcs_execute_function(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *data, int len, void *resp, int *rlen)
 {
    return ilcs_execute_function_ex(st, func, data, len, NULL, 0, VCHI_MEM_HANDLE_INVALID, 0, 0, resp, rlen);
 }
 
 /* ----------------------------------------------------------------------
- * send a buffer via the IL component service.
+ * make a number of calls in order, keeping up to ILCS_MAX_WAITING of
+ * them in flight rather than waiting for each response before sending
+ * the next.  Each call's status and rlen are filled in.
+ * returns 0 if every call was made, -1 otherwise.
  * -------------------------------------------------------------------- */
+int ilcs_execute_functions(ILCS_SERVICE_T *st, ILCS_CALL_T *calls, int count)
+{
+   ILCS_WAIT_T *wait[ILCS_MAX_WAITING];
+   int index[ILCS_MAX_WAITING];
+   int head = 0, tail = 0, outstanding = 0, ret = 0, i;
 
-OMX_ERRORTYPE ilcs_pass_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *reference,
-                               OMX_BUFFERHEADERTYPE *pBuffer)                       
+   for(i=0; i<count; i++)
+   {
+      ILCS_CALL_T *call = &calls[i];
+      int status;
+
+      if(outstanding == ILCS_MAX_WAITING)
+      {
+         calls[index[tail]].status = ilcs_wait_function(st, wait[tail]);
+         tail = (tail+1) % ILCS_MAX_WAITING;
+         outstanding--;
+      }
+
+      // as ilcs_pass_buffers, only block for a free ->wait when
+      // there are no responses of our own to collect
+      while((status = ilcs_send_function(st, call->func, call->data, call->len, NULL, 0,
+                                         VCHI_MEM_HANDLE_INVALID, NULL, 0, call->resp, &call->rlen,
+                                         outstanding == 0, &wait[head])) == 1)
+      {
+         calls[index[tail]].status = ilcs_wait_function(st, wait[tail]);
+         tail = (tail+1) % ILCS_MAX_WAITING;
+         outstanding--;
+      }
+
+      call->status = status;
+      if(status == 0 && wait[head] != NULL)
+      {
+         index[head] = i;
+         head = (head+1) % ILCS_MAX_WAITING;
+         outstanding++;
+      }
+   }
+
+   while(outstanding)
+   {
+      calls[index[tail]].status = ilcs_wait_function(st, wait[tail]);
+      tail = (tail+1) % ILCS_MAX_WAITING;
+      outstanding--;
+   }
+
+   for(i=0; i<count; i++)
+      if(calls[i].status < 0)
+         ret = -1;
+
+   return ret;
+}
+
+/* ----------------------------------------------------------------------
+ * set the largest buffer payload that is sent within the message itself,
+ * larger buffers being sent as a bulk transfer.  The limit is clamped to
+ * what fits in a single message; a negative value restores the default.
+ * returns the limit now in use.
+ * -------------------------------------------------------------------- */
+int ilcs_set_inline_threshold(ILCS_SERVICE_T *st, int max)
+{
+   if(max < 0 || max > ILCS_MAX_INLINE_DATA)
+      max = ILCS_MAX_INLINE_DATA;
+
+   st->inline_max = max;
+   return max;
+}
+
+/* ----------------------------------------------------------------------
+ * mark the handler for func as safe to run straight from the received
+ * message: it must not block or make ilcs calls, and may defer at most
+ * one callback.  Must be called before any messages arrive, eg from
+ * ilcs_common_init.
+ * -------------------------------------------------------------------- */
+void ilcs_set_in_place(ILCS_SERVICE_T *st, IL_FUNCTION_T func)
+{
+   vcos_static_assert(IL_FUNCTION_MAX_NUM <= 32);
+   vcos_assert(func < IL_FUNCTION_MAX_NUM);
+   st->in_place |= 1<<func;
+}
+
+/* ----------------------------------------------------------------------
+ * deliver deferred callbacks for the keys hashed to this worker
+ * -------------------------------------------------------------------- */
+static void *ilcs_worker_task(void *param)
+{
+   ILCS_WORKER_T *w = (ILCS_WORKER_T *) param;
+   ILCS_SERVICE_T *st = w->st;
+   ILCS_CALLBACK_STATS_T *stats = &st->callback_stats;
+
+   vcos_mutex_lock(&st->defer_mtx);
+   for (;;)
+   {
+      ILCS_DEFERRED_T *d = w->head;
+      uint32_t start, end;
+
+      if(!d)
+      {
+         if(w->quit)
+            break;
+
+         vcos_mutex_unlock(&st->defer_mtx);
+         vcos_event_wait(&w->work);
+         vcos_mutex_lock(&st->defer_mtx);
+         continue;
+      }
+
+      if((w->head = d->next) == NULL)
+         w->tail = NULL;
+      w->running = d->key;
+      st->defer_pending--;
+      vcos_mutex_unlock(&st->defer_mtx);
+
+      start = vcos_getmicrosecs();
+      d->fn(d->key, d->data);
+      end = vcos_getmicrosecs();
+
+      vcos_mutex_lock(&st->defer_mtx);
+      stats->delivered++;
+      if(end - d->timestamp > stats->max_latency_us)
+         stats->max_latency_us = end - d->timestamp;
+      stats->total_latency_us += end - d->timestamp;
+      if(end - start > stats->max_run_us)
+         stats->max_run_us = end - start;
+
+      w->running = NULL;
+      d->next = st->defer_free;
+      st->defer_free = d;
+
+      while(w->flush_waiters)
+      {
+         w->flush_waiters--;
+         vcos_semaphore_post(&w->done);
+      }
+   }
+   vcos_mutex_unlock(&st->defer_mtx);
+
+   return 0;
+}
+
+/* ----------------------------------------------------------------------
+ * start the callback workers.  called with defer_mtx held.
+ * -------------------------------------------------------------------- */
+static void ilcs_start_workers(ILCS_SERVICE_T *st)
+{
+   VCOS_THREAD_ATTR_T thread_attrs;
+   int i;
+
+   vcos_thread_attr_init(&thread_attrs);
+   vcos_thread_attr_setstacksize(&thread_attrs, 4096);
+
+   for(i=0; i<ILCS_MAX_WORKERS; i++)
+   {
+      ILCS_WORKER_T *w = &st->worker[i];
+
+      memset(w, 0, sizeof(ILCS_WORKER_T));
+      w->st = st;
+
+      if(vcos_event_create(&w->work, "ILCS") != VCOS_SUCCESS)
+         break;
+
+      if(vcos_semaphore_create(&w->done, "ILCS", 0) != VCOS_SUCCESS)
+      {
+         vcos_event_delete(&w->work);
+         break;
+      }
+
+      if(vcos_thread_create(&w->thread, "ILCS_CB", &thread_attrs, ilcs_worker_task, w) != VCOS_SUCCESS)
+      {
+         vcos_semaphore_delete(&w->done);
+         vcos_event_delete(&w->work);
+         break;
+      }
+   }
+
+   // callbacks are made on the ilcs thread if none could be started
+   st->num_workers = i ? i : -1;
+}
+
+/* ----------------------------------------------------------------------
+ * stop the callback workers once they have delivered everything queued.
+ * called on the ilcs thread as it exits, so nothing more is queued.
+ * -------------------------------------------------------------------- */
+static void ilcs_stop_workers(ILCS_SERVICE_T *st)
+{
+   int i;
+
+   for(i=0; i<st->num_workers; i++)
+   {
+      ILCS_WORKER_T *w = &st->worker[i];
+      void *data;
+
+      vcos_mutex_lock(&st->defer_mtx);
+      w->quit = 1;
+      vcos_mutex_unlock(&st->defer_mtx);
+      vcos_event_signal(&w->work);
+
+      vcos_thread_join(&w->thread, &data);
+      vcos_semaphore_delete(&w->done);
+      vcos_event_delete(&w->work);
+   }
+   st->num_workers = 0;
+
+   while(st->defer_free)
+   {
+      ILCS_DEFERRED_T *d = st->defer_free;
+      st->defer_free = d->next;
+      vcos_free(d);
+   }
+}
+
+/* ----------------------------------------------------------------------
+ * make sure the next ilcs_defer will hand its callback to a worker rather
+ * than calling it directly, which an in-place handler must not do while
+ * the vchiq message is held.  Returns 0 if that can't be guaranteed.
+ * Called on the ilcs thread, the only one that takes from ->defer_free.
+ * -------------------------------------------------------------------- */
+static int ilcs_reserve_deferred(ILCS_SERVICE_T *st)
+{
+   int reserved;
+
+   vcos_mutex_lock(&st->defer_mtx);
+
+   if(st->num_workers == 0)
+      ilcs_start_workers(st);
+
+   if(st->num_workers > 0 && !st->defer_free)
+   {
+      ILCS_DEFERRED_T *d = vcos_malloc(sizeof(ILCS_DEFERRED_T), "ILCS callback");
+      if(d)
+      {
+         d->next = NULL;
+         st->defer_free = d;
+      }
+   }
+
+   reserved = st->num_workers > 0 && st->defer_free;
+   vcos_mutex_unlock(&st->defer_mtx);
+
+   return reserved;
+}
+
+static ILCS_WORKER_T *ilcs_key_worker(ILCS_SERVICE_T *st, void *key)
+{
+   return &st->worker[(((unsigned long) key) >> 4) % st->num_workers];
+}
+
+/* ----------------------------------------------------------------------
+ * called by a handler on the ilcs thread to have fn(key, data) called
+ * from a worker thread instead, so a slow callback does not hold up
+ * other messages.  Callbacks with the same key are made in the order
+ * they were deferred.  len bytes of data are copied.
+ * -------------------------------------------------------------------- */
+void ilcs_defer(ILCS_SERVICE_T *st, void *key, ILCS_DEFER_FN_T fn, const void *data, int len)
 {
+   ILCS_DEFERRED_T *d = NULL;
+   ILCS_WORKER_T *w;
+
+   vcos_assert(len <= ILCS_MAX_DEFER_DATA);
+
+   vcos_mutex_lock(&st->defer_mtx);
+
+   if(st->num_workers == 0)
+      ilcs_start_workers(st);
+
+   if(st->num_workers > 0)
+   {
+      if((d = st->defer_free) != NULL)
+         st->defer_free = d->next;
+      else
+         d = vcos_malloc(sizeof(ILCS_DEFERRED_T), "ILCS callback");
+   }
+
+   if(!d)
+   {
+      uint64_t copy[ILCS_MAX_DEFER_DATA/8];
+
+      st->callback_stats.direct++;
+      vcos_mutex_unlock(&st->defer_mtx);
+
+      memcpy(copy, data, len);
+      fn(key, copy);
+      return;
+   }
+
+   d->next = NULL;
+   d->fn = fn;
+   d->key = key;
+   d->timestamp = vcos_getmicrosecs();
+   memcpy(d->data, data, len);
+
+   w = ilcs_key_worker(st, key);
+   if(w->tail)
+      w->tail->next = d;
+   else
+      w->head = d;
+   w->tail = d;
+
+   st->callback_stats.deferred++;
+   if(++st->defer_pending > st->callback_stats.max_pending)
+      st->callback_stats.max_pending = st->defer_pending;
+
+   vcos_mutex_unlock(&st->defer_mtx);
+   vcos_event_signal(&w->work);
+}
+
+/* ----------------------------------------------------------------------
+ * discard any deferred callbacks for key that have not yet started, and
+ * wait for one in progress to return (unless called from within it).
+ * Used before the state the callbacks refer to is freed.
+ * -------------------------------------------------------------------- */
+void ilcs_defer_flush(ILCS_SERVICE_T *st, void *key)
+{
+   ILCS_DEFERRED_T **pd;
+   ILCS_WORKER_T *w;
+
+   vcos_mutex_lock(&st->defer_mtx);
+
+   if(st->num_workers <= 0)
+   {
+      vcos_mutex_unlock(&st->defer_mtx);
+      return;
+   }
+
+   w = ilcs_key_worker(st, key);
+   pd = &w->head;
+   w->tail = NULL;
+   while(*pd)
+   {
+      ILCS_DEFERRED_T *d = *pd;
+      if(d->key == key)
+      {
+         *pd = d->next;
+         d->next = st->defer_free;
+         st->defer_free = d;
+         st->defer_pending--;
+         st->callback_stats.discarded++;
+      }
+      else
+      {
+         w->tail = d;
+         pd = &d->next;
+      }
+   }
+
+   while(w->running == key && vcos_thread_current() != &w->thread)
+   {
+      w->flush_waiters++;
+      vcos_mutex_unlock(&st->defer_mtx);
+      vcos_semaphore_wait(&w->done);
+      vcos_mutex_lock(&st->defer_mtx);
+   }
+
+   vcos_mutex_unlock(&st->defer_mtx);
+}
+
+/* ----------------------------------------------------------------------
+ * copy out the deferred callback statistics
+ * -------------------------------------------------------------------- */
+void ilcs_get_callback_stats(ILCS_SERVICE_T *st, ILCS_CALLBACK_STATS_T *stats)
+{
+   vcos_mutex_lock(&st->defer_mtx);
+   *stats = st->callback_stats;
+   vcos_mutex_unlock(&st->defer_mtx);
+}
+
+/* ----------------------------------------------------------------------
+ * state for a single buffer passed via the IL component service, kept
+ * together so several can be in flight at once.
+ * -------------------------------------------------------------------- */
+typedef struct {
    IL_PASS_BUFFER_EXECUTE_T exe;
-   IL_BUFFER_BULK_T fixup;
+   OMX_U8 headerlen, trailerlen;
+   VCHIQ_ELEMENT_T vec[ILCS_MAX_ELEMENTS];
+   int count;
    IL_RESPONSE_HEADER_T resp;
-   VCHI_MEM_HANDLE_T mem_handle = VCHI_MEM_HANDLE_INVALID;
-   void *ret = NULL, *data2 = NULL, *bulk_offset = NULL;
-   int len2 = 0, bulk_len = 0;
+   int rlen;
+   VCHI_MEM_HANDLE_T mem_handle;
+   void *bulk_offset;
+   int bulk_len;
+   OMX_U8 *ptr;
+   OMX_BUFFERHEADERTYPE *buffer;
+   ILCS_WAIT_T *wait;
+} ILCS_PASS_BUFFER_T;
+
+static const OMX_U8 ilcs_zero_pad[IL_BUFFER_BULK_UNALIGNED_MAX];
+
+/* ----------------------------------------------------------------------
+ * append a payload element to a buffer's message, skipping empty ones.
+ * -------------------------------------------------------------------- */
+static void ilcs_add_element(ILCS_PASS_BUFFER_T *pass, const void *data, int size)
+{
+   if(size > 0)
+   {
+      vcos_assert(pass->count < ILCS_MAX_ELEMENTS);
+      pass->vec[pass->count].data = data;
+      pass->vec[pass->count].size = size;
+      pass->count++;
+   }
+}
+
+/* ----------------------------------------------------------------------
+ * lock the buffer data and work out how to send it: inline, in bulk or
+ * not at all.
+ * -------------------------------------------------------------------- */
+static OMX_ERRORTYPE ilcs_prepare_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *reference,
+                                         OMX_BUFFERHEADERTYPE *pBuffer, ILCS_PASS_BUFFER_T *pass)
+{
    OMX_U8 *ptr = NULL;
-   int rlen = sizeof(resp);
 
-   if(st->kill_service)
-      return OMX_ErrorHardware;
+   pass->rlen = sizeof(pass->resp);
+   pass->mem_handle = VCHI_MEM_HANDLE_INVALID;
+   pass->bulk_offset = NULL;
+   pass->bulk_len = pass->count = 0;
+   pass->ptr = NULL;
+   pass->buffer = pBuffer;
+   pass->wait = NULL;
 
    if((func == IL_EMPTY_THIS_BUFFER && pBuffer->pInputPortPrivate == NULL) ||
       (func == IL_FILL_THIS_BUFFER && pBuffer->pOutputPortPrivate == NULL))
@@ -826,12 +1343,12 @@ OMX_ERRORTYPE ilcs_pass_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *ref
    }
 
    if((pBuffer->nFlags & OMX_BUFFERFLAG_EXTRADATA) || pBuffer->nFilledLen)
-      ptr = st->config.ilcs_mem_lock(pBuffer) + pBuffer->nOffset;
+      ptr = pass->ptr = st->config.ilcs_mem_lock(pBuffer) + pBuffer->nOffset;
 
-   exe.reference = reference;
-   memcpy(&exe.bufferHeader, pBuffer, sizeof(OMX_BUFFERHEADERTYPE));
+   pass->exe.reference = reference;
+   memcpy(&pass->exe.bufferHeader, pBuffer, sizeof(OMX_BUFFERHEADERTYPE));
 
-   exe.bufferLen = pBuffer->nFilledLen;
+   pass->exe.bufferLen = pBuffer->nFilledLen;
    if(pBuffer->nFlags & OMX_BUFFERFLAG_EXTRADATA)
    {
       // walk down extra-data's appended to the buffer data to work out their length
@@ -863,11 +1380,11 @@ OMX_ERRORTYPE ilcs_pass_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *ref
       if(b_corrupt)
          pBuffer->nFlags &= ~OMX_BUFFERFLAG_EXTRADATA;
       else
-         exe.bufferLen = ((uint8_t *) extra) - ptr;
+         pass->exe.bufferLen = ((uint8_t *) extra) - ptr;
    }
 
    // check that the buffer fits in the allocated region
-   if(exe.bufferLen + pBuffer->nOffset > pBuffer->nAllocLen)
+   if(pass->exe.bufferLen + pBuffer->nOffset > pBuffer->nAllocLen)
    {
       if(ptr != NULL)
          st->config.ilcs_mem_unlock(pBuffer);
@@ -875,15 +1392,14 @@ OMX_ERRORTYPE ilcs_pass_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *ref
       return OMX_ErrorBadParameter;
    }
 
-   if(exe.bufferLen)
+   if(pass->exe.bufferLen)
    {
-      if(exe.bufferLen + sizeof(IL_PASS_BUFFER_EXECUTE_T) <= VC_ILCS_MAX_INLINE)
+      if(pass->exe.bufferLen <= (OMX_U32) st->inline_max)
       {
          // Pass the data in the message itself, and avoid doing a bulk transfer at all...
-         exe.method = IL_BUFFER_INLINE;
+         pass->exe.method = IL_BUFFER_INLINE;
 
-         data2 = ptr;
-         len2 = exe.bufferLen;
+         ilcs_add_element(pass, ptr, pass->exe.bufferLen);
       }
       else
       {
@@ -891,53 +1407,168 @@ OMX_ERRORTYPE ilcs_pass_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *ref
          // message, and the bulk of the message using a separate bulk
          // transfer
          const uint8_t *start = ptr;
-         const uint8_t *end   = start + exe.bufferLen;
+         const uint8_t *end   = start + pass->exe.bufferLen;
          const uint8_t *round_start = (const OMX_U8*)ILCS_ROUND_UP(start);
          const uint8_t *round_end   = (const OMX_U8*)ILCS_ROUND_DOWN(end);
 
-         exe.method = IL_BUFFER_BULK;
+         pass->exe.method = IL_BUFFER_BULK;
 
          if(st->use_memmgr)
          {
-            bulk_offset = (void *) (round_start-(ptr-pBuffer->nOffset));
-            mem_handle = (VCHI_MEM_HANDLE_T) pBuffer->pBuffer;
+            pass->bulk_offset = (void *) (round_start-(ptr-pBuffer->nOffset));
+            pass->mem_handle = (VCHI_MEM_HANDLE_T) pBuffer->pBuffer;
          }
          else
-            bulk_offset = (void *) round_start;
-
-         bulk_len = round_end-round_start;
+            pass->bulk_offset = (void *) round_start;
 
-         if((fixup.headerlen = round_start - start) > 0)
-            memcpy(fixup.header, start, fixup.headerlen);
+         pass->bulk_len = round_end-round_start;
 
-         if((fixup.trailerlen = end - round_end) > 0)
-            memcpy(fixup.trailer, round_end, fixup.trailerlen);
+         // build the IL_BUFFER_BULK_T in place from the buffer itself
+         vcos_static_assert(sizeof(IL_BUFFER_BULK_T) == 2*IL_BUFFER_BULK_UNALIGNED_MAX);
+         pass->headerlen = round_start - start;
+         ilcs_add_element(pass, start, pass->headerlen);
+         ilcs_add_element(pass, ilcs_zero_pad, IL_BUFFER_BULK_UNALIGNED_MAX-1 - pass->headerlen);
+         ilcs_add_element(pass, &pass->headerlen, 1);
 
-         data2 = &fixup;
-         len2 = sizeof(fixup);
+         pass->trailerlen = end - round_end;
+         ilcs_add_element(pass, round_end, pass->trailerlen);
+         ilcs_add_element(pass, ilcs_zero_pad, IL_BUFFER_BULK_UNALIGNED_MAX-1 - pass->trailerlen);
+         ilcs_add_element(pass, &pass->trailerlen, 1);
       }
    }
    else 
    {
-      exe.method = IL_BUFFER_NONE;
+      pass->exe.method = IL_BUFFER_NONE;
    }
 
+
+   return OMX_ErrorNone;
+}
+
+/* ----------------------------------------------------------------------
+ * transmit a prepared buffer.  returns as ilcs_send_function.
+ * -------------------------------------------------------------------- */
+static int ilcs_send_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, ILCS_PASS_BUFFER_T *pass, int block)
+{
    // when used for callbacks to client, no need for response
-   // so only set ret when use component to component
-   if(func == IL_EMPTY_THIS_BUFFER || func == IL_FILL_THIS_BUFFER)
-      ret = &resp;
+   // so only ask for one when use component to component
+   void *ret = (func == IL_EMPTY_THIS_BUFFER || func == IL_FILL_THIS_BUFFER) ? &pass->resp : NULL;
+
+   return ilcs_send_function(st, func, &pass->exe, sizeof(IL_PASS_BUFFER_EXECUTE_T),
+                             pass->vec, pass->count, pass->mem_handle, pass->bulk_offset, pass->bulk_len,
+                             ret, &pass->rlen, block, &pass->wait);
+}
+
+/* ----------------------------------------------------------------------
+ * collect the response to a sent buffer, if any, and unlock its data.
+ * status is the result of ilcs_send_buffer.
+ * -------------------------------------------------------------------- */
+static OMX_ERRORTYPE ilcs_finish_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func,
+                                        ILCS_PASS_BUFFER_T *pass, int status)
+{
+   OMX_ERRORTYPE err = OMX_ErrorNone;
+
+   if(status == 0 && pass->wait != NULL)
+      status = ilcs_wait_function(st, pass->wait);
+
+   if(status < 0 || pass->rlen != sizeof(pass->resp))
+      err = OMX_ErrorHardware;
+   else if(func == IL_EMPTY_THIS_BUFFER || func == IL_FILL_THIS_BUFFER)
+      err = pass->resp.err;
+
+   if(pass->ptr != NULL)
+      st->config.ilcs_mem_unlock(pass->buffer);
+
+   return err;
+}
+
+/* ----------------------------------------------------------------------
+ * send a buffer via the IL component service.
+ * -------------------------------------------------------------------- */
+
+OMX_ERRORTYPE ilcs_pass_buffer(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *reference,
+                               OMX_BUFFERHEADERTYPE *pBuffer)                       
+{
+   ILCS_PASS_BUFFER_T pass;
+   OMX_ERRORTYPE err;
+
+   if(st->kill_service)
+      return OMX_ErrorHardware;
+
+   if((err = ilcs_prepare_buffer(st, func, reference, pBuffer, &pass)) != OMX_ErrorNone)
+      return err;
+
+   return ilcs_finish_buffer(st, func, &pass, ilcs_send_buffer(st, func, &pass, 1));
+}
+
+/* ----------------------------------------------------------------------
+ * send a number of buffers via the IL component service, keeping up to
+ * ILCS_MAX_WAITING of them in flight rather than waiting for each
+ * response before sending the next.  The result for buffers[i] is put
+ * in errors[i]; the first error is also returned.
+ * -------------------------------------------------------------------- */
+
+OMX_ERRORTYPE ilcs_pass_buffers(ILCS_SERVICE_T *st, IL_FUNCTION_T func, void *reference,
+                                OMX_BUFFERHEADERTYPE **buffers, int count, OMX_ERRORTYPE *errors)
+{
+   ILCS_PASS_BUFFER_T pass[ILCS_MAX_WAITING];
+   int index[ILCS_MAX_WAITING];
+   int head = 0, tail = 0, outstanding = 0, i;
+
+   for(i=0; i<count; i++)
+   {
+      ILCS_PASS_BUFFER_T *p;
+      int status;
+
+      if(outstanding == ILCS_MAX_WAITING)
+      {
+         // ring is full, retire the oldest
+         errors[index[tail]] = ilcs_finish_buffer(st, func, &pass[tail], 0);
+         tail = (tail+1) % ILCS_MAX_WAITING;
+         outstanding--;
+      }
+
+      if(st->kill_service)
+      {
+         errors[i] = OMX_ErrorHardware;
+         continue;
+      }
+
+      p = &pass[head];
+      if((errors[i] = ilcs_prepare_buffer(st, func, reference, buffers[i], p)) != OMX_ErrorNone)
+         continue;
+
+      // only block for a free ->wait when we have no responses of our
+      // own to collect, otherwise we could be waiting on ourselves
+      while((status = ilcs_send_buffer(st, func, p, outstanding == 0)) == 1)
+      {
+         errors[index[tail]] = ilcs_finish_buffer(st, func, &pass[tail], 0);
+         tail = (tail+1) % ILCS_MAX_WAITING;
+         outstanding--;
+      }
+
+      if(status < 0 || p->wait == NULL)
+         errors[i] = ilcs_finish_buffer(st, func, p, status);
+      else
+      {
+         index[head] = i;
+         head = (head+1) % ILCS_MAX_WAITING;
+         outstanding++;
+      }
+   }
 
-   if(ilcs_execute_function_ex(st, func, &exe, sizeof(IL_PASS_BUFFER_EXECUTE_T),
-                               data2, len2, mem_handle, bulk_offset, bulk_len, ret, &rlen) < 0 || rlen != sizeof(resp))
+   while(outstanding)
    {
-      ret = &resp;
-      resp.err = OMX_ErrorHardware;
+      errors[index[tail]] = ilcs_finish_buffer(st, func, &pass[tail], 0);
+      tail = (tail+1) % ILCS_MAX_WAITING;
+      outstanding--;
    }
 
-   if(ptr != NULL)
-      st->config.ilcs_mem_unlock(pBuffer);
+   for(i=0; i<count; i++)
+      if(errors[i] != OMX_ErrorNone)
+         return errors[i];
 
-   return ret ? resp.err : OMX_ErrorNone;
+   return OMX_ErrorNone;
 }
 
 
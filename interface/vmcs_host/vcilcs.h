@@ -39,6 +39,33 @@ typedef struct ILCS_COMMON_T ILCS_COMMON_T;
 
 typedef void (*IL_FN_T)(ILCS_COMMON_T *st, void *call, int clen, void *resp, int *rlen);
 
+// callback made from an ilcs worker thread, see ilcs_defer
+typedef void (*ILCS_DEFER_FN_T)(void *key, void *data);
+
+// largest data copied with a deferred callback
+#define ILCS_MAX_DEFER_DATA 32
+
+typedef struct ILCS_CALLBACK_STATS_T {
+   uint32_t deferred;         // callbacks queued to a worker
+   uint32_t direct;           // callbacks made on the ilcs thread as no worker was available
+   uint32_t delivered;        // deferred callbacks made
+   uint32_t discarded;        // deferred callbacks dropped by ilcs_defer_flush
+   uint32_t max_pending;      // most deferred callbacks waiting at once
+   uint32_t max_latency_us;   // longest time from queueing to the callback returning
+   uint64_t total_latency_us; // divide by delivered for the average
+   uint32_t max_run_us;       // longest time spent in one callback
+} ILCS_CALLBACK_STATS_T;
+
+// one call made with ilcs_execute_functions
+typedef struct {
+   IL_FUNCTION_T func;
+   void *data;
+   int len;
+   void *resp;                // NULL if no response is wanted
+   int rlen;                  // size of resp, set to the response length
+   int status;                // set to 0, or -1 if the call failed
+} ILCS_CALL_T;
+
 typedef struct {
    IL_FN_T *fns;
    ILCS_COMMON_T *(*ilcs_common_init)(ILCS_SERVICE_T *);
@@ -66,9 +93,26 @@ VCHPRE_ int VCHPOST_ ilcs_thread_current(void *param);
 VCHPRE_ ILCS_COMMON_T *ilcs_get_common(ILCS_SERVICE_T *ilcs);
 
 VCHPRE_ int VCHPOST_ ilcs_execute_function(ILCS_SERVICE_T *ilcs, IL_FUNCTION_T func, void *data, int len, void *resp, int *rlen);
+// makes each call in turn, without waiting for a response before sending the next
+VCHPRE_ int VCHPOST_ ilcs_execute_functions(ILCS_SERVICE_T *ilcs, ILCS_CALL_T *calls, int count);
 VCHPRE_ OMX_ERRORTYPE VCHPOST_ ilcs_pass_buffer(ILCS_SERVICE_T *ilcs, IL_FUNCTION_T func, void *reference, OMX_BUFFERHEADERTYPE *pBuffer);
+VCHPRE_ OMX_ERRORTYPE VCHPOST_ ilcs_pass_buffers(ILCS_SERVICE_T *ilcs, IL_FUNCTION_T func, void *reference, OMX_BUFFERHEADERTYPE **buffers, int count, OMX_ERRORTYPE *errors);
 VCHPRE_ OMX_BUFFERHEADERTYPE * VCHPOST_ ilcs_receive_buffer(ILCS_SERVICE_T *ilcs, void *call, int clen, OMX_COMPONENTTYPE **pComp);
 
+// sets the largest buffer payload passed inline rather than by bulk transfer,
+// clamped to what fits in one message.  returns the value in use.
+VCHPRE_ int VCHPOST_ ilcs_set_inline_threshold(ILCS_SERVICE_T *ilcs, int max);
+
+// marks the handler for func as safe to run from the received message
+// without copying it first; it must not block or make ilcs calls
+VCHPRE_ void VCHPOST_ ilcs_set_in_place(ILCS_SERVICE_T *ilcs, IL_FUNCTION_T func);
+
+// called from a handler to make fn(key, data) on a worker thread, in order per key
+VCHPRE_ void VCHPOST_ ilcs_defer(ILCS_SERVICE_T *ilcs, void *key, ILCS_DEFER_FN_T fn, const void *data, int len);
+// drops deferred callbacks for key not yet made, and waits for one in progress
+VCHPRE_ void VCHPOST_ ilcs_defer_flush(ILCS_SERVICE_T *ilcs, void *key);
+VCHPRE_ void VCHPOST_ ilcs_get_callback_stats(ILCS_SERVICE_T *ilcs, ILCS_CALLBACK_STATS_T *stats);
+
 // bulks are 16 bytes aligned, implicit in use of vchiq
 #define ILCS_ALIGN   16
 
@@ -77,8 +77,25 @@ static ILCS_COMMON_T *vcilcs_common_init(ILCS_SERVICE_T *ilcs)
       return NULL;
    }
 
+   if(vcos_semaphore_create(&st->info_lock, "ILCS info", 1) != VCOS_SUCCESS)
+   {
+      vcos_semaphore_delete(&st->component_lock);
+      vcos_free(st);
+      return NULL;
+   }
+
    st->ilcs = ilcs;
    st->component_list = NULL;
+   st->info_list = NULL;
+   st->names = NULL;
+   st->numNames = 0;
+   st->namesComplete = 0;
+   st->paramCache = 1;
+
+   // these only copy the message contents and defer the client callback
+   // (they run from the message only while a worker can take the callback)
+   ilcs_set_in_place(ilcs, IL_EVENT_HANDLER);
+   ilcs_set_in_place(ilcs, IL_EMPTY_BUFFER_DONE);
    return st;
 }
 
@@ -90,9 +107,25 @@ static void vcilcs_common_deinit(ILCS_COMMON_T *st)
    {
       VC_PRIVATE_COMPONENT_T *comp = st->component_list;
       st->component_list = comp->next;
-      vcos_free(comp);
+      vcil_out_free_component(comp);
    }
 
+   vcos_semaphore_delete(&st->info_lock);
+
+   while(st->info_list)
+   {
+      VC_COMPONENT_INFO_T *info = st->info_list;
+      st->info_list = info->next;
+      if(info->port)
+         vcos_free(info->port);
+      if(info->roles)
+         vcos_free(info->roles);
+      vcos_free(info);
+   }
+
+   if(st->names)
+      vcos_free(st->names);
+
    vcos_free(st);
 }
 
@@ -31,8 +31,30 @@ typedef struct {
    OMX_BOOL bEGL;
    OMX_U32 numBuffers;
    OMX_DIRTYPE dir;
+   // open addressed set of the headers registered on this port
+   OMX_BUFFERHEADERTYPE **buffers;
+   OMX_U32 bufferSlots;
 } VC_PRIVATE_PORT_T;
 
+// Properties of a VideoCore component that do not change between
+// instances, kept for the lifetime of the process once discovered.
+typedef struct VC_COMPONENT_INFO_T {
+   struct VC_COMPONENT_INFO_T *next;
+   char name[128];
+   OMX_U32 numPorts;          // 0 until a creation has reported the layout
+   VC_PRIVATE_PORT_T *port;   // only port and dir are valid
+   int numRoles;              // -1 until the roles have been enumerated
+   char (*roles)[128];
+} VC_COMPONENT_INFO_T;
+
+// A cached GetParameter result, valid while size is non-zero.
+#define VC_PARAM_CACHE_SIZE 8
+typedef struct {
+   OMX_INDEXTYPE index;
+   OMX_U32 size;
+   unsigned char param[VC_ILCS_MAX_PARAM_SIZE];
+} VC_PARAM_CACHE_ENTRY_T;
+
 struct _VC_PRIVATE_COMPONENT_T {
    OMX_COMPONENTTYPE *comp;
    void *reference;
@@ -40,6 +62,15 @@ struct _VC_PRIVATE_COMPONENT_T {
    OMX_CALLBACKTYPE callbacks;
    OMX_PTR callback_state;
    VC_PRIVATE_PORT_T *port;
+   // maps port index - portBase to 1 + offset into port, if not NULL
+   OMX_U16 *portMap;
+   OMX_U32 portBase;
+   OMX_U32 portSpan;
+   VC_COMPONENT_INFO_T *info;
+   // parameter cache, protected by component_lock
+   VC_PARAM_CACHE_ENTRY_T *params;
+   OMX_U32 paramNext;
+   OMX_U32 paramGeneration;
    struct _VC_PRIVATE_COMPONENT_T *next;
 };
 typedef struct _VC_PRIVATE_COMPONENT_T  VC_PRIVATE_COMPONENT_T;
@@ -48,6 +79,15 @@ struct ILCS_COMMON_T {
    VCOS_SEMAPHORE_T component_lock;
    VC_PRIVATE_COMPONENT_T *component_list;
    ILCS_SERVICE_T *ilcs;
+
+   // component name and layout cache, protected by info_lock
+   VCOS_SEMAPHORE_T info_lock;
+   VC_COMPONENT_INFO_T *info_list;
+   char (*names)[128];
+   OMX_U32 numNames;
+   int namesComplete;
+
+   int paramCache;
 };
    
 VCHPRE_ void VCHPOST_ vcilcs_config(ILCS_CONFIG_T *config);
@@ -76,6 +116,11 @@ VCHPRE_ void VCHPOST_ vcil_out_empty_buffer_done(ILCS_COMMON_T *st, void *call,
 VCHPRE_ void VCHPOST_ vcil_out_fill_buffer_done(ILCS_COMMON_T *st, void *call, int clen, void *resp, int *rlen);
 
 // functions used by the host IL core
+struct OMX_TRANSACTIONTYPE;   // see interface/vmcs_host/khronos/IL/OMX_ILCS.h
 VCHPRE_ OMX_ERRORTYPE VCHPOST_ vcil_out_get_debug_information(ILCS_COMMON_T *st, OMX_STRING debugInfo, OMX_S32 *pLen);
 VCHPRE_ OMX_ERRORTYPE VCHPOST_ vcil_out_create_component(ILCS_COMMON_T *st, OMX_HANDLETYPE hComponent, OMX_STRING component_name);
 VCHPRE_ OMX_ERRORTYPE VCHPOST_ vcil_out_component_name_enum(ILCS_COMMON_T *st, OMX_STRING cComponentName, OMX_U32 nNameLength, OMX_U32 nIndex);
+VCHPRE_ void VCHPOST_ vcil_out_free_component(VC_PRIVATE_COMPONENT_T *comp);
+VCHPRE_ void VCHPOST_ vcil_out_set_param_cache(ILCS_COMMON_T *st, int enable);
+VCHPRE_ OMX_ERRORTYPE VCHPOST_ vcil_out_transaction(OMX_HANDLETYPE hComponent, struct OMX_TRANSACTIONTYPE *pTransaction);
+VCHPRE_ OMX_ERRORTYPE VCHPOST_ vcil_out_pass_buffers(OMX_HANDLETYPE hComponent, IL_FUNCTION_T func, OMX_BUFFERHEADERTYPE **ppBuffers, OMX_U32 nCount, OMX_ERRORTYPE *pErrors);
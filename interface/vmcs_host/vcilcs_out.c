@@ -43,6 +43,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 static VC_PRIVATE_PORT_T *find_port(VC_PRIVATE_COMPONENT_T *comp, OMX_U32 nPortIndex)
 {
    OMX_U32 i=0;
+
+   if (comp->portMap)
+   {
+      OMX_U32 offset = nPortIndex - comp->portBase;
+
+      if (offset >= comp->portSpan || comp->portMap[offset] == 0)
+         return NULL;
+
+      return &comp->port[comp->portMap[offset] - 1];
+   }
+
    while (i<comp->numPorts && comp->port[i].port != nPortIndex)
       i++;
 
@@ -52,6 +63,142 @@ static VC_PRIVATE_PORT_T *find_port(VC_PRIVATE_COMPONENT_T *comp, OMX_U32 nPortI
    return NULL;
 }
 
+// Port indices of a component are usually a short contiguous run, so
+// index a table by port number rather than searching.  Components whose
+// ports are spread too widely keep the linear search.
+#define VC_PORT_MAP_MAX 256
+
+static void build_port_map(VC_PRIVATE_COMPONENT_T *comp)
+{
+   OMX_U32 i, lo, hi;
+
+   if (comp->numPorts == 0)
+      return;
+
+   lo = hi = comp->port[0].port;
+   for (i=1; i<comp->numPorts; i++)
+   {
+      if (comp->port[i].port < lo)
+         lo = comp->port[i].port;
+      if (comp->port[i].port > hi)
+         hi = comp->port[i].port;
+   }
+
+   if (hi - lo >= VC_PORT_MAP_MAX && hi - lo >= comp->numPorts * 4)
+      return;
+
+   comp->portMap = vcos_malloc(sizeof(OMX_U16) * (hi - lo + 1), "ILCS port map");
+   if (!comp->portMap)
+      return;
+
+   memset(comp->portMap, 0, sizeof(OMX_U16) * (hi - lo + 1));
+   for (i=0; i<comp->numPorts; i++)
+      comp->portMap[comp->port[i].port - lo] = (OMX_U16) (i + 1);
+
+   comp->portBase = lo;
+   comp->portSpan = hi - lo + 1;
+}
+
+// The set of buffer headers registered on a port, so that buffers passed
+// in can be checked in constant time.  Like numBuffers, it is only changed
+// while buffers are being added to or removed from the port, which the
+// client must not do at the same time as passing that port buffers.
+static OMX_U32 buffer_hash(OMX_BUFFERHEADERTYPE *pBuffer)
+{
+   return (OMX_U32) ((unsigned long) pBuffer >> 3) * 2654435761u;
+}
+
+static int find_buffer(VC_PRIVATE_PORT_T *port, OMX_BUFFERHEADERTYPE *pBuffer)
+{
+   OMX_U32 mask = port->bufferSlots - 1, i;
+
+   if (!port->buffers)
+      return -1;
+
+   for (i = buffer_hash(pBuffer) & mask; port->buffers[i]; i = (i + 1) & mask)
+      if (port->buffers[i] == pBuffer)
+         return (int) i;
+
+   return -1;
+}
+
+static void insert_buffer(VC_PRIVATE_PORT_T *port, OMX_BUFFERHEADERTYPE *pBuffer)
+{
+   OMX_U32 mask = port->bufferSlots - 1, i;
+
+   for (i = buffer_hash(pBuffer) & mask; port->buffers[i]; i = (i + 1) & mask)
+      ;
+   port->buffers[i] = pBuffer;
+}
+
+// make room for one more buffer, keeping the set at most half full
+static int reserve_buffer(VC_PRIVATE_PORT_T *port)
+{
+   OMX_BUFFERHEADERTYPE **old = port->buffers;
+   OMX_U32 slots = port->bufferSlots, i;
+
+   if ((port->numBuffers + 1) * 2 <= slots)
+      return 1;
+
+   port->bufferSlots = slots ? slots * 2 : 8;
+   port->buffers = vcos_malloc(sizeof(OMX_BUFFERHEADERTYPE *) * port->bufferSlots, "ILCS port buffers");
+   if (!port->buffers)
+   {
+      port->buffers = old;
+      port->bufferSlots = slots;
+      return 0;
+   }
+
+   memset(port->buffers, 0, sizeof(OMX_BUFFERHEADERTYPE *) * port->bufferSlots);
+   for (i=0; i<slots; i++)
+      if (old[i])
+         insert_buffer(port, old[i]);
+
+   if (old)
+      vcos_free(old);
+   return 1;
+}
+
+static void remove_buffer(VC_PRIVATE_PORT_T *port, int slot)
+{
+   OMX_U32 mask = port->bufferSlots - 1, i = slot, j = slot;
+
+   // shift later members of the probe run back over the gap, so that
+   // lookups never need tombstones
+   for (;;)
+   {
+      OMX_U32 home;
+
+      j = (j + 1) & mask;
+      if (!port->buffers[j])
+         break;
+
+      home = buffer_hash(port->buffers[j]) & mask;
+      if (((j - home) & mask) >= ((j - i) & mask))
+      {
+         port->buffers[i] = port->buffers[j];
+         i = j;
+      }
+   }
+
+   port->buffers[i] = NULL;
+}
+
+void vcil_out_free_component(VC_PRIVATE_COMPONENT_T *comp)
+{
+   OMX_U32 i;
+
+   for (i=0; i<comp->numPorts; i++)
+      if (comp->port[i].buffers)
+         vcos_free(comp->port[i].buffers);
+
+   if (comp->portMap)
+      vcos_free(comp->portMap);
+   if (comp->params)
+      vcos_free(comp->params);
+   vcos_free(comp);
+}
+
 #ifndef NDEBUG
 static int is_valid_hostside_buffer(OMX_BUFFERHEADERTYPE *pBuf)
 {
@@ -113,7 +260,10 @@ static OMX_ERRORTYPE vcil_out_ComponentDeInit(OMX_IN OMX_HANDLETYPE hComponent)
       }
 
       vcos_semaphore_post(&st->component_lock);
-      vcos_free(comp);
+
+      // drop any callbacks still waiting to be made to the client
+      ilcs_defer_flush(st->ilcs, pComp);
+      vcil_out_free_component(comp);
    }
 
    return resp.err;
@@ -207,6 +357,124 @@ static OMX_ERRORTYPE vcil_out_GetState(OMX_IN  OMX_HANDLETYPE hComponent,
    return resp.err;
 }
 
+// Parameters whose value only changes through calls this component sees
+// (a set, a command, buffer allocation or tunnelling) or with an event
+// from VideoCore, so a GetParameter result can be reused until then.
+// keylen is how many bytes of the structure identify the query: the
+// header plus the port index, and a format index where there is one.
+static const struct {
+   OMX_INDEXTYPE index;
+   OMX_U32 keylen;
+} vcil_out_cached_params[] = {
+   { OMX_IndexParamPortDefinition,         12 },
+   { OMX_IndexParamAudioPortFormat,        16 },
+   { OMX_IndexParamImagePortFormat,        16 },
+   { OMX_IndexParamVideoPortFormat,        16 },
+   { OMX_IndexParamOtherPortFormat,        16 },
+   { OMX_IndexParamAudioInit,               8 },
+   { OMX_IndexParamImageInit,               8 },
+   { OMX_IndexParamVideoInit,               8 },
+   { OMX_IndexParamOtherInit,               8 },
+   { OMX_IndexParamStandardComponentRole,   8 },
+};
+
+static OMX_U32 vcil_out_param_keylen(OMX_INDEXTYPE index)
+{
+   int i;
+   for (i=0; i<sizeof(vcil_out_cached_params)/sizeof(vcil_out_cached_params[0]); i++)
+      if (vcil_out_cached_params[i].index == index)
+         return vcil_out_cached_params[i].keylen;
+   return 0;
+}
+
+// Drop all cached parameters for a component, and stop any query already
+// in flight from storing its (possibly stale) result.
+static void vcil_out_param_invalidate(ILCS_COMMON_T *st, VC_PRIVATE_COMPONENT_T *comp)
+{
+   OMX_U32 i;
+
+   vcos_semaphore_wait(&st->component_lock);
+   comp->paramGeneration++;
+   if (comp->params)
+      for (i=0; i<VC_PARAM_CACHE_SIZE; i++)
+         comp->params[i].size = 0;
+   vcos_semaphore_post(&st->component_lock);
+}
+
+// Returns 1 and fills in param if a matching result is cached, otherwise
+// returns 0 and the generation to pass to vcil_out_param_store.
+static int vcil_out_param_lookup(ILCS_COMMON_T *st, VC_PRIVATE_COMPONENT_T *comp,
+                                 OMX_INDEXTYPE index, OMX_U32 keylen, void *param, OMX_U32 size,
+                                 OMX_U32 *generation)
+{
+   int found = 0;
+   OMX_U32 i;
+
+   vcos_semaphore_wait(&st->component_lock);
+   if (comp->params)
+   {
+      for (i=0; i<VC_PARAM_CACHE_SIZE; i++)
+      {
+         VC_PARAM_CACHE_ENTRY_T *entry = &comp->params[i];
+         if (entry->size == size && entry->index == index &&
+             memcmp(entry->param + 8, (unsigned char *) param + 8, keylen - 8) == 0)
+         {
+            memcpy(param, entry->param, size);
+            found = 1;
+            break;
+         }
+      }
+   }
+   *generation = comp->paramGeneration;
+   vcos_semaphore_post(&st->component_lock);
+
+   return found;
+}
+
+static void vcil_out_param_store(ILCS_COMMON_T *st, VC_PRIVATE_COMPONENT_T *comp,
+                                 OMX_INDEXTYPE index, const void *param, OMX_U32 size,
+                                 OMX_U32 generation)
+{
+   vcos_semaphore_wait(&st->component_lock);
+   if (generation == comp->paramGeneration)
+   {
+      if (!comp->params)
+      {
+         comp->params = vcos_malloc(sizeof(VC_PARAM_CACHE_ENTRY_T) * VC_PARAM_CACHE_SIZE, "ILCS param cache");
+         if (comp->params)
+            memset(comp->params, 0, sizeof(VC_PARAM_CACHE_ENTRY_T) * VC_PARAM_CACHE_SIZE);
+      }
+
+      if (comp->params)
+      {
+         VC_PARAM_CACHE_ENTRY_T *entry = &comp->params[comp->paramNext++ % VC_PARAM_CACHE_SIZE];
+         entry->index = index;
+         entry->size = size;
+         memcpy(entry->param, param, size);
+      }
+   }
+   vcos_semaphore_post(&st->component_lock);
+}
+
+void vcil_out_set_param_cache(ILCS_COMMON_T *st, int enable)
+{
+   VC_PRIVATE_COMPONENT_T *comp;
+
+   st->paramCache = enable;
+
+   vcos_semaphore_wait(&st->component_lock);
+   for (comp = st->component_list; comp; comp = comp->next)
+   {
+      comp->paramGeneration++;
+      if (comp->params)
+      {
+         vcos_free(comp->params);
+         comp->params = NULL;
+      }
+   }
+   vcos_semaphore_post(&st->component_lock);
+}
+
 static OMX_ERRORTYPE vcil_out_get(OMX_IN  OMX_HANDLETYPE hComponent,
                                   OMX_IN  OMX_INDEXTYPE nParamIndex,
                                   OMX_INOUT OMX_PTR pComponentParameterStructure,
@@ -216,7 +484,7 @@ static OMX_ERRORTYPE vcil_out_get(OMX_IN  OMX_HANDLETYPE hComponent,
    VC_PRIVATE_COMPONENT_T *comp;
    IL_GET_EXECUTE_T exe;
    IL_GET_RESPONSE_T resp;
-   OMX_U32 size;
+   OMX_U32 size, keylen = 0, generation = 0;
    ILCS_COMMON_T *st;
    int rlen = sizeof(resp);
 
@@ -234,6 +502,15 @@ static OMX_ERRORTYPE vcil_out_get(OMX_IN  OMX_HANDLETYPE hComponent,
    if(size > VC_ILCS_MAX_PARAM_SIZE)
       return OMX_ErrorHardware;
 
+   if (func == IL_GET_PARAMETER && st->paramCache)
+   {
+      keylen = vcil_out_param_keylen(nParamIndex);
+      if (keylen > size)
+         keylen = 0;
+      if (keylen && vcil_out_param_lookup(st, comp, nParamIndex, keylen, pComponentParameterStructure, size, &generation))
+         return OMX_ErrorNone;
+   }
+
    memcpy(exe.param, pComponentParameterStructure, size);
 
    if(ilcs_execute_function(st->ilcs, func, &exe, size + IL_GET_EXECUTE_HEADER_SIZE, &resp, &rlen) < 0 || rlen > sizeof(resp))
@@ -241,6 +518,9 @@ static OMX_ERRORTYPE vcil_out_get(OMX_IN  OMX_HANDLETYPE hComponent,
 
    memcpy(pComponentParameterStructure, resp.param, size);
 
+   if (keylen && resp.err == OMX_ErrorNone)
+      vcil_out_param_store(st, comp, nParamIndex, resp.param, size, generation);
+
    return resp.err;
 }
 
@@ -274,7 +554,10 @@ static OMX_ERRORTYPE vcil_out_set(OMX_IN  OMX_HANDLETYPE hComponent,
    memcpy(exe.param, pComponentParameterStructure, size);
 
    if(ilcs_execute_function(st->ilcs, func, &exe, size + IL_SET_EXECUTE_HEADER_SIZE, &resp, &rlen) < 0 || rlen != sizeof(resp))
-      return OMX_ErrorHardware;
+      resp.err = OMX_ErrorHardware;
+
+   // a set can change other parameters too, so drop them all
+   vcil_out_param_invalidate(st, comp);
 
    return resp.err;
 }
@@ -340,36 +623,39 @@ static OMX_ERRORTYPE vcil_out_SendCommand(OMX_IN  OMX_HANDLETYPE hComponent,
    }
 
    if(ilcs_execute_function(st->ilcs, IL_SEND_COMMAND, &exe, sizeof(exe), &resp, &rlen) < 0 || rlen != sizeof(resp))
-      return OMX_ErrorHardware;
+      resp.err = OMX_ErrorHardware;
+
+   vcil_out_param_invalidate(st, comp);
 
    return resp.err;
 }
 
 // Called to pass a buffer from the host-side across the interface to videcore.
 
-static OMX_ERRORTYPE vcil_out_addBuffer(OMX_IN OMX_HANDLETYPE hComponent,
-                                        OMX_INOUT OMX_BUFFERHEADERTYPE** ppBufferHdr,
-                                        OMX_IN OMX_U32 nPortIndex,
-                                        OMX_IN OMX_PTR pAppPrivate,
-                                        OMX_IN OMX_U32 nSizeBytes,
-                                        OMX_IN OMX_U8* pBuffer,
-                                        OMX_IN void *eglImage,
-                                        IL_FUNCTION_T func)
-{
-   OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *) hComponent;
-   VC_PRIVATE_COMPONENT_T *comp;
+// A buffer being added to a port, between sending the request to
+// VideoCore and dealing with the response.
+typedef struct {
    IL_ADD_BUFFER_EXECUTE_T exe;
    IL_ADD_BUFFER_RESPONSE_T resp;
+   VC_PRIVATE_PORT_T *port;
    OMX_BUFFERHEADERTYPE *pHeader;
+   OMX_U8 *pBuffer;
+   OMX_PTR pAppPrivate;
+   void *eglImage;
+   IL_FUNCTION_T func;
+} VCIL_OUT_ADD_BUFFER_T;
+
+static OMX_ERRORTYPE vcil_out_prepare_buffer(VC_PRIVATE_COMPONENT_T *comp,
+                                             OMX_IN OMX_U32 nPortIndex,
+                                             OMX_IN OMX_PTR pAppPrivate,
+                                             OMX_IN OMX_U32 nSizeBytes,
+                                             OMX_IN OMX_U8* pBuffer,
+                                             OMX_IN void *eglImage,
+                                             IL_FUNCTION_T func,
+                                             VCIL_OUT_ADD_BUFFER_T *add)
+{
    VC_PRIVATE_PORT_T *port;
-   ILCS_COMMON_T *st;
-   int rlen = sizeof(resp);
-
-   if (!(pComp && ppBufferHdr))
-      return OMX_ErrorBadParameter;
-
-   st = pComp->pApplicationPrivate;
-   comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+   OMX_BUFFERHEADERTYPE *pHeader;
 
    port = find_port(comp, nPortIndex);
    if (!port) // bad port index
@@ -392,8 +678,12 @@ static OMX_ERRORTYPE vcil_out_addBuffer(OMX_IN OMX_HANDLETYPE hComponent,
 
    pHeader = vcos_malloc(sizeof(*pHeader), "vcout buffer header");
 
-   if (!pHeader)
+   if (!pHeader || !reserve_buffer(port))
+   {
+      if (pHeader)
+         vcos_free(pHeader);
       return OMX_ErrorInsufficientResources;
+   }
 
    if (func == IL_ALLOCATE_BUFFER)
    {
@@ -405,46 +695,102 @@ static OMX_ERRORTYPE vcil_out_addBuffer(OMX_IN OMX_HANDLETYPE hComponent,
       }
    }
 
-   exe.reference = comp->reference;
-   exe.bufferReference = pHeader;
-   exe.port = nPortIndex;
-   exe.size = nSizeBytes;
-   exe.eglImage = eglImage;
+   // count the buffer now, so that the space reserved above holds
+   // for further buffers prepared before this one completes
+   port->numBuffers++;
+
+   add->exe.reference = comp->reference;
+   add->exe.bufferReference = pHeader;
+   add->exe.port = nPortIndex;
+   add->exe.size = nSizeBytes;
+   add->exe.eglImage = eglImage;
+
+   add->port = port;
+   add->pHeader = pHeader;
+   add->pBuffer = pBuffer;
+   add->pAppPrivate = pAppPrivate;
+   add->eglImage = eglImage;
+   add->func = func;
+   return OMX_ErrorNone;
+}
 
-   if(ilcs_execute_function(st->ilcs, func, &exe, sizeof(exe), &resp, &rlen) < 0 || rlen != sizeof(resp))
-      resp.err = OMX_ErrorHardware;
+static OMX_ERRORTYPE vcil_out_finish_buffer(ILCS_COMMON_T *st, VC_PRIVATE_COMPONENT_T *comp,
+                                            VCIL_OUT_ADD_BUFFER_T *add, int status, int rlen,
+                                            OMX_BUFFERHEADERTYPE **ppBufferHdr)
+{
+   VC_PRIVATE_PORT_T *port = add->port;
+   OMX_BUFFERHEADERTYPE *pHeader = add->pHeader;
 
-   if (resp.err == OMX_ErrorNone)
+   if (status < 0 || rlen != sizeof(add->resp))
+      add->resp.err = OMX_ErrorHardware;
+
+   // the port definition reports whether the port is populated
+   vcil_out_param_invalidate(st, comp);
+
+   if (add->resp.err == OMX_ErrorNone)
    {
-      memcpy(pHeader, &resp.bufferHeader, sizeof(OMX_BUFFERHEADERTYPE));
+      memcpy(pHeader, &add->resp.bufferHeader, sizeof(OMX_BUFFERHEADERTYPE));
       if (port->dir == OMX_DirOutput)
-         pHeader->pOutputPortPrivate = resp.reference;
+         pHeader->pOutputPortPrivate = add->resp.reference;
       else
-         pHeader->pInputPortPrivate = resp.reference;
+         pHeader->pInputPortPrivate = add->resp.reference;
 
-      if (func == IL_USE_EGL_IMAGE)
+      if (add->func == IL_USE_EGL_IMAGE)
       {
-         pHeader->pBuffer = (OMX_U8*)eglImage;
+         pHeader->pBuffer = (OMX_U8*)add->eglImage;
          port->bEGL = OMX_TRUE;
       }         
       else
       {
-         pHeader->pBuffer = pBuffer;
+         pHeader->pBuffer = add->pBuffer;
          port->bEGL = OMX_FALSE;
       }
 
-      pHeader->pAppPrivate = pAppPrivate;
+      pHeader->pAppPrivate = add->pAppPrivate;
       *ppBufferHdr = pHeader;
-      port->numBuffers++;
+      insert_buffer(port, pHeader);
    }
    else
    {
-      if (func == IL_ALLOCATE_BUFFER)
-         vcos_free(pBuffer);
+      if (add->func == IL_ALLOCATE_BUFFER)
+         vcos_free(add->pBuffer);
       vcos_free(pHeader);
+      port->numBuffers--;
    }
 
-   return resp.err;
+   return add->resp.err;
+}
+
+static OMX_ERRORTYPE vcil_out_addBuffer(OMX_IN OMX_HANDLETYPE hComponent,
+                                        OMX_INOUT OMX_BUFFERHEADERTYPE** ppBufferHdr,
+                                        OMX_IN OMX_U32 nPortIndex,
+                                        OMX_IN OMX_PTR pAppPrivate,
+                                        OMX_IN OMX_U32 nSizeBytes,
+                                        OMX_IN OMX_U8* pBuffer,
+                                        OMX_IN void *eglImage,
+                                        IL_FUNCTION_T func)
+{
+   OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *) hComponent;
+   VC_PRIVATE_COMPONENT_T *comp;
+   VCIL_OUT_ADD_BUFFER_T add;
+   OMX_ERRORTYPE err;
+   ILCS_COMMON_T *st;
+   int rlen = sizeof(add.resp);
+   int status;
+
+   if (!(pComp && ppBufferHdr))
+      return OMX_ErrorBadParameter;
+
+   st = pComp->pApplicationPrivate;
+   comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+
+   err = vcil_out_prepare_buffer(comp, nPortIndex, pAppPrivate, nSizeBytes, pBuffer, eglImage, func, &add);
+   if (err != OMX_ErrorNone)
+      return err;
+
+   status = ilcs_execute_function(st->ilcs, func, &add.exe, sizeof(add.exe), &add.resp, &rlen);
+
+   return vcil_out_finish_buffer(st, comp, &add, status, rlen, ppBufferHdr);
 }
 
 static OMX_ERRORTYPE vcil_out_UseEGLImage(OMX_IN OMX_HANDLETYPE hComponent,
@@ -486,6 +832,7 @@ static OMX_ERRORTYPE vcil_out_FreeBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
    VC_PRIVATE_PORT_T *port;
    ILCS_COMMON_T *st;
    int rlen = sizeof(resp);
+   int slot;
 
    if (!(pComp && pBufferHdr))
       return OMX_ErrorBadParameter;
@@ -500,6 +847,10 @@ static OMX_ERRORTYPE vcil_out_FreeBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
    if (port->numBuffers == 0)
       return OMX_ErrorIncorrectStateTransition;
 
+   slot = find_buffer(port, pBufferHdr);
+   if (slot < 0)
+      return OMX_ErrorBadParameter;
+
    exe.reference = comp->reference;
    exe.port = nPortIndex;
    if (port->dir == OMX_DirOutput)
@@ -511,13 +862,16 @@ static OMX_ERRORTYPE vcil_out_FreeBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
    exe.outputPrivate = NULL;
 
    if(ilcs_execute_function(st->ilcs, IL_FREE_BUFFER, &exe, sizeof(exe), &resp, &rlen) < 0 || rlen != sizeof(resp))
-      return OMX_ErrorHardware;
+      resp.err = OMX_ErrorHardware;
+
+   vcil_out_param_invalidate(st, comp);
 
    if (resp.err == OMX_ErrorNone)
    {
       if (port->func == IL_ALLOCATE_BUFFER)
          vcos_free(pBufferHdr->pBuffer);
       vcos_free(pBufferHdr);
+      remove_buffer(port, slot);
       port->numBuffers--;
    }
 
@@ -563,6 +917,9 @@ static OMX_ERRORTYPE vcil_out_FillThisBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
    if(!port)
       return OMX_ErrorBadPortIndex;
 
+   if(find_buffer(port, pBuffer) < 0)
+      return OMX_ErrorBadParameter;
+
    if(pBuffer->pBuffer == 0)
       return OMX_ErrorIncorrectStateOperation;
 
@@ -588,6 +945,252 @@ static OMX_ERRORTYPE vcil_out_FillThisBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
    return err;
 }
 
+// Called on the host side to pass a number of buffers to VideoCore with
+// the same function, without waiting for each one to be accepted before
+// sending the next.  Components that are not VideoCore proxies just get
+// the buffers one at a time.
+#define VCIL_OUT_MAX_BATCH 16
+
+OMX_ERRORTYPE vcil_out_pass_buffers(OMX_HANDLETYPE hComponent, IL_FUNCTION_T func,
+                                    OMX_BUFFERHEADERTYPE **ppBuffers, OMX_U32 nCount, OMX_ERRORTYPE *pErrors)
+{
+   OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *) hComponent;
+   OMX_BUFFERHEADERTYPE *batch[VCIL_OUT_MAX_BATCH];
+   OMX_ERRORTYPE batch_err[VCIL_OUT_MAX_BATCH];
+   OMX_U32 batch_index[VCIL_OUT_MAX_BATCH];
+   OMX_ERRORTYPE err = OMX_ErrorNone;
+   VC_PRIVATE_COMPONENT_T *comp;
+   ILCS_COMMON_T *st;
+   OMX_U32 i, j, n;
+
+   if (!(pComp && ppBuffers && pErrors))
+      return OMX_ErrorBadParameter;
+
+   if(pComp->EmptyThisBuffer != vcil_out_EmptyThisBuffer)
+   {
+      for(i=0; i<nCount; i++)
+      {
+         if(func == IL_EMPTY_THIS_BUFFER)
+            pErrors[i] = pComp->EmptyThisBuffer(hComponent, ppBuffers[i]);
+         else
+            pErrors[i] = pComp->FillThisBuffer(hComponent, ppBuffers[i]);
+
+         if(err == OMX_ErrorNone)
+            err = pErrors[i];
+      }
+      return err;
+   }
+
+   st = pComp->pApplicationPrivate;
+   comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+
+   for(i=0; i<nCount; )
+   {
+      // apply the same checks as the single buffer calls, and gather
+      // the buffers that pass into a batch
+      for(n=0; i<nCount && n<VCIL_OUT_MAX_BATCH; i++)
+      {
+         OMX_BUFFERHEADERTYPE *pBuffer = ppBuffers[i];
+
+         pErrors[i] = OMX_ErrorNone;
+         if(!pBuffer)
+            pErrors[i] = OMX_ErrorBadParameter;
+         else if(func == IL_FILL_THIS_BUFFER)
+         {
+            VC_PRIVATE_PORT_T *port = find_port(comp, pBuffer->nOutputPortIndex);
+
+            if(!port)
+               pErrors[i] = OMX_ErrorBadPortIndex;
+            else if(find_buffer(port, pBuffer) < 0)
+               pErrors[i] = OMX_ErrorBadParameter;
+            else if(pBuffer->pBuffer == 0)
+               pErrors[i] = OMX_ErrorIncorrectStateOperation;
+            else
+            {
+               // see vcil_out_FillThisBuffer
+               pBuffer->nFilledLen = 0;
+               pBuffer->nFlags = 0;
+               vc_assert(port->bEGL == OMX_TRUE || is_valid_hostside_buffer(pBuffer));
+            }
+         }
+
+         if(pErrors[i] == OMX_ErrorNone)
+         {
+            batch_index[n] = i;
+            batch[n++] = pBuffer;
+         }
+      }
+
+      if(n == 0)
+         continue;
+
+      ilcs_pass_buffers(st->ilcs, func, comp->reference, batch, n, batch_err);
+
+      for(j=0; j<n; j++)
+      {
+         OMX_BUFFERHEADERTYPE *pBuffer = batch[j];
+
+         pErrors[batch_index[j]] = batch_err[j];
+
+         if(func == IL_FILL_THIS_BUFFER && batch_err[j] == OMX_ErrorNone)
+         {
+            VC_PRIVATE_PORT_T *port = find_port(comp, pBuffer->nOutputPortIndex);
+            if(port->bEGL == OMX_TRUE)
+               eglIntOpenMAXILDoneMarker(comp->reference, (EGLImageKHR)pBuffer->pBuffer);
+         }
+      }
+   }
+
+   for(i=0; i<nCount; i++)
+      if(pErrors[i] != OMX_ErrorNone)
+         return pErrors[i];
+
+   return OMX_ErrorNone;
+}
+
+// Called on the host side to send a group of port enables, a state change
+// and buffer registrations to a component in one go.  VideoCore has no
+// single message for this, so the individual calls are pipelined rather
+// than each waiting for its response before the next is sent.
+OMX_ERRORTYPE vcil_out_transaction(OMX_HANDLETYPE hComponent, OMX_TRANSACTIONTYPE *pTransaction)
+{
+   OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *) hComponent;
+   VC_PRIVATE_COMPONENT_T *comp;
+   ILCS_COMMON_T *st;
+   IL_SEND_COMMAND_EXECUTE_T *cmd;
+   IL_RESPONSE_HEADER_T *cmd_resp;
+   VCIL_OUT_ADD_BUFFER_T *add;
+   ILCS_CALL_T *calls;
+   OMX_U32 nCmds, i, n = 0;
+   OMX_ERRORTYPE err = OMX_ErrorNone;
+   unsigned char *mem;
+
+   if (!(pComp && pTransaction) ||
+       (pTransaction->nEnablePorts && !pTransaction->pEnablePorts) ||
+       (pTransaction->nBuffers && !pTransaction->pBuffers))
+      return OMX_ErrorBadParameter;
+
+   if (pComp->SendCommand != vcil_out_SendCommand)
+   {
+      // not a VideoCore component, so just make the calls one at a time
+      for (i=0; i<pTransaction->nEnablePorts; i++)
+      {
+         OMX_ERRORTYPE e = pComp->SendCommand(hComponent, OMX_CommandPortEnable, pTransaction->pEnablePorts[i], NULL);
+         if (err == OMX_ErrorNone)
+            err = e;
+      }
+      if (pTransaction->bSetState)
+      {
+         OMX_ERRORTYPE e = pComp->SendCommand(hComponent, OMX_CommandStateSet, pTransaction->eState, NULL);
+         if (err == OMX_ErrorNone)
+            err = e;
+      }
+      for (i=0; i<pTransaction->nBuffers; i++)
+      {
+         OMX_TRANSACTION_BUFFERTYPE *buf = &pTransaction->pBuffers[i];
+
+         buf->pBufferHdr = NULL;
+         if (buf->pBuffer)
+            buf->eError = pComp->UseBuffer(hComponent, &buf->pBufferHdr, buf->nPortIndex, buf->pAppPrivate,
+                                           buf->nSizeBytes, buf->pBuffer);
+         else
+            buf->eError = pComp->AllocateBuffer(hComponent, &buf->pBufferHdr, buf->nPortIndex, buf->pAppPrivate,
+                                                buf->nSizeBytes);
+         if (err == OMX_ErrorNone)
+            err = buf->eError;
+      }
+      return err;
+   }
+
+   st = pComp->pApplicationPrivate;
+   comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+
+   nCmds = pTransaction->nEnablePorts + (pTransaction->bSetState ? 1 : 0);
+   if (nCmds + pTransaction->nBuffers == 0)
+      return OMX_ErrorNone;
+
+   mem = vcos_malloc(nCmds * (sizeof(*cmd) + sizeof(*cmd_resp)) +
+                     pTransaction->nBuffers * sizeof(*add) +
+                     (nCmds + pTransaction->nBuffers) * sizeof(*calls), "vcout transaction");
+   if (!mem)
+      return OMX_ErrorInsufficientResources;
+
+   calls = (ILCS_CALL_T *) mem;
+   add = (VCIL_OUT_ADD_BUFFER_T *) (calls + nCmds + pTransaction->nBuffers);
+   cmd = (IL_SEND_COMMAND_EXECUTE_T *) (add + pTransaction->nBuffers);
+   cmd_resp = (IL_RESPONSE_HEADER_T *) (cmd + nCmds);
+
+   for (i=0; i<nCmds; i++)
+   {
+      cmd[i].reference = comp->reference;
+      if (i < pTransaction->nEnablePorts)
+      {
+         cmd[i].cmd = OMX_CommandPortEnable;
+         cmd[i].param = pTransaction->pEnablePorts[i];
+      }
+      else
+      {
+         cmd[i].cmd = OMX_CommandStateSet;
+         cmd[i].param = pTransaction->eState;
+      }
+      cmd[i].mark.hMarkTargetComponent = 0;
+      cmd[i].mark.pMarkData = 0;
+
+      calls[n].func = IL_SEND_COMMAND;
+      calls[n].data = &cmd[i];
+      calls[n].len = sizeof(cmd[i]);
+      calls[n].resp = &cmd_resp[i];
+      calls[n].rlen = sizeof(cmd_resp[i]);
+      n++;
+   }
+
+   for (i=0; i<pTransaction->nBuffers; i++)
+   {
+      OMX_TRANSACTION_BUFFERTYPE *buf = &pTransaction->pBuffers[i];
+
+      buf->pBufferHdr = NULL;
+      buf->eError = vcil_out_prepare_buffer(comp, buf->nPortIndex, buf->pAppPrivate, buf->nSizeBytes,
+                                            buf->pBuffer, NULL,
+                                            buf->pBuffer ? IL_USE_BUFFER : IL_ALLOCATE_BUFFER, &add[i]);
+      if (buf->eError != OMX_ErrorNone)
+         continue;
+
+      calls[n].func = add[i].func;
+      calls[n].data = &add[i].exe;
+      calls[n].len = sizeof(add[i].exe);
+      calls[n].resp = &add[i].resp;
+      calls[n].rlen = sizeof(add[i].resp);
+      n++;
+   }
+
+   ilcs_execute_functions(st->ilcs, calls, n);
+
+   for (i=0; i<nCmds; i++)
+   {
+      if (calls[i].status < 0 || calls[i].rlen != sizeof(cmd_resp[i]))
+         cmd_resp[i].err = OMX_ErrorHardware;
+      if (err == OMX_ErrorNone)
+         err = cmd_resp[i].err;
+   }
+
+   for (i=0, n=nCmds; i<pTransaction->nBuffers; i++)
+   {
+      OMX_TRANSACTION_BUFFERTYPE *buf = &pTransaction->pBuffers[i];
+
+      if (buf->eError == OMX_ErrorNone)
+      {
+         buf->eError = vcil_out_finish_buffer(st, comp, &add[i], calls[n].status, calls[n].rlen, &buf->pBufferHdr);
+         n++;
+      }
+      if (err == OMX_ErrorNone)
+         err = buf->eError;
+   }
+
+   vcil_out_param_invalidate(st, comp);
+   vcos_free(mem);
+   return err;
+}
+
 static OMX_ERRORTYPE vcil_out_ComponentTunnelRequest(OMX_IN  OMX_HANDLETYPE hComponent,
       OMX_IN  OMX_U32 nPort,
       OMX_IN  OMX_HANDLETYPE hTunneledComp,
@@ -636,7 +1239,15 @@ static OMX_ERRORTYPE vcil_out_ComponentTunnelRequest(OMX_IN  OMX_HANDLETYPE hCom
    }
 
    if(ilcs_execute_function(st->ilcs, IL_COMPONENT_TUNNEL_REQUEST, &exe, sizeof(exe), &resp, &rlen) < 0 || rlen != sizeof(resp))
-      return OMX_ErrorHardware;
+      resp.err = OMX_ErrorHardware;
+
+   // tunnelling negotiates port settings on both ends
+   vcil_out_param_invalidate(st, comp);
+   if (list != NULL)
+      vcil_out_param_invalidate(st, list);
+
+   if (resp.err == OMX_ErrorHardware)
+      return resp.err;
 
    if (pTunnelSetup)
       *pTunnelSetup = resp.setup;
@@ -671,15 +1282,11 @@ static OMX_ERRORTYPE vcil_out_GetExtensionIndex(OMX_IN  OMX_HANDLETYPE hComponen
    return resp.err;
 }
 
-static OMX_ERRORTYPE vcil_out_ComponentRoleEnum(OMX_IN OMX_HANDLETYPE hComponent,
-      OMX_OUT OMX_U8 *cRole,
-      OMX_IN OMX_U32 nIndex)
+static OMX_ERRORTYPE vcil_out_role_enum_remote(ILCS_COMMON_T *st, VC_PRIVATE_COMPONENT_T *comp,
+      char *role, OMX_U32 nIndex)
 {
-   OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *) hComponent;
-   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
    IL_COMPONENT_ROLE_ENUM_EXECUTE_T exe;
    IL_COMPONENT_ROLE_ENUM_RESPONSE_T resp;
-   ILCS_COMMON_T *st = pComp->pApplicationPrivate;
    int rlen = sizeof(resp);
 
    exe.reference = comp->reference;
@@ -688,12 +1295,82 @@ static OMX_ERRORTYPE vcil_out_ComponentRoleEnum(OMX_IN OMX_HANDLETYPE hComponent
    if(ilcs_execute_function(st->ilcs, IL_COMPONENT_ROLE_ENUM, &exe, sizeof(exe), &resp, &rlen) < 0 || rlen != sizeof(resp))
       return OMX_ErrorHardware;
 
-   strncpy((char *) cRole, (char *) resp.role, 128);
-   cRole[127] = 0;
+   strncpy(role, (char *) resp.role, 128);
+   role[127] = 0;
    return resp.err;
 }
 
-OMX_ERRORTYPE vcil_out_component_name_enum(ILCS_COMMON_T *st, OMX_STRING cComponentName, OMX_U32 nNameLength, OMX_U32 nIndex)
+#define VC_ROLE_CACHE_MAX 16
+
+// Enumerate all the roles of a component into its info entry.
+// Called with info_lock held.
+static void vcil_out_fetch_roles(ILCS_COMMON_T *st, VC_PRIVATE_COMPONENT_T *comp)
+{
+   VC_COMPONENT_INFO_T *info = comp->info;
+   char (*roles)[128];
+   OMX_ERRORTYPE err = OMX_ErrorNone;
+   int count = 0;
+
+   roles = vcos_malloc(VC_ROLE_CACHE_MAX * 128, "ILCS role cache");
+   if(!roles)
+      return;
+
+   while(count < VC_ROLE_CACHE_MAX &&
+         (err = vcil_out_role_enum_remote(st, comp, roles[count], count)) == OMX_ErrorNone)
+      count++;
+
+   if(err != OMX_ErrorNoMore)
+   {
+      // transport failure, or more roles than we keep: don't cache
+      vcos_free(roles);
+      return;
+   }
+
+   info->roles = roles;
+   info->numRoles = count;
+}
+
+static OMX_ERRORTYPE vcil_out_ComponentRoleEnum(OMX_IN OMX_HANDLETYPE hComponent,
+      OMX_OUT OMX_U8 *cRole,
+      OMX_IN OMX_U32 nIndex)
+{
+   OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *) hComponent;
+   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+   ILCS_COMMON_T *st = pComp->pApplicationPrivate;
+
+   if(comp->info)
+   {
+      VC_COMPONENT_INFO_T *info = comp->info;
+      OMX_ERRORTYPE err = OMX_ErrorNone;
+      int cached;
+
+      // the roles of a component don't change, so serve them locally
+      // once the first enumeration has fetched them all
+      vcos_semaphore_wait(&st->info_lock);
+      if(info->numRoles < 0)
+         vcil_out_fetch_roles(st, comp);
+
+      cached = info->numRoles >= 0;
+      if(cached)
+      {
+         if(nIndex >= (OMX_U32) info->numRoles)
+            err = OMX_ErrorNoMore;
+         else
+         {
+            strncpy((char *) cRole, info->roles[nIndex], 128);
+            cRole[127] = 0;
+         }
+      }
+      vcos_semaphore_post(&st->info_lock);
+
+      if(cached)
+         return err;
+   }
+
+   return vcil_out_role_enum_remote(st, comp, (char *) cRole, nIndex);
+}
+
+static OMX_ERRORTYPE vcil_out_name_enum_remote(ILCS_COMMON_T *st, char *name, OMX_U32 nIndex)
 {
    IL_COMPONENT_NAME_ENUM_EXECUTE_T exe;
    IL_COMPONENT_NAME_ENUM_RESPONSE_T resp;
@@ -704,14 +1381,124 @@ OMX_ERRORTYPE vcil_out_component_name_enum(ILCS_COMMON_T *st, OMX_STRING cCompon
    if(ilcs_execute_function(st->ilcs, IL_COMPONENT_NAME_ENUM, &exe, sizeof(exe), &resp, &rlen) < 0 || rlen != sizeof(resp))
       return OMX_ErrorHardware;
 
-   if (sizeof(resp.name) < nNameLength)
-      nNameLength = sizeof(resp.name);
-
-   strncpy((char *)cComponentName, (char *) resp.name, nNameLength);
-   cComponentName[127] = 0;
+   strncpy(name, (char *) resp.name, 128);
+   name[127] = 0;
    return resp.err;
 }
 
+#define VC_NAME_CACHE_MAX 256
+
+// Enumerate every component name on VideoCore into st->names.
+// Called with info_lock held.
+static void vcil_out_fetch_names(ILCS_COMMON_T *st)
+{
+   char (*names)[128] = NULL;
+   OMX_ERRORTYPE err = OMX_ErrorNone;
+   OMX_U32 count = 0, size = 0;
+
+   while(err == OMX_ErrorNone)
+   {
+      if(count == size)
+      {
+         char (*grown)[128];
+
+         if(size == VC_NAME_CACHE_MAX)
+            break;
+
+         size = size ? size*2 : 32;
+         grown = vcos_malloc(size * 128, "ILCS name cache");
+         if(!grown)
+            break;
+         if(names)
+         {
+            memcpy(grown, names, count * 128);
+            vcos_free(names);
+         }
+         names = grown;
+      }
+
+      err = vcil_out_name_enum_remote(st, names[count], count);
+      if(err == OMX_ErrorNone)
+         count++;
+   }
+
+   if(err != OMX_ErrorNoMore)
+   {
+      // incomplete list; callers go to VideoCore for each index
+      if(names)
+         vcos_free(names);
+      return;
+   }
+
+   st->names = names;
+   st->numNames = count;
+   st->namesComplete = 1;
+}
+
+OMX_ERRORTYPE vcil_out_component_name_enum(ILCS_COMMON_T *st, OMX_STRING cComponentName, OMX_U32 nNameLength, OMX_U32 nIndex)
+{
+   OMX_ERRORTYPE err = OMX_ErrorNone;
+   char name[128];
+   int cached;
+
+   // the component list is fixed for the lifetime of the firmware, so
+   // the first enumeration fetches it all and later ones are local
+   vcos_semaphore_wait(&st->info_lock);
+   if(!st->namesComplete)
+      vcil_out_fetch_names(st);
+
+   cached = st->namesComplete;
+   if(cached)
+   {
+      if(nIndex >= st->numNames)
+         err = OMX_ErrorNoMore;
+      else
+         memcpy(name, st->names[nIndex], sizeof(name));
+   }
+   vcos_semaphore_post(&st->info_lock);
+
+   if(!cached)
+      err = vcil_out_name_enum_remote(st, name, nIndex);
+
+   if(err != OMX_ErrorNone)
+      return err;
+
+   if (sizeof(name) < nNameLength)
+      nNameLength = sizeof(name);
+
+   if(nNameLength)
+   {
+      strncpy((char *)cComponentName, name, nNameLength);
+      cComponentName[nNameLength-1] = 0;
+   }
+   return OMX_ErrorNone;
+}
+
+// Find or add the info entry for a component name.
+// Called with info_lock held.
+static VC_COMPONENT_INFO_T *vcil_out_get_info(ILCS_COMMON_T *st, const char *name)
+{
+   VC_COMPONENT_INFO_T *info;
+
+   if(strlen(name) >= sizeof(info->name))
+      return NULL;
+
+   for(info = st->info_list; info; info = info->next)
+      if(strcmp(info->name, name) == 0)
+         return info;
+
+   info = vcos_malloc(sizeof(VC_COMPONENT_INFO_T), "ILCS component info");
+   if(!info)
+      return NULL;
+
+   memset(info, 0, sizeof(VC_COMPONENT_INFO_T));
+   strcpy(info->name, name);
+   info->numRoles = -1;
+   info->next = st->info_list;
+   st->info_list = info;
+   return info;
+}
+
 OMX_ERRORTYPE vcil_out_get_debug_information(ILCS_COMMON_T *st, OMX_STRING debugInfo, OMX_S32 *pLen)
 {
    IL_GET_DEBUG_INFORMATION_EXECUTE_T exe;
@@ -733,6 +1520,7 @@ OMX_ERRORTYPE vcil_out_create_component(ILCS_COMMON_T *st, OMX_HANDLETYPE hCompo
    VC_PRIVATE_COMPONENT_T *comp;
    OMX_U32 i;
    int rlen = sizeof(resp);
+   int cached = 0;
 
    if (strlen(component_name) >= sizeof(exe.name))
       return OMX_ErrorInvalidComponent;
@@ -766,7 +1554,22 @@ OMX_ERRORTYPE vcil_out_create_component(ILCS_COMMON_T *st, OMX_HANDLETYPE hCompo
    comp->numPorts = resp.numPorts;
    comp->port = (VC_PRIVATE_PORT_T *) ((unsigned char *) comp + sizeof(VC_PRIVATE_COMPONENT_T));
 
-   for (i=0; i<comp->numPorts; i++)
+   // components with more than 32 ports need a port summary query for each
+   // further 32, so reuse the layout seen by an earlier creation if we can
+   vcos_semaphore_wait(&st->info_lock);
+   comp->info = vcil_out_get_info(st, component_name);
+   if(comp->info && comp->info->port && comp->info->numPorts == comp->numPorts)
+   {
+      for (i=0; i<comp->numPorts; i++)
+      {
+         comp->port[i].port = comp->info->port[i].port;
+         comp->port[i].dir = comp->info->port[i].dir;
+      }
+      cached = 1;
+   }
+   vcos_semaphore_post(&st->info_lock);
+
+   for (i=0; !cached && i<comp->numPorts; i++)
    {
       if (i && !(i&0x1f))
       {
@@ -796,6 +1599,25 @@ OMX_ERRORTYPE vcil_out_create_component(ILCS_COMMON_T *st, OMX_HANDLETYPE hCompo
       comp->port[i].dir = ((resp.portDir >> (i&0x1f)) & 1) ? OMX_DirOutput : OMX_DirInput;
    }
 
+   if (!cached && comp->info && comp->numPorts)
+   {
+      VC_PRIVATE_PORT_T *layout = vcos_malloc(sizeof(VC_PRIVATE_PORT_T) * comp->numPorts, "ILCS port layout");
+
+      if (layout)
+      {
+         memcpy(layout, comp->port, sizeof(VC_PRIVATE_PORT_T) * comp->numPorts);
+
+         vcos_semaphore_wait(&st->info_lock);
+         if (comp->info->port)
+            vcos_free(comp->info->port);
+         comp->info->port = layout;
+         comp->info->numPorts = comp->numPorts;
+         vcos_semaphore_post(&st->info_lock);
+      }
+   }
+
+   build_port_map(comp);
+
    vcos_semaphore_wait(&st->component_lock);
    // insert into head of list
    comp->next = st->component_list;
@@ -829,24 +1651,66 @@ OMX_ERRORTYPE vcil_out_create_component(ILCS_COMMON_T *st, OMX_HANDLETYPE hCompo
 
 /* callbacks */
 
+// Client callbacks are made from an ilcs worker thread, so that a slow
+// callback doesn't hold up messages for other components.  The
+// component is the key, keeping its callbacks in order.
+typedef struct {
+   OMX_EVENTTYPE event;
+   OMX_U32 data1;
+   OMX_U32 data2;
+   OMX_PTR eventdata;
+} VCIL_OUT_EVENT_T;
+
+static void vcil_out_deliver_event(void *key, void *data)
+{
+   OMX_COMPONENTTYPE *pComp = key;
+   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+   VCIL_OUT_EVENT_T *event = data;
+
+   vcos_assert(comp->callbacks.EventHandler);
+   comp->callbacks.EventHandler(pComp, comp->callback_state, event->event, event->data1, event->data2, event->eventdata);
+}
+
+static void vcil_out_deliver_empty_buffer_done(void *key, void *data)
+{
+   OMX_COMPONENTTYPE *pComp = key;
+   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+
+   vcos_assert(comp->callbacks.EmptyBufferDone);
+   comp->callbacks.EmptyBufferDone(pComp, comp->callback_state, *(OMX_BUFFERHEADERTYPE **) data);
+}
+
+static void vcil_out_deliver_fill_buffer_done(void *key, void *data)
+{
+   OMX_COMPONENTTYPE *pComp = key;
+   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+
+   vc_assert(comp->callbacks.FillBufferDone);
+   comp->callbacks.FillBufferDone(pComp, comp->callback_state, *(OMX_BUFFERHEADERTYPE **) data);
+}
+
 void vcil_out_event_handler(ILCS_COMMON_T *st, void *call, int clen, void *resp, int *rlen)
 {
    IL_EVENT_HANDLER_EXECUTE_T *exe = call;
-   OMX_COMPONENTTYPE *pComp = exe->reference;
-   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
+   VCIL_OUT_EVENT_T event;
 
    *rlen = 0;
 
-   vcos_assert(comp->callbacks.EventHandler);
-   comp->callbacks.EventHandler(pComp, comp->callback_state, exe->event, exe->data1, exe->data2, exe->eventdata);
+   // port settings changes and command completions (state changes, port
+   // enable and disable) alter parameters behind our back
+   vcil_out_param_invalidate(st, (VC_PRIVATE_COMPONENT_T *) ((OMX_COMPONENTTYPE *) exe->reference)->pComponentPrivate);
+
+   event.event = exe->event;
+   event.data1 = exe->data1;
+   event.data2 = exe->data2;
+   event.eventdata = exe->eventdata;
+   ilcs_defer(st->ilcs, exe->reference, vcil_out_deliver_event, &event, sizeof(event));
 }
 
 // Called on host side via RPC in response to empty buffer completing
 void vcil_out_empty_buffer_done(ILCS_COMMON_T *st, void *call, int clen, void *resp, int *rlen)
 {
    IL_PASS_BUFFER_EXECUTE_T *exe = call;
-   OMX_COMPONENTTYPE *pComp = exe->reference;
-   VC_PRIVATE_COMPONENT_T *comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
    OMX_BUFFERHEADERTYPE *pHeader = exe->bufferHeader.pOutputPortPrivate;
    OMX_U8 *pBuffer = pHeader->pBuffer;
    OMX_PTR *pAppPrivate = pHeader->pAppPrivate;
@@ -864,8 +1728,7 @@ void vcil_out_empty_buffer_done(ILCS_COMMON_T *st, void *call, int clen, void *r
 
    *rlen = 0;
 
-   vcos_assert(comp->callbacks.EmptyBufferDone);
-   comp->callbacks.EmptyBufferDone(pComp, comp->callback_state, pHeader);
+   ilcs_defer(st->ilcs, exe->reference, vcil_out_deliver_empty_buffer_done, &pHeader, sizeof(pHeader));
 }
 
 // Called on host side via RPC in response to a fill-buffer completing
@@ -873,17 +1736,11 @@ void vcil_out_empty_buffer_done(ILCS_COMMON_T *st, void *call, int clen, void *r
 void vcil_out_fill_buffer_done(ILCS_COMMON_T *st, void *call, int clen, void *resp, int *rlen)
 {
    OMX_COMPONENTTYPE *pComp;
-   VC_PRIVATE_COMPONENT_T *comp;
    OMX_BUFFERHEADERTYPE *pHeader;
 
    pHeader = ilcs_receive_buffer(st->ilcs, call, clen, &pComp);
    *rlen = 0;
 
    if(pHeader)
-   {
-      comp = (VC_PRIVATE_COMPONENT_T *) pComp->pComponentPrivate;
-
-      vc_assert(comp->callbacks.FillBufferDone);
-      comp->callbacks.FillBufferDone(pComp, comp->callback_state, pHeader);
-   }
+      ilcs_defer(st->ilcs, pComp, vcil_out_deliver_fill_buffer_done, &pHeader, sizeof(pHeader));
 }